@@ -3,6 +3,8 @@ out vec4 FragColor;
 
 uniform vec3 color;
 
+in vec4 tint;
+
 void main() {
-    FragColor = vec4(color, 1.0);
+    FragColor = vec4(color, 1.0) * tint;
 }
\ No newline at end of file
@@ -1,12 +1,35 @@
 #version 460 core
+// packed vertices, see engine/render/vertex_format.hpp
 layout(location = 0) in vec3 aPos;
-layout(location = 1) in vec3 aNormal;
+layout(location = 1) in vec2 aNormal;
 layout(location = 2) in vec2 aTexCoords;
 
+// shared with every shader, see engine/render/uniform_blocks.hpp
+layout(std140) uniform FrameBlock {
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec3 viewPos;
+    float time;
+    float deltaTime;
+} frame;
+
+#ifdef INSTANCED
+// per instance attributes, see engine/render/instance_batch.hpp
+layout(location = 5) in mat4 aInstanceModel;
+layout(location = 9) in vec4 aInstanceTint;
+#else
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+#endif
+
+out vec4 tint;
 
 void main() {
-    gl_Position = projection * view * model * vec4(aPos, 1.0);
+#ifdef INSTANCED
+    mat4 model = aInstanceModel;
+    tint = aInstanceTint;
+#else
+    tint = vec4(1.0);
+#endif
+    gl_Position = frame.viewProjection * model * vec4(aPos, 1.0);
 }
\ No newline at end of file
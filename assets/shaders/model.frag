@@ -1,4 +1,7 @@
 #version 460 core
+#ifdef BINDLESS
+#extension GL_ARB_bindless_texture : require
+#endif
 
 in VS_OUT {
     mat3 TBN;
@@ -6,8 +9,66 @@ in VS_OUT {
     vec3 Normal;
     vec2 TexCoords;
     float use_tbn;
+    vec4 tint;
+    flat uint material;
 } fs_in;
 
+// tangent space normal of a normal map texel, z is rebuilt from x and y so that the BC5 maps (red and green only) decode like the rgb ones
+vec3 unpackNormal(vec4 texel) {
+    vec2 xy = texel.rg * 2.0 - 1.0;
+    return vec3(xy, sqrt(max(1.0 - dot(xy, xy), 0.0)));
+}
+
+#ifdef INDIRECT
+// see engine/render/material_system.hpp
+const uint SLOT_DIFFUSE = 0u;
+const uint SLOT_SPECULAR = 1u;
+const uint SLOT_NORMAL = 2u;
+const uint NO_TEXTURE = 0xFFFFFFFFu;
+
+struct MaterialData {
+    vec4 diffuse;
+    vec4 specular;
+    float shininess;
+    float alpha;
+    uint flags;
+    uint padding;
+    uvec4 textures;
+    uvec2 handles[4];
+};
+layout(std430, binding = 1) readonly buffer MaterialBlock {
+    MaterialData materials[];
+};
+
+#ifndef BINDLESS
+uniform sampler2DArray textureArrays[8];
+#endif
+
+// false when the slot has no texture, the gradients are taken before any branch
+bool sampleSlot(MaterialData data, uint slot, vec2 dx, vec2 dy, out vec4 texel) {
+    uint reference = data.textures[slot];
+    if (reference == NO_TEXTURE) {
+        return false;
+    }
+#ifdef BINDLESS
+    texel = textureGrad(sampler2D(data.handles[slot]), fs_in.TexCoords, dx, dy);
+#else
+    // array << 16 | layer, the array is picked with constant indices
+    vec3 coords = vec3(fs_in.TexCoords, float(reference & 0xFFFFu));
+    switch (reference >> 16) {
+    case 0u: texel = textureGrad(textureArrays[0], coords, dx, dy); break;
+    case 1u: texel = textureGrad(textureArrays[1], coords, dx, dy); break;
+    case 2u: texel = textureGrad(textureArrays[2], coords, dx, dy); break;
+    case 3u: texel = textureGrad(textureArrays[3], coords, dx, dy); break;
+    case 4u: texel = textureGrad(textureArrays[4], coords, dx, dy); break;
+    case 5u: texel = textureGrad(textureArrays[5], coords, dx, dy); break;
+    case 6u: texel = textureGrad(textureArrays[6], coords, dx, dy); break;
+    default: texel = textureGrad(textureArrays[7], coords, dx, dy); break;
+    }
+#endif
+    return true;
+}
+#else
 struct Material {
     sampler2D ambient[16];
     sampler2D diffuse[16];
@@ -21,27 +82,52 @@ struct Material {
 };
 
 uniform Material material;
-
-struct Light {
+#endif
+
+// shared with every shader, see engine/render/uniform_blocks.hpp
+layout(std140) uniform FrameBlock {
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec3 viewPos;
+    float time;
+    float deltaTime;
+} frame;
+
+layout(std140) uniform LightBlock {
     vec3 position;
-
     vec3 ambient;
     vec3 diffuse;
     vec3 specular;
-};
-
-uniform Light light;
-
-uniform vec3 viewPos;
+} light;
 
 out vec4 FragColor;
 
 void main() {
+#ifdef INDIRECT
+    MaterialData drawMaterial = materials[fs_in.material];
+    float shininess = drawMaterial.shininess;
+    float alpha = drawMaterial.alpha;
+    vec2 dx = dFdx(fs_in.TexCoords);
+    vec2 dy = dFdy(fs_in.TexCoords);
+    vec4 texel;
+#else
+    float shininess = material.shininess;
+    float alpha = 1.0;
+#endif
 
     // ----------------
     // Diffuse color
     // ----------------
     vec3 diffuseColor = vec3(1.0); // fallback white
+#ifdef INDIRECT
+    if(drawMaterial.diffuse.a > 0.0) {
+        diffuseColor = drawMaterial.diffuse.rgb;
+    }
+    if(sampleSlot(drawMaterial, SLOT_DIFFUSE, dx, dy, texel)) {
+        diffuseColor = texel.rgb;
+    }
+#else
     if(material.diffuseCount > 0) {
         diffuseColor = vec3(0.0);
         for(int i = 0; i < material.diffuseCount; i++) {
@@ -49,11 +135,20 @@ void main() {
         }
         diffuseColor /= float(material.diffuseCount);
     }
+#endif
 
     // ----------------
     // Specular color
     // ----------------
     vec3 specularColor = vec3(1.0); // fallback white (so specular works without a map)
+#ifdef INDIRECT
+    if(drawMaterial.specular.a > 0.0) {
+        specularColor = drawMaterial.specular.rgb;
+    }
+    if(sampleSlot(drawMaterial, SLOT_SPECULAR, dx, dy, texel)) {
+        specularColor = texel.rgb;
+    }
+#else
     if(material.specularCount > 0) {
         specularColor = vec3(0.0);
         for(int i = 0; i < material.specularCount; i++) {
@@ -61,22 +156,27 @@ void main() {
         }
         specularColor /= float(material.specularCount);
     }
+#endif
 
     // ----------------
     // Normals
     // ----------------
-    vec3 norm;
+    // fallback: use mesh normal (Z axis of TBN basis is usually the interpolated normal)
+    vec3 norm = normalize(fs_in.use_tbn > 0.0 ? fs_in.TBN[2] : fs_in.Normal);
+#ifdef INDIRECT
+    if(fs_in.use_tbn > 0.0 && sampleSlot(drawMaterial, SLOT_NORMAL, dx, dy, texel)) {
+        norm = normalize(fs_in.TBN * normalize(unpackNormal(texel)));
+    }
+#else
     if(material.normalCount > 0 && fs_in.use_tbn > 0.0) {
         vec3 tangentNormal = vec3(0.0);
         for(int i = 0; i < material.normalCount; i++) {
-            tangentNormal += texture(material.normal[i], fs_in.TexCoords).rgb * 2.0 - 1.0;
+            tangentNormal += unpackNormal(texture(material.normal[i], fs_in.TexCoords));
         }
         tangentNormal = normalize(tangentNormal / float(material.normalCount));
         norm = normalize(fs_in.TBN * tangentNormal);
-    } else {
-        // fallback: use mesh normal (Z axis of TBN basis is usually the interpolated normal)
-        norm = normalize(fs_in.Normal);
     }
+#endif
 
     // ----------------
     // Lighting
@@ -84,7 +184,7 @@ void main() {
 
     // lighting directions (world space)
     vec3 lightDir = normalize(light.position - fs_in.FragPos);
-    vec3 viewDir = normalize(viewPos - fs_in.FragPos);
+    vec3 viewDir = normalize(frame.viewPos - fs_in.FragPos);
 
     // ambient
     vec3 ambient = light.ambient * diffuseColor;
@@ -95,8 +195,8 @@ void main() {
 
     // specular
     vec3 reflectDir = reflect(-lightDir, norm);
-    float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), shininess);
     vec3 specular = light.specular * spec * specularColor;
 
-    FragColor = vec4(ambient + diffuse + specular, 1.0);
+    FragColor = vec4(ambient + diffuse + specular, alpha) * fs_in.tint;
 }
\ No newline at end of file
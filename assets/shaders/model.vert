@@ -1,9 +1,11 @@
 #version 460 core
+// packed vertices, see engine/render/vertex_format.hpp
 layout(location = 0) in vec3 aPos;
-layout(location = 1) in vec3 aNormal;
+// octahedral
+layout(location = 1) in vec2 aNormal;
 layout(location = 2) in vec2 aTexCoords;
-layout(location = 3) in vec3 aTangent;
-layout(location = 4) in vec3 aBitangent;
+// octahedral, x on 16 bits, y on 15 bits followed by the bitangent sign
+layout(location = 3) in ivec2 aTangent;
 
 out VS_OUT {
     mat3 TBN;
@@ -11,35 +13,87 @@ out VS_OUT {
     vec3 Normal;
     vec2 TexCoords;
     float use_tbn;
+    vec4 tint;
+    flat uint material;
 } vs_out;
 
+// shared with every shader, see engine/render/uniform_blocks.hpp
+layout(std140) uniform FrameBlock {
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec3 viewPos;
+    float time;
+    float deltaTime;
+} frame;
+
+#if defined(INSTANCED)
+// per instance attributes, see engine/render/instance_batch.hpp
+layout(location = 5) in mat4 aInstanceModel;
+layout(location = 9) in vec4 aInstanceTint;
+#elif defined(INDIRECT)
+// per draw data of a multi draw, see engine/render/indirect_batch.hpp
+struct DrawData {
+    mat4 model;
+    uint material;
+    uint flags;
+};
+layout(std430, binding = 0) readonly buffer DrawBlock {
+    DrawData draws[];
+};
+#else
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+#endif
 
+#ifndef INDIRECT
 uniform float use_tbn;
+#endif
+
+// inverse of VertexFormat::EncodeOctahedral
+vec3 octahedralDecode(vec2 encoded) {
+    vec3 direction = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+    float fold = max(-direction.z, 0.0);
+    direction.x += direction.x >= 0.0 ? -fold : fold;
+    direction.y += direction.y >= 0.0 ? -fold : fold;
+    return normalize(direction);
+}
 
 void main() {
+#if defined(INSTANCED)
+    mat4 model = aInstanceModel;
+    vec4 tint = aInstanceTint;
+    vs_out.material = 0u;
+#elif defined(INDIRECT)
+    DrawData draw = draws[gl_DrawID];
+    mat4 model = draw.model;
+    vec4 tint = vec4(1.0);
+    float use_tbn = (draw.flags & 1u) != 0u ? 1.0 : 0.0;
+    vs_out.material = draw.material;
+#else
+    vec4 tint = vec4(1.0);
+    vs_out.material = 0u;
+#endif
+    vec3 normal = octahedralDecode(aNormal);
+
     // normal matrix
     mat3 normalMatrix = transpose(inverse(mat3(model)));
 
-    // world space positions
-    vec3 T = normalize(normalMatrix * aTangent);
-    vec3 B = normalize(normalMatrix * aBitangent);
-    vec3 N = normalize(normalMatrix * aNormal);
-
-    T = normalize(T - dot(T, N) * N);
-    B = cross(N, T);
-
     vec3 fragPos = vec3(model * vec4(aPos, 1.0));
     vs_out.FragPos = fragPos;
     vs_out.TexCoords = aTexCoords;
     vs_out.use_tbn = use_tbn;
+    vs_out.tint = tint;
     if (use_tbn > 0.0) {
-        vs_out.TBN = mat3(T, B, N);
+        // world space, the bitangent is rebuilt from the sign stored with the tangent
+        vec3 tangent = octahedralDecode(vec2(float(aTangent.x) / 32767.0, float(aTangent.y >> 1) / 16383.0));
+        float handedness = (aTangent.y & 1) != 0 ? -1.0 : 1.0;
+        vec3 N = normalize(normalMatrix * normal);
+        vec3 T = normalize(normalMatrix * tangent);
+        T = normalize(T - dot(T, N) * N);
+        vs_out.TBN = mat3(T, cross(N, T) * handedness, N);
     } else {
-        vs_out.Normal = mat3(transpose(inverse(model))) * aNormal;
+        vs_out.Normal = normalMatrix * normal;
     }
 
-    gl_Position = projection * view * model * vec4(aPos, 1.0);
+    gl_Position = frame.viewProjection * model * vec4(aPos, 1.0);
 }
\ No newline at end of file
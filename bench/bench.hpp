@@ -0,0 +1,45 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+// wall clock of repeated runs, in milliseconds
+struct Timing
+{
+    double min = 0.0;
+    double max = 0.0;
+};
+
+/**
+ * Runs setup then run, iterations times, and times run only.
+ * setup gives every run the same starting state (e.g. undoing what the previous run changed).
+ */
+template <typename Setup, typename Run>
+Timing measure(int iterations, Setup &&setup, Run &&run)
+{
+    std::vector<double> times;
+    for (int i = 0; i < iterations; i++)
+    {
+        setup();
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        run();
+        times.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    }
+    auto [min, max] = std::minmax_element(times.begin(), times.end());
+    return {*min, *max};
+}
+
+template <typename Run>
+Timing measure(int iterations, Run &&run)
+{
+    return measure(iterations, []() {}, run);
+}
+
+// every benchmark seeds its own generator with this so that runs are comparable
+constexpr uint32_t BENCH_SEED = 42;
+
+void benchBVH();
+void benchHashMap();
+void benchTangents();
@@ -0,0 +1,149 @@
+#include <format>
+#include <iostream>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <core/bvh.hpp>
+#include <render/frustum.hpp>
+
+#include "bench.hpp"
+
+// slab test of a ray against the box of an object, standing in for the exact test of a mesh
+static float hitBox(const AABB &box, const Ray &ray)
+{
+    glm::vec3 inverse = 1.0f / ray.direction;
+    glm::vec3 near = (box.min - ray.origin) * inverse;
+    glm::vec3 far = (box.max - ray.origin) * inverse;
+    glm::vec3 entries = glm::min(near, far);
+    glm::vec3 exits = glm::max(near, far);
+    float entry = std::max(std::max(entries.x, entries.y), std::max(entries.z, 0.0f));
+    float exit = std::min(std::min(exits.x, exits.y), exits.z);
+    return entry <= exit ? entry : -1.0f;
+}
+
+/**
+ * Random boxes of 0.4 to 3 units in a cube growing with the count (constant density), the kind of scene
+ * SceneLoadingTest builds. The queries are a camera looking at the whole cube, boxes of 4 units at random
+ * and rays shot through the cube, the refit follows a small move of every object.
+ */
+void benchBVH()
+{
+    constexpr int ITERATIONS = 5;
+    constexpr int QUERIES = 10000;
+
+    std::cout << std::format("{:>8} {:>16} {:>16} {:>16} {:>14} {:>14} {:>12}", "objects", "build (ms)", "insert all (ms)", "refit (ms)",
+                 "frustum (q/s)", "overlap (q/s)", "rays (q/s)") << std::endl;
+    for (int count : {1000, 10000, 100000})
+    {
+        std::mt19937 random(BENCH_SEED);
+        float world = std::cbrt(static_cast<float>(count)) * 4.0f;
+        std::uniform_real_distribution<float> position(-world, world);
+        std::uniform_real_distribution<float> size(0.2f, 1.5f);
+
+        std::vector<BVH::Item> items(count);
+        for (int i = 0; i < count; i++)
+        {
+            glm::vec3 center(position(random), position(random), position(random));
+            glm::vec3 extents(size(random));
+            items[i] = {AABB{center - extents, center + extents}, static_cast<uint32_t>(i)};
+        }
+
+        BVH bvh;
+        std::vector<int32_t> proxies;
+        Timing build = measure(ITERATIONS, [&]()
+                               { proxies = bvh.Build(items); });
+
+        Timing insert = measure(
+            ITERATIONS, [&]()
+            { bvh.Clear(); },
+            [&]()
+            {
+                for (const BVH::Item &item : items)
+                {
+                    bvh.Insert(item.box, item.userData);
+                }
+            });
+        proxies = bvh.Build(items);
+
+        // every object moves a little, in turn one way then back, Update isn't timed
+        std::vector<AABB> moved(count);
+        for (int i = 0; i < count; i++)
+        {
+            glm::vec3 offset(position(random) * 0.001f);
+            moved[i] = {items[i].box.min + offset, items[i].box.max + offset};
+        }
+        int run = 0;
+        Timing refit = measure(
+            ITERATIONS, [&]()
+            {
+                for (int i = 0; i < count; i++)
+                {
+                    bvh.Update(proxies[i], run % 2 == 0 ? moved[i] : items[i].box);
+                }
+                run++;
+            },
+            [&]()
+            { bvh.Refit(); });
+
+        glm::mat4 projection = glm::perspective(0.8f, 16.0f / 9.0f, 0.1f, world);
+        glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 0.0f, world * 1.2f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+        Frustum frustum(projection * view);
+        std::vector<AABB> boxes(QUERIES);
+        std::vector<Ray> rays(QUERIES);
+        for (int i = 0; i < QUERIES; i++)
+        {
+            glm::vec3 center(position(random), position(random), position(random));
+            boxes[i] = {center - glm::vec3(2.0f), center + glm::vec3(2.0f)};
+            rays[i].origin = glm::vec3(position(random), position(random), world * 1.5f);
+            rays[i].direction = glm::normalize(glm::vec3(position(random) * 0.1f, position(random) * 0.1f, -1.0f));
+        }
+
+        // the counts are printed so that the compiler can't drop the queries
+        size_t visible = 0;
+        size_t overlaps = 0;
+        size_t hits = 0;
+        int frustumQueries = std::max(1, QUERIES * 100 / count);
+        Timing frustumTime = measure(ITERATIONS, [&]()
+                                     {
+                                         for (int q = 0; q < frustumQueries; q++)
+                                         {
+                                             bvh.QueryFrustum(frustum, [&](uint32_t)
+                                                              { visible++; });
+                                         }
+                                     });
+        Timing overlapTime = measure(ITERATIONS, [&]()
+                                     {
+                                         for (const AABB &box : boxes)
+                                         {
+                                             bvh.QueryOverlaps(box, [&](uint32_t)
+                                                               { overlaps++; });
+                                         }
+                                     });
+        auto hitObject = [&](uint32_t object, const Ray &ray)
+        {
+            return hitBox(bvh.GetBox(proxies[object]), ray);
+        };
+        Timing rayTime = measure(ITERATIONS, [&]()
+                                 {
+                                     for (const Ray &ray : rays)
+                                     {
+                                         hits += bvh.Raycast(ray, hitObject).has_value();
+                                     }
+                                 });
+
+        auto range = [](const Timing &timing)
+        { return std::format("{:.2f}-{:.2f}", timing.min, timing.max); };
+        // throughput of the best run
+        auto rate = [](const Timing &timing, int queries)
+        { return std::format("{:.3g}", queries / timing.min * 1000.0); };
+        std::cout << std::format("{:>8} {:>16} {:>16} {:>16} {:>14} {:>14} {:>12}", count, range(build), range(insert), range(refit),
+                     rate(frustumTime, frustumQueries), rate(overlapTime, QUERIES), rate(rayTime, QUERIES)) << std::endl;
+        std::cout << std::format("{:>8} height {}, area ratio {:.2f}, {} visible, {:.1f} overlaps per query, {:.0f}% rays hit", "",
+                     bvh.GetHeight(), bvh.GetAreaRatio(), visible / (frustumQueries * ITERATIONS),
+                     static_cast<double>(overlaps) / (QUERIES * ITERATIONS), 100.0 * hits / (QUERIES * ITERATIONS)) << std::endl;
+    }
+}
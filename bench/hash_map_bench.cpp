@@ -0,0 +1,102 @@
+#include <format>
+#include <iostream>
+#include <unordered_map>
+#include <vector>
+
+#include <helpers/flat_hash_map.hpp>
+#include <resources/loaders/obj_loader.hpp>
+
+#include "bench.hpp"
+
+using Triplet = OBJLoader::Triplet;
+using TripletHash = OBJLoader::TripletHash;
+
+// the vertex de-duplication of OBJLoader::buildMesh before FlatHashMap
+static void deduplicate(const std::vector<Triplet> &corners, std::unordered_map<Triplet, unsigned int, TripletHash> &vertices, std::vector<unsigned int> &indices)
+{
+    for (const Triplet &corner : corners)
+    {
+        auto it = vertices.find(corner);
+        if (it != vertices.end())
+        {
+            indices.push_back(it->second);
+            continue;
+        }
+        unsigned int index = static_cast<unsigned int>(vertices.size());
+        vertices[corner] = index;
+        indices.push_back(index);
+    }
+}
+
+// and with it
+static void deduplicate(const std::vector<Triplet> &corners, FlatHashMap<Triplet, unsigned int, TripletHash> &vertices, std::vector<unsigned int> &indices)
+{
+    for (const Triplet &corner : corners)
+    {
+        if (const unsigned int *found = vertices.Find(corner))
+        {
+            indices.push_back(*found);
+            continue;
+        }
+        unsigned int index = static_cast<unsigned int>(vertices.Size());
+        vertices.TryEmplace(corner, index);
+        indices.push_back(index);
+    }
+}
+
+/**
+ * The backpack .obj isn't in the tree, a triangulated grid stands in for it: the corner stream of its faces
+ * as the loader sees it, every vertex shared by about six corners with its own UV and normal indices.
+ */
+void benchHashMap()
+{
+    constexpr int ITERATIONS = 7;
+
+    std::cout << std::format("{:>10} {:>10} {:>20} {:>20}", "grid", "corners", "unordered_map (ms)", "FlatHashMap (ms)") << std::endl;
+    for (int side : {100, 400, 1000})
+    {
+        std::vector<Triplet> corners;
+        corners.reserve(static_cast<size_t>(side - 1) * (side - 1) * 6);
+        for (int y = 0; y < side - 1; y++)
+        {
+            for (int x = 0; x < side - 1; x++)
+            {
+                int a = y * side + x;
+                int b = a + 1;
+                int c = a + side + 1;
+                int d = a + side;
+                for (int corner : {a, b, c, a, c, d})
+                {
+                    corners.push_back({corner, corner, corner});
+                }
+            }
+        }
+
+        // reserved the way the loader does, from the corner count, and built from scratch every run
+        std::vector<unsigned int> standardIndices;
+        std::vector<unsigned int> flatIndices;
+        Timing standard = measure(ITERATIONS, [&]()
+                                  {
+                                      std::unordered_map<Triplet, unsigned int, TripletHash> vertices;
+                                      vertices.reserve(corners.size() / 2);
+                                      standardIndices.clear();
+                                      standardIndices.reserve(corners.size());
+                                      deduplicate(corners, vertices, standardIndices);
+                                  });
+        Timing flat = measure(ITERATIONS, [&]()
+                              {
+                                  FlatHashMap<Triplet, unsigned int, TripletHash> vertices(corners.size() / 2);
+                                  flatIndices.clear();
+                                  flatIndices.reserve(corners.size());
+                                  deduplicate(corners, vertices, flatIndices);
+                              });
+        if (standardIndices != flatIndices)
+        {
+            std::cout << "the two maps disagree" << std::endl;
+        }
+
+        std::cout << std::format("{:>10} {:>10} {:>20} {:>20}", std::format("{}x{}", side, side), corners.size(),
+                                 std::format("{:.1f}-{:.1f}", standard.min, standard.max), std::format("{:.1f}-{:.1f}", flat.min, flat.max))
+                  << std::endl;
+    }
+}
@@ -0,0 +1,56 @@
+#include <iostream>
+#include <algorithm>
+#include <string>
+#include <functional>
+#include <vector>
+
+#include "bench.hpp"
+
+/**
+ * Micro-benchmarks of the engine's hot paths, on synthetic data so that the numbers can be reproduced
+ * without the assets. Build in Release, every timing is the min-max of a few runs on the calling thread
+ * (plus the ThreadPool for the code that uses it).
+ *
+ * usage: engine-bench [name...]   (all of them when none is given)
+ *
+ * - bvh: BVH build, refit and query throughput at 1k, 10k and 100k objects
+ * - hashmap: OBJ vertex de-duplication with std::unordered_map and FlatHashMap
+ * - tangents: MeshTangents against assimp's CalcTangentSpace on spheres of 77k to 1M triangles
+ */
+
+struct Benchmark
+{
+    const char *name;
+    std::function<void()> run;
+};
+
+int main(int argc, char const *argv[])
+{
+    std::vector<Benchmark> benchmarks = {
+        {"bvh", benchBVH},
+        {"hashmap", benchHashMap},
+        {"tangents", benchTangents},
+    };
+
+    std::vector<std::string> selected(argv + 1, argv + argc);
+    int ran = 0;
+    for (const Benchmark &benchmark : benchmarks)
+    {
+        if (selected.empty() || std::find(selected.begin(), selected.end(), benchmark.name) != selected.end())
+        {
+            std::cout << "== " << benchmark.name << std::endl;
+            benchmark.run();
+            ran++;
+        }
+    }
+    if (ran == 0)
+    {
+        std::cout << "usage: engine-bench [name...]" << std::endl;
+        for (const Benchmark &benchmark : benchmarks)
+        {
+            std::cout << "  " << benchmark.name << std::endl;
+        }
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,117 @@
+#include <cmath>
+#include <format>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <assimp/Importer.hpp>
+#include <assimp/postprocess.h>
+#include <assimp/scene.h>
+
+#include <core/thread_pool.hpp>
+#include <render/mesh_tangents.hpp>
+
+#include "bench.hpp"
+
+/**
+ * UV sphere with the UVs tiled 4x2 and mirrored on one half, the way a symmetric model is usually unwrapped.
+ * The seam vertices are duplicated like an exporter would.
+ */
+static Mesh sphere(int segments, int rings)
+{
+    Mesh mesh;
+    for (int ring = 0; ring <= rings; ring++)
+    {
+        for (int segment = 0; segment <= segments; segment++)
+        {
+            float u = static_cast<float>(segment) / segments;
+            float v = static_cast<float>(ring) / rings;
+            float theta = u * 2.0f * 3.14159265f;
+            float phi = v * 3.14159265f;
+            glm::vec3 position(std::sin(phi) * std::cos(theta), std::cos(phi), std::sin(phi) * std::sin(theta));
+            mesh.vertices.push_back({
+                .position = position,
+                .normal = position,
+                .tcoords = glm::vec2((u > 0.5f ? 1.0f - u : u) * 4.0f, v * 2.0f),
+            });
+        }
+    }
+    unsigned int width = segments + 1;
+    for (int ring = 0; ring < rings; ring++)
+    {
+        for (int segment = 0; segment < segments; segment++)
+        {
+            unsigned int a = ring * width + segment;
+            unsigned int b = a + 1;
+            unsigned int c = a + width;
+            unsigned int d = c + 1;
+            mesh.indices.insert(mesh.indices.end(), {a, b, c, b, d, c});
+        }
+    }
+    return mesh;
+}
+
+// the mesh as an .obj in memory, for assimp to import it
+static std::string toOBJ(const Mesh &mesh)
+{
+    std::string text;
+    for (const Vertex &vertex : mesh.vertices)
+    {
+        text += std::format("v {} {} {}\nvt {} {}\nvn {} {} {}\n", vertex.position.x, vertex.position.y, vertex.position.z,
+                            vertex.tcoords.x, vertex.tcoords.y, vertex.normal.x, vertex.normal.y, vertex.normal.z);
+    }
+    for (size_t i = 0; i < mesh.indices.size(); i += 3)
+    {
+        unsigned int a = mesh.indices[i] + 1;
+        unsigned int b = mesh.indices[i + 1] + 1;
+        unsigned int c = mesh.indices[i + 2] + 1;
+        text += std::format("f {0}/{0}/{0} {1}/{1}/{1} {2}/{2}/{2}\n", a, b, c);
+    }
+    return text;
+}
+
+/**
+ * MeshTangents::Generate against aiProcess_CalcTangentSpace, which it replaced at import. Only the tangent
+ * pass is timed: assimp imports the .obj (joining the identical vertices) before every run, and Generate
+ * gets a fresh copy of the mesh. Generate splits its passes across the ThreadPool, so the comparison
+ * depends on the number of cores, printed first.
+ */
+void benchTangents()
+{
+    constexpr int ITERATIONS = 5;
+
+    std::cout << std::format("ThreadPool: {} threads", ThreadPool::Get().GetThreadCount()) << std::endl;
+    std::cout << std::format("{:>10} {:>10} {:>20} {:>28}", "triangles", "vertices", "MeshTangents (ms)", "CalcTangentSpace (ms)") << std::endl;
+    for (auto [segments, rings] : {std::pair{256, 150}, std::pair{512, 256}, std::pair{1024, 512}})
+    {
+        Mesh source = sphere(segments, rings);
+
+        Mesh mesh;
+        Timing generate = measure(
+            ITERATIONS, [&]()
+            {
+                mesh.vertices = source.vertices;
+                mesh.indices = source.indices;
+            },
+            [&]()
+            { MeshTangents::Generate(mesh); });
+
+        std::string obj = toOBJ(source);
+        Assimp::Importer importer;
+        bool imported = true;
+        Timing calculate = measure(
+            ITERATIONS, [&]()
+            { imported = imported && importer.ReadFileFromMemory(obj.data(), obj.size(), aiProcess_Triangulate | aiProcess_JoinIdenticalVertices, "obj"); },
+            [&]()
+            { importer.ApplyPostProcessing(aiProcess_CalcTangentSpace); });
+        if (!imported)
+        {
+            std::cout << "assimp couldn't import the sphere: " << importer.GetErrorString() << std::endl;
+            return;
+        }
+
+        std::cout << std::format("{:>10} {:>10} {:>20} {:>28}", source.indices.size() / 3, source.vertices.size(),
+                                 std::format("{:.1f}-{:.1f}", generate.min, generate.max), std::format("{:.1f}-{:.1f}", calculate.min, calculate.max))
+                  << std::endl;
+    }
+}
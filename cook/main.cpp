@@ -0,0 +1,349 @@
+#include <mutex>
+#include <atomic>
+#include <cctype>
+#include <optional>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <filesystem>
+#include <format>
+#include <iostream>
+#include <unordered_set>
+
+#include <assimp/Importer.hpp>
+
+#include <core/thread_pool.hpp>
+#include <render/mesh_optimizer.hpp>
+#include <render/mesh_simplifier.hpp>
+#include <render/model.hpp>
+#include <resources/cooked_texture.hpp>
+#include <resources/loaders/all.hpp>
+#include <helpers/log.hpp>
+
+/**
+ * Offline asset cooker: walks an asset directory and writes next to every source the cooked
+ * version the engine loads instead of it (see MeshCache and CookedTexture).
+ *
+ * usage: engine-cook [directory = assets] [--force] [--bc7] [--report]
+ *
+ * The meshes get their levels of detail here (MeshSimplifier), the runtime doesn't generate them.
+ *
+ * The textures are block compressed: BC5 for the ones the materials of the meshes use as normal maps, BC1 or
+ * BC3 (alpha) for the others, or BC7 for both with --bc7 (add --force to re-encode the textures already cooked).
+ *
+ * --report cooks nothing: it imports the meshes in their source order and prints, for every level, the
+ * simulated post transform cache (ACMR, ATVR) and vertex fetch efficiency before and after MeshOptimizer,
+ * and for every mesh the size of its GPU buffers as full precision Vertex and in its VertexFormat.
+ */
+
+enum class AssetKind
+{
+    Mesh,
+    Model,
+    Texture,
+};
+
+struct Asset
+{
+    std::string path;
+    AssetKind kind;
+};
+
+static std::string lower(std::string text)
+{
+    std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c)
+                   { return static_cast<char>(std::tolower(c)); });
+    return text;
+}
+
+static std::optional<AssetKind> classify(const std::filesystem::path &path)
+{
+    std::string extension = lower(path.extension().string());
+    if (extension.empty() || extension == std::string(".") + MeshCache::EXTENSION ||
+        extension == std::string(".") + CookedTexture::EXTENSION || extension == ".tmp")
+    {
+        return {};
+    }
+    // already in a GPU format (.dds, ...)
+    if (Loader::HasTextureLoader(extension.substr(1)))
+    {
+        return {};
+    }
+
+    if (extension == ".jpg" || extension == ".jpeg" || extension == ".png" || extension == ".tga" || extension == ".bmp")
+    {
+        return AssetKind::Texture;
+    }
+    if (Loader::HasLoader(extension.substr(1)))
+    {
+        return AssetKind::Mesh;
+    }
+    if (Assimp::Importer().IsExtensionSupported(extension))
+    {
+        return AssetKind::Model;
+    }
+    return {};
+}
+
+static std::vector<Mesh> importMeshes(const Asset &asset)
+{
+    return asset.kind == AssetKind::Mesh ? Loader::Parse(asset.path, false) : Model::Import(asset.path);
+}
+
+static std::string canonical(const std::string &path)
+{
+    std::error_code error;
+    std::filesystem::path canonicalPath = std::filesystem::weakly_canonical(path, error);
+    return error ? path : canonicalPath.generic_string();
+}
+
+// textures the materials of the meshes use as normal maps, filled while cooking the meshes
+struct NormalMaps
+{
+    std::mutex mutex;
+    std::unordered_set<std::string> paths;
+
+    void Collect(const std::vector<Mesh> &meshes)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const Mesh &mesh : meshes)
+        {
+            for (const Material &material : mesh.materials)
+            {
+                if (!material.texture_normal.path.empty())
+                {
+                    paths.insert(canonical(material.texture_normal.path));
+                }
+            }
+        }
+    }
+
+    bool Contains(const std::string &path)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return paths.contains(canonical(path));
+    }
+};
+
+enum class Outcome
+{
+    Cooked,
+    Skipped,
+    Failed,
+};
+
+static Outcome cookMeshes(const Asset &asset, bool force, NormalMaps &normalMaps)
+{
+    std::string cookedPath = MeshCache::GetCookedPath(asset.path);
+    // files cooked by the runtime have no levels of detail, they are cooked again
+    if (!force && MeshCache::IsFresh(cookedPath, asset.path, MeshCache::COOK_FLAG_LODS))
+    {
+        // the materials of the cooked meshes still tell which textures are normal maps
+        normalMaps.Collect(Loader::Parse(cookedPath, false));
+        return Outcome::Skipped;
+    }
+
+    std::vector<Mesh> meshes = importMeshes(asset);
+    normalMaps.Collect(meshes);
+    if (meshes.empty() || !Loader::CreateCooker(MeshCache::EXTENSION)->Cook(asset.path, meshes, cookedPath))
+    {
+        return Outcome::Failed;
+    }
+    return Outcome::Cooked;
+}
+
+static Outcome cookTexture(const Asset &asset, bool force, const CookedTexture::Settings &settings)
+{
+    std::string cookedPath = CookedTexture::GetCookedPath(asset.path);
+    // cooked again when it was encoded for other settings (became a normal map, --bc7 added or removed)
+    if (!force && CookedTexture::IsFresh(cookedPath, asset.path, settings))
+    {
+        return Outcome::Skipped;
+    }
+    return CookedTexture::Cook(asset.path, cookedPath, settings) ? Outcome::Cooked : Outcome::Failed;
+}
+
+// transformed vertices over every level of every mesh, to weight the totals
+struct ReportTotals
+{
+    double triangles = 0.0;
+    double before = 0.0;
+    double after = 0.0;
+    double fullBytes = 0.0;
+    double packedBytes = 0.0;
+};
+
+static std::string report(const Asset &asset, ReportTotals &totals)
+{
+    std::vector<Mesh> meshes = importMeshes(asset);
+    std::string lines;
+    for (Mesh &mesh : meshes)
+    {
+        auto levelIndices = [&](size_t level) -> const std::vector<unsigned int> &
+        {
+            return level == 0 ? mesh.indices : mesh.lods[level - 1].indices;
+        };
+
+        size_t levelCount = mesh.GetLodCount();
+        std::vector<MeshOptimizer::VertexCacheStats> cacheBefore(levelCount);
+        std::vector<MeshOptimizer::VertexFetchStats> fetchBefore(levelCount);
+        for (size_t level = 0; level < levelCount; level++)
+        {
+            cacheBefore[level] = MeshOptimizer::AnalyzeVertexCache(levelIndices(level), mesh.vertices.size());
+            fetchBefore[level] = MeshOptimizer::AnalyzeVertexFetch(levelIndices(level), mesh.vertices.size());
+        }
+
+        MeshOptimizer::Optimize(mesh);
+
+        for (size_t level = 0; level < levelCount; level++)
+        {
+            MeshOptimizer::VertexCacheStats cache = MeshOptimizer::AnalyzeVertexCache(levelIndices(level), mesh.vertices.size());
+            MeshOptimizer::VertexFetchStats fetch = MeshOptimizer::AnalyzeVertexFetch(levelIndices(level), mesh.vertices.size());
+            size_t triangles = levelIndices(level).size() / 3;
+            lines += std::format("{} [{}] lod {}: {} triangles, ACMR {:.3f} -> {:.3f}, ATVR {:.3f} -> {:.3f}, overfetch {:.2f} -> {:.2f}\n",
+                                 asset.path, mesh.name, level, triangles, cacheBefore[level].acmr, cache.acmr,
+                                 cacheBefore[level].atvr, cache.atvr, fetchBefore[level].overfetch, fetch.overfetch);
+            totals.triangles += triangles;
+            totals.before += cacheBefore[level].acmr * triangles;
+            totals.after += cache.acmr * triangles;
+        }
+
+        VertexFormat format = VertexFormat::Choose(mesh);
+        size_t fullBytes = mesh.vertices.size() * sizeof(Vertex) + mesh.GetTotalIndexCount() * sizeof(unsigned int);
+        size_t packedBytes = mesh.vertices.size() * format.GetVertexSize() + mesh.GetTotalIndexCount() * format.GetIndexSize();
+        lines += std::format("{} [{}]: {} -> {} bytes ({} bytes per vertex, {} bits indices)\n", asset.path, mesh.name, fullBytes,
+                             packedBytes, format.GetVertexSize(), format.GetIndexSize() * 8);
+        totals.fullBytes += fullBytes;
+        totals.packedBytes += packedBytes;
+    }
+    return lines;
+}
+
+static int reportAll(const std::vector<Asset> &assets)
+{
+    // measures the order of the sources, the loaders would optimize them already
+    MeshOptimizer::SetEnabled(false);
+
+    std::vector<std::string> lines(assets.size());
+    std::vector<ReportTotals> totals(assets.size());
+    ThreadPool::Get().ParallelFor(assets.size(), [&](size_t i)
+                                  {
+                                      if (assets[i].kind != AssetKind::Texture)
+                                      {
+                                          lines[i] = report(assets[i], totals[i]);
+                                      } });
+
+    ReportTotals all;
+    for (size_t i = 0; i < assets.size(); i++)
+    {
+        std::cout << lines[i];
+        all.triangles += totals[i].triangles;
+        all.before += totals[i].before;
+        all.after += totals[i].after;
+        all.fullBytes += totals[i].fullBytes;
+        all.packedBytes += totals[i].packedBytes;
+    }
+    if (all.triangles > 0.0)
+    {
+        INFO("ACMR over " << all.triangles << " triangles: " << all.before / all.triangles << " -> " << all.after / all.triangles);
+        INFO("GPU buffers: " << all.fullBytes << " -> " << all.packedBytes << " bytes");
+    }
+    return 0;
+}
+
+int main(int argc, char const *argv[])
+{
+    std::string directory = "assets";
+    bool force = false;
+    bool highQuality = false;
+    bool reportOnly = false;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string argument = argv[i];
+        if (argument == "--force")
+        {
+            force = true;
+        }
+        else if (argument == "--bc7")
+        {
+            highQuality = true;
+        }
+        else if (argument == "--report")
+        {
+            reportOnly = true;
+        }
+        else
+        {
+            directory = argument;
+        }
+    }
+
+    if (!std::filesystem::is_directory(directory))
+    {
+        ERROR("Asset directory doesn't exist: " << directory);
+        return 1;
+    }
+
+    std::vector<Asset> assets;
+    for (const std::filesystem::directory_entry &entry : std::filesystem::recursive_directory_iterator(directory))
+    {
+        if (!entry.is_regular_file())
+        {
+            continue;
+        }
+        std::optional<AssetKind> kind = classify(entry.path());
+        if (kind)
+        {
+            assets.push_back({entry.path().generic_string(), *kind});
+        }
+    }
+
+    // a cook time step, too slow for the imports of the runtime
+    MeshSimplifier::SetEnabled(true);
+
+    if (reportOnly)
+    {
+        return reportAll(assets);
+    }
+
+    std::atomic<size_t> cooked = 0;
+    std::atomic<size_t> skipped = 0;
+    std::atomic<size_t> failed = 0;
+    auto count = [&](const Asset &asset, Outcome outcome)
+    {
+        if (outcome == Outcome::Cooked)
+        {
+            cooked++;
+        }
+        else if (outcome == Outcome::Skipped)
+        {
+            skipped++;
+        }
+        else
+        {
+            ERROR("Failed to cook: " << asset.path);
+            failed++;
+        }
+    };
+
+    // the meshes first, their materials tell which textures are normal maps
+    NormalMaps normalMaps;
+    ThreadPool::Get().ParallelFor(assets.size(), [&](size_t i)
+                                  {
+                                      if (assets[i].kind != AssetKind::Texture)
+                                      {
+                                          count(assets[i], cookMeshes(assets[i], force, normalMaps));
+                                      } });
+    ThreadPool::Get().ParallelFor(assets.size(), [&](size_t i)
+                                  {
+                                      if (assets[i].kind == AssetKind::Texture)
+                                      {
+                                          CookedTexture::Settings settings;
+                                          settings.normalMap = normalMaps.Contains(assets[i].path);
+                                          settings.highQuality = highQuality;
+                                          count(assets[i], cookTexture(assets[i], force, settings));
+                                      } });
+
+    INFO("Cooked " << cooked << " assets, " << skipped << " up to date, " << failed << " failed");
+    return failed == 0 ? 0 : 1;
+}
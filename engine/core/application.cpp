@@ -6,14 +6,18 @@ Application::Application(int width, int height) : m_window(nullptr), m_width(wid
 
 Application::~Application()
 {
+    // GPU resources have to be released while the context is still alive
+    m_scenes.clear();
+    TextureCache::Get().Clear();
     glfwTerminate();
 }
 
 bool Application::Init()
 {
     glfwInit();
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    // multi draw indirect, shader storage buffers and gl_DrawID
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
     m_window = glfwCreateWindow(m_width, m_height, "Engine", nullptr, nullptr);
@@ -83,6 +87,9 @@ bool Application::Run()
             scene->Render(deltaTime);
         }
 
+        // finish the loads that streamed in meanwhile, without stalling the frame
+        resourceManager.ProcessUploads(UPLOAD_BUDGET);
+
         glfwSwapBuffers(m_window);
         glfwPollEvents();
     }
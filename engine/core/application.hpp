@@ -16,6 +16,7 @@
 #include "render/camera/camera_perspective.hpp"
 #include "render/model.hpp"
 #include "resources/manager.hpp"
+#include "resources/texture_cache.hpp"
 #include "helpers/log.hpp"
 
 class Application
@@ -31,6 +32,9 @@ public:
     static void ResizeCallback(GLFWwindow *window, int width, int height);
 
 private:
+    // time given each frame to the GL side of asynchronous loads
+    static constexpr std::chrono::microseconds UPLOAD_BUDGET = std::chrono::milliseconds(4);
+
     GLFWwindow *m_window;
     int m_width, m_height;
     bool m_bShouldExit;
@@ -0,0 +1,400 @@
+#include "bvh.hpp"
+
+#include <algorithm>
+#include <queue>
+
+namespace
+{
+    // centroid bins of the SAH build
+    constexpr int BIN_COUNT = 12;
+
+    struct Bin
+    {
+        AABB box;
+        uint32_t count = 0;
+    };
+}
+
+BVH::BVH(float iMargin) : m_margin(iMargin)
+{
+}
+
+std::vector<int32_t> BVH::Build(const std::vector<Item> &iItems)
+{
+    Clear();
+    if (iItems.empty())
+    {
+        return {};
+    }
+
+    m_nodes.reserve(iItems.size() * 2);
+    std::vector<int32_t> aLeaves(iItems.size());
+    std::vector<glm::vec3> aCentroids(iItems.size());
+    std::vector<uint32_t> aOrder(iItems.size());
+    for (uint32_t i = 0; i < iItems.size(); i++)
+    {
+        int32_t aLeaf = allocateNode();
+        m_nodes[aLeaf].box = iItems[i].box;
+        m_nodes[aLeaf].userData = iItems[i].userData;
+        m_nodes[aLeaf].height = 0;
+        aLeaves[i] = aLeaf;
+        aCentroids[i] = iItems[i].box.GetCenter();
+        aOrder[i] = i;
+    }
+    m_leafCount = iItems.size();
+
+    m_root = buildRange(aOrder, 0, aOrder.size(), aCentroids, aLeaves);
+    m_nodes[m_root].parent = NULL_NODE;
+    m_bTopologyChanged = true;
+    return aLeaves;
+}
+
+int32_t BVH::buildRange(std::vector<uint32_t> &ioItems, size_t iBegin, size_t iEnd, const std::vector<glm::vec3> &iCentroids, const std::vector<int32_t> &iLeaves)
+{
+    if (iEnd - iBegin == 1)
+    {
+        return iLeaves[ioItems[iBegin]];
+    }
+
+    AABB aCentroidBox;
+    for (size_t i = iBegin; i < iEnd; i++)
+    {
+        aCentroidBox.Expand(iCentroids[ioItems[i]]);
+    }
+    glm::vec3 aSize = aCentroidBox.max - aCentroidBox.min;
+    int aAxis = aSize.x > aSize.y ? (aSize.x > aSize.z ? 0 : 2) : (aSize.y > aSize.z ? 1 : 2);
+
+    size_t aMiddle = iBegin + (iEnd - iBegin) / 2;
+    if (aSize[aAxis] > 0.0f)
+    {
+        // sweep the bins from both sides and split where area * count is the smallest
+        Bin aBins[BIN_COUNT];
+        float aScale = BIN_COUNT / aSize[aAxis];
+        auto aBinOf = [&](uint32_t iItem)
+        {
+            int aBin = static_cast<int>((iCentroids[iItem][aAxis] - aCentroidBox.min[aAxis]) * aScale);
+            return std::min(aBin, BIN_COUNT - 1);
+        };
+        for (size_t i = iBegin; i < iEnd; i++)
+        {
+            Bin &aBin = aBins[aBinOf(ioItems[i])];
+            aBin.box.Expand(m_nodes[iLeaves[ioItems[i]]].box);
+            aBin.count++;
+        }
+
+        float aRightCosts[BIN_COUNT] = {};
+        AABB aRightBox;
+        uint32_t aRightCount = 0;
+        for (int i = BIN_COUNT - 1; i > 0; i--)
+        {
+            aRightBox.Expand(aBins[i].box);
+            aRightCount += aBins[i].count;
+            aRightCosts[i] = aRightBox.GetSurfaceArea() * aRightCount;
+        }
+
+        float aBestCost = FLT_MAX;
+        int aBestSplit = -1;
+        AABB aLeftBox;
+        uint32_t aLeftCount = 0;
+        for (int i = 0; i < BIN_COUNT - 1; i++)
+        {
+            aLeftBox.Expand(aBins[i].box);
+            aLeftCount += aBins[i].count;
+            float aCost = aLeftBox.GetSurfaceArea() * aLeftCount + aRightCosts[i + 1];
+            if (aLeftCount > 0 && aLeftCount < iEnd - iBegin && aCost < aBestCost)
+            {
+                aBestCost = aCost;
+                aBestSplit = i;
+            }
+        }
+
+        if (aBestSplit >= 0)
+        {
+            auto aSplit = std::partition(ioItems.begin() + iBegin, ioItems.begin() + iEnd, [&](uint32_t iItem)
+                                         { return aBinOf(iItem) <= aBestSplit; });
+            aMiddle = static_cast<size_t>(aSplit - ioItems.begin());
+        }
+    }
+    if (aMiddle == iBegin || aMiddle == iEnd)
+    {
+        // every centroid in the same place, halve the range
+        aMiddle = iBegin + (iEnd - iBegin) / 2;
+    }
+
+    int32_t aNode = allocateNode();
+    int32_t aLeft = buildRange(ioItems, iBegin, aMiddle, iCentroids, iLeaves);
+    int32_t aRight = buildRange(ioItems, aMiddle, iEnd, iCentroids, iLeaves);
+
+    Node &aParent = m_nodes[aNode];
+    aParent.left = aLeft;
+    aParent.right = aRight;
+    aParent.box = AABB::Union(m_nodes[aLeft].box, m_nodes[aRight].box);
+    aParent.height = 1 + std::max(m_nodes[aLeft].height, m_nodes[aRight].height);
+    m_nodes[aLeft].parent = aNode;
+    m_nodes[aRight].parent = aNode;
+    return aNode;
+}
+
+int32_t BVH::Insert(const AABB &iBox, uint32_t iUserData)
+{
+    int32_t aLeaf = allocateNode();
+    Node &aNode = m_nodes[aLeaf];
+    aNode.box = {iBox.min - glm::vec3(m_margin), iBox.max + glm::vec3(m_margin)};
+    aNode.userData = iUserData;
+    aNode.height = 0;
+
+    insertLeaf(aLeaf);
+    m_leafCount++;
+    return aLeaf;
+}
+
+void BVH::Remove(int32_t iProxy)
+{
+    removeLeaf(iProxy);
+    freeNode(iProxy);
+    m_leafCount--;
+}
+
+bool BVH::Move(int32_t iProxy, const AABB &iBox, const glm::vec3 &iDisplacement)
+{
+    if (m_nodes[iProxy].box.Contains(iBox))
+    {
+        return false;
+    }
+
+    removeLeaf(iProxy);
+
+    AABB aFat = {iBox.min - glm::vec3(m_margin), iBox.max + glm::vec3(m_margin)};
+    aFat.min += glm::min(iDisplacement, glm::vec3(0.0f));
+    aFat.max += glm::max(iDisplacement, glm::vec3(0.0f));
+    m_nodes[iProxy].box = aFat;
+
+    insertLeaf(iProxy);
+    return true;
+}
+
+void BVH::Update(int32_t iProxy, const AABB &iBox)
+{
+    m_nodes[iProxy].box = iBox;
+}
+
+void BVH::Refit()
+{
+    if (m_root == NULL_NODE)
+    {
+        return;
+    }
+
+    if (m_bTopologyChanged)
+    {
+        // pre order reversed: children always come before their parent
+        m_refitOrder.clear();
+        std::vector<int32_t> aStack = {m_root};
+        while (!aStack.empty())
+        {
+            int32_t aIndex = aStack.back();
+            aStack.pop_back();
+            const Node &aNode = m_nodes[aIndex];
+            if (!aNode.IsLeaf())
+            {
+                m_refitOrder.push_back(aIndex);
+                aStack.push_back(aNode.left);
+                aStack.push_back(aNode.right);
+            }
+        }
+        std::reverse(m_refitOrder.begin(), m_refitOrder.end());
+        m_bTopologyChanged = false;
+    }
+
+    for (int32_t aIndex : m_refitOrder)
+    {
+        Node &aNode = m_nodes[aIndex];
+        aNode.box = AABB::Union(m_nodes[aNode.left].box, m_nodes[aNode.right].box);
+    }
+}
+
+void BVH::Clear()
+{
+    m_nodes.clear();
+    m_root = NULL_NODE;
+    m_freeList = NULL_NODE;
+    m_leafCount = 0;
+    m_refitOrder.clear();
+    m_bTopologyChanged = true;
+}
+
+float BVH::GetAreaRatio() const
+{
+    if (m_root == NULL_NODE || m_nodes[m_root].IsLeaf())
+    {
+        return 0.0f;
+    }
+
+    float aTotal = 0.0f;
+    for (const Node &aNode : m_nodes)
+    {
+        if (aNode.height > 0)
+        {
+            aTotal += aNode.box.GetSurfaceArea();
+        }
+    }
+    return aTotal / m_nodes[m_root].box.GetSurfaceArea();
+}
+
+int32_t BVH::allocateNode()
+{
+    if (m_freeList == NULL_NODE)
+    {
+        m_nodes.emplace_back();
+        return static_cast<int32_t>(m_nodes.size() - 1);
+    }
+
+    int32_t aNode = m_freeList;
+    m_freeList = m_nodes[aNode].parent;
+    m_nodes[aNode] = Node();
+    return aNode;
+}
+
+void BVH::freeNode(int32_t iNode)
+{
+    m_nodes[iNode] = Node();
+    m_nodes[iNode].parent = m_freeList;
+    m_freeList = iNode;
+}
+
+void BVH::insertLeaf(int32_t iLeaf)
+{
+    m_bTopologyChanged = true;
+    if (m_root == NULL_NODE)
+    {
+        m_root = iLeaf;
+        m_nodes[iLeaf].parent = NULL_NODE;
+        return;
+    }
+
+    const AABB aBox = m_nodes[iLeaf].box;
+    int32_t aSibling = findBestSibling(aBox);
+    int32_t aOldParent = m_nodes[aSibling].parent;
+
+    // the new parent takes the place of the sibling
+    int32_t aNewParent = allocateNode();
+    Node &aParent = m_nodes[aNewParent];
+    aParent.parent = aOldParent;
+    aParent.left = aSibling;
+    aParent.right = iLeaf;
+    aParent.box = AABB::Union(aBox, m_nodes[aSibling].box);
+    aParent.height = m_nodes[aSibling].height + 1;
+
+    if (aOldParent == NULL_NODE)
+    {
+        m_root = aNewParent;
+    }
+    else if (m_nodes[aOldParent].left == aSibling)
+    {
+        m_nodes[aOldParent].left = aNewParent;
+    }
+    else
+    {
+        m_nodes[aOldParent].right = aNewParent;
+    }
+    m_nodes[aSibling].parent = aNewParent;
+    m_nodes[iLeaf].parent = aNewParent;
+
+    refitAncestors(aOldParent);
+}
+
+void BVH::removeLeaf(int32_t iLeaf)
+{
+    m_bTopologyChanged = true;
+    if (iLeaf == m_root)
+    {
+        m_root = NULL_NODE;
+        return;
+    }
+
+    // the sibling takes the place of the parent
+    int32_t aParent = m_nodes[iLeaf].parent;
+    int32_t aGrandParent = m_nodes[aParent].parent;
+    int32_t aSibling = m_nodes[aParent].left == iLeaf ? m_nodes[aParent].right : m_nodes[aParent].left;
+
+    if (aGrandParent == NULL_NODE)
+    {
+        m_root = aSibling;
+        m_nodes[aSibling].parent = NULL_NODE;
+    }
+    else
+    {
+        if (m_nodes[aGrandParent].left == aParent)
+        {
+            m_nodes[aGrandParent].left = aSibling;
+        }
+        else
+        {
+            m_nodes[aGrandParent].right = aSibling;
+        }
+        m_nodes[aSibling].parent = aGrandParent;
+    }
+    freeNode(aParent);
+    m_nodes[iLeaf].parent = NULL_NODE;
+
+    refitAncestors(aGrandParent);
+}
+
+int32_t BVH::findBestSibling(const AABB &iBox) const
+{
+    // branch and bound: the cost of a sibling is the area of the new parent plus the growth of its ancestors
+    struct Candidate
+    {
+        int32_t node;
+        float inheritedCost;
+
+        bool operator<(const Candidate &iOther) const { return inheritedCost > iOther.inheritedCost; }
+    };
+
+    const float aArea = iBox.GetSurfaceArea();
+    int32_t aBest = m_root;
+    float aBestCost = AABB::Union(m_nodes[m_root].box, iBox).GetSurfaceArea();
+
+    std::priority_queue<Candidate> aQueue;
+    aQueue.push({m_root, 0.0f});
+    while (!aQueue.empty())
+    {
+        Candidate aCandidate = aQueue.top();
+        aQueue.pop();
+        if (aCandidate.inheritedCost + aArea >= aBestCost)
+        {
+            // every candidate left is at least as expensive
+            break;
+        }
+
+        const Node &aNode = m_nodes[aCandidate.node];
+        float aDirectCost = AABB::Union(aNode.box, iBox).GetSurfaceArea();
+        float aCost = aDirectCost + aCandidate.inheritedCost;
+        if (aCost < aBestCost)
+        {
+            aBestCost = aCost;
+            aBest = aCandidate.node;
+        }
+
+        if (!aNode.IsLeaf())
+        {
+            float aInherited = aCandidate.inheritedCost + aDirectCost - aNode.box.GetSurfaceArea();
+            if (aInherited + aArea < aBestCost)
+            {
+                aQueue.push({aNode.left, aInherited});
+                aQueue.push({aNode.right, aInherited});
+            }
+        }
+    }
+    return aBest;
+}
+
+void BVH::refitAncestors(int32_t iNode)
+{
+    for (int32_t aIndex = iNode; aIndex != NULL_NODE; aIndex = m_nodes[aIndex].parent)
+    {
+        Node &aNode = m_nodes[aIndex];
+        aNode.box = AABB::Union(m_nodes[aNode.left].box, m_nodes[aNode.right].box);
+        aNode.height = 1 + std::max(m_nodes[aNode.left].height, m_nodes[aNode.right].height);
+    }
+}
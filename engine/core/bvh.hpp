@@ -0,0 +1,348 @@
+#pragma once
+
+#include <cfloat>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "render/bounds.hpp"
+#include "render/frustum.hpp"
+
+struct Ray
+{
+    glm::vec3 origin = glm::vec3(0.0f);
+    // doesn't need to be normalized, distances are in units of its length
+    glm::vec3 direction = glm::vec3(0.0f, 0.0f, -1.0f);
+    float maxDistance = FLT_MAX;
+};
+
+struct RayHit
+{
+    uint32_t userData;
+    float distance;
+};
+
+/**
+ * Bounding volume hierarchy over the objects of a scene, one leaf per object carrying a user value.
+ * Static content is best given at once to Build (top down, binned surface area heuristic). Moving objects go
+ * through Insert/Move/Remove: insertion picks the sibling of least surface area cost (branch and bound) and
+ * leaves keep a box fattened by a margin, so that small moves don't touch the tree. When most objects move
+ * a little every frame, Update their boxes then Refit the tree in one bottom up pass instead.
+ * Proxies (leaf ids) stay valid until removed. Queries are const and can run concurrently.
+ */
+class BVH
+{
+public:
+    static constexpr int32_t NULL_NODE = -1;
+
+    struct Item
+    {
+        AABB box;
+        uint32_t userData;
+    };
+
+    explicit BVH(float iMargin = 0.1f);
+
+    // replaces the content of the tree, returns the proxies in the order of iItems
+    std::vector<int32_t> Build(const std::vector<Item> &iItems);
+    int32_t Insert(const AABB &iBox, uint32_t iUserData);
+    void Remove(int32_t iProxy);
+    /**
+     * Reinserts the proxy when iBox gets out of its fattened box, returns whether it did.
+     * iDisplacement (the move expected for the next frame) stretches the new fat box in that direction.
+     */
+    bool Move(int32_t iProxy, const AABB &iBox, const glm::vec3 &iDisplacement = glm::vec3(0.0f));
+    // sets the exact box of a leaf without touching the tree, Refit must be called before the next query
+    void Update(int32_t iProxy, const AABB &iBox);
+    void Refit();
+    void Clear();
+
+    uint32_t GetUserData(int32_t iProxy) const { return m_nodes[iProxy].userData; }
+    const AABB &GetBox(int32_t iProxy) const { return m_nodes[iProxy].box; }
+    size_t Size() const { return m_leafCount; }
+    int GetHeight() const { return m_root == NULL_NODE ? 0 : m_nodes[m_root].height; }
+    // sum of the surface areas of the internal nodes over the one of the root, lower is better
+    float GetAreaRatio() const;
+
+    // iVisit(userData) for every leaf intersecting iFrustum, subtrees fully inside are not tested further
+    template <typename F>
+    void QueryFrustum(const Frustum &iFrustum, F &&iVisit) const;
+    // iVisit(userData) for every leaf overlapping iBox
+    template <typename F>
+    void QueryOverlaps(const AABB &iBox, F &&iVisit) const;
+    /**
+     * Closest hit along iRay. iHit(userData, ray) tests the actual object of a leaf whose box the ray
+     * crosses and returns the distance of the hit, or a negative value for a miss.
+     */
+    template <typename F>
+    std::optional<RayHit> Raycast(const Ray &iRay, F &&iHit) const;
+    // iPair(userDataA, userDataB) once for every pair of overlapping leaves (broad phase)
+    template <typename F>
+    void QueryPairs(F &&iPair) const;
+
+private:
+    struct Node
+    {
+        AABB box;
+        // next free node while in the free list
+        int32_t parent = NULL_NODE;
+        int32_t left = NULL_NODE;
+        int32_t right = NULL_NODE;
+        // 0 for leaves, -1 for free nodes
+        int32_t height = -1;
+        uint32_t userData = 0;
+
+        bool IsLeaf() const { return left == NULL_NODE; }
+    };
+
+    // traversal stack on the stack frame, spilling to the heap for very deep trees
+    template <typename T>
+    class Stack
+    {
+    public:
+        void Push(const T &iValue)
+        {
+            if (m_size < FIXED)
+            {
+                m_fixed[m_size] = iValue;
+            }
+            else
+            {
+                m_overflow.push_back(iValue);
+            }
+            m_size++;
+        }
+        T Pop()
+        {
+            m_size--;
+            if (m_size < FIXED)
+            {
+                return m_fixed[m_size];
+            }
+            T aValue = m_overflow.back();
+            m_overflow.pop_back();
+            return aValue;
+        }
+        bool IsEmpty() const { return m_size == 0; }
+
+    private:
+        static constexpr size_t FIXED = 64;
+        T m_fixed[FIXED];
+        std::vector<T> m_overflow;
+        size_t m_size = 0;
+    };
+
+    int32_t allocateNode();
+    void freeNode(int32_t iNode);
+    void insertLeaf(int32_t iLeaf);
+    void removeLeaf(int32_t iLeaf);
+    int32_t findBestSibling(const AABB &iBox) const;
+    // refits the boxes and heights from iNode up to the root
+    void refitAncestors(int32_t iNode);
+    int32_t buildRange(std::vector<uint32_t> &ioItems, size_t iBegin, size_t iEnd, const std::vector<glm::vec3> &iCentroids, const std::vector<int32_t> &iLeaves);
+
+    float m_margin;
+    std::vector<Node> m_nodes;
+    int32_t m_root = NULL_NODE;
+    int32_t m_freeList = NULL_NODE;
+    size_t m_leafCount = 0;
+
+    // internal nodes children first, rebuilt when the topology changes
+    std::vector<int32_t> m_refitOrder;
+    bool m_bTopologyChanged = true;
+};
+
+template <typename F>
+void BVH::QueryFrustum(const Frustum &iFrustum, F &&iVisit) const
+{
+    if (m_root == NULL_NODE)
+    {
+        return;
+    }
+
+    const auto &aPlanes = iFrustum.GetPlanes();
+    constexpr uint32_t ALL_INSIDE = 0;
+    constexpr uint32_t ALL_PLANES = (1u << Frustum::PLANE_COUNT) - 1;
+
+    // the mask holds the planes the node still has to be tested against
+    struct Entry
+    {
+        int32_t node;
+        uint32_t mask;
+    };
+    Stack<Entry> aStack;
+    aStack.Push({m_root, ALL_PLANES});
+    while (!aStack.IsEmpty())
+    {
+        Entry aEntry = aStack.Pop();
+        const Node &aNode = m_nodes[aEntry.node];
+
+        uint32_t aMask = aEntry.mask;
+        bool aOutside = false;
+        glm::vec3 aCenter = aNode.box.GetCenter();
+        glm::vec3 aExtents = aNode.box.GetExtents();
+        for (uint32_t aPlane = 0; aPlane < Frustum::PLANE_COUNT && aMask != ALL_INSIDE; aPlane++)
+        {
+            if ((aMask & (1u << aPlane)) == 0)
+            {
+                continue;
+            }
+            float aDistance = glm::dot(glm::vec3(aPlanes[aPlane]), aCenter) + aPlanes[aPlane].w;
+            float aRadius = glm::dot(glm::abs(glm::vec3(aPlanes[aPlane])), aExtents);
+            if (aDistance + aRadius < 0.0f)
+            {
+                aOutside = true;
+                break;
+            }
+            if (aDistance - aRadius >= 0.0f)
+            {
+                aMask &= ~(1u << aPlane);
+            }
+        }
+        if (aOutside)
+        {
+            continue;
+        }
+
+        if (aNode.IsLeaf())
+        {
+            iVisit(aNode.userData);
+        }
+        else
+        {
+            aStack.Push({aNode.left, aMask});
+            aStack.Push({aNode.right, aMask});
+        }
+    }
+}
+
+template <typename F>
+void BVH::QueryOverlaps(const AABB &iBox, F &&iVisit) const
+{
+    if (m_root == NULL_NODE)
+    {
+        return;
+    }
+
+    Stack<int32_t> aStack;
+    aStack.Push(m_root);
+    while (!aStack.IsEmpty())
+    {
+        const Node &aNode = m_nodes[aStack.Pop()];
+        if (!aNode.box.Overlaps(iBox))
+        {
+            continue;
+        }
+        if (aNode.IsLeaf())
+        {
+            iVisit(aNode.userData);
+        }
+        else
+        {
+            aStack.Push(aNode.left);
+            aStack.Push(aNode.right);
+        }
+    }
+}
+
+template <typename F>
+std::optional<RayHit> BVH::Raycast(const Ray &iRay, F &&iHit) const
+{
+    if (m_root == NULL_NODE)
+    {
+        return std::nullopt;
+    }
+
+    // slab test, infinities from zero components compare the right way
+    glm::vec3 aInverse = glm::vec3(1.0f) / iRay.direction;
+    auto aEntryDistance = [&](const AABB &iBox) -> float
+    {
+        glm::vec3 aNear = (iBox.min - iRay.origin) * aInverse;
+        glm::vec3 aFar = (iBox.max - iRay.origin) * aInverse;
+        glm::vec3 aMin = glm::min(aNear, aFar);
+        glm::vec3 aMax = glm::max(aNear, aFar);
+        float aEnter = glm::max(glm::max(aMin.x, aMin.y), glm::max(aMin.z, 0.0f));
+        float aExit = glm::min(glm::min(aMax.x, aMax.y), aMax.z);
+        return aEnter <= aExit ? aEnter : std::numeric_limits<float>::infinity();
+    };
+
+    std::optional<RayHit> aClosest;
+    float aMaxDistance = iRay.maxDistance;
+    Stack<int32_t> aStack;
+    aStack.Push(m_root);
+    while (!aStack.IsEmpty())
+    {
+        const Node &aNode = m_nodes[aStack.Pop()];
+        if (aEntryDistance(aNode.box) > aMaxDistance)
+        {
+            continue;
+        }
+        if (aNode.IsLeaf())
+        {
+            float aDistance = iHit(aNode.userData, iRay);
+            if (aDistance >= 0.0f && aDistance <= aMaxDistance)
+            {
+                aMaxDistance = aDistance;
+                aClosest = RayHit{aNode.userData, aDistance};
+            }
+            continue;
+        }
+
+        // nearest child popped first, it shrinks the max distance for the other one
+        float aLeft = aEntryDistance(m_nodes[aNode.left].box);
+        float aRight = aEntryDistance(m_nodes[aNode.right].box);
+        if (aLeft < aRight)
+        {
+            aStack.Push(aNode.right);
+            aStack.Push(aNode.left);
+        }
+        else
+        {
+            aStack.Push(aNode.left);
+            aStack.Push(aNode.right);
+        }
+    }
+    return aClosest;
+}
+
+template <typename F>
+void BVH::QueryPairs(F &&iPair) const
+{
+    for (int32_t i = 0; i < static_cast<int32_t>(m_nodes.size()); i++)
+    {
+        const Node &aLeaf = m_nodes[i];
+        if (aLeaf.height != 0)
+        {
+            continue;
+        }
+
+        // each pair is reported by the leaf with the lower proxy
+        Stack<int32_t> aStack;
+        aStack.Push(m_root);
+        while (!aStack.IsEmpty())
+        {
+            int32_t aIndex = aStack.Pop();
+            const Node &aNode = m_nodes[aIndex];
+            if (!aNode.box.Overlaps(aLeaf.box))
+            {
+                continue;
+            }
+            if (aNode.IsLeaf())
+            {
+                if (aIndex > i)
+                {
+                    iPair(aLeaf.userData, aNode.userData);
+                }
+            }
+            else
+            {
+                aStack.Push(aNode.left);
+                aStack.Push(aNode.right);
+            }
+        }
+    }
+}
@@ -4,6 +4,8 @@
 #include <GLFW/glfw3.h>
 #include <glm/glm.hpp>
 
+#include "bvh.hpp"
+
 class Scene
 {
 public:
@@ -18,4 +20,10 @@ public:
         Update(deltaTime);
         Draw(deltaTime);
     }
+
+    // spatial index over the objects of the scene (culling, picking, overlaps), user data is up to each scene
+    const BVH &GetSpatialIndex() const { return m_spatialIndex; }
+
+protected:
+    BVH m_spatialIndex;
 };
\ No newline at end of file
@@ -24,18 +24,21 @@ void SceneBackpack::Init()
     m_resourceManager->Load<Shader>("model", "assets/shaders/model.vert", "assets/shaders/model.frag");
     m_resourceManager->Load<Shader>("light", "assets/shaders/light.vert", "assets/shaders/light.frag");
 
-    m_resourceManager->Get<Shader>("model")->Use();
-    m_resourceManager->Get<Shader>("model")->Upload("projection", m_camera.GetProjectionMatrix());
     m_resourceManager->Get<Shader>("model")->Upload("model", glm::mat4(1.0f));
     m_resourceManager->Get<Shader>("model")->Upload("material.shininess", 32.0f);
 
-    m_resourceManager->Get<Shader>("model")->Upload("light.ambient", glm::vec3(0.2f, 0.2f, 0.2f));
-    m_resourceManager->Get<Shader>("model")->Upload("light.diffuse", glm::vec3(0.5f, 0.5f, 0.5f));
-    m_resourceManager->Get<Shader>("model")->Upload("light.specular", glm::vec3(0.7f, 0.7f, 0.7f));
-
-    m_resourceManager->Get<Shader>("light")->Use();
-    m_resourceManager->Get<Shader>("light")->Upload("projection", m_camera.GetProjectionMatrix());
     m_resourceManager->Get<Shader>("light")->Upload("color", glm::vec3(1.0f));
+
+    // the light moves, its proxy follows it in Draw
+    m_backpackProxy = m_spatialIndex.Insert(m_backpack.GetBounds(), OBJECT_BACKPACK);
+    m_lightProxy = m_spatialIndex.Insert(m_light.GetBounds(), OBJECT_LIGHT);
+
+    m_frameUniforms.Create(static_cast<GLuint>(UniformBinding::Frame));
+    m_lightUniforms.Create(static_cast<GLuint>(UniformBinding::Light));
+    m_lightBlock = {};
+    m_lightBlock.ambient = glm::vec3(0.2f, 0.2f, 0.2f);
+    m_lightBlock.diffuse = glm::vec3(0.5f, 0.5f, 0.5f);
+    m_lightBlock.specular = glm::vec3(0.7f, 0.7f, 0.7f);
 }
 
 void SceneBackpack::Update(float deltaTime)
@@ -57,23 +60,35 @@ void SceneBackpack::Draw(float deltaTime)
 {
     float currentFrame = static_cast<float>(glfwGetTime());
 
-    const glm::mat4 &view = m_camera.GetViewMatrix();
-
     glm::mat4 lightModel = glm::mat4(1.0f);
     lightModel = glm::rotate(lightModel, currentFrame, glm::vec3(0.0f, 1.0f, 0.0f));
     lightModel = glm::translate(lightModel, glm::vec3(2.0f, 0.0f, 0.0f));
     lightModel = glm::scale(lightModel, glm::vec3(0.1f));
-    glm::vec3 lightPos = glm::vec3(lightModel[3]);
 
-    Shader &lightShader = *(m_resourceManager->Get<Shader>("light").get());
-    lightShader.Use();
-    lightShader.Upload("view", view);
-    m_light.Draw(lightShader, lightModel);
+    FrameBlock frame = {};
+    frame.view = m_camera.GetViewMatrix();
+    frame.projection = m_camera.GetProjectionMatrix();
+    frame.viewProjection = m_camera.GetViewProjectionMatrix();
+    frame.viewPos = m_camera.GetPosition();
+    frame.time = currentFrame;
+    frame.deltaTime = deltaTime;
+    m_frameUniforms.Update(frame);
+
+    m_lightBlock.position = glm::vec3(lightModel[3]);
+    m_lightUniforms.Update(m_lightBlock);
 
+    Shader &lightShader = *(m_resourceManager->Get<Shader>("light").get());
     Shader &modelShader = *(m_resourceManager->Get<Shader>("model").get());
-    modelShader.Use();
-    modelShader.Upload("view", view);
-    modelShader.Upload("light.position", lightPos);
-    modelShader.Upload("viewPos", m_camera.GetPosition());
-    m_backpack.Draw(modelShader, glm::mat4(1.0f));
+    Frustum frustum(m_camera.GetViewProjectionMatrix());
+    LodSelector lods(m_camera);
+    m_spatialIndex.Move(m_lightProxy, m_light.GetBounds().Transformed(lightModel));
+
+    bool visible[OBJECT_COUNT] = {};
+    m_spatialIndex.QueryFrustum(frustum, [&](uint32_t object)
+                                { visible[object] = true; });
+    if (visible[OBJECT_LIGHT])
+        m_light.Submit(m_renderQueue, lightShader, lightModel, frustum, lods);
+    if (visible[OBJECT_BACKPACK])
+        m_backpack.Submit(m_renderQueue, modelShader, glm::mat4(1.0f), frustum, lods);
+    m_renderQueue.Flush();
 }
\ No newline at end of file
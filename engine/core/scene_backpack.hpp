@@ -7,8 +7,10 @@
 #include "scene.hpp"
 
 #include "render/shader.hpp"
+#include "render/uniform_buffer.hpp"
 #include "render/camera/camera_perspective.hpp"
 #include "render/model.hpp"
+#include "render/render_queue.hpp"
 #include "resources/manager.hpp"
 
 class SceneBackpack : public Scene
@@ -27,6 +29,20 @@ private:
     ResourceManager *m_resourceManager;
 
     PerspectiveCamera m_camera;
+    // camera and light, written once per frame and shared by both shaders
+    UniformBuffer<FrameBlock> m_frameUniforms;
+    UniformBuffer<LightBlock> m_lightUniforms;
+    LightBlock m_lightBlock;
+    RenderQueue m_renderQueue;
     Model m_backpack;
     Model m_light;
+    // proxies in m_spatialIndex, whose user data is the index of the model in this list
+    enum SceneObject : uint32_t
+    {
+        OBJECT_BACKPACK = 0,
+        OBJECT_LIGHT,
+        OBJECT_COUNT,
+    };
+    int32_t m_backpackProxy = BVH::NULL_NODE;
+    int32_t m_lightProxy = BVH::NULL_NODE;
 };
\ No newline at end of file
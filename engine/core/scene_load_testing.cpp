@@ -18,24 +18,45 @@ void SceneLoadingTest::Init()
 {
     m_camera = PerspectiveCamera({45.0f, (float)m_width, (float)m_height, 0.1f, 150.0f}, glm::vec3(0.0f, 0.0f, 9.0f), glm::vec3(0, 0, 0), glm::vec3(0, 1, 0));
 
-    m_meshes = Loader::Load("assets/meshes/backpack/backpack.obj");
-    m_light = Loader::Load("assets/meshes/cube/cube.obj")[0];
+    m_meshes = m_resourceManager->LoadAsync<std::vector<Mesh>>("backpack", "assets/meshes/backpack/backpack.obj");
+    m_light = std::move(Loader::Load("assets/meshes/cube/cube.obj")[0]);
 
     m_resourceManager->Load<Shader>("model", "assets/shaders/model.vert", "assets/shaders/model.frag");
+    m_resourceManager->Load<Shader>("model_indirect", "assets/shaders/model.vert", "assets/shaders/model.frag", m_materials.GetShaderDefines());
+    m_resourceManager->Load<Shader>("cull", "assets/shaders/cull.comp");
+    m_resourceManager->Load<Shader>("hiz_reduce", "assets/shaders/hiz_reduce.comp");
     m_resourceManager->Load<Shader>("light", "assets/shaders/light.vert", "assets/shaders/light.frag");
+    m_resourceManager->Load<Shader>("light_instanced", "assets/shaders/light.vert", "assets/shaders/light.frag", std::vector<std::string>{"INSTANCED"});
 
-    m_resourceManager->Get<Shader>("model")->Use();
-    m_resourceManager->Get<Shader>("model")->Upload("projection", m_camera.GetProjectionMatrix());
     m_resourceManager->Get<Shader>("model")->Upload("model", glm::mat4(1.0f));
     m_resourceManager->Get<Shader>("model")->Upload("material.shininess", 32.0f);
 
-    m_resourceManager->Get<Shader>("model")->Upload("light.ambient", glm::vec3(0.2f, 0.2f, 0.2f));
-    m_resourceManager->Get<Shader>("model")->Upload("light.diffuse", glm::vec3(0.5f, 0.5f, 0.5f));
-    m_resourceManager->Get<Shader>("model")->Upload("light.specular", glm::vec3(0.7f, 0.7f, 0.7f));
-
-    m_resourceManager->Get<Shader>("light")->Use();
-    m_resourceManager->Get<Shader>("light")->Upload("projection", m_camera.GetProjectionMatrix());
     m_resourceManager->Get<Shader>("light")->Upload("color", glm::vec3(1.0f));
+    m_resourceManager->Get<Shader>("light_instanced")->Upload("color", glm::vec3(1.0f));
+
+    const int propsPerSide = 100;
+    m_props = InstanceBatch(m_light);
+    std::vector<BVH::Item> propBounds;
+    for (int x = 0; x < propsPerSide; x++)
+    {
+        for (int z = 0; z < propsPerSide; z++)
+        {
+            glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3(x - propsPerSide / 2, -3.0f, z - propsPerSide / 2));
+            model = glm::scale(model, glm::vec3(0.1f));
+            glm::vec4 tint = glm::vec4(x / float(propsPerSide), 0.5f, z / float(propsPerSide), 1.0f);
+            propBounds.push_back({m_light.GetBounds().box.Transformed(model), static_cast<uint32_t>(m_propInstances.size())});
+            m_propInstances.push_back({model, tint});
+        }
+    }
+    // the props never move, built once
+    m_spatialIndex.Build(propBounds);
+
+    m_frameUniforms.Create(static_cast<GLuint>(UniformBinding::Frame));
+    m_lightUniforms.Create(static_cast<GLuint>(UniformBinding::Light));
+    m_lightBlock = {};
+    m_lightBlock.ambient = glm::vec3(0.2f, 0.2f, 0.2f);
+    m_lightBlock.diffuse = glm::vec3(0.5f, 0.5f, 0.5f);
+    m_lightBlock.specular = glm::vec3(0.7f, 0.7f, 0.7f);
 }
 
 void SceneLoadingTest::Update(float deltaTime)
@@ -55,24 +76,69 @@ void SceneLoadingTest::Update(float deltaTime)
 
 void SceneLoadingTest::Draw(float deltaTime)
 {
+    float currentFrame = static_cast<float>(glfwGetTime());
+
     glm::mat4 lightModel = glm::mat4(1.0f);
-    lightModel = glm::rotate(lightModel, static_cast<float>(glfwGetTime()), glm::vec3(0.0f, 1.0f, 0.0f));
+    lightModel = glm::rotate(lightModel, currentFrame, glm::vec3(0.0f, 1.0f, 0.0f));
     lightModel = glm::translate(lightModel, glm::vec3(2.0f, 0.0f, 0.0f));
     lightModel = glm::scale(lightModel, glm::vec3(0.1f));
-    glm::vec3 lightPos = glm::vec3(lightModel[3]);
 
-    Shader &lightShader = *(m_resourceManager->Get<Shader>("light").get());
-    lightShader.Use();
-    lightShader.Upload("view", m_camera.GetViewMatrix());
-    lightShader.Upload("model", lightModel);
-    m_light.Draw(lightShader);
+    FrameBlock frame = {};
+    frame.view = m_camera.GetViewMatrix();
+    frame.projection = m_camera.GetProjectionMatrix();
+    frame.viewProjection = m_camera.GetViewProjectionMatrix();
+    frame.viewPos = m_camera.GetPosition();
+    frame.time = currentFrame;
+    frame.deltaTime = deltaTime;
+    m_frameUniforms.Update(frame);
 
+    m_lightBlock.position = glm::vec3(lightModel[3]);
+    m_lightUniforms.Update(m_lightBlock);
+
+    Shader &lightShader = *(m_resourceManager->Get<Shader>("light").get());
     Shader &shader = *(m_resourceManager->Get<Shader>("model").get());
-    shader.Use();
-    shader.Upload("view", m_camera.GetViewMatrix());
-    shader.Upload("viewPos", m_camera.GetPosition());
-    shader.Upload("model", glm::mat4(1.0f));
-    shader.Upload("light.position", lightPos);
-    for (const Mesh &mesh : m_meshes)
-        mesh.Draw(shader);
+    m_renderQueue.Submit(m_light, lightShader, lightModel);
+    Frustum frustum(m_camera.GetViewProjectionMatrix());
+    m_visibleProps.clear();
+    m_spatialIndex.QueryFrustum(frustum, [&](uint32_t prop)
+                                { m_visibleProps.push_back(prop); });
+    // the instances are only uploaded again when the visible set changes
+    if (m_visibleProps != m_previousVisibleProps)
+    {
+        std::vector<InstanceData> &instances = m_props.GetInstances();
+        instances.clear();
+        for (uint32_t prop : m_visibleProps)
+            instances.push_back(m_propInstances[prop]);
+        std::swap(m_visibleProps, m_previousVisibleProps);
+    }
+    m_renderQueue.Submit(m_props, *(m_resourceManager->Get<Shader>("light_instanced").get()));
+
+    std::shared_ptr<std::vector<Mesh>> meshes = m_meshes.Get();
+    if (!meshes)
+    {
+        // placeholder until the backpack is uploaded
+        m_renderQueue.Submit(m_light, shader, glm::mat4(1.0f));
+    }
+    else if (m_staticMeshes.Size() == 0)
+    {
+        for (const Mesh &mesh : *meshes)
+            m_staticMeshes.Add(mesh);
+    }
+    m_renderQueue.Flush();
+
+    // culled and drawn from the GPU, against the depth of the last frame too
+    Shader &cullShader = *(m_resourceManager->Get<Shader>("cull").get());
+    CullView view(frustum, LodSelector(m_camera));
+    m_staticMeshes.Draw(*(m_resourceManager->Get<Shader>("model_indirect").get()), cullShader, view, &m_depthPyramid);
+    // checked once against the CPU reference (reads back and stalls), works on software GL as well
+    if (m_bValidateCulling && m_staticMeshes.GetGPUCuller())
+    {
+        if (m_staticMeshes.GetGPUCuller()->Validate(cullShader, view, &m_depthPyramid))
+            INFO("GPU culling matches the CPU reference");
+        m_bValidateCulling = false;
+    }
+
+    int framebufferWidth, framebufferHeight;
+    glfwGetFramebufferSize(m_window, &framebufferWidth, &framebufferHeight);
+    m_depthPyramid.Build(*(m_resourceManager->Get<Shader>("hiz_reduce").get()), framebufferWidth, framebufferHeight, m_camera.GetViewProjectionMatrix());
 }
\ No newline at end of file
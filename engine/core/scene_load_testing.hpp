@@ -9,8 +9,15 @@
 #include "scene.hpp"
 
 #include "render/shader.hpp"
+#include "render/uniform_buffer.hpp"
 #include "render/camera/camera_perspective.hpp"
 #include "render/model.hpp"
+#include "render/geometry_pool.hpp"
+#include "render/gpu_culler.hpp"
+#include "render/indirect_batch.hpp"
+#include "render/instance_batch.hpp"
+#include "render/material_system.hpp"
+#include "render/render_queue.hpp"
 #include "resources/manager.hpp"
 #include "resources/loaders/all.hpp"
 #include "helpers/log.hpp"
@@ -31,6 +38,25 @@ private:
     ResourceManager *m_resourceManager;
 
     PerspectiveCamera m_camera;
-    std::vector<Mesh> m_meshes;
+    // camera and light, written once per frame and shared by both shaders
+    UniformBuffer<FrameBlock> m_frameUniforms;
+    UniformBuffer<LightBlock> m_lightUniforms;
+    LightBlock m_lightBlock;
+    RenderQueue m_renderQueue;
+    ResourceHandle<std::vector<Mesh>> m_meshes;
+    // the backpack, moved into shared buffers and multi drawn once loaded
+    GeometryPool m_geometry;
+    MaterialSystem m_materials;
+    IndirectBatch m_staticMeshes{m_geometry, m_materials};
+    // depth of the last frame, occludes the static meshes
+    HiZPyramid m_depthPyramid;
+    bool m_bValidateCulling = true;
+    // also drawn in place of the meshes while they load
     Mesh m_light;
+    // grid of small cubes, indexed by m_spatialIndex (user data: index in m_propInstances)
+    std::vector<InstanceData> m_propInstances;
+    // the visible ones, drawn in a single instanced call
+    InstanceBatch m_props;
+    std::vector<uint32_t> m_visibleProps;
+    std::vector<uint32_t> m_previousVisibleProps;
 };
\ No newline at end of file
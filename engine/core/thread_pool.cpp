@@ -0,0 +1,136 @@
+#include "thread_pool.hpp"
+
+ThreadPool::ThreadPool(size_t iThreadCount)
+{
+    m_workers.reserve(iThreadCount);
+    for (size_t i = 0; i < iThreadCount; i++)
+    {
+        m_workers.emplace_back([this]()
+                               { work(); });
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> aLock(m_mutex);
+        m_bStopping = true;
+    }
+    m_condition.notify_all();
+
+    for (std::thread &aWorker : m_workers)
+    {
+        aWorker.join();
+    }
+}
+
+ThreadPool &ThreadPool::Get()
+{
+    static ThreadPool aPool;
+    return aPool;
+}
+
+void ThreadPool::ParallelFor(size_t iCount, const std::function<void(size_t)> &iTask)
+{
+    if (iCount == 0)
+    {
+        return;
+    }
+    if (iCount == 1 || m_workers.empty())
+    {
+        for (size_t i = 0; i < iCount; i++)
+        {
+            iTask(i);
+        }
+        return;
+    }
+
+    // shared with the helpers, some of them may only get scheduled after every index has been processed
+    struct State
+    {
+        std::atomic<size_t> next = 0;
+        std::atomic<size_t> done = 0;
+        std::mutex mutex;
+        std::condition_variable finished;
+        // first exception thrown by iTask, the indices after it are counted without running
+        std::atomic<bool> failed = false;
+        std::exception_ptr error;
+    };
+    auto aState = std::make_shared<State>();
+
+    auto aRun = [aState, &iTask, iCount]()
+    {
+        size_t aIndex;
+        while ((aIndex = aState->next.fetch_add(1)) < iCount)
+        {
+            // an exception must not leave while the helpers still reference iTask, nor escape a worker
+            if (!aState->failed.load())
+            {
+                try
+                {
+                    iTask(aIndex);
+                }
+                catch (...)
+                {
+                    std::lock_guard<std::mutex> aLock(aState->mutex);
+                    if (!aState->error)
+                    {
+                        aState->error = std::current_exception();
+                    }
+                    aState->failed = true;
+                }
+            }
+            if (aState->done.fetch_add(1) + 1 == iCount)
+            {
+                std::lock_guard<std::mutex> aLock(aState->mutex);
+                aState->finished.notify_all();
+            }
+        }
+    };
+
+    size_t aHelpers = std::min(iCount - 1, m_workers.size());
+    for (size_t i = 0; i < aHelpers; i++)
+    {
+        // a helper scheduled after every index was processed only sees an exhausted counter and never calls iTask
+        push(aRun);
+    }
+
+    aRun();
+
+    std::unique_lock<std::mutex> aLock(aState->mutex);
+    aState->finished.wait(aLock, [&aState, iCount]()
+                          { return aState->done.load() == iCount; });
+    if (aState->error)
+    {
+        std::rethrow_exception(aState->error);
+    }
+}
+
+void ThreadPool::push(std::function<void()> iTask)
+{
+    {
+        std::lock_guard<std::mutex> aLock(m_mutex);
+        m_tasks.push(std::move(iTask));
+    }
+    m_condition.notify_one();
+}
+
+void ThreadPool::work()
+{
+    while (true)
+    {
+        std::function<void()> aTask;
+        {
+            std::unique_lock<std::mutex> aLock(m_mutex);
+            m_condition.wait(aLock, [this]()
+                             { return m_bStopping || !m_tasks.empty(); });
+            if (m_bStopping && m_tasks.empty())
+            {
+                return;
+            }
+            aTask = std::move(m_tasks.front());
+            m_tasks.pop();
+        }
+        aTask();
+    }
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+/**
+ * Fixed size pool of worker threads used for CPU side work (asset parsing, decoding, ...).
+ * Tasks must never touch the OpenGL context, it only lives on the main thread.
+ */
+class ThreadPool
+{
+public:
+    explicit ThreadPool(size_t iThreadCount = std::max(1u, std::thread::hardware_concurrency()));
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    // engine wide pool, created on first use
+    static ThreadPool &Get();
+
+    size_t GetThreadCount() const { return m_workers.size(); }
+
+    template <typename F>
+    std::future<std::invoke_result_t<F>> Submit(F &&iTask)
+    {
+        using Result = std::invoke_result_t<F>;
+        auto aTask = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(iTask));
+        std::future<Result> aFuture = aTask->get_future();
+        push([aTask]()
+             { (*aTask)(); });
+        return aFuture;
+    }
+
+    /**
+     * Runs iTask(i) for every i in [0, iCount) and returns once all of them are done.
+     * The calling thread takes part in the work, so it is safe to call from inside a pool task.
+     * When a task throws, the indices not started yet are skipped and the first exception is rethrown
+     * to the caller, once no thread runs iTask anymore.
+     */
+    void ParallelFor(size_t iCount, const std::function<void(size_t)> &iTask);
+
+private:
+    void push(std::function<void()> iTask);
+    void work();
+
+    std::vector<std::thread> m_workers;
+    std::queue<std::function<void()>> m_tasks;
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    bool m_bStopping = false;
+};
@@ -0,0 +1,253 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+#include <utility>
+#include <vector>
+
+/**
+ * Open addressing hash map with Robin Hood linear probing.
+ * Entries live in one contiguous array (no allocation per entry) which makes it a good fit for hot lookups
+ * such as vertex de-duplication. Pointers returned by Find/TryEmplace are invalidated by any insertion that
+ * makes the table grow, call Reserve with an estimate of the final size up front to avoid rehashing.
+ *
+ * Key and Value must be default constructible and movable.
+ */
+template <typename Key, typename Value, typename Hash = std::hash<Key>, typename Equal = std::equal_to<Key>>
+class FlatHashMap
+{
+public:
+    FlatHashMap() = default;
+    explicit FlatHashMap(size_t iExpectedSize)
+    {
+        Reserve(iExpectedSize);
+    }
+
+    size_t Size() const { return m_size; }
+    bool Empty() const { return m_size == 0; }
+    size_t Capacity() const { return m_slots.size(); }
+
+    // makes room for iExpectedSize entries without any further rehash
+    void Reserve(size_t iExpectedSize)
+    {
+        size_t aCapacity = MIN_CAPACITY;
+        while (aCapacity * MAX_LOAD_NUMERATOR < iExpectedSize * MAX_LOAD_DENOMINATOR)
+        {
+            aCapacity *= 2;
+        }
+        if (aCapacity > m_slots.size())
+        {
+            rehash(aCapacity);
+        }
+    }
+
+    Value *Find(const Key &iKey)
+    {
+        size_t aIndex = findIndex(iKey);
+        return aIndex == NPOS ? nullptr : &m_slots[aIndex].value;
+    }
+
+    const Value *Find(const Key &iKey) const
+    {
+        size_t aIndex = findIndex(iKey);
+        return aIndex == NPOS ? nullptr : &m_slots[aIndex].value;
+    }
+
+    bool Contains(const Key &iKey) const
+    {
+        return findIndex(iKey) != NPOS;
+    }
+
+    /**
+     * Inserts iKey with a value built from iArgs if the key is not present yet.
+     * Returns the value stored for iKey and whether it was inserted.
+     */
+    template <typename... Args>
+    std::pair<Value *, bool> TryEmplace(const Key &iKey, Args &&...iArgs)
+    {
+        size_t aIndex = findIndex(iKey);
+        if (aIndex != NPOS)
+        {
+            return {&m_slots[aIndex].value, false};
+        }
+
+        if ((m_size + 1) * MAX_LOAD_DENOMINATOR > m_slots.size() * MAX_LOAD_NUMERATOR)
+        {
+            rehash(m_slots.empty() ? MIN_CAPACITY : m_slots.size() * 2);
+        }
+
+        aIndex = insert(Slot{iKey, Value(std::forward<Args>(iArgs)...)});
+        if (aIndex == NPOS)
+        {
+            // the table grew while the entry was being placed
+            aIndex = findIndex(iKey);
+        }
+        return {&m_slots[aIndex].value, true};
+    }
+
+    Value &operator[](const Key &iKey)
+    {
+        return *TryEmplace(iKey).first;
+    }
+
+    bool Erase(const Key &iKey)
+    {
+        size_t aIndex = findIndex(iKey);
+        if (aIndex == NPOS)
+        {
+            return false;
+        }
+
+        // backward shift: pull the following displaced entries one slot closer to their home
+        size_t aNext = (aIndex + 1) & m_mask;
+        while (m_distances[aNext] > 1)
+        {
+            m_slots[aIndex] = std::move(m_slots[aNext]);
+            m_distances[aIndex] = m_distances[aNext] - 1;
+            aIndex = aNext;
+            aNext = (aNext + 1) & m_mask;
+        }
+        m_slots[aIndex] = Slot{};
+        m_distances[aIndex] = 0;
+        m_size--;
+        return true;
+    }
+
+    void Clear()
+    {
+        for (size_t i = 0; i < m_slots.size(); i++)
+        {
+            if (m_distances[i] != 0)
+            {
+                m_slots[i] = Slot{};
+                m_distances[i] = 0;
+            }
+        }
+        m_size = 0;
+    }
+
+    // calls iFunction(key, value) for every entry, in no particular order
+    template <typename F>
+    void ForEach(F &&iFunction) const
+    {
+        for (size_t i = 0; i < m_slots.size(); i++)
+        {
+            if (m_distances[i] != 0)
+            {
+                iFunction(m_slots[i].key, m_slots[i].value);
+            }
+        }
+    }
+
+private:
+    struct Slot
+    {
+        Key key = {};
+        Value value = {};
+    };
+
+    static constexpr size_t NPOS = static_cast<size_t>(-1);
+    static constexpr size_t MIN_CAPACITY = 16;
+    // maximum load factor of 7/8
+    static constexpr size_t MAX_LOAD_NUMERATOR = 7;
+    static constexpr size_t MAX_LOAD_DENOMINATOR = 8;
+    // probe distances are stored on a byte, 0 meaning an empty slot
+    static constexpr uint8_t MAX_DISTANCE = 255;
+
+    size_t home(const Key &iKey) const
+    {
+        // fibonacci hashing spreads weak hashes (std::hash<int> is the identity) over the whole table
+        uint64_t aHash = static_cast<uint64_t>(Hash{}(iKey)) * 0x9E3779B97F4A7C15ull;
+        return static_cast<size_t>(aHash >> m_shift);
+    }
+
+    size_t findIndex(const Key &iKey) const
+    {
+        if (m_size == 0)
+        {
+            return NPOS;
+        }
+
+        size_t aIndex = home(iKey);
+        // an entry further than its own probe distance would have displaced the one we look at (Robin Hood invariant)
+        for (uint8_t aDistance = 1; aDistance <= m_distances[aIndex]; aDistance++)
+        {
+            if (m_distances[aIndex] == aDistance && Equal{}(m_slots[aIndex].key, iKey))
+            {
+                return aIndex;
+            }
+            aIndex = (aIndex + 1) & m_mask;
+        }
+        return NPOS;
+    }
+
+    // places a key that is known to be absent, returns its slot or NPOS if the table had to grow meanwhile
+    size_t insert(Slot &&iSlot)
+    {
+        Slot aCarried = std::move(iSlot);
+        size_t aIndex = home(aCarried.key);
+        size_t aPlaced = NPOS;
+        uint8_t aDistance = 1;
+
+        while (true)
+        {
+            if (m_distances[aIndex] == 0)
+            {
+                m_slots[aIndex] = std::move(aCarried);
+                m_distances[aIndex] = aDistance;
+                m_size++;
+                return aPlaced == NPOS ? aIndex : aPlaced;
+            }
+
+            // take the slot from richer entries (closer to their home) and carry them further
+            if (m_distances[aIndex] < aDistance)
+            {
+                std::swap(aCarried, m_slots[aIndex]);
+                std::swap(aDistance, m_distances[aIndex]);
+                if (aPlaced == NPOS)
+                {
+                    aPlaced = aIndex;
+                }
+            }
+
+            aIndex = (aIndex + 1) & m_mask;
+            if (++aDistance == MAX_DISTANCE)
+            {
+                rehash(m_slots.size() * 2);
+                insert(std::move(aCarried));
+                return NPOS;
+            }
+        }
+    }
+
+    void rehash(size_t iCapacity)
+    {
+        std::vector<Slot> aSlots = std::move(m_slots);
+        std::vector<uint8_t> aDistances = std::move(m_distances);
+
+        m_slots = std::vector<Slot>(iCapacity);
+        m_distances = std::vector<uint8_t>(iCapacity, 0);
+        m_mask = iCapacity - 1;
+        m_shift = 64;
+        for (size_t aCapacity = iCapacity; aCapacity > 1; aCapacity >>= 1)
+        {
+            m_shift--;
+        }
+        m_size = 0;
+
+        for (size_t i = 0; i < aSlots.size(); i++)
+        {
+            if (aDistances[i] != 0)
+            {
+                insert(std::move(aSlots[i]));
+            }
+        }
+    }
+
+    std::vector<Slot> m_slots;
+    std::vector<uint8_t> m_distances;
+    size_t m_size = 0;
+    size_t m_mask = 0;
+    int m_shift = 64;
+};
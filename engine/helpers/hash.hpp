@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+namespace tools
+{
+    /**
+     * 64-bit non-cryptographic hash of a byte range, used to detect content changes of asset files.
+     * Processes 8 bytes per step (FNV-1a style mixing on words) so hashing a large file stays far cheaper than parsing it.
+     */
+    inline uint64_t HashBytes(std::string_view iData, uint64_t iSeed = 0xcbf29ce484222325ull)
+    {
+        constexpr uint64_t aPrime = 0x100000001b3ull;
+
+        uint64_t aHash = iSeed ^ (static_cast<uint64_t>(iData.size()) * aPrime);
+        size_t i = 0;
+        for (; i + 8 <= iData.size(); i += 8)
+        {
+            uint64_t aWord;
+            std::memcpy(&aWord, iData.data() + i, sizeof(aWord));
+            aHash = (aHash ^ aWord) * aPrime;
+            aHash ^= aHash >> 29;
+        }
+        for (; i < iData.size(); i++)
+        {
+            aHash = (aHash ^ static_cast<unsigned char>(iData[i])) * aPrime;
+        }
+
+        // final avalanche
+        aHash ^= aHash >> 33;
+        aHash *= 0xff51afd7ed558ccdull;
+        aHash ^= aHash >> 33;
+        return aHash;
+    }
+};
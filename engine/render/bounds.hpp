@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cfloat>
+
+#include <glm/glm.hpp>
+
+// axis aligned bounding box, empty (inverted) until a point is added
+struct AABB
+{
+    glm::vec3 min = glm::vec3(FLT_MAX);
+    glm::vec3 max = glm::vec3(-FLT_MAX);
+
+    bool IsValid() const { return min.x <= max.x && min.y <= max.y && min.z <= max.z; }
+    glm::vec3 GetCenter() const { return (min + max) * 0.5f; }
+    glm::vec3 GetExtents() const { return (max - min) * 0.5f; }
+    float GetSurfaceArea() const
+    {
+        glm::vec3 aSize = max - min;
+        return IsValid() ? 2.0f * (aSize.x * aSize.y + aSize.y * aSize.z + aSize.z * aSize.x) : 0.0f;
+    }
+
+    bool Overlaps(const AABB &iOther) const
+    {
+        return min.x <= iOther.max.x && max.x >= iOther.min.x &&
+               min.y <= iOther.max.y && max.y >= iOther.min.y &&
+               min.z <= iOther.max.z && max.z >= iOther.min.z;
+    }
+    bool Contains(const AABB &iOther) const
+    {
+        return min.x <= iOther.min.x && min.y <= iOther.min.y && min.z <= iOther.min.z &&
+               max.x >= iOther.max.x && max.y >= iOther.max.y && max.z >= iOther.max.z;
+    }
+
+    void Expand(const glm::vec3 &iPoint)
+    {
+        min = glm::min(min, iPoint);
+        max = glm::max(max, iPoint);
+    }
+
+    void Expand(const AABB &iOther)
+    {
+        if (iOther.IsValid())
+        {
+            min = glm::min(min, iOther.min);
+            max = glm::max(max, iOther.max);
+        }
+    }
+
+    static AABB Union(const AABB &iLeft, const AABB &iRight)
+    {
+        AABB aResult = iLeft;
+        aResult.Expand(iRight);
+        return aResult;
+    }
+
+    // box enclosing this one once transformed, without going through its 8 corners
+    AABB Transformed(const glm::mat4 &iTransform) const
+    {
+        if (!IsValid())
+        {
+            return {};
+        }
+        glm::vec3 aCenter = glm::vec3(iTransform * glm::vec4(GetCenter(), 1.0f));
+        glm::vec3 aExtents = GetExtents();
+        glm::vec3 aNewExtents = glm::abs(glm::vec3(iTransform[0])) * aExtents.x +
+                                glm::abs(glm::vec3(iTransform[1])) * aExtents.y +
+                                glm::abs(glm::vec3(iTransform[2])) * aExtents.z;
+        return {aCenter - aNewExtents, aCenter + aNewExtents};
+    }
+};
+
+struct BoundingSphere
+{
+    glm::vec3 center = glm::vec3(0.0f);
+    float radius = -1.0f;
+
+    bool IsValid() const { return radius >= 0.0f; }
+
+    // the scale of the transform is taken as its largest axis
+    BoundingSphere Transformed(const glm::mat4 &iTransform) const
+    {
+        float aScale = glm::max(glm::length(glm::vec3(iTransform[0])), glm::max(glm::length(glm::vec3(iTransform[1])), glm::length(glm::vec3(iTransform[2]))));
+        return {glm::vec3(iTransform * glm::vec4(center, 1.0f)), radius * aScale};
+    }
+};
+
+// both volumes of a mesh, in its local space
+struct Bounds
+{
+    AABB box;
+    BoundingSphere sphere;
+};
@@ -36,6 +36,11 @@ public:
 
     ~PerspectiveCamera() = default;
 
+    const Frustrum &GetFrustrum() const
+    {
+        return m_cameraFrustrum;
+    }
+
     void SetFrustrum(const Frustrum &frustrum)
     {
         m_cameraFrustrum = frustrum;
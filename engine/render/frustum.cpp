@@ -0,0 +1,153 @@
+#include "frustum.hpp"
+
+#include <algorithm>
+
+namespace
+{
+    glm::vec4 normalizePlane(const glm::vec4 &plane)
+    {
+        float length = glm::length(glm::vec3(plane));
+        return length > 0.0f ? plane / length : plane;
+    }
+}
+
+Frustum::Frustum(const glm::mat4 &iViewProjection)
+{
+    // Gribb/Hartmann: each plane is the last row plus or minus one of the others (glm is column major)
+    glm::vec4 aRows[4];
+    for (int i = 0; i < 4; i++)
+    {
+        aRows[i] = glm::vec4(iViewProjection[0][i], iViewProjection[1][i], iViewProjection[2][i], iViewProjection[3][i]);
+    }
+    m_planes[PLANE_LEFT] = normalizePlane(aRows[3] + aRows[0]);
+    m_planes[PLANE_RIGHT] = normalizePlane(aRows[3] - aRows[0]);
+    m_planes[PLANE_BOTTOM] = normalizePlane(aRows[3] + aRows[1]);
+    m_planes[PLANE_TOP] = normalizePlane(aRows[3] - aRows[1]);
+    // OpenGL clip space, z goes from -w to w
+    m_planes[PLANE_NEAR] = normalizePlane(aRows[3] + aRows[2]);
+    m_planes[PLANE_FAR] = normalizePlane(aRows[3] - aRows[2]);
+}
+
+bool Frustum::Intersects(const AABB &iBox) const
+{
+    if (!iBox.IsValid())
+    {
+        return true;
+    }
+    glm::vec3 aCenter = iBox.GetCenter();
+    glm::vec3 aExtents = iBox.GetExtents();
+    for (const glm::vec4 &aPlane : m_planes)
+    {
+        // distance of the center against the projection of the extents on the normal
+        float aDistance = glm::dot(glm::vec3(aPlane), aCenter) + aPlane.w;
+        float aRadius = glm::dot(glm::abs(glm::vec3(aPlane)), aExtents);
+        if (aDistance + aRadius < 0.0f)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Frustum::Intersects(const BoundingSphere &iSphere) const
+{
+    if (!iSphere.IsValid())
+    {
+        return true;
+    }
+    for (const glm::vec4 &aPlane : m_planes)
+    {
+        if (glm::dot(glm::vec3(aPlane), iSphere.center) + aPlane.w < -iSphere.radius)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+uint32_t FrustumCuller::Add(const AABB &iBox)
+{
+    uint32_t aIndex = static_cast<uint32_t>(m_centerX.size());
+    m_centerX.push_back(0.0f);
+    m_centerY.push_back(0.0f);
+    m_centerZ.push_back(0.0f);
+    m_extentX.push_back(0.0f);
+    m_extentY.push_back(0.0f);
+    m_extentZ.push_back(0.0f);
+    m_visible.push_back(1);
+    Set(aIndex, iBox);
+    return aIndex;
+}
+
+void FrustumCuller::Set(uint32_t iIndex, const AABB &iBox)
+{
+    glm::vec3 aCenter = iBox.GetCenter();
+    glm::vec3 aExtents = iBox.GetExtents();
+    if (!iBox.IsValid())
+    {
+        // unknown bounds, infinite extents always pass the test
+        aCenter = glm::vec3(0.0f);
+        aExtents = glm::vec3(FLT_MAX);
+    }
+    m_centerX[iIndex] = aCenter.x;
+    m_centerY[iIndex] = aCenter.y;
+    m_centerZ[iIndex] = aCenter.z;
+    m_extentX[iIndex] = aExtents.x;
+    m_extentY[iIndex] = aExtents.y;
+    m_extentZ[iIndex] = aExtents.z;
+}
+
+void FrustumCuller::Clear()
+{
+    m_centerX.clear();
+    m_centerY.clear();
+    m_centerZ.clear();
+    m_extentX.clear();
+    m_extentY.clear();
+    m_extentZ.clear();
+    m_visible.clear();
+}
+
+void FrustumCuller::Reserve(size_t iCount)
+{
+    m_centerX.reserve(iCount);
+    m_centerY.reserve(iCount);
+    m_centerZ.reserve(iCount);
+    m_extentX.reserve(iCount);
+    m_extentY.reserve(iCount);
+    m_extentZ.reserve(iCount);
+    m_visible.reserve(iCount);
+}
+
+size_t FrustumCuller::Cull(const Frustum &iFrustum)
+{
+    const size_t aCount = m_centerX.size();
+    const float *aCenterX = m_centerX.data();
+    const float *aCenterY = m_centerY.data();
+    const float *aCenterZ = m_centerZ.data();
+    const float *aExtentX = m_extentX.data();
+    const float *aExtentY = m_extentY.data();
+    const float *aExtentZ = m_extentZ.data();
+    uint8_t *aVisible = m_visible.data();
+
+    std::fill(m_visible.begin(), m_visible.end(), uint8_t(1));
+    // one pass per plane, no branch in the loop body
+    for (const glm::vec4 &aPlane : iFrustum.GetPlanes())
+    {
+        const float aNx = aPlane.x, aNy = aPlane.y, aNz = aPlane.z, aD = aPlane.w;
+        const float aAx = glm::abs(aNx), aAy = glm::abs(aNy), aAz = glm::abs(aNz);
+        for (size_t i = 0; i < aCount; i++)
+        {
+            float aDistance = aNx * aCenterX[i] + aNy * aCenterY[i] + aNz * aCenterZ[i] + aD;
+            float aRadius = aAx * aExtentX[i] + aAy * aExtentY[i] + aAz * aExtentZ[i];
+            aVisible[i] &= static_cast<uint8_t>(aDistance + aRadius >= 0.0f);
+        }
+    }
+
+    size_t aVisibleCount = 0;
+    for (size_t i = 0; i < aCount; i++)
+    {
+        aVisibleCount += aVisible[i];
+    }
+    return aVisibleCount;
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "bounds.hpp"
+
+/**
+ * The six planes of a view volume, extracted from a view projection matrix (Camera::GetViewProjectionMatrix).
+ * Planes are normalized and point inwards: a point p is inside when dot(plane.xyz, p) + plane.w >= 0 for all of them.
+ * Tests are conservative, a volume crossing the corner of the frustum may be reported visible, and so is an
+ * invalid (never computed) one.
+ */
+class Frustum
+{
+public:
+    enum PlaneIndex
+    {
+        PLANE_LEFT = 0,
+        PLANE_RIGHT,
+        PLANE_BOTTOM,
+        PLANE_TOP,
+        PLANE_NEAR,
+        PLANE_FAR,
+        PLANE_COUNT,
+    };
+
+    Frustum() = default;
+    explicit Frustum(const glm::mat4 &iViewProjection);
+
+    bool Intersects(const AABB &iBox) const;
+    bool Intersects(const BoundingSphere &iSphere) const;
+
+    const std::array<glm::vec4, PLANE_COUNT> &GetPlanes() const { return m_planes; }
+
+private:
+    // everything is visible until built from a matrix
+    std::array<glm::vec4, PLANE_COUNT> m_planes = {};
+};
+
+/**
+ * Culls many world space boxes against a frustum at once. The boxes are stored as structure of arrays
+ * (centers and extents per axis) so that the test of one plane against every box is a flat loop the
+ * compiler vectorizes.
+ */
+class FrustumCuller
+{
+public:
+    // returns the index of the box
+    uint32_t Add(const AABB &iBox);
+    void Set(uint32_t iIndex, const AABB &iBox);
+    void Clear();
+    void Reserve(size_t iCount);
+    size_t Size() const { return m_centerX.size(); }
+
+    // returns the number of visible boxes
+    size_t Cull(const Frustum &iFrustum);
+    // result of the last Cull, one per box
+    bool IsVisible(uint32_t iIndex) const { return m_visible[iIndex] != 0; }
+    const std::vector<uint8_t> &GetVisibility() const { return m_visible; }
+
+private:
+    std::vector<float> m_centerX, m_centerY, m_centerZ;
+    std::vector<float> m_extentX, m_extentY, m_extentZ;
+    std::vector<uint8_t> m_visible;
+};
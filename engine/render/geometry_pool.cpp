@@ -0,0 +1,114 @@
+#include "geometry_pool.hpp"
+
+#include <algorithm>
+
+#include "helpers/log.hpp"
+
+GeometryPool::GeometryPool(size_t iVertexCapacity, size_t iIndexCapacity, const VertexFormat &iFormat)
+    : m_format(iFormat), m_vertexCapacity(std::max<size_t>(iVertexCapacity, 1)), m_indexCapacity(std::max<size_t>(iIndexCapacity, 1))
+{
+}
+
+GeometryRange GeometryPool::Add(const Mesh &iMesh)
+{
+    if (iMesh.vertices.empty() || iMesh.indices.empty())
+    {
+        return {};
+    }
+    if (m_format.shortIndices && iMesh.vertices.size() > VertexFormat::MAX_SHORT_INDEX_VERTICES)
+    {
+        ERROR("Mesh " << iMesh.name << " has too many vertices for the 16 bits indices of the geometry pool: " << iMesh.vertices.size());
+        return {};
+    }
+    if (m_format.halfTexCoords && !iMesh.GetVertexFormat().halfTexCoords)
+    {
+        WARNING("Texture coordinates of mesh " << iMesh.name << " lose precision as half floats in the geometry pool");
+    }
+    if (!m_vertexArray)
+    {
+        create();
+    }
+
+    std::optional<size_t> aVertexOffset = m_vertices.Allocate(iMesh.vertices.size());
+    while (!aVertexOffset)
+    {
+        size_t aCapacity = std::max(m_vertices.GetCapacity() * 2, m_vertices.GetCapacity() + iMesh.vertices.size());
+        grow(m_vertexBuffer, m_vertices.GetCapacity() * m_format.GetVertexSize(), aCapacity * m_format.GetVertexSize());
+        m_vertices.Grow(aCapacity);
+        aVertexOffset = m_vertices.Allocate(iMesh.vertices.size());
+    }
+
+    // every level of detail, one after the other
+    size_t aIndexCount = iMesh.GetTotalIndexCount();
+    std::optional<size_t> aIndexOffset = m_indices.Allocate(aIndexCount);
+    while (!aIndexOffset)
+    {
+        size_t aCapacity = std::max(m_indices.GetCapacity() * 2, m_indices.GetCapacity() + aIndexCount);
+        grow(m_indexBuffer, m_indices.GetCapacity() * m_format.GetIndexSize(), aCapacity * m_format.GetIndexSize());
+        m_indices.Grow(aCapacity);
+        aIndexOffset = m_indices.Allocate(aIndexCount);
+    }
+
+    // the vertex array keeps pointing to the old buffers after a grow
+    GLStateCache::Get().BindVertexArray(m_vertexArray.Get());
+    m_format.Bind(m_vertexBuffer.Get(), m_indexBuffer.Get());
+
+    // indices stay relative to the mesh, the draw adds baseVertex
+    std::vector<std::byte> aVertices = m_format.PackVertices(iMesh.vertices);
+    glBufferSubData(GL_ARRAY_BUFFER, *aVertexOffset * m_format.GetVertexSize(), aVertices.size(), aVertices.data());
+    for (uint32_t aLod = 0; aLod < iMesh.GetLodCount(); aLod++)
+    {
+        IndexRange aLodRange = iMesh.GetLodRange(aLod);
+        std::vector<std::byte> aIndices = m_format.PackIndices(aLod == 0 ? iMesh.indices : iMesh.lods[aLod - 1].indices);
+        glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, (*aIndexOffset + aLodRange.first) * m_format.GetIndexSize(), aIndices.size(), aIndices.data());
+    }
+    GLStateCache::Get().BindVertexArray(0);
+
+    GeometryRange aRange;
+    aRange.firstIndex = static_cast<uint32_t>(*aIndexOffset);
+    aRange.indexCount = static_cast<uint32_t>(aIndexCount);
+    aRange.baseVertex = static_cast<int32_t>(*aVertexOffset);
+    aRange.vertexCount = static_cast<uint32_t>(iMesh.vertices.size());
+    return aRange;
+}
+
+void GeometryPool::Remove(const GeometryRange &iRange)
+{
+    if (!iRange.IsValid())
+    {
+        return;
+    }
+    m_vertices.Free(static_cast<size_t>(iRange.baseVertex), iRange.vertexCount);
+    m_indices.Free(iRange.firstIndex, iRange.indexCount);
+}
+
+void GeometryPool::create()
+{
+    m_vertexArray = GLVertexArray::Create();
+    m_vertexBuffer = GLBuffer::Create();
+    m_indexBuffer = GLBuffer::Create();
+
+    GLStateCache::Get().BindVertexArray(m_vertexArray.Get());
+    m_format.Bind(m_vertexBuffer.Get(), m_indexBuffer.Get());
+    glBufferData(GL_ARRAY_BUFFER, m_vertexCapacity * m_format.GetVertexSize(), nullptr, GL_STATIC_DRAW);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, m_indexCapacity * m_format.GetIndexSize(), nullptr, GL_STATIC_DRAW);
+    GLStateCache::Get().BindVertexArray(0);
+
+    m_vertices = RangeAllocator(m_vertexCapacity);
+    m_indices = RangeAllocator(m_indexCapacity);
+}
+
+void GeometryPool::grow(GLBuffer &ioBuffer, size_t iOldSize, size_t iNewSize)
+{
+    INFO("Geometry pool grows from " << iOldSize << " to " << iNewSize << " bytes");
+
+    GLBuffer aBuffer = GLBuffer::Create();
+    glBindBuffer(GL_COPY_WRITE_BUFFER, aBuffer.Get());
+    glBufferData(GL_COPY_WRITE_BUFFER, iNewSize, nullptr, GL_STATIC_DRAW);
+    glBindBuffer(GL_COPY_READ_BUFFER, ioBuffer.Get());
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, iOldSize);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    ioBuffer = std::move(aBuffer);
+}
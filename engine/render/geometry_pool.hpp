@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <glad/glad.h>
+
+#include "gl_object.hpp"
+#include "mesh.hpp"
+#include "range_allocator.hpp"
+
+// where a mesh lives inside a GeometryPool, matches the fields of an indirect draw command
+struct GeometryRange
+{
+    uint32_t firstIndex = 0;
+    // of every level of detail, Mesh::GetLodRange gives a level relative to firstIndex
+    uint32_t indexCount = 0;
+    int32_t baseVertex = 0;
+    uint32_t vertexCount = 0;
+
+    bool IsValid() const { return indexCount != 0; }
+};
+
+/**
+ * Shared vertex and index buffers static meshes are sub-allocated from, with a single vertex array for one
+ * VertexFormat. Meshes of a pool can be drawn together by one glMultiDrawElementsIndirect (see IndirectBatch),
+ * so they are all packed in the format of the pool rather than their own.
+ * The buffers grow (by copy on the GPU) when full, GL thread only.
+ */
+class GeometryPool
+{
+public:
+    // half float texture coordinates and tangents, 32 bits indices for meshes of any size
+    static constexpr VertexFormat DEFAULT_FORMAT = {.halfTexCoords = true, .tangents = true, .shortIndices = false};
+
+    GeometryPool() = default;
+    // capacities in vertices and indices, the buffers are created by the first Add
+    GeometryPool(size_t iVertexCapacity, size_t iIndexCapacity, const VertexFormat &iFormat = DEFAULT_FORMAT);
+
+    GeometryPool(const GeometryPool &) = delete;
+    GeometryPool &operator=(const GeometryPool &) = delete;
+
+    // uploads the CPU side vertices and indices of iMesh, its own buffers (if any) are left alone
+    // an invalid range when the indices of iMesh don't fit the 16 bits indices of the pool
+    GeometryRange Add(const Mesh &iMesh);
+    void Remove(const GeometryRange &iRange);
+
+    GLuint GetVertexArray() const { return m_vertexArray.Get(); }
+    const VertexFormat &GetVertexFormat() const { return m_format; }
+    size_t GetVertexCount() const { return m_vertices.GetUsed(); }
+    size_t GetIndexCount() const { return m_indices.GetUsed(); }
+
+private:
+    static constexpr size_t DEFAULT_VERTEX_CAPACITY = 1 << 20;
+    static constexpr size_t DEFAULT_INDEX_CAPACITY = 1 << 22;
+
+    void create();
+    // reallocates iBuffer with iNewSize bytes, keeping its first iOldSize bytes
+    static void grow(GLBuffer &ioBuffer, size_t iOldSize, size_t iNewSize);
+
+    GLVertexArray m_vertexArray;
+    GLBuffer m_vertexBuffer;
+    GLBuffer m_indexBuffer;
+    RangeAllocator m_vertices;
+    RangeAllocator m_indices;
+    VertexFormat m_format = DEFAULT_FORMAT;
+    size_t m_vertexCapacity = DEFAULT_VERTEX_CAPACITY;
+    size_t m_indexCapacity = DEFAULT_INDEX_CAPACITY;
+};
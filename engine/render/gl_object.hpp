@@ -0,0 +1,120 @@
+#pragma once
+
+#include <utility>
+
+#include <glad/glad.h>
+
+#include "gl_state.hpp"
+
+/**
+ * Move-only owner of an OpenGL object name, deleted when the owner goes away.
+ * Traits provide how the name is created and destroyed, see the aliases below.
+ * Owners must be destroyed while the GL context is still alive.
+ */
+template <typename Traits>
+class GLObject
+{
+public:
+    GLObject() = default;
+    // takes ownership of an existing name
+    explicit GLObject(GLuint id) : m_id(id) {}
+    ~GLObject()
+    {
+        Reset();
+    }
+
+    GLObject(const GLObject &) = delete;
+    GLObject &operator=(const GLObject &) = delete;
+
+    GLObject(GLObject &&other) noexcept : m_id(std::exchange(other.m_id, 0)) {}
+    GLObject &operator=(GLObject &&other) noexcept
+    {
+        if (this != &other)
+        {
+            Reset(std::exchange(other.m_id, 0));
+        }
+        return *this;
+    }
+
+    static GLObject Create()
+    {
+        return GLObject(Traits::Create());
+    }
+
+    GLuint Get() const { return m_id; }
+    explicit operator bool() const { return m_id != 0; }
+
+    // gives the name up without deleting it
+    GLuint Release()
+    {
+        return std::exchange(m_id, 0);
+    }
+
+    void Reset(GLuint id = 0)
+    {
+        if (m_id != 0)
+        {
+            Traits::Destroy(m_id);
+        }
+        m_id = id;
+    }
+
+private:
+    GLuint m_id = 0;
+};
+
+struct GLBufferTraits
+{
+    static GLuint Create()
+    {
+        GLuint id = 0;
+        glGenBuffers(1, &id);
+        return id;
+    }
+    static void Destroy(GLuint id) { glDeleteBuffers(1, &id); }
+};
+
+struct GLVertexArrayTraits
+{
+    static GLuint Create()
+    {
+        GLuint id = 0;
+        glGenVertexArrays(1, &id);
+        return id;
+    }
+    static void Destroy(GLuint id)
+    {
+        GLStateCache::Get().OnVertexArrayDeleted(id);
+        glDeleteVertexArrays(1, &id);
+    }
+};
+
+struct GLTextureTraits
+{
+    static GLuint Create()
+    {
+        GLuint id = 0;
+        glGenTextures(1, &id);
+        return id;
+    }
+    static void Destroy(GLuint id)
+    {
+        GLStateCache::Get().OnTextureDeleted(id);
+        glDeleteTextures(1, &id);
+    }
+};
+
+struct GLProgramTraits
+{
+    static GLuint Create() { return glCreateProgram(); }
+    static void Destroy(GLuint id)
+    {
+        GLStateCache::Get().OnProgramDeleted(id);
+        glDeleteProgram(id);
+    }
+};
+
+using GLBuffer = GLObject<GLBufferTraits>;
+using GLVertexArray = GLObject<GLVertexArrayTraits>;
+using GLTexture = GLObject<GLTextureTraits>;
+using GLProgram = GLObject<GLProgramTraits>;
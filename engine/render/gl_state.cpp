@@ -0,0 +1,89 @@
+#include "gl_state.hpp"
+
+GLStateCache &GLStateCache::Get()
+{
+    static GLStateCache aCache;
+    return aCache;
+}
+
+void GLStateCache::UseProgram(GLuint iProgram)
+{
+    if (m_program != iProgram)
+    {
+        glUseProgram(iProgram);
+        m_program = iProgram;
+    }
+}
+
+void GLStateCache::BindVertexArray(GLuint iVertexArray)
+{
+    if (m_vertexArray != iVertexArray)
+    {
+        glBindVertexArray(iVertexArray);
+        m_vertexArray = iVertexArray;
+    }
+}
+
+void GLStateCache::BindTexture(GLuint iUnit, GLenum iTarget, GLuint iTexture)
+{
+    if (iUnit >= MAX_CACHED_UNITS)
+    {
+        activeTexture(iUnit);
+        glBindTexture(iTarget, iTexture);
+        return;
+    }
+
+    // a unit has one binding per target, only the last one is tracked
+    TextureBinding &aBinding = m_textures[iUnit];
+    if (aBinding.target == iTarget && aBinding.texture == iTexture)
+    {
+        return;
+    }
+    activeTexture(iUnit);
+    glBindTexture(iTarget, iTexture);
+    aBinding = {iTarget, iTexture};
+}
+
+void GLStateCache::OnProgramDeleted(GLuint iProgram)
+{
+    if (m_program == iProgram)
+    {
+        m_program = UNKNOWN;
+    }
+}
+
+void GLStateCache::OnVertexArrayDeleted(GLuint iVertexArray)
+{
+    if (m_vertexArray == iVertexArray)
+    {
+        m_vertexArray = 0;
+    }
+}
+
+void GLStateCache::OnTextureDeleted(GLuint iTexture)
+{
+    for (TextureBinding &aBinding : m_textures)
+    {
+        if (aBinding.texture == iTexture)
+        {
+            aBinding.texture = 0;
+        }
+    }
+}
+
+void GLStateCache::Invalidate()
+{
+    m_program = UNKNOWN;
+    m_vertexArray = UNKNOWN;
+    m_activeUnit = UNKNOWN;
+    m_textures.fill({});
+}
+
+void GLStateCache::activeTexture(GLuint iUnit)
+{
+    if (m_activeUnit != iUnit)
+    {
+        glActiveTexture(GL_TEXTURE0 + iUnit);
+        m_activeUnit = iUnit;
+    }
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <array>
+
+#include <glad/glad.h>
+
+/**
+ * Shadow of the GL bindings the renderer changes the most (program, vertex array, textures) so that binding
+ * what is already bound costs nothing. Only valid if every bind goes through it, GL thread only.
+ * Deleting a GL object must be reported (GLObject does it) since GL resets the bindings of a deleted name.
+ */
+class GLStateCache
+{
+public:
+    // engine wide cache, matches the single GL context
+    static GLStateCache &Get();
+
+    void UseProgram(GLuint iProgram);
+    void BindVertexArray(GLuint iVertexArray);
+    void BindTexture(GLuint iUnit, GLenum iTarget, GLuint iTexture);
+
+    void OnProgramDeleted(GLuint iProgram);
+    void OnVertexArrayDeleted(GLuint iVertexArray);
+    void OnTextureDeleted(GLuint iTexture);
+
+    // forgets everything, to call after GL state was changed behind the cache's back
+    void Invalidate();
+
+private:
+    // units above are bound without caching
+    static constexpr GLuint MAX_CACHED_UNITS = 32;
+    // no GL name is ever this value, forces the next bind
+    static constexpr GLuint UNKNOWN = ~0u;
+
+    struct TextureBinding
+    {
+        GLenum target = 0;
+        GLuint texture = UNKNOWN;
+    };
+
+    void activeTexture(GLuint iUnit);
+
+    GLuint m_program = UNKNOWN;
+    GLuint m_vertexArray = UNKNOWN;
+    GLuint m_activeUnit = UNKNOWN;
+    std::array<TextureBinding, MAX_CACHED_UNITS> m_textures;
+};
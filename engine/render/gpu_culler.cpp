@@ -0,0 +1,432 @@
+#include "gpu_culler.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <optional>
+
+#include "uniform_blocks.hpp"
+#include "helpers/log.hpp"
+
+namespace
+{
+    // the functions below mirror assets/shaders/cull.comp, operation for operation
+
+    bool outsideFrustum(const CullView &iView, const glm::vec3 &iCenter, const glm::vec3 &iExtents)
+    {
+        for (const glm::vec4 &aPlane : iView.planes)
+        {
+            float aDistance = glm::dot(glm::vec3(aPlane), iCenter) + aPlane.w;
+            float aRadius = glm::dot(glm::abs(glm::vec3(aPlane)), iExtents);
+            if (aDistance + aRadius < 0.0f)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool occluded(const HiZPyramid::Snapshot &iHiZ, const CullView &iView, const glm::vec3 &iCenter, const glm::vec3 &iExtents)
+    {
+        glm::vec3 aMin = iCenter - iExtents;
+        glm::vec3 aMax = iCenter + iExtents;
+        glm::vec2 aNdcMin(1.0f);
+        glm::vec2 aNdcMax(-1.0f);
+        float aDepth = 1.0f;
+        for (int i = 0; i < 8; i++)
+        {
+            glm::vec3 aCorner((i & 1) ? aMax.x : aMin.x, (i & 2) ? aMax.y : aMin.y, (i & 4) ? aMax.z : aMin.z);
+            glm::vec4 aClip = iHiZ.viewProjection * glm::vec4(aCorner, 1.0f);
+            if (aClip.w <= iView.near)
+            {
+                return false;
+            }
+            glm::vec3 aNdc = glm::vec3(aClip) / aClip.w;
+            aNdcMin = glm::min(aNdcMin, glm::vec2(aNdc));
+            aNdcMax = glm::max(aNdcMax, glm::vec2(aNdc));
+            aDepth = std::min(aDepth, aNdc.z * 0.5f + 0.5f);
+        }
+        glm::vec2 aUvMin = glm::clamp(aNdcMin * 0.5f + 0.5f, glm::vec2(0.0f), glm::vec2(1.0f));
+        glm::vec2 aUvMax = glm::clamp(aNdcMax * 0.5f + 0.5f, glm::vec2(0.0f), glm::vec2(1.0f));
+
+        glm::vec2 aSize = (aUvMax - aUvMin) * glm::vec2(iHiZ.size);
+        int aLevelCount = static_cast<int>(iHiZ.levels.size());
+        int aLevel = std::clamp(static_cast<int>(std::ceil(std::log2(std::max(std::max(aSize.x, aSize.y), 1.0f)))), 0, aLevelCount - 1);
+        glm::ivec2 aLevelSize(std::max(iHiZ.size.x >> aLevel, 1), std::max(iHiZ.size.y >> aLevel, 1));
+        auto aTexel = [&](const glm::vec2 &iUv)
+        {
+            return glm::ivec2(std::clamp(static_cast<int>(iUv.x * aLevelSize.x), 0, aLevelSize.x - 1),
+                              std::clamp(static_cast<int>(iUv.y * aLevelSize.y), 0, aLevelSize.y - 1));
+        };
+        glm::ivec2 aTexelMin = aTexel(aUvMin);
+        glm::ivec2 aTexelMax = aTexel(aUvMax);
+        const std::vector<float> &aDepths = iHiZ.levels[aLevel];
+        auto aFetch = [&](int x, int y)
+        {
+            return aDepths[static_cast<size_t>(y) * aLevelSize.x + x];
+        };
+        float aFarthest = std::max(std::max(aFetch(aTexelMin.x, aTexelMin.y), aFetch(aTexelMax.x, aTexelMin.y)),
+                                   std::max(aFetch(aTexelMin.x, aTexelMax.y), aFetch(aTexelMax.x, aTexelMax.y)));
+        return aDepth > aFarthest;
+    }
+
+    uint32_t selectLod(const CullObject &iObject, const CullView &iView, const glm::vec3 &iCenter)
+    {
+        if (iObject.lodCount <= 1 || iObject.center.w < 0.0f)
+        {
+            return 0;
+        }
+
+        float aScale = std::max(glm::length(glm::vec3(iObject.model[0])), std::max(glm::length(glm::vec3(iObject.model[1])), glm::length(glm::vec3(iObject.model[2]))));
+        float aDistance = glm::length(iCenter - iView.position) - iObject.center.w * aScale;
+        float aPixelsPerError = iView.projectionScale / std::max(aDistance, iView.near) * aScale;
+
+        float aStay = iView.maxPixelError * (1.0f + iView.hysteresis);
+        float aSwitch = iView.maxPixelError * (1.0f - iView.hysteresis);
+        for (uint32_t aLod = std::min(iObject.lodCount, CullObject::MAX_LODS) - 1; aLod > 0; aLod--)
+        {
+            float aLimit = aLod == iObject.lod ? aStay : aLod > iObject.lod ? aSwitch : iView.maxPixelError;
+            if (iObject.lodErrors[aLod] * aPixelsPerError <= aLimit)
+            {
+                return aLod;
+            }
+        }
+        return 0;
+    }
+}
+
+CullView::CullView(const Frustum &iFrustum, const LodSelector &iLods)
+    : planes(iFrustum.GetPlanes()), position(iLods.GetPosition()), projectionScale(iLods.GetProjectionScale()), near(iLods.GetNear()),
+      maxPixelError(iLods.GetSettings().maxPixelError), hysteresis(iLods.GetSettings().hysteresis)
+{
+}
+
+void HiZPyramid::allocate(int iWidth, int iHeight)
+{
+    m_size = glm::ivec2(iWidth, iHeight);
+    m_levels = 1 + static_cast<int>(std::floor(std::log2(static_cast<float>(std::max(iWidth, iHeight)))));
+
+    GLStateCache &aState = GLStateCache::Get();
+    m_depth = GLTexture::Create();
+    aState.BindTexture(0, GL_TEXTURE_2D, m_depth.Get());
+    glTexStorage2D(GL_TEXTURE_2D, 1, GL_DEPTH_COMPONENT24, iWidth, iHeight);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    m_pyramid = GLTexture::Create();
+    aState.BindTexture(0, GL_TEXTURE_2D, m_pyramid.Get());
+    glTexStorage2D(GL_TEXTURE_2D, m_levels, GL_R32F, iWidth, iHeight);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+}
+
+void HiZPyramid::Build(Shader &iReduceShader, int iWidth, int iHeight, const glm::mat4 &iViewProjection)
+{
+    if (iWidth <= 0 || iHeight <= 0)
+    {
+        return;
+    }
+    if (!m_pyramid || m_size != glm::ivec2(iWidth, iHeight))
+    {
+        allocate(iWidth, iHeight);
+    }
+    m_viewProjection = iViewProjection;
+
+    GLStateCache &aState = GLStateCache::Get();
+    aState.BindTexture(0, GL_TEXTURE_2D, m_depth.Get());
+    glCopyTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 0, 0, iWidth, iHeight);
+
+    if (iReduceShader.GetId() != m_reduceProgram)
+    {
+        m_reduceProgram = iReduceShader.GetId();
+        m_sourceUniform = iReduceShader.GetUniform<int>("source");
+        m_sourceLevelUniform = iReduceShader.GetUniform<int>("sourceLevel");
+    }
+    iReduceShader.Use();
+    iReduceShader.Set(m_sourceUniform, 0);
+
+    // level 0 copies the depth, every next one reads the previous (different levels: no feedback)
+    for (int aLevel = 0; aLevel < m_levels; aLevel++)
+    {
+        aState.BindTexture(0, GL_TEXTURE_2D, aLevel == 0 ? m_depth.Get() : m_pyramid.Get());
+        iReduceShader.Set(m_sourceLevelUniform, aLevel - 1);
+        glBindImageTexture(0, m_pyramid.Get(), aLevel, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+
+        GLuint aWidth = static_cast<GLuint>(std::max(iWidth >> aLevel, 1));
+        GLuint aHeight = static_cast<GLuint>(std::max(iHeight >> aLevel, 1));
+        glDispatchCompute((aWidth + 7) / 8, (aHeight + 7) / 8, 1);
+        glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+    }
+}
+
+HiZPyramid::Snapshot HiZPyramid::ReadBack() const
+{
+    Snapshot aSnapshot;
+    aSnapshot.viewProjection = m_viewProjection;
+    aSnapshot.size = m_size;
+    if (!m_pyramid)
+    {
+        return aSnapshot;
+    }
+
+    GLStateCache::Get().BindTexture(0, GL_TEXTURE_2D, m_pyramid.Get());
+    aSnapshot.levels.resize(m_levels);
+    for (int aLevel = 0; aLevel < m_levels; aLevel++)
+    {
+        std::vector<float> &aDepths = aSnapshot.levels[aLevel];
+        aDepths.resize(static_cast<size_t>(std::max(m_size.x >> aLevel, 1)) * std::max(m_size.y >> aLevel, 1));
+        glGetTexImage(GL_TEXTURE_2D, aLevel, GL_RED, GL_FLOAT, aDepths.data());
+    }
+    return aSnapshot;
+}
+
+void GPUCuller::SetObjects(const std::vector<CullObject> &iObjects)
+{
+    if (!m_objectBuffer)
+    {
+        m_objectBuffer = GLBuffer::Create();
+        m_commandBuffer = GLBuffer::Create();
+        m_drawBuffer = GLBuffer::Create();
+        m_countBuffer = GLBuffer::Create();
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_countBuffer.Get());
+        glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(uint32_t), nullptr, GL_DYNAMIC_COPY);
+    }
+
+    m_objectCount = iObjects.size();
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_objectBuffer.Get());
+    glBufferData(GL_SHADER_STORAGE_BUFFER, iObjects.size() * sizeof(CullObject), iObjects.data(), GL_DYNAMIC_DRAW);
+
+    // the outputs hold every object in the worst case, only written by the pass
+    if (m_objectCount > m_capacity)
+    {
+        m_capacity = std::max(m_objectCount, m_capacity * 2);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_commandBuffer.Get());
+        glBufferData(GL_SHADER_STORAGE_BUFFER, m_capacity * sizeof(DrawElementsIndirectCommand), nullptr, GL_DYNAMIC_COPY);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_drawBuffer.Get());
+        glBufferData(GL_SHADER_STORAGE_BUFFER, m_capacity * sizeof(IndirectDraw), nullptr, GL_DYNAMIC_COPY);
+    }
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+void GPUCuller::SetTransform(uint32_t iObject, const glm::mat4 &iModel)
+{
+    if (iObject >= m_objectCount)
+    {
+        return;
+    }
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_objectBuffer.Get());
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, iObject * sizeof(CullObject) + offsetof(CullObject, model), sizeof(glm::mat4), &iModel);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+const GPUCuller::ShaderUniforms &GPUCuller::getUniforms(const Shader &iShader)
+{
+    auto [aUniforms, aInserted] = m_uniforms.TryEmplace(iShader.GetId());
+    if (aInserted)
+    {
+        aUniforms->objectCount = iShader.GetUniform<int>("objectCount");
+        aUniforms->planes = iShader.GetUniformArray<glm::vec4>("planes");
+        aUniforms->cameraPosition = iShader.GetUniform<glm::vec3>("cameraPosition");
+        aUniforms->projectionScale = iShader.GetUniform<float>("projectionScale");
+        aUniforms->nearDistance = iShader.GetUniform<float>("nearDistance");
+        aUniforms->maxPixelError = iShader.GetUniform<float>("maxPixelError");
+        aUniforms->hysteresis = iShader.GetUniform<float>("hysteresis");
+        aUniforms->useHiZ = iShader.GetUniform<int>("useHiZ");
+        aUniforms->hiZ = iShader.GetUniform<int>("hiZ");
+        aUniforms->hiZViewProjection = iShader.GetUniform<glm::mat4>("hiZViewProjection");
+        aUniforms->hiZSize = iShader.GetUniform<glm::vec2>("hiZSize");
+        aUniforms->hiZLevels = iShader.GetUniform<int>("hiZLevels");
+    }
+    return *aUniforms;
+}
+
+void GPUCuller::Dispatch(Shader &iCullShader, const CullView &iView, const HiZPyramid *iHiZ)
+{
+    if (m_objectCount == 0)
+    {
+        return;
+    }
+
+    const ShaderUniforms &aUniforms = getUniforms(iCullShader);
+    iCullShader.Set(aUniforms.objectCount, static_cast<int>(m_objectCount));
+    for (uint32_t i = 0; i < Frustum::PLANE_COUNT; i++)
+    {
+        iCullShader.Set(aUniforms.planes[i], iView.planes[i]);
+    }
+    iCullShader.Set(aUniforms.cameraPosition, iView.position);
+    iCullShader.Set(aUniforms.projectionScale, iView.projectionScale);
+    iCullShader.Set(aUniforms.nearDistance, iView.near);
+    iCullShader.Set(aUniforms.maxPixelError, iView.maxPixelError);
+    iCullShader.Set(aUniforms.hysteresis, iView.hysteresis);
+
+    bool aUseHiZ = iHiZ && iHiZ->IsValid();
+    iCullShader.Set(aUniforms.useHiZ, aUseHiZ ? 1 : 0);
+    if (aUseHiZ)
+    {
+        GLStateCache::Get().BindTexture(0, GL_TEXTURE_2D, iHiZ->GetTexture());
+        iCullShader.Set(aUniforms.hiZ, 0);
+        iCullShader.Set(aUniforms.hiZViewProjection, iHiZ->GetViewProjection());
+        iCullShader.Set(aUniforms.hiZSize, glm::vec2(iHiZ->GetSize()));
+        iCullShader.Set(aUniforms.hiZLevels, iHiZ->GetLevelCount());
+    }
+    iCullShader.Use();
+
+    uint32_t aZero = 0;
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_countBuffer.Get());
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(uint32_t), &aZero);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, static_cast<GLuint>(StorageBinding::CullObjects), m_objectBuffer.Get());
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, static_cast<GLuint>(StorageBinding::CullCommands), m_commandBuffer.Get());
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, static_cast<GLuint>(StorageBinding::Draws), m_drawBuffer.Get());
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, static_cast<GLuint>(StorageBinding::CullCount), m_countBuffer.Get());
+
+    GLuint aGroups = static_cast<GLuint>((m_objectCount + GROUP_SIZE - 1) / GROUP_SIZE);
+    glDispatchCompute(aGroups, 1, 1);
+    // the commands and the count are read by the draw, the draws by the vertex shader
+    glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+void GPUCuller::Draw(GLenum iIndexType)
+{
+    if (m_objectCount == 0)
+    {
+        return;
+    }
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, static_cast<GLuint>(StorageBinding::Draws), m_drawBuffer.Get());
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_commandBuffer.Get());
+    glBindBuffer(GL_PARAMETER_BUFFER, m_countBuffer.Get());
+
+    // the count is at offset 0 of the parameter buffer, commands past it aren't read
+    glMultiDrawElementsIndirectCount(GL_TRIANGLES, iIndexType, nullptr, 0, static_cast<GLsizei>(m_objectCount), 0);
+
+    glBindBuffer(GL_PARAMETER_BUFFER, 0);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
+
+template <typename T>
+std::vector<T> GPUCuller::readBuffer(const GLBuffer &iBuffer, size_t iCount)
+{
+    std::vector<T> aValues(iCount);
+    if (iCount > 0)
+    {
+        glBindBuffer(GL_COPY_READ_BUFFER, iBuffer.Get());
+        glGetBufferSubData(GL_COPY_READ_BUFFER, 0, iCount * sizeof(T), aValues.data());
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    }
+    return aValues;
+}
+
+bool GPUCuller::Validate(Shader &iCullShader, const CullView &iView, const HiZPyramid *iHiZ)
+{
+    if (m_objectCount == 0)
+    {
+        return true;
+    }
+
+    // the reference starts from the levels the pass selected so far
+    std::vector<CullObject> aObjects = readBuffer<CullObject>(m_objectBuffer, m_objectCount);
+    std::optional<HiZPyramid::Snapshot> aHiZ;
+    if (iHiZ && iHiZ->IsValid())
+    {
+        aHiZ = iHiZ->ReadBack();
+    }
+    std::vector<DrawElementsIndirectCommand> aCommands;
+    std::vector<IndirectDraw> aDraws;
+    uint32_t aExpected = Cull(aObjects, iView, aHiZ ? &*aHiZ : nullptr, aCommands, aDraws);
+
+    Dispatch(iCullShader, iView, iHiZ);
+    uint32_t aCount = std::min(readBuffer<uint32_t>(m_countBuffer, 1)[0], static_cast<uint32_t>(m_objectCount));
+    std::vector<DrawElementsIndirectCommand> aGPUCommands = readBuffer<DrawElementsIndirectCommand>(m_commandBuffer, aCount);
+    std::vector<IndirectDraw> aGPUDraws = readBuffer<IndirectDraw>(m_drawBuffer, aCount);
+    std::vector<CullObject> aGPUObjects = readBuffer<CullObject>(m_objectBuffer, m_objectCount);
+
+    bool aValid = true;
+    if (aCount != aExpected)
+    {
+        ERROR("GPU culling drew " << aCount << " objects, the reference " << aExpected);
+        aValid = false;
+    }
+
+    // slot of each object in the GPU output, the order of the appends is up to the atomics
+    std::vector<int64_t> aSlots(m_objectCount, -1);
+    for (uint32_t i = 0; i < aCount; i++)
+    {
+        uint32_t aObject = aGPUCommands[i].baseInstance;
+        if (aObject >= m_objectCount || aSlots[aObject] >= 0)
+        {
+            ERROR("GPU culling wrote an invalid or duplicated draw for object " << aObject);
+            aValid = false;
+            continue;
+        }
+        aSlots[aObject] = i;
+    }
+
+    for (uint32_t i = 0; i < aExpected; i++)
+    {
+        const DrawElementsIndirectCommand &aCommand = aCommands[i];
+        uint32_t aObject = aCommand.baseInstance;
+        if (aSlots[aObject] < 0)
+        {
+            ERROR("Object " << aObject << " is visible for the reference only");
+            aValid = false;
+            continue;
+        }
+        const DrawElementsIndirectCommand &aGPUCommand = aGPUCommands[aSlots[aObject]];
+        const IndirectDraw &aGPUDraw = aGPUDraws[aSlots[aObject]];
+        bool aSame = aGPUCommand.count == aCommand.count && aGPUCommand.instanceCount == aCommand.instanceCount &&
+                     aGPUCommand.firstIndex == aCommand.firstIndex && aGPUCommand.baseVertex == aCommand.baseVertex &&
+                     aGPUDraw.model == aDraws[i].model && aGPUDraw.material == aDraws[i].material && aGPUDraw.flags == aDraws[i].flags;
+        if (!aSame)
+        {
+            ERROR("Draw of object " << aObject << " differs from the reference");
+            aValid = false;
+        }
+        aSlots[aObject] = -1;
+    }
+    for (uint32_t aObject = 0; aObject < m_objectCount; aObject++)
+    {
+        if (aSlots[aObject] >= 0)
+        {
+            ERROR("Object " << aObject << " is visible for the GPU only");
+            aValid = false;
+        }
+        if (aGPUObjects[aObject].lod != aObjects[aObject].lod)
+        {
+            ERROR("Object " << aObject << " selected level " << aGPUObjects[aObject].lod << ", the reference " << aObjects[aObject].lod);
+            aValid = false;
+        }
+    }
+    return aValid;
+}
+
+uint32_t GPUCuller::Cull(std::vector<CullObject> &ioObjects, const CullView &iView, const HiZPyramid::Snapshot *iHiZ,
+                         std::vector<DrawElementsIndirectCommand> &oCommands, std::vector<IndirectDraw> &oDraws)
+{
+    oCommands.clear();
+    oDraws.clear();
+    bool aUseHiZ = iHiZ && !iHiZ->levels.empty();
+    for (uint32_t i = 0; i < ioObjects.size(); i++)
+    {
+        CullObject &aObject = ioObjects[i];
+        glm::vec3 aCenter = glm::vec3(aObject.model * glm::vec4(glm::vec3(aObject.center), 1.0f));
+        if (aObject.extents.w == 0.0f)
+        {
+            glm::vec3 aExtents = glm::abs(glm::vec3(aObject.model[0])) * aObject.extents.x +
+                                 glm::abs(glm::vec3(aObject.model[1])) * aObject.extents.y +
+                                 glm::abs(glm::vec3(aObject.model[2])) * aObject.extents.z;
+            if (outsideFrustum(iView, aCenter, aExtents) || (aUseHiZ && occluded(*iHiZ, iView, aCenter, aExtents)))
+            {
+                continue;
+            }
+        }
+
+        aObject.lod = selectLod(aObject, iView, aCenter);
+        const glm::uvec2 &aLod = aObject.lods[aObject.lod];
+        oCommands.push_back({aLod.y, 1, aLod.x, aObject.baseVertex, i});
+        oDraws.push_back({aObject.model, aObject.material, aObject.flags, {}});
+    }
+    return static_cast<uint32_t>(oCommands.size());
+}
@@ -0,0 +1,187 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "frustum.hpp"
+#include "gl_object.hpp"
+#include "indirect_batch.hpp"
+#include "lod_selector.hpp"
+#include "shader.hpp"
+#include "uniform.hpp"
+#include "helpers/flat_hash_map.hpp"
+
+// std430, GLSL: CullObject objects[] (StorageBinding::CullObjects), see assets/shaders/cull.comp
+struct CullObject
+{
+    static constexpr uint32_t MAX_LODS = 8;
+
+    glm::mat4 model;
+    // local bounding box center, w: radius of the bounding sphere around the same center (< 0 without bounds)
+    glm::vec4 center;
+    // local bounding box half size, w: 1 for objects never culled
+    glm::vec4 extents;
+    // IndirectDraw::material and flags
+    uint32_t material;
+    uint32_t flags;
+    int32_t baseVertex;
+    uint32_t lodCount;
+    // level selected last frame, written back by the pass for the hysteresis
+    uint32_t lod;
+    uint32_t padding[3];
+    // per level: first index in the geometry pool, index count
+    glm::uvec2 lods[MAX_LODS];
+    float lodErrors[MAX_LODS];
+};
+
+static_assert(offsetof(CullObject, material) == 96 && offsetof(CullObject, lod) == 112);
+static_assert(offsetof(CullObject, lods) == 128 && offsetof(CullObject, lodErrors) == 192 && sizeof(CullObject) == 224);
+
+// what the objects are tested against for a frame, also selects their level of detail (see LodSelector)
+struct CullView
+{
+    std::array<glm::vec4, Frustum::PLANE_COUNT> planes;
+    glm::vec3 position;
+    float projectionScale;
+    float near;
+    float maxPixelError;
+    float hysteresis;
+
+    CullView(const Frustum &iFrustum, const LodSelector &iLods);
+};
+
+/**
+ * Max depth pyramid of the last frame, for occlusion culling: level 0 is a copy of the depth buffer, each next
+ * level keeps the farthest depth of the texels it covers. A box whose nearest depth is farther than the
+ * pyramid over its screen rectangle is hidden.
+ * Built at the end of a frame from the bound framebuffer and used by the culling of the next one, with the
+ * view projection it was rendered with: objects disoccluded by a fast camera move may show up a frame late.
+ */
+class HiZPyramid
+{
+public:
+    // the pyramid read back, for the CPU reference of the culling
+    struct Snapshot
+    {
+        glm::mat4 viewProjection;
+        glm::ivec2 size;
+        // level i is max(size >> i, 1) texels, rows first
+        std::vector<std::vector<float>> levels;
+    };
+
+    HiZPyramid() = default;
+
+    HiZPyramid(const HiZPyramid &) = delete;
+    HiZPyramid &operator=(const HiZPyramid &) = delete;
+
+    /**
+     * Copies the depth of the framebuffer bound for reading (iWidth x iHeight) and reduces it with
+     * iReduceShader (assets/shaders/hiz_reduce.comp). iViewProjection is the one the depth was rendered with.
+     */
+    void Build(Shader &iReduceShader, int iWidth, int iHeight, const glm::mat4 &iViewProjection);
+    bool IsValid() const { return static_cast<bool>(m_pyramid); }
+
+    GLuint GetTexture() const { return m_pyramid.Get(); }
+    const glm::mat4 &GetViewProjection() const { return m_viewProjection; }
+    glm::ivec2 GetSize() const { return m_size; }
+    int GetLevelCount() const { return m_levels; }
+
+    // glGetTexImage of every level, stalls
+    Snapshot ReadBack() const;
+
+private:
+    void allocate(int iWidth, int iHeight);
+
+    GLTexture m_depth;
+    // GL_R32F, full mip chain
+    GLTexture m_pyramid;
+    glm::mat4 m_viewProjection = glm::mat4(1.0f);
+    glm::ivec2 m_size = glm::ivec2(0);
+    int m_levels = 0;
+
+    GLuint m_reduceProgram = 0;
+    UniformHandle<int> m_sourceUniform;
+    UniformHandle<int> m_sourceLevelUniform;
+};
+
+/**
+ * GPU driven culling: a compute pass (assets/shaders/cull.comp) tests every object against the frustum, and
+ * optionally the HiZPyramid of the last frame, picks the level of detail of the visible ones and appends their
+ * DrawElementsIndirectCommand and IndirectDraw to compacted buffers with an atomic counter. The draw consumes
+ * them with glMultiDrawElementsIndirectCount, the CPU never sees which objects are visible.
+ * Cull is the same test in C++, the reference the GPU results are validated against.
+ */
+class GPUCuller
+{
+public:
+    // one compute invocation per object, must match local_size_x in cull.comp
+    static constexpr uint32_t GROUP_SIZE = 64;
+
+    GPUCuller() = default;
+
+    GPUCuller(const GPUCuller &) = delete;
+    GPUCuller &operator=(const GPUCuller &) = delete;
+
+    // replaces every object, the levels selected so far included
+    void SetObjects(const std::vector<CullObject> &iObjects);
+    // only rewrites the matrix, the level of detail state of the pass is kept
+    void SetTransform(uint32_t iObject, const glm::mat4 &iModel);
+    size_t Size() const { return m_objectCount; }
+
+    // dispatches iCullShader, the draw buffers are ready for Draw once it returns
+    void Dispatch(Shader &iCullShader, const CullView &iView, const HiZPyramid *iHiZ = nullptr);
+    // binds the outputs of the last Dispatch and multi draws them, the shader and vertex array must be bound
+    // iIndexType: of the element buffer of the vertex array (VertexFormat::GetIndexType)
+    void Draw(GLenum iIndexType);
+
+    /**
+     * Runs the pass and the CPU reference from the same state and compares what they output, order aside
+     * (atomics don't keep it). Reads every buffer back: for tests and debugging, not for a frame.
+     */
+    bool Validate(Shader &iCullShader, const CullView &iView, const HiZPyramid *iHiZ = nullptr);
+
+    /**
+     * CPU reference of cull.comp: appends the visible objects of ioObjects in order, updates their selected
+     * level and returns how many there are. baseInstance of the commands is the index of the object.
+     */
+    static uint32_t Cull(std::vector<CullObject> &ioObjects, const CullView &iView, const HiZPyramid::Snapshot *iHiZ,
+                         std::vector<DrawElementsIndirectCommand> &oCommands, std::vector<IndirectDraw> &oDraws);
+
+private:
+    struct ShaderUniforms
+    {
+        UniformHandle<int> objectCount;
+        UniformArray<glm::vec4> planes;
+        UniformHandle<glm::vec3> cameraPosition;
+        UniformHandle<float> projectionScale;
+        UniformHandle<float> nearDistance;
+        UniformHandle<float> maxPixelError;
+        UniformHandle<float> hysteresis;
+        UniformHandle<int> useHiZ;
+        UniformHandle<int> hiZ;
+        UniformHandle<glm::mat4> hiZViewProjection;
+        UniformHandle<glm::vec2> hiZSize;
+        UniformHandle<int> hiZLevels;
+    };
+
+    const ShaderUniforms &getUniforms(const Shader &iShader);
+
+    template <typename T>
+    static std::vector<T> readBuffer(const GLBuffer &iBuffer, size_t iCount);
+
+    GLBuffer m_objectBuffer;
+    GLBuffer m_commandBuffer;
+    GLBuffer m_drawBuffer;
+    // a single uint, the draw count
+    GLBuffer m_countBuffer;
+    size_t m_objectCount = 0;
+    // capacity of the output buffers, in objects
+    size_t m_capacity = 0;
+
+    FlatHashMap<GLuint, ShaderUniforms> m_uniforms;
+};
@@ -0,0 +1,203 @@
+#include "indirect_batch.hpp"
+
+#include <algorithm>
+
+#include "gpu_culler.hpp"
+#include "uniform_blocks.hpp"
+
+IndirectBatch::IndirectBatch(GeometryPool &iPool, MaterialSystem &iMaterials) : m_pool(iPool), m_materials(iMaterials)
+{
+}
+
+IndirectBatch::~IndirectBatch()
+{
+    Clear();
+}
+
+uint32_t IndirectBatch::Add(const Mesh &iMesh, const glm::mat4 &iTransform)
+{
+    Entry aEntry;
+    aEntry.mesh = &iMesh;
+    aEntry.range = m_pool.Add(iMesh);
+    aEntry.transform = iTransform;
+    aEntry.material = m_materials.Add(iMesh.materials);
+    // the shader can only read the tangents the pool stores
+    aEntry.flags = iMesh.HasTangents() && m_pool.GetVertexFormat().tangents ? DRAW_FLAG_TANGENTS : 0;
+    aEntry.lod = 0;
+
+    m_entries.push_back(aEntry);
+    m_culler.Add(iMesh.GetBounds().box.Transformed(iTransform));
+    m_bCullObjectsDirty = true;
+    return static_cast<uint32_t>(m_entries.size() - 1);
+}
+
+void IndirectBatch::SetTransform(uint32_t iId, const glm::mat4 &iTransform)
+{
+    if (iId < m_entries.size())
+    {
+        m_entries[iId].transform = iTransform;
+        m_culler.Set(iId, m_entries[iId].mesh->GetBounds().box.Transformed(iTransform));
+        if (m_gpuCuller && !m_bCullObjectsDirty)
+        {
+            m_gpuCuller->SetTransform(iId, iTransform);
+        }
+    }
+}
+
+void IndirectBatch::Clear()
+{
+    for (const Entry &aEntry : m_entries)
+    {
+        m_pool.Remove(aEntry.range);
+    }
+    m_entries.clear();
+    m_culler.Clear();
+    m_bCullObjectsDirty = true;
+}
+
+void IndirectBatch::Draw(Shader &iShader)
+{
+    draw(iShader, nullptr, nullptr);
+}
+
+void IndirectBatch::Draw(Shader &iShader, const Frustum &iFrustum)
+{
+    draw(iShader, &iFrustum, nullptr);
+}
+
+void IndirectBatch::Draw(Shader &iShader, const Frustum &iFrustum, const LodSelector &iLods)
+{
+    draw(iShader, &iFrustum, &iLods);
+}
+
+void IndirectBatch::Draw(Shader &iShader, Shader &iCullShader, const CullView &iView, const HiZPyramid *iHiZ)
+{
+    m_stats = {};
+    if (m_entries.empty())
+    {
+        return;
+    }
+
+    if (!m_gpuCuller)
+    {
+        m_gpuCuller = std::make_unique<GPUCuller>();
+    }
+    if (m_bCullObjectsDirty)
+    {
+        uploadCullObjects();
+    }
+    m_gpuCuller->Dispatch(iCullShader, iView, iHiZ);
+
+    iShader.Use();
+    m_materials.Bind(iShader);
+    GLStateCache::Get().BindVertexArray(m_pool.GetVertexArray());
+    m_gpuCuller->Draw(m_pool.GetVertexFormat().GetIndexType());
+    m_stats.multiDraws = 1;
+    m_stats.draws = m_entries.size();
+}
+
+void IndirectBatch::uploadCullObjects()
+{
+    std::vector<CullObject> aObjects(m_entries.size());
+    for (size_t i = 0; i < m_entries.size(); i++)
+    {
+        const Entry &aEntry = m_entries[i];
+        CullObject &aObject = aObjects[i];
+        aObject = {};
+        aObject.model = aEntry.transform;
+        aObject.material = aEntry.material;
+        aObject.flags = aEntry.flags;
+        aObject.lod = aEntry.lod;
+
+        const Bounds &aBounds = aEntry.mesh->GetBounds();
+        if (aBounds.box.IsValid())
+        {
+            aObject.center = glm::vec4(aBounds.box.GetCenter(), aBounds.sphere.radius);
+            aObject.extents = glm::vec4(aBounds.box.GetExtents(), 0.0f);
+        }
+        else
+        {
+            aObject.center = glm::vec4(0.0f, 0.0f, 0.0f, -1.0f);
+            aObject.extents = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+        }
+
+        // an entry the pool had no room for draws nothing (lods[0] stays empty)
+        if (!aEntry.range.IsValid())
+        {
+            continue;
+        }
+        aObject.baseVertex = aEntry.range.baseVertex;
+        aObject.lodCount = std::min(static_cast<uint32_t>(aEntry.mesh->GetLodCount()), CullObject::MAX_LODS);
+        for (uint32_t aLod = 0; aLod < aObject.lodCount; aLod++)
+        {
+            IndexRange aRange = aEntry.mesh->GetLodRange(aLod);
+            aObject.lods[aLod] = glm::uvec2(aEntry.range.firstIndex + aRange.first, aRange.count);
+            aObject.lodErrors[aLod] = aEntry.mesh->GetLodError(aLod);
+        }
+    }
+    m_gpuCuller->SetObjects(aObjects);
+    m_bCullObjectsDirty = false;
+}
+
+void IndirectBatch::draw(Shader &iShader, const Frustum *iFrustum, const LodSelector *iLods)
+{
+    m_stats = {};
+    if (m_entries.empty())
+    {
+        return;
+    }
+
+    if (iFrustum)
+    {
+        m_stats.culled = m_entries.size() - m_culler.Cull(*iFrustum);
+    }
+
+    // gl_DrawID indexes m_draws
+    m_commands.clear();
+    m_draws.clear();
+    for (uint32_t i = 0; i < m_entries.size(); i++)
+    {
+        Entry &aEntry = m_entries[i];
+        if (!aEntry.range.IsValid() || (iFrustum && !m_culler.IsVisible(i)))
+        {
+            continue;
+        }
+        if (iLods)
+        {
+            aEntry.lod = iLods->Select(*aEntry.mesh, aEntry.transform, aEntry.lod);
+        }
+        IndexRange aLod = aEntry.mesh->GetLodRange(iLods ? aEntry.lod : 0);
+        uint32_t aDraw = static_cast<uint32_t>(m_draws.size());
+        m_commands.push_back({aLod.count, 1, aEntry.range.firstIndex + aLod.first, aEntry.range.baseVertex, aDraw});
+        m_stats.triangles += aLod.count / 3;
+        m_draws.push_back({aEntry.transform, aEntry.material, aEntry.flags, {}});
+    }
+    if (m_commands.empty())
+    {
+        return;
+    }
+
+    if (!m_commandBuffer)
+    {
+        m_commandBuffer = GLBuffer::Create();
+        m_drawBuffer = GLBuffer::Create();
+    }
+    // orphaned every frame, the previous frame may still be reading them
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_commandBuffer.Get());
+    glBufferData(GL_DRAW_INDIRECT_BUFFER, m_commands.size() * sizeof(DrawElementsIndirectCommand), m_commands.data(), GL_STREAM_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_drawBuffer.Get());
+    glBufferData(GL_SHADER_STORAGE_BUFFER, m_draws.size() * sizeof(IndirectDraw), m_draws.data(), GL_STREAM_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, static_cast<GLuint>(StorageBinding::Draws), m_drawBuffer.Get());
+
+    iShader.Use();
+    m_materials.Bind(iShader);
+    GLStateCache::Get().BindVertexArray(m_pool.GetVertexArray());
+
+    glMultiDrawElementsIndirect(GL_TRIANGLES, m_pool.GetVertexFormat().GetIndexType(), nullptr, static_cast<GLsizei>(m_commands.size()), 0);
+    m_stats.multiDraws = 1;
+    m_stats.draws = m_commands.size();
+
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "frustum.hpp"
+#include "geometry_pool.hpp"
+#include "gl_object.hpp"
+#include "lod_selector.hpp"
+#include "material_system.hpp"
+#include "mesh.hpp"
+#include "shader.hpp"
+
+// layout expected by glMultiDrawElementsIndirect
+struct DrawElementsIndirectCommand
+{
+    uint32_t count;
+    uint32_t instanceCount;
+    uint32_t firstIndex;
+    int32_t baseVertex;
+    uint32_t baseInstance;
+};
+
+// std430, GLSL: DrawData draws[] (StorageBinding::Draws)
+struct IndirectDraw
+{
+    glm::mat4 model;
+    // id in the MaterialSystem
+    uint32_t material;
+    uint32_t flags;
+    uint32_t padding[2];
+};
+
+static_assert(sizeof(DrawElementsIndirectCommand) == 20);
+static_assert(sizeof(IndirectDraw) == 80);
+
+class GPUCuller;
+class HiZPyramid;
+struct CullView;
+
+/**
+ * Static meshes sub-allocated from a GeometryPool and drawn with a single glMultiDrawElementsIndirect.
+ * The command buffer is rebuilt every frame, per draw data (transform, material id) goes to a shader
+ * storage buffer read with gl_DrawID. Materials live in a MaterialSystem, so meshes with different textures
+ * share the multi draw.
+ * Draw it with a shader compiled with MaterialSystem::GetShaderDefines, the meshes must outlive the batch.
+ * The GPU driven Draw leaves the culling, level selection and command building to a compute pass instead.
+ */
+class IndirectBatch
+{
+public:
+    static constexpr uint32_t DRAW_FLAG_TANGENTS = 1 << 0;
+
+    struct Stats
+    {
+        size_t draws = 0;
+        size_t multiDraws = 0;
+        size_t culled = 0;
+        size_t triangles = 0;
+    };
+
+    IndirectBatch(GeometryPool &iPool, MaterialSystem &iMaterials);
+    ~IndirectBatch();
+
+    IndirectBatch(const IndirectBatch &) = delete;
+    IndirectBatch &operator=(const IndirectBatch &) = delete;
+
+    // uploads iMesh into the pool, returns the id of the draw
+    uint32_t Add(const Mesh &iMesh, const glm::mat4 &iTransform = glm::mat4(1.0f));
+    void SetTransform(uint32_t iId, const glm::mat4 &iTransform);
+    // gives the geometry back to the pool
+    void Clear();
+
+    size_t Size() const { return m_entries.size(); }
+    const Stats &GetStats() const { return m_stats; }
+
+    void Draw(Shader &iShader);
+    // draws only the meshes whose transformed bounds intersect iFrustum
+    void Draw(Shader &iShader, const Frustum &iFrustum);
+    // same, each mesh at the level of detail picked by iLods
+    void Draw(Shader &iShader, const Frustum &iFrustum, const LodSelector &iLods);
+    /**
+     * Same on the GPU: iCullShader (assets/shaders/cull.comp) culls against iView, and against the last frame's
+     * depth with iHiZ, then the visible meshes are drawn with glMultiDrawElementsIndirectCount.
+     * Nothing comes back to the CPU, the stats only count the draws submitted to the pass.
+     */
+    void Draw(Shader &iShader, Shader &iCullShader, const CullView &iView, const HiZPyramid *iHiZ = nullptr);
+    // culler of the GPU driven draw (nullptr before the first one), e.g. to Validate it
+    GPUCuller *GetGPUCuller() { return m_gpuCuller.get(); }
+
+private:
+    struct Entry
+    {
+        const Mesh *mesh;
+        GeometryRange range;
+        glm::mat4 transform;
+        uint32_t material;
+        uint32_t flags;
+        // last selected level, for the hysteresis of LodSelector
+        uint32_t lod;
+    };
+
+    void draw(Shader &iShader, const Frustum *iFrustum, const LodSelector *iLods);
+    // one CullObject per entry, same indices
+    void uploadCullObjects();
+
+    GeometryPool &m_pool;
+    MaterialSystem &m_materials;
+    std::vector<Entry> m_entries;
+    // world bounds of the entries, same indices
+    FrustumCuller m_culler;
+
+    std::vector<DrawElementsIndirectCommand> m_commands;
+    std::vector<IndirectDraw> m_draws;
+
+    GLBuffer m_commandBuffer;
+    GLBuffer m_drawBuffer;
+
+    std::unique_ptr<GPUCuller> m_gpuCuller;
+    // entries added or removed since the objects of m_gpuCuller were uploaded
+    bool m_bCullObjectsDirty = true;
+
+    Stats m_stats;
+};
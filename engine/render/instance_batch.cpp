@@ -0,0 +1,101 @@
+#include "instance_batch.hpp"
+
+#include <algorithm>
+
+namespace
+{
+    // first attribute location after the ones of the meshes (see VertexFormat::Bind), 4 is kept free
+    constexpr GLuint INSTANCE_MODEL_LOCATION = 5;
+    constexpr GLuint INSTANCE_TINT_LOCATION = INSTANCE_MODEL_LOCATION + 4;
+}
+
+InstanceBatch::InstanceBatch(const Mesh &mesh) : mesh(&mesh)
+{
+    VAO = GLVertexArray::Create();
+    instanceBuffer = GLBuffer::Create();
+
+    GLStateCache::Get().BindVertexArray(VAO.Get());
+    mesh.BindVertexAttributes();
+
+    glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer.Get());
+    // a mat4 attribute takes one location per column
+    for (GLuint column = 0; column < 4; column++)
+    {
+        GLuint location = INSTANCE_MODEL_LOCATION + column;
+        glEnableVertexAttribArray(location);
+        glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (void *)(offsetof(InstanceData, model) + column * sizeof(glm::vec4)));
+        glVertexAttribDivisor(location, 1);
+    }
+    glEnableVertexAttribArray(INSTANCE_TINT_LOCATION);
+    glVertexAttribPointer(INSTANCE_TINT_LOCATION, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (void *)offsetof(InstanceData, tint));
+    glVertexAttribDivisor(INSTANCE_TINT_LOCATION, 1);
+
+    GLStateCache::Get().BindVertexArray(0);
+}
+
+void InstanceBatch::Add(const glm::mat4 &model, const glm::vec4 &tint)
+{
+    instances.push_back({model, tint});
+    dirty = true;
+}
+
+void InstanceBatch::Set(std::vector<InstanceData> newInstances)
+{
+    instances = std::move(newInstances);
+    dirty = true;
+}
+
+void InstanceBatch::Clear()
+{
+    instances.clear();
+    dirty = true;
+}
+
+std::vector<InstanceData> &InstanceBatch::GetInstances()
+{
+    dirty = true;
+    return instances;
+}
+
+void InstanceBatch::Draw(Shader &shader, const MaterialUniforms &uniforms) const
+{
+    if (mesh == nullptr || instances.empty())
+    {
+        return;
+    }
+
+    shader.Use();
+    mesh->BindMaterials(shader, uniforms);
+    DrawElements();
+}
+
+void InstanceBatch::DrawElements() const
+{
+    if (mesh == nullptr || instances.empty())
+    {
+        return;
+    }
+
+    if (dirty)
+    {
+        upload();
+    }
+
+    GLStateCache::Get().BindVertexArray(VAO.Get());
+    glDrawElementsInstanced(GL_TRIANGLES, static_cast<GLsizei>(mesh->indices.size()), mesh->GetVertexFormat().GetIndexType(), 0, static_cast<GLsizei>(instances.size()));
+}
+
+void InstanceBatch::upload() const
+{
+    glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer.Get());
+    size_t size = instances.size() * sizeof(InstanceData);
+    if (instances.size() > capacity)
+    {
+        // grows geometrically so that adding a few props doesn't reallocate every frame
+        capacity = std::max(instances.size(), capacity * 2);
+    }
+    // orphaned, the previous frame may still be reading it
+    glBufferData(GL_ARRAY_BUFFER, capacity * sizeof(InstanceData), nullptr, GL_DYNAMIC_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, size, instances.data());
+    dirty = false;
+}
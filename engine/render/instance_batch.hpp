@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "gl_object.hpp"
+#include "mesh.hpp"
+#include "shader.hpp"
+
+// per instance vertex attributes, read by the INSTANCED shader variants (locations 5 to 9)
+struct InstanceData
+{
+    glm::mat4 model = glm::mat4(1.0f);
+    glm::vec4 tint = glm::vec4(1.0f);
+};
+
+/**
+ * Many copies of one mesh drawn with a single glDrawElementsInstanced.
+ * The batch has its own vertex array sharing the mesh's vertex and index buffers, plus a buffer of
+ * InstanceData advanced once per instance, so several batches can use the same mesh.
+ * Draw it with a shader compiled with the INSTANCED define (see Shader), the mesh must outlive the batch.
+ */
+class InstanceBatch
+{
+public:
+    InstanceBatch() = default;
+    explicit InstanceBatch(const Mesh &mesh);
+
+    InstanceBatch(const InstanceBatch &) = delete;
+    InstanceBatch &operator=(const InstanceBatch &) = delete;
+    InstanceBatch(InstanceBatch &&) noexcept = default;
+    InstanceBatch &operator=(InstanceBatch &&) noexcept = default;
+
+    void Add(const glm::mat4 &model, const glm::vec4 &tint = glm::vec4(1.0f));
+    void Set(std::vector<InstanceData> instances);
+    void Clear();
+
+    // instances are kept on the CPU, the changed ones are uploaded by the next draw
+    std::vector<InstanceData> &GetInstances();
+    const std::vector<InstanceData> &GetInstances() const { return instances; }
+    size_t Size() const { return instances.size(); }
+
+    const Mesh *GetMesh() const { return mesh; }
+    GLuint GetVertexArray() const { return VAO.Get(); }
+
+    void Draw(Shader &shader, const MaterialUniforms &uniforms) const;
+    // expects the shader and the materials to be bound (see RenderQueue)
+    void DrawElements() const;
+
+private:
+    void upload() const;
+
+    const Mesh *mesh = nullptr;
+    std::vector<InstanceData> instances;
+
+    GLVertexArray VAO;
+    mutable GLBuffer instanceBuffer;
+    mutable size_t capacity = 0;
+    mutable bool dirty = false;
+};
@@ -0,0 +1,49 @@
+#include "lod_selector.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+LodSelector::LodSelector(const PerspectiveCamera &iCamera) : LodSelector(iCamera, Settings())
+{
+}
+
+LodSelector::LodSelector(const PerspectiveCamera &iCamera, const Settings &iSettings) : m_position(iCamera.GetPosition()), m_settings(iSettings)
+{
+    const PerspectiveCamera::Frustrum &aFrustrum = iCamera.GetFrustrum();
+    m_projectionScale = aFrustrum.height / (2.0f * std::tan(glm::radians(aFrustrum.angle) * 0.5f));
+    m_near = std::max(aFrustrum.near, 1e-4f);
+}
+
+float LodSelector::GetPixelsPerUnit(float iDistance) const
+{
+    return m_projectionScale / std::max(iDistance, m_near);
+}
+
+uint32_t LodSelector::Select(const Mesh &iMesh, const glm::mat4 &iTransform, uint32_t iCurrent) const
+{
+    uint32_t aCount = static_cast<uint32_t>(iMesh.GetLodCount());
+    const BoundingSphere &aLocal = iMesh.GetBounds().sphere;
+    if (aCount == 1 || !aLocal.IsValid())
+    {
+        return 0;
+    }
+
+    // the closest point of the mesh sets the size of its error on screen
+    BoundingSphere aSphere = aLocal.Transformed(iTransform);
+    float aDistance = glm::length(aSphere.center - m_position) - aSphere.radius;
+    float aScale = aLocal.radius > 0.0f ? aSphere.radius / aLocal.radius : 1.0f;
+    float aPixelsPerError = GetPixelsPerUnit(aDistance) * aScale;
+
+    float aStay = m_settings.maxPixelError * (1.0f + m_settings.hysteresis);
+    float aSwitch = m_settings.maxPixelError * (1.0f - m_settings.hysteresis);
+    // errors grow with the level, the first one that fits from the coarsest is the one
+    for (uint32_t aLod = aCount - 1; aLod > 0; aLod--)
+    {
+        float aLimit = aLod == iCurrent ? aStay : aLod > iCurrent ? aSwitch : m_settings.maxPixelError;
+        if (iMesh.GetLodError(aLod) * aPixelsPerError <= aLimit)
+        {
+            return aLod;
+        }
+    }
+    return 0;
+}
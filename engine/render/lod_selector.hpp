@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+#include "mesh.hpp"
+#include "camera/camera_perspective.hpp"
+
+/**
+ * Picks the level of detail of a mesh from the size its simplification error takes on screen: the coarsest
+ * level whose error, projected at the distance of the mesh with the field of view and viewport height of the
+ * camera, stays under a number of pixels.
+ * Levels switch with hysteresis: a coarser level is only taken once its error is well under the limit and the
+ * current one kept until its error is well over, so a mesh at the limit distance doesn't pop every frame.
+ * The caller keeps the level selected last frame, per draw.
+ */
+class LodSelector
+{
+public:
+    struct Settings
+    {
+        float maxPixelError = 1.0f;
+        // width of the band around maxPixelError, relative to it
+        float hysteresis = 0.25f;
+    };
+
+    LodSelector(const PerspectiveCamera &iCamera);
+    LodSelector(const PerspectiveCamera &iCamera, const Settings &iSettings);
+
+    // pixels covered on screen by one world unit at iDistance from the camera
+    float GetPixelsPerUnit(float iDistance) const;
+    // iCurrent: the level selected for the same draw last frame (0 the first time)
+    uint32_t Select(const Mesh &iMesh, const glm::mat4 &iTransform, uint32_t iCurrent) const;
+
+    // the same selection runs on the GPU (see GPUCuller), which takes these as uniforms
+    const glm::vec3 &GetPosition() const { return m_position; }
+    float GetProjectionScale() const { return m_projectionScale; }
+    float GetNear() const { return m_near; }
+    const Settings &GetSettings() const { return m_settings; }
+
+private:
+    glm::vec3 m_position;
+    // viewport height / (2 tan(fov / 2))
+    float m_projectionScale;
+    float m_near;
+    Settings m_settings;
+};
@@ -0,0 +1,392 @@
+#include "material_system.hpp"
+
+#include <algorithm>
+
+#include "gl_state.hpp"
+#include "uniform_blocks.hpp"
+#include "core/thread_pool.hpp"
+#include "resources/fileloader.hpp"
+#include "resources/texture_cache.hpp"
+#include "resources/block_compression.hpp"
+#include "helpers/log.hpp"
+
+namespace
+{
+    struct TextureFormat
+    {
+        GLenum internalFormat;
+        GLenum format;
+    };
+
+    TextureFormat getFormat(int channels)
+    {
+        switch (channels)
+        {
+        case 1:
+            return {GL_R8, GL_RED};
+        case 2:
+            return {GL_RG8, GL_RG};
+        case 3:
+            return {GL_RGB8, GL_RGB};
+        default:
+            return {GL_RGBA8, GL_RGBA};
+        }
+    }
+
+    GLsizei getMipCount(int width, int height)
+    {
+        GLsizei levels = 1;
+        for (int size = std::max(width, height); size > 1; size >>= 1)
+        {
+            levels++;
+        }
+        return levels;
+    }
+
+    const Texture *getSlotTexture(const Material &material, MaterialSlot slot)
+    {
+        switch (slot)
+        {
+        case MaterialSlot::Diffuse:
+            return &material.texture_diffuse;
+        case MaterialSlot::Specular:
+            return &material.texture_specular;
+        case MaterialSlot::Normal:
+            return &material.texture_normal;
+        default:
+            return &material.texture_ambiant;
+        }
+    }
+}
+
+MaterialSystem::MaterialSystem()
+{
+#ifdef GL_ARB_bindless_texture
+    m_bBindless = GLAD_GL_ARB_bindless_texture != 0;
+#endif
+    INFO("Material textures use " << (m_bBindless ? "bindless handles" : "texture arrays"));
+}
+
+MaterialSystem::~MaterialSystem()
+{
+    Clear();
+}
+
+std::vector<std::string> MaterialSystem::GetShaderDefines() const
+{
+    std::vector<std::string> aDefines = {"INDIRECT"};
+    if (m_bBindless)
+    {
+        aDefines.push_back("BINDLESS");
+    }
+    return aDefines;
+}
+
+uint32_t MaterialSystem::Add(const Material &iMaterial)
+{
+    return Add(std::vector<Material>{iMaterial});
+}
+
+uint32_t MaterialSystem::Add(const std::vector<Material> &iMaterials)
+{
+    GPUMaterial aMaterial = {};
+    aMaterial.diffuse = glm::vec4(1.0f, 1.0f, 1.0f, 0.0f);
+    aMaterial.specular = glm::vec4(1.0f, 1.0f, 1.0f, 0.0f);
+    aMaterial.shininess = DEFAULT_SHININESS;
+    aMaterial.alpha = 1.0f;
+    std::fill(std::begin(aMaterial.textures), std::end(aMaterial.textures), NO_TEXTURE);
+
+    // unset values are negative (see Material), the first set one wins
+    bool aHasDiffuse = false, aHasSpecular = false, aHasShininess = false, aHasAlpha = false;
+    std::array<std::string, static_cast<size_t>(MaterialSlot::Count)> aPaths;
+    for (const Material &aSource : iMaterials)
+    {
+        if (!aHasDiffuse && aSource.diffuse_color.x >= 0.0f)
+        {
+            aMaterial.diffuse = glm::vec4(aSource.diffuse_color, 1.0f);
+            aHasDiffuse = true;
+        }
+        if (!aHasSpecular && aSource.specular_color.x >= 0.0f)
+        {
+            aMaterial.specular = glm::vec4(aSource.specular_color, 1.0f);
+            aHasSpecular = true;
+        }
+        if (!aHasShininess && aSource.specular_exponent > 0.0f)
+        {
+            aMaterial.shininess = aSource.specular_exponent;
+            aHasShininess = true;
+        }
+        if (!aHasAlpha && aSource.alpha >= 0.0f)
+        {
+            aMaterial.alpha = aSource.alpha;
+            aHasAlpha = true;
+        }
+
+        for (size_t aSlot = 0; aSlot < aPaths.size(); aSlot++)
+        {
+            const Texture *aTexture = getSlotTexture(aSource, static_cast<MaterialSlot>(aSlot));
+            if (aPaths[aSlot].empty() && aTexture->type != TextureType::UNKNOWN && !aTexture->path.empty())
+            {
+                aPaths[aSlot] = aTexture->path;
+            }
+        }
+    }
+    // the merged values and paths, not the names: different materials are often named alike ("Material", "")
+    std::string aKey(reinterpret_cast<const char *>(&aMaterial), sizeof(aMaterial));
+    for (const std::string &aPath : aPaths)
+    {
+        aKey += aPath;
+        aKey += '\0';
+    }
+
+    auto [aId, aInserted] = m_materialIds.TryEmplace(aKey, static_cast<uint32_t>(m_materials.size()));
+    if (!aInserted)
+    {
+        return *aId;
+    }
+
+    m_materials.push_back(aMaterial);
+    for (size_t aSlot = 0; aSlot < aPaths.size(); aSlot++)
+    {
+        if (!aPaths[aSlot].empty())
+        {
+            m_pending.push_back({aPaths[aSlot], *aId, static_cast<MaterialSlot>(aSlot)});
+        }
+    }
+    m_bDirty = true;
+    return *aId;
+}
+
+void MaterialSystem::Upload()
+{
+    if (!m_pending.empty())
+    {
+        std::vector<std::string> aPaths;
+        for (PendingTexture &aPending : m_pending)
+        {
+            aPending.path = TextureCache::MakeKey(aPending.path).path;
+            bool aKnown = m_bBindless ? m_handles.Contains(aPending.path) : m_layers.Contains(aPending.path);
+            if (!aKnown && std::find(aPaths.begin(), aPaths.end(), aPending.path) == aPaths.end())
+            {
+                aPaths.push_back(aPending.path);
+            }
+        }
+
+        if (m_bBindless)
+        {
+            loadHandles(aPaths);
+        }
+        else
+        {
+            loadLayers(aPaths);
+        }
+
+        for (const PendingTexture &aPending : m_pending)
+        {
+            GPUMaterial &aMaterial = m_materials[aPending.material];
+            size_t aSlot = static_cast<size_t>(aPending.slot);
+            if (m_bBindless)
+            {
+                const uint64_t *aHandle = m_handles.Find(aPending.path);
+                aMaterial.handles[aSlot] = aHandle ? *aHandle : 0;
+                aMaterial.textures[aSlot] = aHandle && *aHandle != 0 ? 0 : NO_TEXTURE;
+            }
+            else
+            {
+                const uint32_t *aReference = m_layers.Find(aPending.path);
+                aMaterial.textures[aSlot] = aReference ? *aReference : NO_TEXTURE;
+            }
+        }
+        m_pending.clear();
+        m_bDirty = true;
+    }
+
+    if (!m_bDirty)
+    {
+        return;
+    }
+    if (!m_buffer)
+    {
+        m_buffer = GLBuffer::Create();
+    }
+    // never empty, binding a buffer without storage is an error
+    GPUMaterial aEmpty = {};
+    const GPUMaterial *aData = m_materials.empty() ? &aEmpty : m_materials.data();
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_buffer.Get());
+    glBufferData(GL_SHADER_STORAGE_BUFFER, std::max<size_t>(m_materials.size(), 1) * sizeof(GPUMaterial), aData, GL_STATIC_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    m_bDirty = false;
+}
+
+void MaterialSystem::Bind(Shader &iShader)
+{
+    Upload();
+
+    if (iShader.GetId() != m_program)
+    {
+        // sampler values are program state, set once
+        m_program = iShader.GetId();
+        m_arrayUniforms = iShader.GetUniformArray<int>("textureArrays");
+        for (uint32_t i = 0; i < m_arrayUniforms.Size(); i++)
+        {
+            iShader.Set(m_arrayUniforms[i], static_cast<int>(i));
+        }
+    }
+
+    GLStateCache &aState = GLStateCache::Get();
+    for (uint32_t i = 0; i < m_arrays.size(); i++)
+    {
+        aState.BindTexture(i, GL_TEXTURE_2D_ARRAY, m_arrays[i].texture.Get());
+    }
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, static_cast<GLuint>(StorageBinding::Materials), m_buffer.Get());
+}
+
+void MaterialSystem::Clear()
+{
+#ifdef GL_ARB_bindless_texture
+    m_handles.ForEach([](const std::string &, uint64_t iHandle)
+                      {
+                          if (iHandle != 0)
+                          {
+                              glMakeTextureHandleNonResidentARB(iHandle);
+                          } });
+#endif
+    m_handles.Clear();
+    m_layers.Clear();
+    m_arrays.clear();
+    m_materials.clear();
+    m_materialIds.Clear();
+    m_pending.clear();
+    m_bDirty = true;
+}
+
+void MaterialSystem::loadLayers(const std::vector<std::string> &iPaths)
+{
+    std::vector<std::optional<Image>> aImages(iPaths.size());
+    ThreadPool::Get().ParallelFor(iPaths.size(), [&](size_t i)
+                                  { aImages[i] = tools::DecodeTexture(iPaths[i]); });
+
+    std::vector<bool> aNeedsMipmaps(m_arrays.size(), false);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for (size_t i = 0; i < iPaths.size(); i++)
+    {
+        uint32_t aReference = aImages[i] ? addLayer(*aImages[i], iPaths[i], aNeedsMipmaps) : NO_TEXTURE;
+        m_layers[iPaths[i]] = aReference;
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    GLStateCache &aState = GLStateCache::Get();
+    for (size_t i = 0; i < aNeedsMipmaps.size(); i++)
+    {
+        if (aNeedsMipmaps[i])
+        {
+            aState.BindTexture(0, GL_TEXTURE_2D_ARRAY, m_arrays[i].texture.Get());
+            glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+        }
+    }
+}
+
+uint32_t MaterialSystem::addLayer(const Image &iImage, const std::string &iPath, std::vector<bool> &ioNeedsMipmaps)
+{
+    if (iImage.levels.empty() || iImage.width <= 0 || iImage.height <= 0)
+    {
+        return NO_TEXTURE;
+    }
+
+    bool aCompressed = iImage.encoding != Image::Encoding::RAW;
+    GLsizei aImageLevels = static_cast<GLsizei>(iImage.levels.size());
+    auto aFound = std::find_if(m_arrays.begin(), m_arrays.end(), [&](const TextureArray &iArray)
+                               { return iArray.width == iImage.width && iArray.height == iImage.height && iArray.channels == iImage.channels &&
+                                        iArray.encoding == iImage.encoding && (!aCompressed || iArray.levels == aImageLevels); });
+    if (aFound == m_arrays.end())
+    {
+        if (m_arrays.size() == MAX_TEXTURE_ARRAYS)
+        {
+            ERROR("Too many texture sizes for the material system, texture skipped: " << iPath);
+            return NO_TEXTURE;
+        }
+        TextureArray aArray;
+        aArray.width = iImage.width;
+        aArray.height = iImage.height;
+        aArray.channels = iImage.channels;
+        aArray.encoding = iImage.encoding;
+        aArray.levels = aCompressed ? aImageLevels : getMipCount(iImage.width, iImage.height);
+        m_arrays.push_back(std::move(aArray));
+        ioNeedsMipmaps.push_back(false);
+        aFound = m_arrays.end() - 1;
+    }
+
+    TextureArray &aArray = *aFound;
+    uint32_t aIndex = static_cast<uint32_t>(aFound - m_arrays.begin());
+    if (aArray.layers == aArray.capacity)
+    {
+        reserve(aArray, std::max<uint32_t>(4, aArray.capacity * 2));
+    }
+
+    uint32_t aLayer = aArray.layers++;
+    GLenum aFormat = aCompressed ? tools::GetCompressedFormat(aArray.encoding) : getFormat(aArray.channels).format;
+    GLStateCache::Get().BindTexture(0, GL_TEXTURE_2D_ARRAY, aArray.texture.Get());
+    size_t aLevels = std::min<size_t>(iImage.levels.size(), aArray.levels);
+    for (size_t aLevel = 0; aLevel < aLevels; aLevel++)
+    {
+        int aWidth = std::max(1, aArray.width >> aLevel);
+        int aHeight = std::max(1, aArray.height >> aLevel);
+        if (aCompressed)
+        {
+            GLsizei aSize = static_cast<GLsizei>(BlockCompression::GetLevelSize(aArray.encoding, aArray.channels, aWidth, aHeight));
+            glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, static_cast<GLint>(aLevel), 0, 0, aLayer, aWidth, aHeight, 1, aFormat, aSize, iImage.levels[aLevel].data());
+        }
+        else
+        {
+            glTexSubImage3D(GL_TEXTURE_2D_ARRAY, static_cast<GLint>(aLevel), 0, 0, aLayer, aWidth, aHeight, 1, aFormat, GL_UNSIGNED_BYTE, iImage.levels[aLevel].data());
+        }
+    }
+    if (aLevels < static_cast<size_t>(aArray.levels))
+    {
+        ioNeedsMipmaps[aIndex] = true;
+    }
+
+    return (aIndex << 16) | aLayer;
+}
+
+void MaterialSystem::reserve(TextureArray &ioArray, uint32_t iCapacity)
+{
+    GLTexture aTexture = GLTexture::Create();
+    GLStateCache::Get().BindTexture(0, GL_TEXTURE_2D_ARRAY, aTexture.Get());
+    GLenum aInternalFormat = ioArray.encoding != Image::Encoding::RAW ? tools::GetCompressedFormat(ioArray.encoding) : getFormat(ioArray.channels).internalFormat;
+    glTexStorage3D(GL_TEXTURE_2D_ARRAY, ioArray.levels, aInternalFormat, ioArray.width, ioArray.height, iCapacity);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    // layers already there are copied on the GPU
+    for (GLsizei aLevel = 0; ioArray.layers > 0 && aLevel < ioArray.levels; aLevel++)
+    {
+        int aWidth = std::max(1, ioArray.width >> aLevel);
+        int aHeight = std::max(1, ioArray.height >> aLevel);
+        glCopyImageSubData(ioArray.texture.Get(), GL_TEXTURE_2D_ARRAY, aLevel, 0, 0, 0,
+                           aTexture.Get(), GL_TEXTURE_2D_ARRAY, aLevel, 0, 0, 0, aWidth, aHeight, ioArray.layers);
+    }
+
+    ioArray.texture = std::move(aTexture);
+    ioArray.capacity = iCapacity;
+}
+
+void MaterialSystem::loadHandles(const std::vector<std::string> &iPaths)
+{
+#ifdef GL_ARB_bindless_texture
+    // the textures stay owned by the cache, the handles make them resident
+    std::vector<std::optional<Texture>> aTextures = TextureCache::Get().Load(iPaths);
+    for (size_t i = 0; i < iPaths.size(); i++)
+    {
+        uint64_t aHandle = 0;
+        if (aTextures[i])
+        {
+            aHandle = glGetTextureHandleARB(aTextures[i]->id);
+            glMakeTextureHandleResidentARB(aHandle);
+        }
+        m_handles[iPaths[i]] = aHandle;
+    }
+#endif
+}
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "gl_object.hpp"
+#include "mesh.hpp"
+#include "shader.hpp"
+#include "uniform.hpp"
+#include "resources/image.hpp"
+#include "helpers/flat_hash_map.hpp"
+
+// texture slots of a GPUMaterial, in the order of GPUMaterial::textures
+enum class MaterialSlot : uint32_t
+{
+    Diffuse = 0,
+    Specular = 1,
+    Normal = 2,
+    Ambient = 3,
+    Count = 4,
+};
+
+// std430, GLSL: MaterialData materials[] (StorageBinding::Materials)
+struct GPUMaterial
+{
+    // rgb, a > 0 when the material sets the color
+    glm::vec4 diffuse;
+    glm::vec4 specular;
+    float shininess;
+    float alpha;
+    uint32_t flags;
+    uint32_t padding;
+    // texture array << 16 | layer per slot, MaterialSystem::NO_TEXTURE when the slot is empty
+    uint32_t textures[4];
+    // bindless handles per slot (0 when empty), only filled on the bindless path
+    uint64_t handles[4];
+};
+
+static_assert(sizeof(GPUMaterial) == 96);
+
+/**
+ * Every material of a scene in one shader storage buffer indexed by material id, with their textures packed
+ * into GL_TEXTURE_2D_ARRAYs grouped by size and format (or referenced by bindless handles when
+ * ARB_bindless_texture is there). Binding the system once is enough to draw any of its materials, switching
+ * between them costs no texture bind.
+ * Shaders read it with the INDIRECT define, plus BINDLESS when IsBindless (see model.frag). GL thread only.
+ */
+class MaterialSystem
+{
+public:
+    static constexpr uint32_t NO_TEXTURE = ~0u;
+    // sampler2DArray textureArrays[MAX_TEXTURE_ARRAYS] in the shaders, bound to the first units
+    static constexpr uint32_t MAX_TEXTURE_ARRAYS = 8;
+    static constexpr float DEFAULT_SHININESS = 32.0f;
+
+    MaterialSystem();
+    ~MaterialSystem();
+
+    MaterialSystem(const MaterialSystem &) = delete;
+    MaterialSystem &operator=(const MaterialSystem &) = delete;
+
+    bool IsBindless() const { return m_bBindless; }
+    // defines of the shader variant reading this system
+    std::vector<std::string> GetShaderDefines() const;
+
+    /**
+     * Registers the materials of a mesh as one GPU material and returns its id. They are merged: the first
+     * color and the first texture set for each slot win. Materials merging to the same values and textures share an id.
+     * The textures are loaded by the next Upload (or Bind).
+     */
+    uint32_t Add(const std::vector<Material> &iMaterials);
+    uint32_t Add(const Material &iMaterial);
+    size_t Size() const { return m_materials.size(); }
+    size_t GetTextureArrayCount() const { return m_arrays.size(); }
+    const GPUMaterial &GetMaterial(uint32_t iId) const { return m_materials[iId]; }
+
+    // loads the pending textures (decoded in parallel) and uploads the material buffer if it changed
+    void Upload();
+    // uploads if needed then binds the texture arrays and the material buffer for iShader
+    void Bind(Shader &iShader);
+
+    void Clear();
+
+private:
+    struct PendingTexture
+    {
+        std::string path;
+        uint32_t material;
+        MaterialSlot slot;
+    };
+
+    // textures of the same size and format (channels, block compression), one layer each
+    struct TextureArray
+    {
+        int width = 0;
+        int height = 0;
+        int channels = 0;
+        // block compressed arrays hold the levels of their images, the GL can't generate them
+        Image::Encoding encoding = Image::Encoding::RAW;
+        GLsizei levels = 0;
+        uint32_t layers = 0;
+        uint32_t capacity = 0;
+        GLTexture texture;
+    };
+
+    void loadLayers(const std::vector<std::string> &iPaths);
+    // returns the texture reference of the new layer, NO_TEXTURE if it doesn't fit
+    uint32_t addLayer(const Image &iImage, const std::string &iPath, std::vector<bool> &ioNeedsMipmaps);
+    void reserve(TextureArray &ioArray, uint32_t iCapacity);
+    void loadHandles(const std::vector<std::string> &iPaths);
+
+    bool m_bBindless = false;
+
+    std::vector<GPUMaterial> m_materials;
+    FlatHashMap<std::string, uint32_t> m_materialIds;
+    std::vector<PendingTexture> m_pending;
+    bool m_bDirty = false;
+
+    std::vector<TextureArray> m_arrays;
+    // texture reference by canonical path, a texture shared by materials is stored once
+    FlatHashMap<std::string, uint32_t> m_layers;
+    FlatHashMap<std::string, uint64_t> m_handles;
+
+    GLBuffer m_buffer;
+
+    GLuint m_program = 0;
+    UniformArray<int> m_arrayUniforms;
+};
@@ -1,21 +1,75 @@
 #include "mesh.hpp"
 
+#include <algorithm>
+#include <cmath>
+
+#include "mesh_tangents.hpp"
+
 Mesh::Mesh() : vertices({}), indices({}), computedTangents(false)
 {
 }
 
 Mesh::Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, bool computeTangents)
+    : vertices(std::move(vertices)), indices(std::move(indices)), computedTangents(false)
 {
-    this->vertices = vertices;
-    this->indices = indices;
-    this->computedTangents = computeTangents;
-
+    ComputeBounds();
+    vertexFormat = VertexFormat::Choose(*this);
     SetupMesh(computeTangents);
 }
 
+void Mesh::ComputeBounds()
+{
+    bounds = {};
+    for (const Vertex &vertex : vertices)
+    {
+        bounds.box.Expand(vertex.position);
+    }
+    if (!bounds.box.IsValid())
+    {
+        return;
+    }
+
+    // centered on the box, tighter than its half diagonal
+    bounds.sphere.center = bounds.box.GetCenter();
+    float radiusSquared = 0.0f;
+    for (const Vertex &vertex : vertices)
+    {
+        glm::vec3 offset = vertex.position - bounds.sphere.center;
+        radiusSquared = std::max(radiusSquared, glm::dot(offset, offset));
+    }
+    bounds.sphere.radius = std::sqrt(radiusSquared);
+}
+
+MaterialUniforms MaterialUniforms::Resolve(const Shader &shader)
+{
+    MaterialUniforms uniforms;
+    uniforms.ambient = shader.GetUniformArray<int>("material.ambient");
+    uniforms.diffuse = shader.GetUniformArray<int>("material.diffuse");
+    uniforms.specular = shader.GetUniformArray<int>("material.specular");
+    uniforms.normal = shader.GetUniformArray<int>("material.normal");
+    uniforms.ambientCount = shader.GetUniform<glm::uint>("material.ambientCount");
+    uniforms.diffuseCount = shader.GetUniform<glm::uint>("material.diffuseCount");
+    uniforms.specularCount = shader.GetUniform<glm::uint>("material.specularCount");
+    uniforms.normalCount = shader.GetUniform<glm::uint>("material.normalCount");
+    uniforms.useTBN = shader.GetUniform<float>("use_tbn");
+    return uniforms;
+}
+
 void Mesh::Draw(Shader &shader) const
+{
+    Draw(shader, MaterialUniforms::Resolve(shader));
+}
+
+void Mesh::Draw(Shader &shader, const MaterialUniforms &uniforms) const
 {
     shader.Use();
+    BindMaterials(shader, uniforms);
+    DrawElements();
+}
+
+void Mesh::BindMaterials(Shader &shader, const MaterialUniforms &uniforms) const
+{
+    GLStateCache &state = GLStateCache::Get();
 
     int total = 0;
     unsigned int ambientNr = 0;
@@ -28,59 +82,84 @@ void Mesh::Draw(Shader &shader) const
         const Material &material = materials[i];
         if (material.texture_ambiant.type != TextureType::UNKNOWN)
         {
-            glActiveTexture(GL_TEXTURE0 + total);
-            shader.Upload(("material.ambient[" + std::to_string(ambientNr) + "]").c_str(), total);
-            glBindTexture(GL_TEXTURE_2D, material.texture_ambiant.id);
+            shader.Set(uniforms.ambient[ambientNr], total);
+            state.BindTexture(total, GL_TEXTURE_2D, material.texture_ambiant.id);
             ambientNr++;
             total++;
         }
         if (material.texture_diffuse.type != TextureType::UNKNOWN)
         {
-            glActiveTexture(GL_TEXTURE0 + total);
-            shader.Upload(("material.diffuse[" + std::to_string(diffuseNr) + "]").c_str(), total);
-            glBindTexture(GL_TEXTURE_2D, material.texture_diffuse.id);
+            shader.Set(uniforms.diffuse[diffuseNr], total);
+            state.BindTexture(total, GL_TEXTURE_2D, material.texture_diffuse.id);
             diffuseNr++;
             total++;
         }
         if (material.texture_specular.type != TextureType::UNKNOWN)
         {
-            glActiveTexture(GL_TEXTURE0 + total);
-            shader.Upload(("material.specular[" + std::to_string(specularNr) + "]").c_str(), total);
-            glBindTexture(GL_TEXTURE_2D, material.texture_specular.id);
+            shader.Set(uniforms.specular[specularNr], total);
+            state.BindTexture(total, GL_TEXTURE_2D, material.texture_specular.id);
             specularNr++;
             total++;
         }
         if (material.texture_normal.type != TextureType::UNKNOWN)
         {
-            glActiveTexture(GL_TEXTURE0 + total);
-            shader.Upload(("material.normal[" + std::to_string(normalNr) + "]").c_str(), total);
-            glBindTexture(GL_TEXTURE_2D, material.texture_normal.id);
+            shader.Set(uniforms.normal[normalNr], total);
+            state.BindTexture(total, GL_TEXTURE_2D, material.texture_normal.id);
             normalNr++;
             total++;
         }
     }
 
-    shader.Upload("material.ambientCount", ambientNr);
-    shader.Upload("material.diffuseCount", diffuseNr);
-    shader.Upload("material.specularCount", specularNr);
-    shader.Upload("material.normalCount", normalNr);
+    shader.Set(uniforms.ambientCount, ambientNr);
+    shader.Set(uniforms.diffuseCount, diffuseNr);
+    shader.Set(uniforms.specularCount, specularNr);
+    shader.Set(uniforms.normalCount, normalNr);
+
+    shader.Set(uniforms.useTBN, computedTangents ? 1.0f : 0.0f);
+}
+
+void Mesh::DrawElements(uint32_t lod) const
+{
+    // the vertex array stays bound, the state cache skips rebinding it for the next draw of this mesh
+    GLStateCache::Get().BindVertexArray(VAO.Get());
+    IndexRange range = GetLodRange(lod);
+    glDrawElements(GL_TRIANGLES, range.count, vertexFormat.GetIndexType(), (void *)(range.first * vertexFormat.GetIndexSize()));
+}
 
-    if (computedTangents)
+IndexRange Mesh::GetLodRange(uint32_t lod) const
+{
+    IndexRange range{0, static_cast<uint32_t>(indices.size())};
+    for (uint32_t level = 0; level < lod && level < lods.size(); level++)
     {
-        shader.Upload("use_tbn", 1.0f);
+        range.first += range.count;
+        range.count = static_cast<uint32_t>(lods[level].indices.size());
     }
-    else
+    return range;
+}
+
+size_t Mesh::GetTotalIndexCount() const
+{
+    size_t count = indices.size();
+    for (const MeshLod &lod : lods)
     {
-        shader.Upload("use_tbn", 0.0f);
+        count += lod.indices.size();
     }
-    // shader.Upload("use_tbn", 0.0f);
-
-    glActiveTexture(GL_TEXTURE0);
+    return count;
+}
 
-    // draw mesh
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
-    glBindVertexArray(0);
+uint64_t Mesh::GetMaterialKey() const
+{
+    // everything BindMaterials depends on
+    uint64_t key = computedTangents ? 1 : 0;
+    for (const Material &material : materials)
+    {
+        for (const Texture *texture : {&material.texture_ambiant, &material.texture_diffuse, &material.texture_specular, &material.texture_normal})
+        {
+            uint64_t id = texture->type != TextureType::UNKNOWN ? texture->id + 1 : 0;
+            key = (key ^ id) * 0x100000001B3ull;
+        }
+    }
+    return key;
 }
 
 void Mesh::AddMaterials(const std::vector<Material> &iMaterials)
@@ -95,50 +174,48 @@ void Mesh::AddMaterial(const Material &iMaterial)
 
 void Mesh::SetupMesh(bool computeTangents)
 {
-    glGenVertexArrays(1, &VAO);
-    glGenBuffers(1, &VBO);
-    glGenBuffers(1, &EBO);
+    // the loaders generate the tangents at import already, this is for the meshes built without them
+    if (computeTangents && !computedTangents)
+    {
+        SetupTangents();
+    }
 
-    glBindVertexArray(VAO);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    // the tangents are stored for the shader as soon as it reads them (use_tbn), the indices must fit
+    vertexFormat.tangents = computedTangents;
+    vertexFormat.shortIndices = vertexFormat.shortIndices && vertices.size() <= VertexFormat::MAX_SHORT_INDEX_VERTICES;
 
-    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
+    // replaces (and frees) the buffers of a previous setup
+    VAO = GLVertexArray::Create();
+    VBO = GLBuffer::Create();
+    EBO = GLBuffer::Create();
 
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
+    GLStateCache::Get().BindVertexArray(VAO.Get());
+    glBindBuffer(GL_ARRAY_BUFFER, VBO.Get());
 
-    // vertex positions
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)0);
-    // vertex normals
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, normal));
-    // vertex texture coords
-    glEnableVertexAttribArray(2);
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, tcoords));
+    std::vector<std::byte> packedVertices = vertexFormat.PackVertices(vertices);
+    glBufferData(GL_ARRAY_BUFFER, packedVertices.size(), packedVertices.data(), GL_STATIC_DRAW);
 
-    // I don't like how this is done the mix between private member and flag given in the method doesn't sit right with me
-    if (computeTangents)
-    {
-        computedTangents = computeTangents;
-        SetupTangents();
-    }
-    else if (computedTangents)
+    size_t indexSize = vertexFormat.GetIndexSize();
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO.Get());
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, GetTotalIndexCount() * indexSize, nullptr, GL_STATIC_DRAW);
+    for (uint32_t lod = 0; lod < GetLodCount(); lod++)
     {
-        SetupTangents();
+        IndexRange range = GetLodRange(lod);
+        std::vector<std::byte> packedIndices = vertexFormat.PackIndices(lod == 0 ? indices : lods[lod - 1].indices);
+        glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, range.first * indexSize, packedIndices.size(), packedIndices.data());
     }
 
-    // vertex tangent
-    glEnableVertexAttribArray(3);
-    glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, tangent));
-    // vertex bitangent
-    glEnableVertexAttribArray(4);
-    glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, bitangent));
+    BindVertexAttributes();
 
-    glBindVertexArray(0);
+    GLStateCache::Get().BindVertexArray(0);
+}
+
+void Mesh::BindVertexAttributes() const
+{
+    vertexFormat.Bind(VBO.Get(), EBO.Get());
 }
 
 void Mesh::SetupTangents()
 {
-    // this is just not working I need to properly look into how to calculate these tangents, and bitangents
+    computedTangents = MeshTangents::Generate(*this);
 }
\ No newline at end of file
@@ -1,13 +1,19 @@
 #pragma once
 
 #include <print>
+#include <array>
+#include <cstdint>
 #include <vector>
 #include <string>
 
+#include "bounds.hpp"
 #include "shader.hpp"
+#include "gl_object.hpp"
+#include "vertex_format.hpp"
 
 #define MAX_BONE_INFLUENCE 4
 
+// full precision, the GPU gets it packed in the VertexFormat of its mesh
 struct Vertex
 {
     glm::vec3 position = {};
@@ -26,6 +32,7 @@ enum class TextureType
     SPECULAR,
 };
 
+// non-owning, the GL texture belongs to whoever uploaded it (TextureCache for files)
 struct Texture
 {
     unsigned int id = 0; // invalid buffer id by default
@@ -51,6 +58,47 @@ struct Material
     Texture texture_stencil;
 
     std::string name = "";
+
+    // every texture slot, in declaration order
+    std::array<Texture *, 6> GetTextures()
+    {
+        return {&texture_ambiant, &texture_diffuse, &texture_specular, &texture_normal, &texture_disp, &texture_stencil};
+    }
+    std::array<const Texture *, 6> GetTextures() const
+    {
+        return {&texture_ambiant, &texture_diffuse, &texture_specular, &texture_normal, &texture_disp, &texture_stencil};
+    }
+};
+
+// uniforms of the model shader set for every mesh, resolve them once per shader and reuse them between draws
+struct MaterialUniforms
+{
+    UniformArray<int> ambient;
+    UniformArray<int> diffuse;
+    UniformArray<int> specular;
+    UniformArray<int> normal;
+    UniformHandle<glm::uint> ambientCount;
+    UniformHandle<glm::uint> diffuseCount;
+    UniformHandle<glm::uint> specularCount;
+    UniformHandle<glm::uint> normalCount;
+    UniformHandle<float> useTBN;
+
+    static MaterialUniforms Resolve(const Shader &shader);
+};
+
+// a coarser version of a mesh over the same vertices, see MeshSimplifier
+struct MeshLod
+{
+    std::vector<unsigned int> indices;
+    // object space distance the surface moved away from the full detail mesh
+    float error = 0.0f;
+};
+
+// part of an index buffer, in indices
+struct IndexRange
+{
+    uint32_t first = 0;
+    uint32_t count = 0;
 };
 
 class Mesh
@@ -60,17 +108,61 @@ public:
     std::vector<unsigned int> indices;
     std::vector<Material> materials;
     std::string name;
+    // levels of detail 1 and up, coarser and coarser (level 0 is indices)
+    std::vector<MeshLod> lods;
+    // files the loader read besides the source (.mtl, ...), the cooked cache goes stale with them
+    std::vector<std::string> dependencies;
 
     Mesh();
     Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, bool computeTangents = false);
 
+    // owns its GPU buffers, move only
+    Mesh(const Mesh &) = delete;
+    Mesh &operator=(const Mesh &) = delete;
+    Mesh(Mesh &&) noexcept = default;
+    Mesh &operator=(Mesh &&) noexcept = default;
+
+    // resolves the material uniforms on every call, use the overload below when drawing many meshes
     void Draw(Shader &shader) const;
+    void Draw(Shader &shader, const MaterialUniforms &uniforms) const;
+    // the two halves of Draw, for callers that skip rebinding materials shared by consecutive draws (RenderQueue)
+    void BindMaterials(Shader &shader, const MaterialUniforms &uniforms) const;
+    void DrawElements(uint32_t lod = 0) const;
     void AddMaterials(const std::vector<Material> &iMaterials);
     void AddMaterial(const Material &iMaterial);
+    // uploads the CPU side data, generating the tangents first when computeTangents and the mesh has none yet
     void SetupMesh(bool computeTangents = false);
+    // points the vertex attributes of the bound vertex array to this mesh's buffers (see InstanceBatch)
+    void BindVertexAttributes() const;
+    // MeshTangents::Generate, HasTangents tells whether the mesh had UVs to build them from
     void SetupTangents();
 
+    GLuint GetVertexArray() const { return VAO.Get(); }
+    // identifies the textures and flags set by BindMaterials, equal keys bind the same state
+    uint64_t GetMaterialKey() const;
+
+    size_t GetLodCount() const { return lods.size() + 1; }
+    // the index buffer holds indices followed by the indices of every lod, in order
+    IndexRange GetLodRange(uint32_t lod) const;
+    size_t GetTotalIndexCount() const;
+    float GetLodError(uint32_t lod) const { return lod == 0 ? 0.0f : lods[lod - 1].error; }
+
+    // box and sphere around the vertices, computed by the loaders once the vertices are final
+    void ComputeBounds();
+    const Bounds &GetBounds() const { return bounds; }
+
+    // layout of the GPU buffers, chosen by the loaders once the mesh is final (VertexFormat::Choose)
+    const VertexFormat &GetVertexFormat() const { return vertexFormat; }
+    void SetVertexFormat(const VertexFormat &format) { vertexFormat = format; }
+
+    bool HasTangents() const { return computedTangents; }
+    // for meshes built on the CPU and uploaded later with SetupMesh(HasTangents())
+    void SetHasTangents(bool hasTangents) { computedTangents = hasTangents; }
+
 private:
-    unsigned int VAO, VBO, EBO;
+    GLVertexArray VAO;
+    GLBuffer VBO, EBO;
+    Bounds bounds;
+    VertexFormat vertexFormat;
     bool computedTangents;
 };
\ No newline at end of file
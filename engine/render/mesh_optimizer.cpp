@@ -0,0 +1,385 @@
+#include "mesh_optimizer.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <numeric>
+
+namespace
+{
+    std::atomic<bool> enabled = true;
+
+    // FIFO cache simulated with time stamps: an entry is still cached while less than size entries came after it
+    class FifoCache
+    {
+    public:
+        FifoCache(size_t entryCount, uint32_t size) : stamps(entryCount, 0), size(size), time(size + 1) {}
+
+        // true when entry had to be (re)loaded
+        bool Access(size_t entry)
+        {
+            if (time - stamps[entry] > size)
+            {
+                stamps[entry] = time++;
+                return true;
+            }
+            return false;
+        }
+        // everything evicted, without touching the stamps
+        void Flush() { time += size + 1; }
+        // how long ago entry was loaded, in loads
+        uint64_t Age(size_t entry) const { return time - stamps[entry]; }
+
+    private:
+        std::vector<uint64_t> stamps;
+        uint32_t size;
+        uint64_t time;
+    };
+
+    uint32_t triangleMisses(FifoCache &cache, const std::vector<unsigned int> &indices, size_t triangle)
+    {
+        return cache.Access(indices[triangle * 3]) + cache.Access(indices[triangle * 3 + 1]) + cache.Access(indices[triangle * 3 + 2]);
+    }
+
+    // clusters of triangles with their overdraw sort key
+    struct Cluster
+    {
+        uint32_t first;
+        uint32_t count;
+        float key;
+    };
+}
+
+MeshOptimizer::VertexCacheStats MeshOptimizer::AnalyzeVertexCache(const std::vector<unsigned int> &indices, size_t vertexCount, uint32_t cacheSize)
+{
+    VertexCacheStats stats;
+    if (indices.size() < 3)
+    {
+        return stats;
+    }
+
+    FifoCache cache(vertexCount, cacheSize);
+    std::vector<bool> referenced(vertexCount, false);
+    size_t transformed = 0;
+    size_t unique = 0;
+    for (unsigned int index : indices)
+    {
+        transformed += cache.Access(index);
+        if (!referenced[index])
+        {
+            referenced[index] = true;
+            unique++;
+        }
+    }
+    stats.acmr = static_cast<float>(transformed) / static_cast<float>(indices.size() / 3);
+    stats.atvr = static_cast<float>(transformed) / static_cast<float>(unique);
+    return stats;
+}
+
+MeshOptimizer::VertexFetchStats MeshOptimizer::AnalyzeVertexFetch(const std::vector<unsigned int> &indices, size_t vertexCount, size_t vertexSize)
+{
+    constexpr size_t LINE_SIZE = 64;
+    constexpr uint32_t LINE_COUNT = 16 * 1024 / LINE_SIZE;
+
+    VertexFetchStats stats;
+    if (indices.empty())
+    {
+        return stats;
+    }
+
+    // the attributes are only fetched for the vertices the post transform cache misses
+    FifoCache vertices(vertexCount, 16);
+    FifoCache lines((vertexCount * vertexSize + LINE_SIZE - 1) / LINE_SIZE, LINE_COUNT);
+    std::vector<bool> referenced(vertexCount, false);
+    size_t fetched = 0;
+    size_t unique = 0;
+    for (unsigned int index : indices)
+    {
+        if (!referenced[index])
+        {
+            referenced[index] = true;
+            unique++;
+        }
+        if (!vertices.Access(index))
+        {
+            continue;
+        }
+        size_t begin = index * vertexSize;
+        for (size_t line = begin / LINE_SIZE; line <= (begin + vertexSize - 1) / LINE_SIZE; line++)
+        {
+            fetched += lines.Access(line) ? LINE_SIZE : 0;
+        }
+    }
+    stats.overfetch = static_cast<float>(fetched) / static_cast<float>(unique * vertexSize);
+    return stats;
+}
+
+std::vector<unsigned int> MeshOptimizer::OptimizeVertexCache(const std::vector<unsigned int> &indices, size_t vertexCount, uint32_t cacheSize,
+                                                             std::vector<uint32_t> *clusters)
+{
+    constexpr int64_t NONE = -1;
+
+    size_t triangleCount = indices.size() / 3;
+    std::vector<unsigned int> result;
+    result.reserve(triangleCount * 3);
+    if (clusters)
+    {
+        clusters->clear();
+    }
+    if (triangleCount == 0)
+    {
+        return result;
+    }
+
+    // triangles around each vertex, live ones are those not emitted yet
+    std::vector<uint32_t> offsets(vertexCount + 1, 0);
+    for (size_t i = 0; i < triangleCount * 3; i++)
+    {
+        offsets[indices[i] + 1]++;
+    }
+    std::inclusive_scan(offsets.begin(), offsets.end(), offsets.begin());
+    std::vector<uint32_t> adjacency(triangleCount * 3);
+    std::vector<uint32_t> live(vertexCount);
+    for (size_t i = 0; i < triangleCount * 3; i++)
+    {
+        adjacency[offsets[indices[i]] + live[indices[i]]++] = static_cast<uint32_t>(i / 3);
+    }
+    std::vector<bool> emitted(triangleCount, false);
+
+    FifoCache cache(vertexCount, cacheSize);
+    // vertices of the emitted triangles, most recent last: where to go on once a fan is exhausted
+    std::vector<unsigned int> deadEnds;
+    deadEnds.reserve(triangleCount * 3);
+    size_t cursor = 0;
+    auto skipDeadEnd = [&]() -> int64_t
+    {
+        while (!deadEnds.empty())
+        {
+            unsigned int vertex = deadEnds.back();
+            deadEnds.pop_back();
+            if (live[vertex] > 0)
+            {
+                return vertex;
+            }
+        }
+        for (; cursor < vertexCount; cursor++)
+        {
+            if (live[cursor] > 0)
+            {
+                return static_cast<int64_t>(cursor);
+            }
+        }
+        return NONE;
+    };
+
+    std::vector<unsigned int> candidates;
+    int64_t fan = skipDeadEnd();
+    bool coldStart = true;
+    while (fan != NONE)
+    {
+        if (coldStart && clusters)
+        {
+            clusters->push_back(static_cast<uint32_t>(result.size() / 3));
+        }
+
+        // every live triangle around the fanning vertex
+        candidates.clear();
+        for (uint32_t i = offsets[fan]; i < offsets[fan + 1]; i++)
+        {
+            uint32_t triangle = adjacency[i];
+            if (emitted[triangle])
+            {
+                continue;
+            }
+            emitted[triangle] = true;
+            for (int corner = 0; corner < 3; corner++)
+            {
+                unsigned int vertex = indices[triangle * 3 + corner];
+                result.push_back(vertex);
+                deadEnds.push_back(vertex);
+                candidates.push_back(vertex);
+                live[vertex]--;
+                cache.Access(vertex);
+            }
+        }
+
+        // next fan: the oldest candidate that stays cached through its remaining triangles, else any live one
+        int64_t next = NONE;
+        int64_t bestPriority = -1;
+        for (unsigned int vertex : candidates)
+        {
+            if (live[vertex] == 0)
+            {
+                continue;
+            }
+            int64_t priority = 0;
+            if (cache.Age(vertex) + 2 * live[vertex] <= cacheSize)
+            {
+                priority = static_cast<int64_t>(cache.Age(vertex));
+            }
+            if (priority > bestPriority)
+            {
+                bestPriority = priority;
+                next = vertex;
+            }
+        }
+        coldStart = next == NONE;
+        fan = coldStart ? skipDeadEnd() : next;
+    }
+    return result;
+}
+
+std::vector<unsigned int> MeshOptimizer::OptimizeOverdraw(const std::vector<unsigned int> &indices, const std::vector<Vertex> &vertices,
+                                                          const std::vector<uint32_t> &clusters, uint32_t cacheSize, float threshold)
+{
+    size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0 || clusters.empty())
+    {
+        return indices;
+    }
+
+    // splits the clusters where a prefix already reuses the cache about as well as the whole cluster
+    std::vector<Cluster> parts;
+    FifoCache cache(vertices.size(), cacheSize);
+    for (size_t c = 0; c < clusters.size(); c++)
+    {
+        uint32_t begin = clusters[c];
+        uint32_t end = c + 1 < clusters.size() ? clusters[c + 1] : static_cast<uint32_t>(triangleCount);
+
+        cache.Flush();
+        uint32_t misses = 0;
+        for (uint32_t triangle = begin; triangle < end; triangle++)
+        {
+            misses += triangleMisses(cache, indices, triangle);
+        }
+        float limit = threshold * static_cast<float>(misses) / static_cast<float>(end - begin);
+
+        cache.Flush();
+        uint32_t first = begin;
+        misses = 0;
+        for (uint32_t triangle = begin; triangle < end; triangle++)
+        {
+            misses += triangleMisses(cache, indices, triangle);
+            if (triangle + 1 < end && static_cast<float>(misses) <= limit * static_cast<float>(triangle + 1 - first))
+            {
+                parts.push_back({first, triangle + 1 - first, 0.0f});
+                first = triangle + 1;
+                misses = 0;
+                cache.Flush();
+            }
+        }
+        parts.push_back({first, end - first, 0.0f});
+    }
+
+    // clusters facing away from the center of the mesh occlude the others, they are drawn first
+    auto triangleData = [&](size_t triangle, glm::vec3 &center, glm::vec3 &normal)
+    {
+        const glm::vec3 &p0 = vertices[indices[triangle * 3]].position;
+        const glm::vec3 &p1 = vertices[indices[triangle * 3 + 1]].position;
+        const glm::vec3 &p2 = vertices[indices[triangle * 3 + 2]].position;
+        center = (p0 + p1 + p2) / 3.0f;
+        // twice the area long
+        normal = glm::cross(p1 - p0, p2 - p0);
+    };
+    glm::vec3 meshCenter(0.0f);
+    float meshArea = 0.0f;
+    for (size_t triangle = 0; triangle < triangleCount; triangle++)
+    {
+        glm::vec3 center, normal;
+        triangleData(triangle, center, normal);
+        float area = glm::length(normal);
+        meshCenter += center * area;
+        meshArea += area;
+    }
+    meshCenter = meshArea > 0.0f ? meshCenter / meshArea : glm::vec3(0.0f);
+
+    for (Cluster &part : parts)
+    {
+        glm::vec3 clusterCenter(0.0f);
+        glm::vec3 clusterNormal(0.0f);
+        float clusterArea = 0.0f;
+        for (uint32_t triangle = part.first; triangle < part.first + part.count; triangle++)
+        {
+            glm::vec3 center, normal;
+            triangleData(triangle, center, normal);
+            float area = glm::length(normal);
+            clusterCenter += center * area;
+            clusterNormal += normal;
+            clusterArea += area;
+        }
+        float normalLength = glm::length(clusterNormal);
+        if (clusterArea > 0.0f && normalLength > 0.0f)
+        {
+            part.key = glm::dot(clusterCenter / clusterArea - meshCenter, clusterNormal / normalLength);
+        }
+    }
+    std::stable_sort(parts.begin(), parts.end(), [](const Cluster &a, const Cluster &b)
+                     { return a.key > b.key; });
+
+    std::vector<unsigned int> result;
+    result.reserve(triangleCount * 3);
+    for (const Cluster &part : parts)
+    {
+        result.insert(result.end(), indices.begin() + part.first * 3, indices.begin() + (part.first + part.count) * 3);
+    }
+    return result;
+}
+
+void MeshOptimizer::OptimizeVertexFetch(Mesh &mesh)
+{
+    constexpr unsigned int UNUSED = ~0u;
+
+    if (mesh.indices.empty())
+    {
+        return;
+    }
+
+    std::vector<unsigned int> remap(mesh.vertices.size(), UNUSED);
+    std::vector<Vertex> vertices;
+    vertices.reserve(mesh.vertices.size());
+    auto renumber = [&](std::vector<unsigned int> &indices)
+    {
+        for (unsigned int &index : indices)
+        {
+            if (remap[index] == UNUSED)
+            {
+                remap[index] = static_cast<unsigned int>(vertices.size());
+                vertices.push_back(mesh.vertices[index]);
+            }
+            index = remap[index];
+        }
+    };
+    renumber(mesh.indices);
+    for (MeshLod &lod : mesh.lods)
+    {
+        renumber(lod.indices);
+    }
+    mesh.vertices = std::move(vertices);
+}
+
+void MeshOptimizer::Optimize(Mesh &mesh, const Settings &settings)
+{
+    auto optimizeLevel = [&](std::vector<unsigned int> &indices)
+    {
+        std::vector<uint32_t> clusters;
+        indices = OptimizeVertexCache(indices, mesh.vertices.size(), settings.cacheSize, &clusters);
+        indices = OptimizeOverdraw(indices, mesh.vertices, clusters, settings.cacheSize, settings.overdrawThreshold);
+    };
+
+    optimizeLevel(mesh.indices);
+    for (MeshLod &lod : mesh.lods)
+    {
+        optimizeLevel(lod.indices);
+    }
+    // last, the levels are index lists over the same vertices
+    OptimizeVertexFetch(mesh);
+}
+
+void MeshOptimizer::SetEnabled(bool on)
+{
+    enabled = on;
+}
+
+bool MeshOptimizer::IsEnabled()
+{
+    return enabled;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "mesh.hpp"
+
+/**
+ * Reordering of the meshes for the GPU, run by the loaders at import/cook time after the levels of detail:
+ * - triangles for the post transform vertex cache (Tipsify, Sander et al. 2007),
+ * - clusters of those triangles for overdraw, outward facing ones first, as long as the cache order stays
+ *   within a threshold of its efficiency,
+ * - vertices in the order the triangles first use them, for the fetch of the vertex attributes.
+ * Only the order changes: the same triangles, with the same winding, are drawn from the same data.
+ * The Analyze functions simulate the caches, to measure the result on the assets (engine-cook --report).
+ */
+namespace MeshOptimizer
+{
+    struct Settings
+    {
+        // entries of the post transform cache the triangles are ordered for
+        uint32_t cacheSize = 16;
+        // ACMR the overdraw ordering may reach relative to the vertex cache order, per cluster
+        float overdrawThreshold = 1.05f;
+    };
+
+    struct VertexCacheStats
+    {
+        // vertices transformed per triangle, 3 without any reuse, 0.5 at best on a large regular grid
+        float acmr = 0.0f;
+        // vertices transformed per vertex referenced, 1 at best
+        float atvr = 0.0f;
+    };
+
+    struct VertexFetchStats
+    {
+        // bytes read from the vertex buffer over the size of the vertices referenced, 1 at best
+        float overfetch = 0.0f;
+    };
+
+    // FIFO post transform cache of cacheSize entries
+    VertexCacheStats AnalyzeVertexCache(const std::vector<unsigned int> &indices, size_t vertexCount, uint32_t cacheSize = 16);
+    // 64 bytes lines fetched for every vertex transformed, in a 16KB cache
+    VertexFetchStats AnalyzeVertexFetch(const std::vector<unsigned int> &indices, size_t vertexCount, size_t vertexSize = sizeof(Vertex));
+
+    /**
+     * Triangles reordered for a post transform cache of cacheSize entries. clusters receives the first
+     * triangle of each run started from a cold cache, the unit OptimizeOverdraw moves around.
+     */
+    std::vector<unsigned int> OptimizeVertexCache(const std::vector<unsigned int> &indices, size_t vertexCount, uint32_t cacheSize = 16,
+                                                  std::vector<uint32_t> *clusters = nullptr);
+    // clusters of an OptimizeVertexCache order sorted so that the ones facing out of the mesh come first
+    std::vector<unsigned int> OptimizeOverdraw(const std::vector<unsigned int> &indices, const std::vector<Vertex> &vertices,
+                                               const std::vector<uint32_t> &clusters, uint32_t cacheSize = 16, float threshold = 1.05f);
+    // renumbers the vertices in their order of first use by mesh.indices then every level, drops the unused ones
+    void OptimizeVertexFetch(Mesh &mesh);
+
+    // the three above, on every level of the mesh
+    void Optimize(Mesh &mesh, const Settings &settings = {});
+
+    // on by default, the loaders skip the pass when off (engine-cook --report measures the source order)
+    void SetEnabled(bool enabled);
+    bool IsEnabled();
+};
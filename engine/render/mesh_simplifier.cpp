@@ -0,0 +1,629 @@
+#include "mesh_simplifier.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <queue>
+
+#include "helpers/flat_hash_map.hpp"
+
+namespace
+{
+    std::atomic<bool> enabled = false;
+
+    // error quadric of a set of planes, symmetric so only the upper half of the matrix is kept
+    struct Quadric
+    {
+        double a00 = 0.0, a01 = 0.0, a02 = 0.0, a11 = 0.0, a12 = 0.0, a22 = 0.0;
+        double b0 = 0.0, b1 = 0.0, b2 = 0.0;
+        double c = 0.0;
+        // sum of the weights of the planes, the error is normalized by it to stay a squared distance
+        double weight = 0.0;
+
+        // plane dot(normal, p) + distance = 0, normal normalized
+        static Quadric FromPlane(const glm::vec3 &normal, float distance, double weight)
+        {
+            Quadric quadric;
+            double x = normal.x, y = normal.y, z = normal.z, d = distance;
+            quadric.a00 = weight * x * x;
+            quadric.a01 = weight * x * y;
+            quadric.a02 = weight * x * z;
+            quadric.a11 = weight * y * y;
+            quadric.a12 = weight * y * z;
+            quadric.a22 = weight * z * z;
+            quadric.b0 = weight * x * d;
+            quadric.b1 = weight * y * d;
+            quadric.b2 = weight * z * d;
+            quadric.c = weight * d * d;
+            quadric.weight = weight;
+            return quadric;
+        }
+
+        Quadric &operator+=(const Quadric &other)
+        {
+            a00 += other.a00;
+            a01 += other.a01;
+            a02 += other.a02;
+            a11 += other.a11;
+            a12 += other.a12;
+            a22 += other.a22;
+            b0 += other.b0;
+            b1 += other.b1;
+            b2 += other.b2;
+            c += other.c;
+            weight += other.weight;
+            return *this;
+        }
+
+        // weighted mean of the squared distances of p to the planes
+        double Error(const glm::vec3 &p) const
+        {
+            double x = p.x, y = p.y, z = p.z;
+            double error = a00 * x * x + a11 * y * y + a22 * z * z +
+                           2.0 * (a01 * x * y + a02 * x * z + a12 * y * z) +
+                           2.0 * (b0 * x + b1 * y + b2 * z) + c;
+            return weight > 0.0 ? std::max(error, 0.0) / weight : 0.0;
+        }
+    };
+
+    // what a position can collapse along, decided once from the input
+    enum PositionKind : uint8_t
+    {
+        KIND_MANIFOLD,
+        // on an open border, single vertex
+        KIND_BORDER,
+        // two vertices with different attributes
+        KIND_SEAM,
+        KIND_LOCKED,
+    };
+
+    struct PositionKey
+    {
+        uint32_t x, y, z;
+
+        bool operator==(const PositionKey &other) const noexcept
+        {
+            return x == other.x && y == other.y && z == other.z;
+        }
+    };
+
+    struct PositionKeyHash
+    {
+        size_t operator()(const PositionKey &key) const noexcept
+        {
+            uint64_t hash = (static_cast<uint64_t>(key.x) << 32 | key.y) * 0x9E3779B97F4A7C15ull;
+            return static_cast<size_t>(hash ^ (hash >> 29) ^ key.z);
+        }
+    };
+
+    struct Collapse
+    {
+        double cost;
+        // breaks ties between collapses of equal cost (flat areas), short edges first keep the triangles even
+        float length;
+        uint32_t from;
+        uint32_t to;
+        // versions of both positions when the cost was computed, a collapse around them makes it stale
+        uint32_t fromVersion;
+        uint32_t toVersion;
+
+        bool operator>(const Collapse &other) const
+        {
+            return cost > other.cost || (cost == other.cost && length > other.length);
+        }
+    };
+
+    constexpr double BORDER_WEIGHT = 10.0;
+    constexpr double SEAM_WEIGHT = 1.0;
+    constexpr float MIN_NORMAL_COSINE = 0.25f;
+
+    uint64_t edgeKey(uint32_t a, uint32_t b)
+    {
+        return static_cast<uint64_t>(a) << 32 | b;
+    }
+
+    class Simplifier
+    {
+    public:
+        Simplifier(const std::vector<Vertex> &vertices, const std::vector<unsigned int> &indices)
+            : vertices(vertices), triangles(indices), alive(indices.size() / 3, 1), triangleCount(indices.size() / 3)
+        {
+            buildPositions();
+            classify();
+            buildQuadrics();
+
+            // both directions of every edge, once: a half edge pushes its twin itself when it has none
+            FlatHashMap<uint64_t, uint8_t> halfEdges(triangles.size());
+            forEachEdge([&](uint32_t, uint32_t, uint32_t a, uint32_t b)
+                        { halfEdges[edgeKey(a, b)] = 1; });
+            forEachEdge([&](uint32_t, uint32_t, uint32_t a, uint32_t b)
+                        {
+                            push(a, b);
+                            if (halfEdges.Find(edgeKey(b, a)) == nullptr)
+                            {
+                                push(b, a);
+                            } });
+        }
+
+        /**
+         * Collapses until at most targetIndexCount indices are left or the cheapest collapse exceeds maxError.
+         * Can be called again with a lower target to carry on from the result: the quadrics keep the planes
+         * of the input, so the error stays measured against it.
+         */
+        std::vector<unsigned int> Run(size_t targetIndexCount, float maxError, float *error)
+        {
+            double maxCost = static_cast<double>(maxError) * maxError;
+
+            while (triangleCount * 3 > targetIndexCount && !queue.empty())
+            {
+                Collapse collapse = queue.top();
+                uint32_t from = positionOf[collapse.from];
+                uint32_t to = positionOf[collapse.to];
+                if (!positionAlive[from] || !positionAlive[to] ||
+                    versions[from] != collapse.fromVersion || versions[to] != collapse.toVersion)
+                {
+                    queue.pop();
+                    continue;
+                }
+                if (collapse.cost > maxCost)
+                {
+                    break;
+                }
+                queue.pop();
+                if (!tryCollapse(collapse.from, collapse.to))
+                {
+                    continue;
+                }
+                reached = std::max(reached, collapse.cost);
+            }
+
+            if (error)
+            {
+                *error = static_cast<float>(std::sqrt(reached));
+            }
+
+            std::vector<unsigned int> result;
+            result.reserve(triangleCount * 3);
+            for (size_t triangle = 0; triangle < alive.size(); triangle++)
+            {
+                if (alive[triangle])
+                {
+                    result.insert(result.end(), triangles.begin() + triangle * 3, triangles.begin() + triangle * 3 + 3);
+                }
+            }
+            return result;
+        }
+
+    private:
+        const std::vector<Vertex> &vertices;
+        std::vector<unsigned int> triangles;
+        std::vector<uint8_t> alive;
+        size_t triangleCount;
+        // largest cost collapsed so far
+        double reached = 0.0;
+
+        // vertices sharing a position are welded for the collapses, the attributes stay per vertex
+        std::vector<uint32_t> positionOf;
+        std::vector<glm::vec3> points;
+        // the vertices of a position form a ring through nextWedge
+        std::vector<uint32_t> nextWedge;
+        std::vector<uint32_t> firstWedges;
+        std::vector<uint32_t> wedgeCounts;
+        std::vector<PositionKind> kinds;
+        std::vector<uint8_t> positionAlive;
+        std::vector<uint32_t> versions;
+        std::vector<Quadric> quadrics;
+        // per position, triangles using it, dead ones are dropped lazily
+        std::vector<std::vector<uint32_t>> around;
+
+        std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>> queue;
+        // scratch list of the edges around a collapse
+        std::vector<uint64_t> updated;
+
+        void buildPositions()
+        {
+            positionOf.assign(vertices.size(), UINT32_MAX);
+            nextWedge.resize(vertices.size());
+            FlatHashMap<PositionKey, uint32_t, PositionKeyHash> registered(vertices.size());
+
+            for (unsigned int vertex : triangles)
+            {
+                if (positionOf[vertex] != UINT32_MAX)
+                {
+                    continue;
+                }
+                PositionKey key;
+                std::memcpy(&key, &vertices[vertex].position, sizeof(key));
+                auto [position, inserted] = registered.TryEmplace(key, static_cast<uint32_t>(points.size()));
+                positionOf[vertex] = *position;
+                if (inserted)
+                {
+                    points.push_back(vertices[vertex].position);
+                    wedgeCounts.push_back(1);
+                    // first vertex of the ring, nextWedge of the last one comes back to it
+                    nextWedge[vertex] = vertex;
+                    firstWedges.push_back(vertex);
+                }
+                else
+                {
+                    uint32_t first = firstWedges[*position];
+                    nextWedge[vertex] = nextWedge[first];
+                    nextWedge[first] = vertex;
+                    wedgeCounts[*position]++;
+                }
+            }
+
+            around.resize(points.size());
+            for (uint32_t triangle = 0; triangle < alive.size(); triangle++)
+            {
+                for (int k = 0; k < 3; k++)
+                {
+                    around[positionOf[triangles[triangle * 3 + k]]].push_back(triangle);
+                }
+            }
+            positionAlive.assign(points.size(), 1);
+            versions.assign(points.size(), 0);
+        }
+
+        void classify()
+        {
+            FlatHashMap<uint64_t, uint32_t> positionEdges(triangles.size());
+            forEachEdge([&](uint32_t, uint32_t, uint32_t a, uint32_t b)
+                        { positionEdges[edgeKey(positionOf[a], positionOf[b])]++; });
+
+            std::vector<uint32_t> borderEdges(points.size(), 0);
+            std::vector<uint8_t> locked(points.size(), 0);
+            forEachEdge([&](uint32_t, uint32_t, uint32_t a, uint32_t b)
+                        {
+                            uint32_t pa = positionOf[a];
+                            uint32_t pb = positionOf[b];
+                            if (positionEdges[edgeKey(pa, pb)] > 1)
+                            {
+                                // non manifold edge
+                                locked[pa] = locked[pb] = 1;
+                            }
+                            else if (positionEdges.Find(edgeKey(pb, pa)) == nullptr)
+                            {
+                                borderEdges[pa]++;
+                                borderEdges[pb]++;
+                            } });
+
+            kinds.resize(points.size());
+            for (size_t position = 0; position < points.size(); position++)
+            {
+                if (locked[position] || wedgeCounts[position] > 2 || (borderEdges[position] > 0 && wedgeCounts[position] > 1) || borderEdges[position] > 2)
+                {
+                    kinds[position] = KIND_LOCKED;
+                }
+                else if (borderEdges[position] > 0)
+                {
+                    kinds[position] = KIND_BORDER;
+                }
+                else
+                {
+                    kinds[position] = wedgeCounts[position] == 2 ? KIND_SEAM : KIND_MANIFOLD;
+                }
+            }
+        }
+
+        void buildQuadrics()
+        {
+            quadrics.resize(points.size());
+            FlatHashMap<uint64_t, uint32_t> vertexEdges(triangles.size());
+            FlatHashMap<uint64_t, uint32_t> positionEdges(triangles.size());
+            forEachEdge([&](uint32_t, uint32_t, uint32_t a, uint32_t b)
+                        {
+                            vertexEdges[edgeKey(a, b)]++;
+                            positionEdges[edgeKey(positionOf[a], positionOf[b])]++; });
+
+            for (uint32_t triangle = 0; triangle < alive.size(); triangle++)
+            {
+                glm::vec3 p0 = vertices[triangles[triangle * 3]].position;
+                glm::vec3 p1 = vertices[triangles[triangle * 3 + 1]].position;
+                glm::vec3 p2 = vertices[triangles[triangle * 3 + 2]].position;
+                glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+                float doubleArea = glm::length(normal);
+                if (doubleArea == 0.0f)
+                {
+                    continue;
+                }
+                normal /= doubleArea;
+
+                Quadric plane = Quadric::FromPlane(normal, -glm::dot(normal, p0), doubleArea * 0.5);
+                for (int k = 0; k < 3; k++)
+                {
+                    quadrics[positionOf[triangles[triangle * 3 + k]]] += plane;
+                }
+
+                // borders and seams are kept in place by a plane through the edge, perpendicular to the face
+                for (int k = 0; k < 3; k++)
+                {
+                    uint32_t a = triangles[triangle * 3 + k];
+                    uint32_t b = triangles[triangle * 3 + (k + 1) % 3];
+                    double weight = 0.0;
+                    if (positionEdges.Find(edgeKey(positionOf[b], positionOf[a])) == nullptr)
+                    {
+                        weight = BORDER_WEIGHT;
+                    }
+                    else if (vertexEdges.Find(edgeKey(b, a)) == nullptr)
+                    {
+                        weight = SEAM_WEIGHT;
+                    }
+                    if (weight == 0.0)
+                    {
+                        continue;
+                    }
+
+                    glm::vec3 edge = vertices[b].position - vertices[a].position;
+                    float length = glm::length(edge);
+                    if (length == 0.0f)
+                    {
+                        continue;
+                    }
+                    glm::vec3 edgeNormal = glm::normalize(glm::cross(edge, normal));
+                    Quadric edgePlane = Quadric::FromPlane(edgeNormal, -glm::dot(edgeNormal, vertices[a].position), weight * length * length);
+                    quadrics[positionOf[a]] += edgePlane;
+                    quadrics[positionOf[b]] += edgePlane;
+                }
+            }
+        }
+
+        template <typename F>
+        void forEachEdge(F &&visit) const
+        {
+            for (uint32_t triangle = 0; triangle < alive.size(); triangle++)
+            {
+                for (uint32_t k = 0; k < 3; k++)
+                {
+                    visit(triangle, k, triangles[triangle * 3 + k], triangles[triangle * 3 + (k + 1) % 3]);
+                }
+            }
+        }
+
+        void push(uint32_t from, uint32_t to)
+        {
+            uint32_t pf = positionOf[from];
+            uint32_t pt = positionOf[to];
+            if (pf == pt || kinds[pf] == KIND_LOCKED)
+            {
+                return;
+            }
+            Quadric merged = quadrics[pf];
+            merged += quadrics[pt];
+            glm::vec3 edge = points[pt] - points[pf];
+            queue.push({merged.Error(points[pt]), glm::dot(edge, edge), from, to, versions[pf], versions[pt]});
+        }
+
+        // the other vertex of a seam position
+        uint32_t otherWedge(uint32_t vertex) const
+        {
+            return nextWedge[vertex];
+        }
+
+        bool tryCollapse(uint32_t from, uint32_t to)
+        {
+            uint32_t pf = positionOf[from];
+            uint32_t pt = positionOf[to];
+
+            // half edges between the two positions, per direction and with the exact vertices
+            int forward = 0, backward = 0, forwardVertex = 0, backwardVertex = 0;
+            for (uint32_t triangle : around[pf])
+            {
+                if (!alive[triangle])
+                {
+                    continue;
+                }
+                for (int k = 0; k < 3; k++)
+                {
+                    uint32_t a = triangles[triangle * 3 + k];
+                    uint32_t b = triangles[triangle * 3 + (k + 1) % 3];
+                    forward += positionOf[a] == pf && positionOf[b] == pt;
+                    backward += positionOf[a] == pt && positionOf[b] == pf;
+                    forwardVertex += a == from && b == to;
+                    backwardVertex += a == to && b == from;
+                }
+            }
+            if (forward + backward == 0)
+            {
+                // no longer neighbours
+                return false;
+            }
+
+            uint32_t from2 = UINT32_MAX;
+            uint32_t to2 = UINT32_MAX;
+            if (kinds[pf] == KIND_BORDER)
+            {
+                // only along the border, anything else would pull the border inwards
+                if (forward + backward != 1)
+                {
+                    return false;
+                }
+            }
+            else if (kinds[pf] == KIND_SEAM)
+            {
+                // only along the seam: the exact edge is on one side of it only
+                if (forward != 1 || backward != 1 || forwardVertex + backwardVertex != 1)
+                {
+                    return false;
+                }
+                // the other side of the seam follows, onto the vertex it shares an edge with
+                from2 = otherWedge(from);
+                for (uint32_t triangle : around[pf])
+                {
+                    if (!alive[triangle])
+                    {
+                        continue;
+                    }
+                    for (int k = 0; k < 3; k++)
+                    {
+                        uint32_t a = triangles[triangle * 3 + k];
+                        uint32_t b = triangles[triangle * 3 + (k + 1) % 3];
+                        if (a == from2 && positionOf[b] == pt)
+                            to2 = b;
+                        else if (b == from2 && positionOf[a] == pt)
+                            to2 = a;
+                    }
+                }
+                if (to2 == UINT32_MAX || to2 == to)
+                {
+                    return false;
+                }
+            }
+
+            // reject collapses folding a triangle over
+            for (uint32_t triangle : around[pf])
+            {
+                if (!alive[triangle])
+                {
+                    continue;
+                }
+                const unsigned int *corners = &triangles[triangle * 3];
+                if (positionOf[corners[0]] == pt || positionOf[corners[1]] == pt || positionOf[corners[2]] == pt)
+                {
+                    continue;
+                }
+                glm::vec3 p[3];
+                glm::vec3 moved[3];
+                for (int k = 0; k < 3; k++)
+                {
+                    p[k] = points[positionOf[corners[k]]];
+                    moved[k] = positionOf[corners[k]] == pf ? points[pt] : p[k];
+                }
+                glm::vec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+                glm::vec3 after = glm::cross(moved[1] - moved[0], moved[2] - moved[0]);
+                // turning by more than ~75 degrees is as good as a flip once a few collapses add up
+                if (glm::dot(before, after) <= MIN_NORMAL_COSINE * glm::length(before) * glm::length(after))
+                {
+                    return false;
+                }
+            }
+
+            for (uint32_t triangle : around[pf])
+            {
+                if (!alive[triangle])
+                {
+                    continue;
+                }
+                unsigned int *corners = &triangles[triangle * 3];
+                for (int k = 0; k < 3; k++)
+                {
+                    if (corners[k] == from)
+                        corners[k] = to;
+                    else if (corners[k] == from2)
+                        corners[k] = to2;
+                }
+                if (positionOf[corners[0]] == positionOf[corners[1]] || positionOf[corners[1]] == positionOf[corners[2]] ||
+                    positionOf[corners[0]] == positionOf[corners[2]])
+                {
+                    alive[triangle] = 0;
+                    triangleCount--;
+                }
+                else
+                {
+                    around[pt].push_back(triangle);
+                }
+            }
+            std::erase_if(around[pt], [&](uint32_t triangle)
+                          { return !alive[triangle]; });
+            around[pf].clear();
+
+            positionAlive[pf] = 0;
+            quadrics[pt] += quadrics[pf];
+            versions[pt]++;
+
+            // the costs of every edge touching the merged position changed, each is shared by two triangles
+            updated.clear();
+            for (uint32_t triangle : around[pt])
+            {
+                for (int k = 0; k < 3; k++)
+                {
+                    uint32_t vertex = triangles[triangle * 3 + k];
+                    if (positionOf[vertex] != pt)
+                    {
+                        continue;
+                    }
+                    for (int other : {(k + 1) % 3, (k + 2) % 3})
+                    {
+                        uint64_t edge = edgeKey(vertex, triangles[triangle * 3 + other]);
+                        if (std::find(updated.begin(), updated.end(), edge) == updated.end())
+                        {
+                            updated.push_back(edge);
+                        }
+                    }
+                }
+            }
+            for (uint64_t edge : updated)
+            {
+                uint32_t vertex = static_cast<uint32_t>(edge >> 32);
+                uint32_t other = static_cast<uint32_t>(edge);
+                push(vertex, other);
+                push(other, vertex);
+            }
+            return true;
+        }
+    };
+}
+
+std::vector<unsigned int> MeshSimplifier::Simplify(const std::vector<Vertex> &vertices, const std::vector<unsigned int> &indices,
+                                                   size_t targetIndexCount, float maxError, float *error)
+{
+    if (indices.size() <= targetIndexCount || indices.size() % 3 != 0)
+    {
+        if (error)
+        {
+            *error = 0.0f;
+        }
+        return indices;
+    }
+    return Simplifier(vertices, indices).Run(targetIndexCount, maxError, error);
+}
+
+void MeshSimplifier::GenerateLods(Mesh &mesh, const Settings &settings)
+{
+    mesh.lods.clear();
+    if (mesh.indices.empty() || mesh.indices.size() % 3 != 0)
+    {
+        return;
+    }
+
+    AABB box;
+    for (const Vertex &vertex : mesh.vertices)
+    {
+        box.Expand(vertex.position);
+    }
+    float maxError = settings.maxError * glm::length(box.GetExtents());
+
+    // the levels are successive stops of a single collapse sequence, each one carries on from the previous
+    Simplifier simplifier(mesh.vertices, mesh.indices);
+    float target = static_cast<float>(mesh.indices.size());
+    size_t previous = mesh.indices.size();
+    for (uint32_t level = 0; level < settings.levels; level++)
+    {
+        target *= settings.ratio;
+        size_t targetIndexCount = static_cast<size_t>(target) / 3 * 3;
+        if (targetIndexCount < 3)
+        {
+            break;
+        }
+
+        MeshLod lod;
+        lod.indices = simplifier.Run(targetIndexCount, maxError, &lod.error);
+        if (lod.indices.empty() || lod.indices.size() > previous * (1.0f - settings.minReduction))
+        {
+            break;
+        }
+        previous = lod.indices.size();
+        mesh.lods.push_back(std::move(lod));
+    }
+}
+
+void MeshSimplifier::SetEnabled(bool on)
+{
+    enabled = on;
+}
+
+bool MeshSimplifier::IsEnabled()
+{
+    return enabled;
+}
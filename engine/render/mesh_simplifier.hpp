@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "mesh.hpp"
+
+/**
+ * Mesh simplification by edge collapse ordered by quadric error (Garland and Heckbert), run by the loaders
+ * at cook time to build the levels of detail of a mesh: it's off by default, engine-cook turns it on and the
+ * runtime gets the levels from the cooked files.
+ * Collapses move a vertex onto one of its neighbours, so every level is an index list over the vertices of
+ * the full detail mesh and they all share its vertex buffer. Attribute seams (vertices splitting the same
+ * position) are collapsed along the seam only and open borders along the border only, so UVs and normals
+ * don't tear; vertices where neither applies are locked.
+ */
+namespace MeshSimplifier
+{
+    struct Settings
+    {
+        // levels generated on top of the full detail one, fewer when the error bound is hit first
+        uint32_t levels = 4;
+        // index count of a level relative to the previous one
+        float ratio = 0.5f;
+        // largest error accepted for the coarsest level, relative to the radius of the mesh
+        float maxError = 0.05f;
+        // a level that doesn't remove at least this fraction of the previous one isn't worth keeping
+        float minReduction = 0.1f;
+    };
+
+    /**
+     * Collapses edges until at most targetIndexCount indices are left or the next collapse would move the
+     * surface by more than maxError (object space distance). error receives the error of the result.
+     */
+    std::vector<unsigned int> Simplify(const std::vector<Vertex> &vertices, const std::vector<unsigned int> &indices,
+                                       size_t targetIndexCount, float maxError, float *error = nullptr);
+
+    // replaces mesh.lods with levels simplified from mesh.indices
+    void GenerateLods(Mesh &mesh, const Settings &settings = {});
+
+    // off by default, the loaders only generate the levels when on (engine-cook)
+    void SetEnabled(bool enabled);
+    bool IsEnabled();
+};
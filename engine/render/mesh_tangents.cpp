@@ -0,0 +1,283 @@
+#include "mesh_tangents.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <cmath>
+#include <functional>
+
+#include "core/thread_pool.hpp"
+
+namespace
+{
+    // triangles or vertices handled by one task of the parallel passes
+    constexpr size_t CHUNK_SIZE = 4096;
+
+    constexpr uint8_t FLAG_ORIENT_PRESERVING = 1 << 0;
+    // no UV area: the triangle doesn't orient anything and joins any group of its vertices
+    constexpr uint8_t FLAG_DEGENERATE = 1 << 1;
+
+    constexpr uint32_t NO_GROUP = ~0u;
+
+    // task(begin, end) over [0, count), one chunk per ParallelFor item
+    void parallelChunks(size_t count, const std::function<void(size_t, size_t)> &task)
+    {
+        size_t chunks = (count + CHUNK_SIZE - 1) / CHUNK_SIZE;
+        ThreadPool::Get().ParallelFor(chunks, [&](size_t chunk)
+                                      { task(chunk * CHUNK_SIZE, std::min(count, (chunk + 1) * CHUNK_SIZE)); });
+    }
+
+    // vector without its component along the unit normal (unchanged by a null one)
+    glm::vec3 project(const glm::vec3 &vector, const glm::vec3 &normal)
+    {
+        return vector - normal * glm::dot(normal, vector);
+    }
+
+    glm::vec3 normalizeOrZero(const glm::vec3 &vector)
+    {
+        float length = glm::length(vector);
+        return length > FLT_MIN ? vector / length : glm::vec3(0.0f);
+    }
+
+    // a frame for vertices that only touch triangles without UV area, any direction in the tangent plane
+    glm::vec3 anyTangent(const glm::vec3 &normal)
+    {
+        glm::vec3 axis = std::abs(normal.x) < 0.9f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+        glm::vec3 tangent = normalizeOrZero(project(axis, normal));
+        return glm::dot(tangent, tangent) > 0.0f ? tangent : axis;
+    }
+
+    // a corner of a vertex seen from one of the two edges it has at the vertex
+    struct CornerEdge
+    {
+        unsigned int other;
+        uint8_t orientation;
+        uint32_t corner;
+
+        bool SameEdge(const CornerEdge &edge) const { return other == edge.other && orientation == edge.orientation; }
+    };
+
+    uint32_t findRoot(std::vector<uint32_t> &parents, uint32_t corner)
+    {
+        while (parents[corner] != corner)
+        {
+            parents[corner] = parents[parents[corner]];
+            corner = parents[corner];
+        }
+        return corner;
+    }
+}
+
+bool MeshTangents::Generate(Mesh &mesh)
+{
+    std::vector<Vertex> &vertices = mesh.vertices;
+    std::vector<unsigned int> &indices = mesh.indices;
+    size_t triangleCount = indices.size() / 3;
+    size_t cornerCount = triangleCount * 3;
+    size_t vertexCount = vertices.size();
+    if (triangleCount == 0)
+    {
+        return false;
+    }
+
+    // unit normals, read by every corner of their vertex
+    std::vector<glm::vec3> normals(vertexCount);
+    parallelChunks(vertexCount, [&](size_t begin, size_t end)
+                   {
+                       for (size_t vertex = begin; vertex < end; vertex++)
+                       {
+                           normals[vertex] = normalizeOrZero(vertices[vertex].normal);
+                       } });
+
+    // per triangle tangent, projected on the normal of each corner and weighted by its angle
+    std::vector<glm::vec3> cornerTangents(cornerCount);
+    std::vector<uint8_t> triangleFlags(triangleCount);
+    std::atomic<bool> oriented = false;
+    parallelChunks(triangleCount, [&](size_t begin, size_t end)
+                   {
+                       bool anyOriented = false;
+                       for (size_t triangle = begin; triangle < end; triangle++)
+                       {
+                           const unsigned int *corners = &indices[triangle * 3];
+                           const Vertex &v0 = vertices[corners[0]];
+                           const Vertex &v1 = vertices[corners[1]];
+                           const Vertex &v2 = vertices[corners[2]];
+
+                           glm::vec3 d1 = v1.position - v0.position;
+                           glm::vec3 d2 = v2.position - v0.position;
+                           glm::vec2 t21 = v1.tcoords - v0.tcoords;
+                           glm::vec2 t31 = v2.tcoords - v0.tcoords;
+                           float signedArea = t21.x * t31.y - t21.y * t31.x;
+                           glm::vec3 tangent = normalizeOrZero(t31.y * d1 - t21.y * d2) * (signedArea > 0.0f ? 1.0f : -1.0f);
+
+                           uint8_t flags = signedArea > 0.0f ? FLAG_ORIENT_PRESERVING : 0;
+                           if (!(std::abs(signedArea) > FLT_MIN) || glm::dot(tangent, tangent) == 0.0f)
+                           {
+                               flags |= FLAG_DEGENERATE;
+                               tangent = glm::vec3(0.0f);
+                           }
+                           triangleFlags[triangle] = flags;
+                           anyOriented |= (flags & FLAG_DEGENERATE) == 0;
+
+                           // edges[k] goes from corner k to corner k + 1
+                           const glm::vec3 edges[3] = {d1, v2.position - v1.position, -d2};
+                           for (size_t k = 0; k < 3; k++)
+                           {
+                               const glm::vec3 &normal = normals[corners[k]];
+                               glm::vec3 next = normalizeOrZero(project(edges[k], normal));
+                               glm::vec3 previous = normalizeOrZero(project(-edges[(k + 2) % 3], normal));
+                               float angle = std::acos(std::clamp(glm::dot(next, previous), -1.0f, 1.0f));
+                               cornerTangents[triangle * 3 + k] = normalizeOrZero(project(tangent, normal)) * angle;
+                           }
+                       }
+                       if (anyOriented)
+                       {
+                           oriented = true;
+                       } });
+    if (!oriented)
+    {
+        return false;
+    }
+
+    // corners of every vertex, vertexCorners[cornerOffsets[v], cornerOffsets[v + 1])
+    std::vector<uint32_t> cornerOffsets(vertexCount + 1, 0);
+    for (size_t corner = 0; corner < cornerCount; corner++)
+    {
+        cornerOffsets[indices[corner] + 1]++;
+    }
+    for (size_t vertex = 0; vertex < vertexCount; vertex++)
+    {
+        cornerOffsets[vertex + 1] += cornerOffsets[vertex];
+    }
+    std::vector<uint32_t> vertexCorners(cornerCount);
+    {
+        std::vector<uint32_t> filled(cornerOffsets.begin(), cornerOffsets.end() - 1);
+        for (size_t corner = 0; corner < cornerCount; corner++)
+        {
+            vertexCorners[filled[indices[corner]]++] = static_cast<uint32_t>(corner);
+        }
+    }
+
+    // groups of the corners of every vertex, a vertex has at most as many groups as corners so the frame of
+    // its group g goes to groupTangents[cornerOffsets[v] + g]
+    std::vector<uint32_t> cornerGroups(cornerCount, 0);
+    std::vector<uint32_t> groupCounts(vertexCount, 0);
+    std::vector<glm::vec3> groupTangents(cornerCount);
+    std::vector<float> groupSigns(cornerCount, 1.0f);
+    parallelChunks(vertexCount, [&](size_t begin, size_t end)
+                   {
+                       std::vector<CornerEdge> edges;
+                       std::vector<uint32_t> parents;
+                       std::vector<uint32_t> groups;
+                       for (size_t vertex = begin; vertex < end; vertex++)
+                       {
+                           uint32_t first = cornerOffsets[vertex];
+                           uint32_t count = cornerOffsets[vertex + 1] - first;
+                           if (count == 0)
+                           {
+                               continue;
+                           }
+
+                           // corners of the same orientation sharing an edge at the vertex are in the same group
+                           edges.clear();
+                           for (uint32_t local = 0; local < count; local++)
+                           {
+                               uint32_t corner = vertexCorners[first + local];
+                               size_t triangle = corner / 3;
+                               if (triangleFlags[triangle] & FLAG_DEGENERATE)
+                               {
+                                   continue;
+                               }
+                               uint8_t orientation = triangleFlags[triangle] & FLAG_ORIENT_PRESERVING;
+                               edges.push_back({indices[triangle * 3 + (corner + 1) % 3], orientation, local});
+                               edges.push_back({indices[triangle * 3 + (corner + 2) % 3], orientation, local});
+                           }
+                           std::sort(edges.begin(), edges.end(), [](const CornerEdge &a, const CornerEdge &b)
+                                     { return a.other != b.other ? a.other < b.other : a.orientation < b.orientation; });
+
+                           parents.resize(count);
+                           for (uint32_t local = 0; local < count; local++)
+                           {
+                               parents[local] = local;
+                           }
+                           for (size_t edge = 1; edge < edges.size(); edge++)
+                           {
+                               if (edges[edge].SameEdge(edges[edge - 1]))
+                               {
+                                   parents[findRoot(parents, edges[edge].corner)] = findRoot(parents, edges[edge - 1].corner);
+                               }
+                           }
+
+                           // numbered in the order of the corners, the corners without UV area go to the first group
+                           groups.assign(count, NO_GROUP);
+                           uint32_t groupCount = 0;
+                           for (uint32_t local = 0; local < count; local++)
+                           {
+                               uint32_t corner = vertexCorners[first + local];
+                               uint8_t flags = triangleFlags[corner / 3];
+                               uint32_t group = 0;
+                               if ((flags & FLAG_DEGENERATE) == 0)
+                               {
+                                   uint32_t root = findRoot(parents, local);
+                                   if (groups[root] == NO_GROUP)
+                                   {
+                                       groups[root] = groupCount++;
+                                       groupTangents[first + groups[root]] = glm::vec3(0.0f);
+                                       groupSigns[first + groups[root]] = (flags & FLAG_ORIENT_PRESERVING) ? 1.0f : -1.0f;
+                                   }
+                                   group = groups[root];
+                                   groupTangents[first + group] += cornerTangents[corner];
+                               }
+                               cornerGroups[corner] = group;
+                           }
+                           groupCount = std::max(groupCount, 1u);
+                           groupCounts[vertex] = groupCount;
+
+                           const glm::vec3 &normal = normals[vertex];
+                           for (uint32_t group = 0; group < groupCount; group++)
+                           {
+                               glm::vec3 tangent = normalizeOrZero(project(groupTangents[first + group], normal));
+                               groupTangents[first + group] = glm::dot(tangent, tangent) > 0.0f ? tangent : anyTangent(normal);
+                           }
+                       } });
+
+    // the first group of a vertex keeps it, the others get a copy at the end
+    std::vector<uint32_t> copyOffsets(vertexCount);
+    uint32_t copyCount = 0;
+    for (size_t vertex = 0; vertex < vertexCount; vertex++)
+    {
+        copyOffsets[vertex] = static_cast<uint32_t>(vertexCount) + copyCount;
+        copyCount += groupCounts[vertex] > 1 ? groupCounts[vertex] - 1 : 0;
+    }
+    auto groupVertex = [&](size_t vertex, uint32_t group) -> unsigned int
+    {
+        return group == 0 ? static_cast<unsigned int>(vertex) : copyOffsets[vertex] + group - 1;
+    };
+
+    vertices.resize(vertexCount + copyCount);
+    parallelChunks(vertexCount, [&](size_t begin, size_t end)
+                   {
+                       for (size_t vertex = begin; vertex < end; vertex++)
+                       {
+                           Vertex source = vertices[vertex];
+                           const glm::vec3 &normal = normals[vertex];
+                           for (uint32_t group = 0; group < groupCounts[vertex]; group++)
+                           {
+                               uint32_t slot = cornerOffsets[vertex] + group;
+                               Vertex &destination = vertices[groupVertex(vertex, group)];
+                               destination = source;
+                               destination.tangent = groupTangents[slot];
+                               destination.bitangent = groupSigns[slot] * glm::cross(normal, groupTangents[slot]);
+                           }
+                       } });
+    if (copyCount > 0)
+    {
+        parallelChunks(cornerCount, [&](size_t begin, size_t end)
+                       {
+                           for (size_t corner = begin; corner < end; corner++)
+                           {
+                               indices[corner] = groupVertex(indices[corner], cornerGroups[corner]);
+                           } });
+    }
+    return true;
+}
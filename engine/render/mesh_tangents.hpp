@@ -0,0 +1,25 @@
+#pragma once
+
+#include "mesh.hpp"
+
+/**
+ * Tangent frames for normal mapping, computed the way MikkTSpace (Mikkelsen 2008) does so that normal maps
+ * baked by the usual tools decode without seams. Run by the loaders at import/cook time, before the levels
+ * of detail since it may add vertices:
+ * - every triangle gives a tangent from its positions and UVs, projected onto the normal of each of its
+ *   corners and weighted by the angle at the corner,
+ * - the corners of a vertex are averaged per group of triangles connected through their edges and with the
+ *   same UV orientation, a vertex in more than one group (mirrored UVs) is split,
+ * - the bitangent is sign * cross(normal, tangent), the sign being the orientation of the group.
+ * Triangles without UV area join a group they touch. The passes over the triangles and the vertices are
+ * split across the ThreadPool.
+ */
+namespace MeshTangents
+{
+    /**
+     * Fills the tangent and bitangent of mesh.vertices and splits the vertices that need it (indices are
+     * updated, existing levels of detail keep the first copy). Returns false, leaving the mesh untouched,
+     * when no triangle has an UV area to orient a frame with.
+     */
+    bool Generate(Mesh &mesh);
+};
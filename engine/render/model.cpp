@@ -18,31 +18,137 @@ void Model::Load(const char *path)
     loadModel(path);
 }
 
+std::vector<Mesh> Model::Import(const std::string &path)
+{
+    // no aiProcess_FlipUVs: the runtime flips the UVs and the images of assimp models, cooked textures are never flipped
+    Assimp::Importer import;
+    const aiScene *scene = import.ReadFile(path, aiProcess_Triangulate);
+
+    if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode)
+    {
+        ERROR("Could not import 3D model, reason: " << import.GetErrorString());
+        return {};
+    }
+
+    std::vector<Mesh> meshes;
+    importNode(scene->mRootNode, scene, glm::mat4(1.0f), path.substr(0, path.find_last_of('/')), meshes);
+    return meshes;
+}
+
+AABB Model::GetBounds() const
+{
+    if (nodes.Size() == 0)
+    {
+        return {};
+    }
+    updateNodes();
+    return nodeBounds[0].Transformed(nodes.GetLocal(0));
+}
+
+void Model::SetNodeTransform(uint32_t node, const glm::mat4 &localTransform)
+{
+    nodes.SetLocal(node, localTransform);
+    nodeBoundsDirty = true;
+}
+
 void Model::Draw(Shader &shader, const glm::mat4 &modelTransform)
 {
-    DrawNode(rootNode, shader, modelTransform);
+    updateNodes();
+
+    // resolved once for the whole hierarchy
+    UniformHandle<glm::mat4> modelUniform = shader.GetUniform<glm::mat4>("model");
+    MaterialUniforms materialUniforms = MaterialUniforms::Resolve(shader);
+    for (uint32_t node = 0; node < nodes.Size(); node++)
+    {
+        const NodeMeshes &range = nodeMeshRanges[node];
+        if (range.count == 0)
+        {
+            continue;
+        }
+        shader.Set(modelUniform, modelTransform * nodes.GetWorld(node));
+        for (uint32_t i = range.first; i < range.first + range.count; i++)
+        {
+            meshes[nodeMeshes[i]].Draw(shader, materialUniforms);
+        }
+    }
+}
+
+void Model::Submit(RenderQueue &queue, Shader &shader, const glm::mat4 &modelTransform) const
+{
+    submitNodes(queue, shader, modelTransform, nullptr, nullptr);
 }
 
-void Model::DrawNode(Node &node, Shader &shader, const glm::mat4 &parentTransform)
+void Model::Submit(RenderQueue &queue, Shader &shader, const glm::mat4 &modelTransform, const Frustum &frustum) const
 {
-    glm::mat4 globalTransform = parentTransform * node.localTransform;
+    submitNodes(queue, shader, modelTransform, &frustum, nullptr);
+}
 
-    shader.Upload("model", globalTransform);
-    for (Mesh &mesh : node.meshes)
+void Model::Submit(RenderQueue &queue, Shader &shader, const glm::mat4 &modelTransform, const Frustum &frustum, const LodSelector &lods) const
+{
+    submitNodes(queue, shader, modelTransform, &frustum, &lods);
+}
+
+void Model::updateNodes() const
+{
+    nodes.Update();
+    if (!nodeBoundsDirty)
     {
-        mesh.Draw(shader);
+        return;
     }
 
-    for (Node &child : node.children)
+    for (uint32_t node = 0; node < nodes.Size(); node++)
+    {
+        nodeBounds[node] = {};
+        const NodeMeshes &range = nodeMeshRanges[node];
+        for (uint32_t i = range.first; i < range.first + range.count; i++)
+        {
+            nodeBounds[node].Expand(meshes[nodeMeshes[i]].GetBounds().box);
+        }
+    }
+    // children come after their parent, walking backwards completes a subtree before its parent uses it
+    for (size_t node = nodes.Size(); node-- > 1;)
     {
-        DrawNode(child, shader, globalTransform);
+        nodeBounds[nodes.GetParent(node)].Expand(nodeBounds[node].Transformed(nodes.GetLocal(node)));
+    }
+    nodeBoundsDirty = false;
+}
+
+void Model::submitNodes(RenderQueue &queue, Shader &shader, const glm::mat4 &modelTransform, const Frustum *frustum, const LodSelector *lods) const
+{
+    updateNodes();
+
+    for (uint32_t node = 0; node < nodes.Size();)
+    {
+        glm::mat4 globalTransform = modelTransform * nodes.GetWorld(node);
+        if (frustum && !frustum->Intersects(nodeBounds[node].Transformed(globalTransform)))
+        {
+            // nothing below is visible either
+            node = nodes.GetSubtreeEnd(node);
+            continue;
+        }
+
+        const NodeMeshes &range = nodeMeshRanges[node];
+        for (uint32_t i = range.first; i < range.first + range.count; i++)
+        {
+            const Mesh &mesh = meshes[nodeMeshes[i]];
+            if (frustum && range.count > 1 && !frustum->Intersects(mesh.GetBounds().box.Transformed(globalTransform)))
+            {
+                continue;
+            }
+            if (lods)
+            {
+                nodeMeshLods[i] = static_cast<uint8_t>(lods->Select(mesh, globalTransform, nodeMeshLods[i]));
+            }
+            queue.Submit(mesh, shader, globalTransform, lods ? nodeMeshLods[i] : 0);
+        }
+        node++;
     }
 }
 
 void Model::loadModel(std::string path)
 {
     Assimp::Importer import;
-    const aiScene *scene = import.ReadFile(path, aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
+    const aiScene *scene = import.ReadFile(path, aiProcess_Triangulate | aiProcess_FlipUVs);
 
     if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode)
     {
@@ -51,39 +157,61 @@ void Model::loadModel(std::string path)
     }
     directory = path.substr(0, path.find_last_of('/'));
 
-    rootNode = processNode(scene->mRootNode, scene);
+    preloadTextures(scene);
+
+    // materials then meshes are converted once each, the nodes only reference them
+    materials.clear();
+    materials.reserve(scene->mNumMaterials);
+    for (unsigned int i = 0; i < scene->mNumMaterials; i++)
+    {
+        materials.push_back(processMaterial(scene->mMaterials[i], scene));
+    }
+    meshes.clear();
+    meshes.reserve(scene->mNumMeshes);
+    for (unsigned int i = 0; i < scene->mNumMeshes; i++)
+    {
+        meshes.push_back(processMesh(scene->mMeshes[i], scene));
+    }
+
+    nodes.Clear();
+    nodeMeshRanges.clear();
+    nodeMeshes.clear();
+    processNode(scene->mRootNode, scene, TransformHierarchy::NO_PARENT);
+    nodeMeshLods.assign(nodeMeshes.size(), 0);
+    nodeBounds.assign(nodes.Size(), AABB());
+    nodeBoundsDirty = true;
 }
 
-Node Model::processNode(aiNode *node, const aiScene *scene)
+void Model::processNode(aiNode *node, const aiScene *scene, int32_t parent)
 {
-    Node newNode;
-    newNode.name = node->mName.C_Str();
-
     // convert Assimp transform to glm
     aiMatrix4x4 transformation = node->mTransformation;
-    newNode.localTransform = glm::transpose(glm::make_mat4(&transformation.a1));
+    uint32_t index = nodes.Add(glm::transpose(glm::make_mat4(&transformation.a1)), parent);
 
+    nodeMeshRanges.push_back({static_cast<uint32_t>(nodeMeshes.size()), node->mNumMeshes});
     for (unsigned int i = 0; i < node->mNumMeshes; i++)
     {
-        aiMesh *mesh = scene->mMeshes[node->mMeshes[i]];
-        meshes.push_back(processMesh(mesh, scene));
-        newNode.meshes.push_back(processMesh(mesh, scene));
-        meshes.back().name = newNode.name;
-        newNode.meshes.back().name = newNode.name;
+        unsigned int mesh = node->mMeshes[i];
+        nodeMeshes.push_back(mesh);
+        // named after the first node using it
+        if (meshes[mesh].name.empty())
+        {
+            meshes[mesh].name = node->mName.C_Str();
+        }
     }
+    // depth first, so that the subtree of a node is contiguous
     for (unsigned int i = 0; i < node->mNumChildren; i++)
     {
-        newNode.children.push_back(processNode(node->mChildren[i], scene));
+        processNode(node->mChildren[i], scene, static_cast<int32_t>(index));
     }
-
-    return newNode;
 }
 
 Mesh Model::processMesh(aiMesh *mesh, const aiScene *scene)
 {
     std::vector<Vertex> vertices;
     std::vector<unsigned int> indices;
-    std::vector<Texture> textures;
+    vertices.reserve(mesh->mNumVertices);
+    indices.reserve(mesh->mNumFaces * 3);
 
     for (unsigned int i = 0; i < mesh->mNumVertices; i++)
     {
@@ -108,20 +236,6 @@ Mesh Model::processMesh(aiMesh *mesh, const aiScene *scene)
             vec.x = mesh->mTextureCoords[0][i].x;
             vec.y = mesh->mTextureCoords[0][i].y;
             vertex.tcoords = vec;
-            if (mesh->mTangents)
-            {
-                vector.x = mesh->mTangents[i].x;
-                vector.y = mesh->mTangents[i].y;
-                vector.z = mesh->mTangents[i].z;
-                vertex.tangent = vector;
-            }
-            if (mesh->mBitangents)
-            {
-                vector.x = mesh->mBitangents[i].x;
-                vector.y = mesh->mBitangents[i].y;
-                vector.z = mesh->mBitangents[i].z;
-                vertex.bitangent = vector;
-            }
         }
         else
             vertex.tcoords = glm::vec2(0.0f, 0.0f);
@@ -134,41 +248,74 @@ Mesh Model::processMesh(aiMesh *mesh, const aiScene *scene)
         for (unsigned int j = 0; j < face.mNumIndices; j++)
             indices.push_back(face.mIndices[j]);
     }
-    aiMaterial *material = scene->mMaterials[mesh->mMaterialIndex];
 
+    // tangents, GPU friendly order and layout before the upload; no levels of detail, simplifying is a cook time step
+    Mesh temp;
+    temp.vertices = std::move(vertices);
+    temp.indices = std::move(indices);
+    temp.SetHasTangents(MeshTangents::Generate(temp));
+    if (MeshOptimizer::IsEnabled())
+    {
+        MeshOptimizer::Optimize(temp);
+    }
+    temp.SetVertexFormat(VertexFormat::Choose(temp));
+    temp.ComputeBounds();
+    temp.SetupMesh(temp.HasTangents());
+    temp.AddMaterials(materials[mesh->mMaterialIndex]);
+    return temp;
+}
+
+std::vector<Material> Model::processMaterial(aiMaterial *material, const aiScene *scene)
+{
     // I did it without modifying much because it will be removed at some point no need to spend time on this
-    std::vector<Material> materials;
+    std::vector<Material> result;
     // diffuse maps
     std::vector<Texture> diffuseMaps = loadMaterialTextures(scene, material, aiTextureType_DIFFUSE, "diffuse");
     for (auto &elem : diffuseMaps)
     {
         Material mat;
         mat.texture_diffuse = elem;
-        materials.push_back(mat);
+        result.push_back(mat);
     }
-    textures.insert(textures.end(), diffuseMaps.begin(), diffuseMaps.end());
     // specular maps
     std::vector<Texture> specularMaps = loadMaterialTextures(scene, material, aiTextureType_SPECULAR, "specular");
     for (auto &elem : specularMaps)
     {
         Material mat;
         mat.texture_specular = elem;
-        materials.push_back(mat);
+        result.push_back(mat);
     }
-    textures.insert(textures.end(), specularMaps.begin(), specularMaps.end());
     // normal maps
     std::vector<Texture> normalMaps = loadMaterialTextures(scene, material, aiTextureType_HEIGHT, "normal");
     for (auto &elem : normalMaps)
     {
         Material mat;
         mat.texture_normal = elem;
-        materials.push_back(mat);
+        result.push_back(mat);
     }
-    textures.insert(textures.end(), normalMaps.begin(), normalMaps.end());
+    return result;
+}
 
-    Mesh temp(vertices, indices, true);
-    temp.AddMaterials(materials);
-    return temp;
+void Model::preloadTextures(const aiScene *scene)
+{
+    // decode every texture file of the scene in parallel up front, processMesh then only hits the cache
+    std::vector<std::string> paths;
+    for (unsigned int i = 0; i < scene->mNumMaterials; i++)
+    {
+        for (aiTextureType type : {aiTextureType_DIFFUSE, aiTextureType_SPECULAR, aiTextureType_HEIGHT})
+        {
+            for (unsigned int j = 0; j < scene->mMaterials[i]->GetTextureCount(type); j++)
+            {
+                aiString str;
+                scene->mMaterials[i]->GetTexture(type, j, &str);
+                if (str.C_Str()[0] != '*')
+                {
+                    paths.push_back(directory + '/' + str.C_Str());
+                }
+            }
+        }
+    }
+    TextureCache::Get().Load(paths, TextureCache::FLIP_VERTICALLY);
 }
 
 std::vector<Texture> Model::loadMaterialTextures(const aiScene *scene, aiMaterial *mat, aiTextureType type, std::string typeName)
@@ -178,88 +325,55 @@ std::vector<Texture> Model::loadMaterialTextures(const aiScene *scene, aiMateria
     {
         aiString str;
         mat->GetTexture(type, i, &str);
-        bool skip = false;
-        for (unsigned int j = 0; j < textures_loaded.size(); j++)
+
+        std::optional<unsigned int> textureID;
+        if (str.C_Str()[0] != '*')
         {
-            if (std::strcmp(textures_loaded[j].path.data(), str.C_Str()) == 0)
+            std::optional<Texture> cached = TextureCache::Get().Load(directory + '/' + str.C_Str(), TextureCache::FLIP_VERTICALLY);
+            if (cached)
             {
-                textures.push_back(textures_loaded[j]);
-                skip = true;
-                break;
+                textureID = cached->id;
             }
         }
-        // don't load already loaded texture
-        if (!skip)
+        else
         {
-            std::optional<unsigned int> textureID = str.C_Str()[0] != '*' ? TextureFromFile(str.C_Str(), this->directory, scene) : TextureFromEmbedded(str.C_Str(), this->directory, scene);
-            if (textureID)
+            auto embedded = embedded_textures.find(str.C_Str());
+            if (embedded != embedded_textures.end())
             {
-                Texture texture;
-                texture.id = *textureID;
-                if (typeName == "diffuse")
-                {
-                    texture.type = TextureType::DIFFUSE;
-                }
-                if (typeName == "specular")
-                {
-                    texture.type = TextureType::SPECULAR;
-                }
-                if (typeName == "normal")
+                textureID = embedded->second.Get();
+            }
+            else
+            {
+                textureID = TextureFromEmbedded(str.C_Str(), this->directory, scene);
+                if (textureID)
                 {
-                    texture.type = TextureType::NORMAL;
+                    embedded_textures.emplace(str.C_Str(), GLTexture(*textureID));
                 }
-                // texture.type = typeName;
-                texture.path = str.C_Str();
-                textures.push_back(texture);
-                textures_loaded.push_back(texture);
             }
         }
-    }
-    return textures;
-}
-
-std::optional<unsigned int> Model::TextureFromFile(const char *path, const std::string &directory, const aiScene *scene, bool gamma)
-{
-    std::string filename = std::string(path);
-    filename = directory + '/' + filename;
-
-    unsigned int textureID;
-    glGenTextures(1, &textureID);
-
-    stbi_set_flip_vertically_on_load(true);
 
-    int width, height, nrComponents;
-    unsigned char *data = stbi_load(filename.c_str(), &width, &height, &nrComponents, 0);
-    if (data)
-    {
-        GLenum format;
-        if (nrComponents == 1)
-            format = GL_RED;
-        else if (nrComponents == 3)
-            format = GL_RGB;
-        else if (nrComponents == 4)
-            format = GL_RGBA;
-
-        glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-        glBindTexture(GL_TEXTURE_2D, 0);
-        stbi_image_free(data);
-    }
-    else
-    {
-        ERROR("Failed to load texture, param: " << filename);
-        stbi_image_free(data);
-        return {};
+        if (textureID)
+        {
+            Texture texture;
+            texture.id = *textureID;
+            if (typeName == "diffuse")
+            {
+                texture.type = TextureType::DIFFUSE;
+            }
+            if (typeName == "specular")
+            {
+                texture.type = TextureType::SPECULAR;
+            }
+            if (typeName == "normal")
+            {
+                texture.type = TextureType::NORMAL;
+            }
+            // texture.type = typeName;
+            texture.path = str.C_Str();
+            textures.push_back(texture);
+        }
     }
-
-    return textureID;
+    return textures;
 }
 
 std::optional<unsigned int> Model::TextureFromEmbedded(const char *path, const std::string &directory, const aiScene *scene, bool gamma)
@@ -271,7 +385,7 @@ std::optional<unsigned int> Model::TextureFromEmbedded(const char *path, const s
         aiTexture *texture = scene->mTextures[texIndex];
         unsigned int textureID;
         glGenTextures(1, &textureID);
-        glBindTexture(GL_TEXTURE_2D, textureID);
+        GLStateCache::Get().BindTexture(0, GL_TEXTURE_2D, textureID);
 
         if (texture->mHeight == 0)
         {
@@ -309,9 +423,98 @@ std::optional<unsigned int> Model::TextureFromEmbedded(const char *path, const s
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
-        glBindTexture(GL_TEXTURE_2D, 0);
+        GLStateCache::Get().BindTexture(0, GL_TEXTURE_2D, 0);
         return textureID;
     }
 
     return {};
 }
+
+void Model::importNode(aiNode *node, const aiScene *scene, const glm::mat4 &parentTransform, const std::string &directory, std::vector<Mesh> &meshes)
+{
+    aiMatrix4x4 transformation = node->mTransformation;
+    glm::mat4 globalTransform = parentTransform * glm::transpose(glm::make_mat4(&transformation.a1));
+
+    for (unsigned int i = 0; i < node->mNumMeshes; i++)
+    {
+        meshes.push_back(importMesh(scene->mMeshes[node->mMeshes[i]], scene, globalTransform, directory));
+        meshes.back().name = node->mName.C_Str();
+    }
+    for (unsigned int i = 0; i < node->mNumChildren; i++)
+    {
+        importNode(node->mChildren[i], scene, globalTransform, directory, meshes);
+    }
+}
+
+Mesh Model::importMesh(aiMesh *mesh, const aiScene *scene, const glm::mat4 &transform, const std::string &directory)
+{
+    glm::mat3 normalTransform = glm::transpose(glm::inverse(glm::mat3(transform)));
+
+    Mesh result;
+    result.vertices.resize(mesh->mNumVertices);
+    for (unsigned int i = 0; i < mesh->mNumVertices; i++)
+    {
+        Vertex &vertex = result.vertices[i];
+        vertex.position = glm::vec3(transform * glm::vec4(mesh->mVertices[i].x, mesh->mVertices[i].y, mesh->mVertices[i].z, 1.0f));
+        if (mesh->HasNormals())
+        {
+            vertex.normal = glm::normalize(normalTransform * glm::vec3(mesh->mNormals[i].x, mesh->mNormals[i].y, mesh->mNormals[i].z));
+        }
+        if (mesh->mTextureCoords[0])
+        {
+            vertex.tcoords = glm::vec2(mesh->mTextureCoords[0][i].x, mesh->mTextureCoords[0][i].y);
+        }
+    }
+    for (unsigned int i = 0; i < mesh->mNumFaces; i++)
+    {
+        const aiFace &face = mesh->mFaces[i];
+        result.indices.insert(result.indices.end(), face.mIndices, face.mIndices + face.mNumIndices);
+    }
+
+    // same layout as processMesh: one material per texture
+    aiMaterial *material = scene->mMaterials[mesh->mMaterialIndex];
+    const std::pair<aiTextureType, TextureType> types[] = {
+        {aiTextureType_DIFFUSE, TextureType::DIFFUSE},
+        {aiTextureType_SPECULAR, TextureType::SPECULAR},
+        {aiTextureType_HEIGHT, TextureType::NORMAL},
+    };
+    for (const auto &[aiType, type] : types)
+    {
+        for (unsigned int i = 0; i < material->GetTextureCount(aiType); i++)
+        {
+            aiString str;
+            material->GetTexture(aiType, i, &str);
+            if (str.C_Str()[0] == '*')
+            {
+                WARNING("Embedded texture skipped: " << str.C_Str());
+                continue;
+            }
+
+            Texture texture;
+            texture.type = type;
+            texture.path = directory + '/' + str.C_Str();
+
+            Material imported;
+            if (type == TextureType::DIFFUSE)
+                imported.texture_diffuse = texture;
+            else if (type == TextureType::SPECULAR)
+                imported.texture_specular = texture;
+            else
+                imported.texture_normal = texture;
+            result.AddMaterial(imported);
+        }
+    }
+
+    // on the transformed vertices, the frames follow the transform
+    result.SetHasTangents(MeshTangents::Generate(result));
+    if (MeshSimplifier::IsEnabled())
+    {
+        MeshSimplifier::GenerateLods(result);
+    }
+    if (MeshOptimizer::IsEnabled())
+    {
+        MeshOptimizer::Optimize(result);
+    }
+    result.SetVertexFormat(VertexFormat::Choose(result));
+    return result;
+}
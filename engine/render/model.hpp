@@ -4,6 +4,7 @@
 #include <string>
 #include <vector>
 #include <optional>
+#include <unordered_map>
 
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
@@ -13,16 +14,17 @@
 
 #include "shader.hpp"
 #include "mesh.hpp"
+#include "mesh_optimizer.hpp"
+#include "mesh_simplifier.hpp"
+#include "mesh_tangents.hpp"
+#include "bounds.hpp"
+#include "frustum.hpp"
+#include "lod_selector.hpp"
+#include "transform_hierarchy.hpp"
+#include "render_queue.hpp"
+#include "resources/texture_cache.hpp"
 #include "helpers/log.hpp"
 
-struct Node
-{
-    std::string name;
-    glm::mat4 localTransform;
-    std::vector<Mesh> meshes;
-    std::vector<Node> children;
-};
-
 class Model
 {
 public:
@@ -30,24 +32,70 @@ public:
     Model(const char *path);
     ~Model();
 
+    Model(Model &&) = default;
+    Model &operator=(Model &&) = default;
+
     const std::vector<Mesh> &GetMeshes() { return meshes; }
     const Mesh &GetMesh() { return meshes[0]; }
+    // in the space the model transform is applied to
+    AABB GetBounds() const;
+
+    // nodes are numbered depth first from the root (0)
+    size_t GetNodeCount() const { return nodes.Size(); }
+    const glm::mat4 &GetNodeTransform(uint32_t node) const { return nodes.GetLocal(node); }
+    // the world matrices of the node's subtree are recomputed by the next draw
+    void SetNodeTransform(uint32_t node, const glm::mat4 &localTransform);
 
     void Load(const char *path);
+
+    /**
+     * CPU only import used by the asset cooker: the node hierarchy is flattened into the meshes,
+     * textures are only referenced by path (embedded ones are skipped) and nothing is uploaded.
+     */
+    static std::vector<Mesh> Import(const std::string &path);
     void Draw(Shader &shader, const glm::mat4 &modelTransform);
-    void DrawNode(Node &node, Shader &shader, const glm::mat4 &parentTransform);
+    // queues every mesh of the hierarchy instead of drawing it right away, the model must outlive the flush
+    void Submit(RenderQueue &queue, Shader &shader, const glm::mat4 &modelTransform) const;
+    // same, skipping the meshes and whole subtrees outside of the frustum
+    void Submit(RenderQueue &queue, Shader &shader, const glm::mat4 &modelTransform, const Frustum &frustum) const;
+    // same, drawing each mesh at the level of detail picked by lods
+    void Submit(RenderQueue &queue, Shader &shader, const glm::mat4 &modelTransform, const Frustum &frustum, const LodSelector &lods) const;
 
 private:
     // model data
-    std::vector<Texture> textures_loaded;
     std::vector<Mesh> meshes;
+    // per scene material, shared by every mesh using it
+    std::vector<std::vector<Material>> materials;
+    // embedded textures ("*N") aren't files, they can't go through the TextureCache
+    std::unordered_map<std::string, GLTexture> embedded_textures;
     std::string directory;
-    Node rootNode;
 
+    struct NodeMeshes
+    {
+        uint32_t first = 0;
+        uint32_t count = 0;
+    };
+    // node hierarchy flattened depth first, world matrices are a cache updated lazily by the draws
+    mutable TransformHierarchy nodes;
+    // per node: its range in nodeMeshes (indices into meshes, a mesh used by several nodes is only stored once)
+    std::vector<NodeMeshes> nodeMeshRanges;
+    std::vector<unsigned int> nodeMeshes;
+    // level of detail last submitted for each entry of nodeMeshes, for the hysteresis of LodSelector
+    mutable std::vector<uint8_t> nodeMeshLods;
+    // per node: encloses the meshes of the node and of its subtree, in the space of the node
+    mutable std::vector<AABB> nodeBounds;
+    mutable bool nodeBoundsDirty = false;
+
+    void updateNodes() const;
+    void submitNodes(RenderQueue &queue, Shader &shader, const glm::mat4 &modelTransform, const Frustum *frustum, const LodSelector *lods) const;
     void loadModel(std::string path);
-    Node processNode(aiNode *node, const aiScene *scene);
+    void processNode(aiNode *node, const aiScene *scene, int32_t parent);
     Mesh processMesh(aiMesh *mesh, const aiScene *scene);
+    std::vector<Material> processMaterial(aiMaterial *material, const aiScene *scene);
+    void preloadTextures(const aiScene *scene);
     std::vector<Texture> loadMaterialTextures(const aiScene *scene, aiMaterial *mat, aiTextureType type, std::string typeName);
-    std::optional<unsigned int> TextureFromFile(const char *path, const std::string &directory, const aiScene *scene, bool gamma = false);
     std::optional<unsigned int> TextureFromEmbedded(const char *path, const std::string &directory, const aiScene *scene, bool gamma = false);
+
+    static void importNode(aiNode *node, const aiScene *scene, const glm::mat4 &parentTransform, const std::string &directory, std::vector<Mesh> &meshes);
+    static Mesh importMesh(aiMesh *mesh, const aiScene *scene, const glm::mat4 &transform, const std::string &directory);
 };
\ No newline at end of file
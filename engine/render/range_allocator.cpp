@@ -0,0 +1,81 @@
+#include "range_allocator.hpp"
+
+#include <algorithm>
+
+RangeAllocator::RangeAllocator(size_t iCapacity)
+{
+    Grow(iCapacity);
+}
+
+std::optional<size_t> RangeAllocator::Allocate(size_t iSize)
+{
+    if (iSize == 0)
+    {
+        return std::nullopt;
+    }
+
+    for (size_t i = 0; i < m_free.size(); i++)
+    {
+        Range &aRange = m_free[i];
+        if (aRange.size < iSize)
+        {
+            continue;
+        }
+
+        size_t aOffset = aRange.offset;
+        aRange.offset += iSize;
+        aRange.size -= iSize;
+        if (aRange.size == 0)
+        {
+            m_free.erase(m_free.begin() + i);
+        }
+        m_used += iSize;
+        return aOffset;
+    }
+    return std::nullopt;
+}
+
+void RangeAllocator::Free(size_t iOffset, size_t iSize)
+{
+    if (iSize == 0)
+    {
+        return;
+    }
+    m_used -= iSize;
+
+    auto aNext = std::lower_bound(m_free.begin(), m_free.end(), iOffset, [](const Range &iRange, size_t iValue)
+                                  { return iRange.offset < iValue; });
+    aNext = m_free.insert(aNext, Range{iOffset, iSize});
+
+    // merge with the following range, then with the previous one
+    auto aFollowing = aNext + 1;
+    if (aFollowing != m_free.end() && aNext->offset + aNext->size == aFollowing->offset)
+    {
+        aNext->size += aFollowing->size;
+        m_free.erase(aFollowing);
+    }
+    if (aNext != m_free.begin())
+    {
+        auto aPrevious = aNext - 1;
+        if (aPrevious->offset + aPrevious->size == aNext->offset)
+        {
+            aPrevious->size += aNext->size;
+            m_free.erase(aNext);
+        }
+    }
+}
+
+void RangeAllocator::Grow(size_t iCapacity)
+{
+    if (iCapacity <= m_capacity)
+    {
+        return;
+    }
+
+    size_t aAdded = iCapacity - m_capacity;
+    size_t aOffset = m_capacity;
+    m_capacity = iCapacity;
+    // Free merges the new space with a free range ending at the old capacity
+    m_used += aAdded;
+    Free(aOffset, aAdded);
+}
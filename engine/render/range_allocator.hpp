@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <optional>
+#include <vector>
+
+/**
+ * First fit allocator of [offset, offset + size) ranges inside a linear space (elements of a GL buffer).
+ * It only does the bookkeeping, the owner stores the data and grows the space with Grow.
+ */
+class RangeAllocator
+{
+public:
+    RangeAllocator() = default;
+    explicit RangeAllocator(size_t iCapacity);
+
+    // offset of a free range of iSize elements, nothing if the space is full (call Grow and retry)
+    std::optional<size_t> Allocate(size_t iSize);
+    // gives back a range returned by Allocate, merged with its free neighbours
+    void Free(size_t iOffset, size_t iSize);
+    // appends [capacity, iCapacity) to the free space
+    void Grow(size_t iCapacity);
+
+    size_t GetCapacity() const { return m_capacity; }
+    size_t GetUsed() const { return m_used; }
+
+private:
+    struct Range
+    {
+        size_t offset;
+        size_t size;
+    };
+
+    // free ranges sorted by offset, never adjacent
+    std::vector<Range> m_free;
+    size_t m_capacity = 0;
+    size_t m_used = 0;
+};
@@ -0,0 +1,114 @@
+#include "render_queue.hpp"
+
+#include <algorithm>
+
+void RenderQueue::Submit(const Mesh &iMesh, Shader &iShader, const glm::mat4 &iTransform, uint32_t iLod)
+{
+    DrawPacket aPacket;
+    aPacket.mesh = &iMesh;
+    aPacket.shader = &iShader;
+    aPacket.transform = iTransform;
+    aPacket.lod = iLod;
+    aPacket.materialKey = iMesh.GetMaterialKey();
+    aPacket.key = MakeKey(iShader.GetId(), aPacket.materialKey, iMesh.GetVertexArray());
+    m_packets.push_back(aPacket);
+}
+
+void RenderQueue::Submit(const InstanceBatch &iInstances, Shader &iShader)
+{
+    if (iInstances.GetMesh() == nullptr || iInstances.Size() == 0)
+    {
+        return;
+    }
+
+    DrawPacket aPacket;
+    aPacket.mesh = iInstances.GetMesh();
+    aPacket.instances = &iInstances;
+    aPacket.shader = &iShader;
+    aPacket.materialKey = aPacket.mesh->GetMaterialKey();
+    aPacket.key = MakeKey(iShader.GetId(), aPacket.materialKey, iInstances.GetVertexArray());
+    m_packets.push_back(aPacket);
+}
+
+void RenderQueue::Flush()
+{
+    m_stats = {};
+
+    m_order.clear();
+    m_order.reserve(m_packets.size());
+    for (size_t i = 0; i < m_packets.size(); i++)
+    {
+        m_order.emplace_back(m_packets[i].key, static_cast<uint32_t>(i));
+    }
+    // the index breaks ties, keeping the submission order between equal keys
+    std::sort(m_order.begin(), m_order.end());
+
+    const Shader *aShader = nullptr;
+    const ShaderUniforms *aUniforms = nullptr;
+    // keys are folded to fit the sort key, compare the full ones before skipping a bind
+    uint64_t aMaterialKey = 0;
+    bool aHasMaterial = false;
+
+    for (const auto &[aKey, aIndex] : m_order)
+    {
+        const DrawPacket &aPacket = m_packets[aIndex];
+
+        if (aPacket.shader != aShader)
+        {
+            aShader = aPacket.shader;
+            aUniforms = &getUniforms(*aShader);
+            aShader->Use();
+            aHasMaterial = false;
+            m_stats.programChanges++;
+        }
+
+        if (!aHasMaterial || aPacket.materialKey != aMaterialKey)
+        {
+            aPacket.mesh->BindMaterials(*aPacket.shader, aUniforms->materials);
+            aMaterialKey = aPacket.materialKey;
+            aHasMaterial = true;
+            m_stats.materialChanges++;
+        }
+
+        if (aPacket.instances != nullptr)
+        {
+            aPacket.instances->DrawElements();
+            m_stats.instances += aPacket.instances->Size();
+        }
+        else
+        {
+            aPacket.shader->Set(aUniforms->model, aPacket.transform);
+            aPacket.mesh->DrawElements(aPacket.lod);
+            m_stats.instances++;
+        }
+        m_stats.draws++;
+    }
+
+    Clear();
+}
+
+void RenderQueue::Clear()
+{
+    m_packets.clear();
+    m_order.clear();
+}
+
+uint64_t RenderQueue::MakeKey(GLuint iProgram, uint64_t iMaterialKey, GLuint iVertexArray)
+{
+    uint64_t aProgram = iProgram & 0xFFFFu;
+    // xor-fold the 64 bit material key down to 24 bits
+    uint64_t aMaterial = (iMaterialKey ^ (iMaterialKey >> 24) ^ (iMaterialKey >> 48)) & 0xFFFFFFu;
+    uint64_t aVertexArray = iVertexArray & 0xFFFFFFu;
+    return (aProgram << 48) | (aMaterial << 24) | aVertexArray;
+}
+
+const RenderQueue::ShaderUniforms &RenderQueue::getUniforms(const Shader &iShader)
+{
+    auto [aUniforms, aInserted] = m_uniforms.TryEmplace(iShader.GetId());
+    if (aInserted)
+    {
+        aUniforms->model = iShader.GetUniform<glm::mat4>("model");
+        aUniforms->materials = MaterialUniforms::Resolve(iShader);
+    }
+    return *aUniforms;
+}
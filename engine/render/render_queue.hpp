@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "instance_batch.hpp"
+#include "mesh.hpp"
+#include "shader.hpp"
+#include "uniform.hpp"
+#include "helpers/flat_hash_map.hpp"
+
+// one draw submitted to a RenderQueue
+struct DrawPacket
+{
+    const Mesh *mesh = nullptr;
+    // set for instanced draws, the transforms come from the batch
+    const InstanceBatch *instances = nullptr;
+    Shader *shader = nullptr;
+    glm::mat4 transform = glm::mat4(1.0f);
+    uint64_t materialKey = 0;
+    uint64_t key = 0;
+    // level of detail of the mesh, see LodSelector
+    uint32_t lod = 0;
+};
+
+/**
+ * Collects the draws of a frame and issues them sorted by a 64 bit key (program, then materials, then vertex
+ * array) so that consecutive draws share as much state as possible. Materials are only rebound when they
+ * differ from the previous draw and every bind goes through GLStateCache.
+ *
+ * Uniform handles are resolved once per program: the shaders must outlive the queue.
+ */
+class RenderQueue
+{
+public:
+    struct Stats
+    {
+        size_t draws = 0;
+        size_t instances = 0;
+        size_t programChanges = 0;
+        size_t materialChanges = 0;
+    };
+
+    // iMesh and iShader must stay alive until the next Flush
+    void Submit(const Mesh &iMesh, Shader &iShader, const glm::mat4 &iTransform, uint32_t iLod = 0);
+    // one instanced draw for the whole batch, iShader has to be an INSTANCED variant
+    void Submit(const InstanceBatch &iInstances, Shader &iShader);
+
+    // draws everything submitted since the last flush and empties the queue
+    void Flush();
+    void Clear();
+
+    size_t Size() const { return m_packets.size(); }
+    // counters of the last flush
+    const Stats &GetStats() const { return m_stats; }
+
+    // bits: 63..48 program, 47..24 materials, 23..0 vertex array
+    static uint64_t MakeKey(GLuint iProgram, uint64_t iMaterialKey, GLuint iVertexArray);
+
+private:
+    struct ShaderUniforms
+    {
+        UniformHandle<glm::mat4> model;
+        MaterialUniforms materials;
+    };
+
+    const ShaderUniforms &getUniforms(const Shader &iShader);
+
+    std::vector<DrawPacket> m_packets;
+    // (key, packet index), sorted instead of the packets themselves
+    std::vector<std::pair<uint64_t, uint32_t>> m_order;
+    FlatHashMap<GLuint, ShaderUniforms> m_uniforms;
+    Stats m_stats;
+};
@@ -1,25 +1,65 @@
 #include "shader.hpp"
 
-Shader::Shader(const std::string &iVertexFilePath, const std::string &iFragmentFilePath)
+#include <algorithm>
+
+Shader::Shader(const std::string &iVertexFilePath, const std::string &iFragmentFilePath, const std::vector<std::string> &iDefines)
 {
-    GLuint aVertexShader = compile(ShaderType::Vertex, tools::LoadFile(iVertexFilePath));
-    GLuint aFragmentShader = compile(ShaderType::Fragment, tools::LoadFile(iFragmentFilePath));
+    GLuint aVertexShader = compile(ShaderType::Vertex, injectDefines(tools::LoadFile(iVertexFilePath), iDefines));
+    GLuint aFragmentShader = compile(ShaderType::Fragment, injectDefines(tools::LoadFile(iFragmentFilePath), iDefines));
     if (aVertexShader == -1 || aFragmentShader == -1)
     {
         return;
     }
 
-    createProgramShader(aVertexShader, aFragmentShader);
+    createProgramShader({aVertexShader, aFragmentShader});
+}
+
+Shader::Shader(const std::string &iComputeFilePath, const std::vector<std::string> &iDefines)
+{
+    GLuint aComputeShader = compile(ShaderType::Compute, injectDefines(tools::LoadFile(iComputeFilePath), iDefines));
+    if (aComputeShader == -1)
+    {
+        return;
+    }
+
+    createProgramShader({aComputeShader});
 }
 
 Shader::~Shader()
 {
-    glDeleteProgram(m_id);
 }
 
 void Shader::Use() const
 {
-    glUseProgram(m_id);
+    GLStateCache::Get().UseProgram(m_program.Get());
+}
+
+std::string Shader::injectDefines(const std::string &iSource, const std::vector<std::string> &iDefines)
+{
+    if (iDefines.empty() || iSource.empty())
+    {
+        return iSource;
+    }
+
+    std::string aDefines;
+    for (const std::string &aDefine : iDefines)
+    {
+        aDefines += "#define " + aDefine + "\n";
+    }
+
+    // #version has to stay the first statement
+    size_t aVersion = iSource.find("#version");
+    if (aVersion == std::string::npos)
+    {
+        return aDefines + iSource;
+    }
+    size_t aLineEnd = iSource.find('\n', aVersion);
+    if (aLineEnd == std::string::npos)
+    {
+        return iSource + "\n" + aDefines;
+    }
+    // keeps the line numbers of compile errors matching the file
+    return iSource.substr(0, aLineEnd + 1) + aDefines + "#line 2\n" + iSource.substr(aLineEnd + 1);
 }
 
 GLuint Shader::compile(ShaderType iType, const std::string &iShaderData)
@@ -31,26 +71,97 @@ GLuint Shader::compile(ShaderType iType, const std::string &iShaderData)
     }
 
     const char *aData = iShaderData.data();
-    unsigned int aShader = glCreateShader(ShaderType::Fragment == iType ? GL_FRAGMENT_SHADER : GL_VERTEX_SHADER);
+    GLenum aStage = iType == ShaderType::Fragment ? GL_FRAGMENT_SHADER : iType == ShaderType::Compute ? GL_COMPUTE_SHADER : GL_VERTEX_SHADER;
+    unsigned int aShader = glCreateShader(aStage);
     glShaderSource(aShader, 1, &aData, NULL);
     glCompileShader(aShader);
 
     return checkError(iType, aShader) ? aShader : -1;
 }
 
-void Shader::createProgramShader(GLuint iVertexShader, GLuint iFragmentShader)
+void Shader::createProgramShader(std::initializer_list<GLuint> iShaders)
 {
-    m_id = glCreateProgram();
+    m_program = GLProgram::Create();
 
-    glAttachShader(m_id, iVertexShader);
-    glAttachShader(m_id, iFragmentShader);
-    glLinkProgram(m_id);
+    for (GLuint aShader : iShaders)
+    {
+        glAttachShader(m_program.Get(), aShader);
+    }
+    glLinkProgram(m_program.Get());
+
+    if (checkError(ShaderType::Program, m_program.Get()))
+    {
+        for (GLuint aShader : iShaders)
+        {
+            glDeleteShader(aShader);
+        }
+        reflectUniforms();
+
+        // engine wide blocks (see uniform_blocks.hpp), unused ones are simply not declared
+        for (const UniformBlockBinding &aBlock : UNIFORM_BLOCKS)
+        {
+            BindUniformBlock(aBlock.name, static_cast<GLuint>(aBlock.binding));
+        }
+    }
+}
 
-    if (checkError(ShaderType::Program, m_id))
+bool Shader::BindUniformBlock(const std::string &iName, GLuint iBinding)
+{
+    GLuint aIndex = glGetUniformBlockIndex(m_program.Get(), iName.c_str());
+    if (aIndex == GL_INVALID_INDEX)
     {
-        glDeleteShader(iVertexShader);
-        glDeleteShader(iFragmentShader);
+        return false;
     }
+    glUniformBlockBinding(m_program.Get(), aIndex, iBinding);
+    return true;
+}
+
+void Shader::reflectUniforms()
+{
+    GLint aCount = 0;
+    GLint aMaxLength = 0;
+    glGetProgramiv(m_program.Get(), GL_ACTIVE_UNIFORMS, &aCount);
+    glGetProgramiv(m_program.Get(), GL_ACTIVE_UNIFORM_MAX_LENGTH, &aMaxLength);
+
+    std::string aName(std::max(aMaxLength, 1), '\0');
+    m_uniforms.Clear();
+    m_uniforms.Reserve(aCount);
+    for (GLint i = 0; i < aCount; i++)
+    {
+        GLsizei aLength = 0;
+        UniformInfo aInfo;
+        glGetActiveUniform(m_program.Get(), i, static_cast<GLsizei>(aName.size()), &aLength, &aInfo.size, &aInfo.type, aName.data());
+
+        std::string aUniform = aName.substr(0, aLength);
+        aInfo.location = glGetUniformLocation(m_program.Get(), aUniform.c_str());
+        if (aInfo.location < 0)
+        {
+            // members of uniform blocks have no location
+            continue;
+        }
+
+        // arrays are reported as "name[0]", both spellings refer to the first element
+        bool aIsArray = aUniform.size() > 3 && aUniform.compare(aUniform.size() - 3, 3, "[0]") == 0;
+        if (!aIsArray)
+        {
+            m_uniforms[aUniform] = aInfo;
+            continue;
+        }
+
+        std::string aBase = aUniform.substr(0, aUniform.size() - 3);
+        m_uniforms[aBase] = aInfo;
+        for (GLint aElement = 0; aElement < aInfo.size; aElement++)
+        {
+            std::string aElementName = aBase + "[" + std::to_string(aElement) + "]";
+            UniformInfo aElementInfo = {glGetUniformLocation(m_program.Get(), aElementName.c_str()), aInfo.type, 1};
+            m_uniforms[aElementName] = aElementInfo;
+        }
+    }
+}
+
+const UniformInfo *Shader::FindUniform(const std::string &iName) const
+{
+    return m_uniforms.Find(iName);
 }
 
 bool Shader::checkError(ShaderType iType, GLuint iShader)
@@ -58,7 +169,7 @@ bool Shader::checkError(ShaderType iType, GLuint iShader)
     int aStatus;
     char aInfoLog[512];
 
-    if (iType == ShaderType::Vertex || iType == ShaderType::Fragment)
+    if (iType != ShaderType::Program)
     {
         glGetShaderiv(iShader, GL_COMPILE_STATUS, &aStatus);
     }
@@ -77,10 +188,15 @@ bool Shader::checkError(ShaderType iType, GLuint iShader)
         glGetShaderInfoLog(iShader, 512, NULL, aInfoLog);
         ERROR("Fragment shader not compiled, reason: " << aInfoLog);
     }
+    else if (!aStatus && iType == ShaderType::Compute)
+    {
+        glGetShaderInfoLog(iShader, 512, NULL, aInfoLog);
+        ERROR("Compute shader not compiled, reason: " << aInfoLog);
+    }
     else if (!aStatus && iType == ShaderType::Program)
     {
         glGetProgramInfoLog(iShader, 512, NULL, aInfoLog);
-        ERROR("Vertex and Fragment shaders not linked, reason: " << aInfoLog);
+        ERROR("Shaders not linked, reason: " << aInfoLog);
     }
 
     return aStatus;
@@ -88,42 +204,35 @@ bool Shader::checkError(ShaderType iType, GLuint iShader)
 
 void Shader::UploadUniformBool(const std::string &iName, const glm::uint &iValue)
 {
-    glUseProgram(m_id);
-    glUniform1i(glGetUniformLocation(m_id, iName.c_str()), iValue);
+    Set(GetUniform<glm::uint>(iName), iValue);
 }
 
 void Shader::UploadUniformInt(const std::string &iName, const glm::uint &iValue)
 {
-    glUseProgram(m_id);
-    glUniform1i(glGetUniformLocation(m_id, iName.c_str()), iValue);
+    Set(GetUniform<glm::uint>(iName), iValue);
 }
 
 void Shader::UploadUniformFloat1(const std::string &iName, const float &iVector)
 {
-    glUseProgram(m_id);
-    glUniform1f(glGetUniformLocation(m_id, iName.c_str()), iVector);
+    Set(GetUniform<float>(iName), iVector);
 }
 
 void Shader::UploadUniformFloat2(const std::string &iName, const glm::vec2 &iVector)
 {
-    glUseProgram(m_id);
-    glUniform2f(glGetUniformLocation(m_id, iName.c_str()), iVector[0], iVector[1]);
+    Set(GetUniform<glm::vec2>(iName), iVector);
 }
 
 void Shader::UploadUniformFloat3(const std::string &iName, const glm::vec3 &iVector)
 {
-    glUseProgram(m_id);
-    glUniform3f(glGetUniformLocation(m_id, iName.c_str()), iVector[0], iVector[1], iVector[2]);
+    Set(GetUniform<glm::vec3>(iName), iVector);
 }
 
 void Shader::UploadUniformFloat4(const std::string &iName, const glm::vec4 &iVector)
 {
-    glUseProgram(m_id);
-    glUniform4f(glGetUniformLocation(m_id, iName.c_str()), iVector[0], iVector[1], iVector[2], iVector[3]);
+    Set(GetUniform<glm::vec4>(iName), iVector);
 }
 
 void Shader::UploadUniformMatrixFloat4(const std::string &iName, const glm::mat4 &iVector)
 {
-    glUseProgram(m_id);
-    glUniformMatrix4fv(glGetUniformLocation(m_id, iName.c_str()), 1, GL_FALSE, value_ptr(iVector));
+    Set(GetUniform<glm::mat4>(iName), iVector);
 }
\ No newline at end of file
@@ -1,7 +1,9 @@
 #pragma once
 
+#include <initializer_list>
 #include <print>
 #include <string>
+#include <vector>
 #include <format>
 #include <type_traits>
 
@@ -10,13 +12,19 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include "gl_object.hpp"
+#include "gl_state.hpp"
+#include "uniform.hpp"
+#include "uniform_blocks.hpp"
 #include "resources/fileloader.hpp"
+#include "helpers/flat_hash_map.hpp"
 #include "helpers/log.hpp"
 
 enum class ShaderType
 {
     Fragment,
     Vertex,
+    Compute,
     Program
 };
 
@@ -24,9 +32,19 @@ class Shader
 {
 public:
     Shader() = delete;
-    Shader(const std::string &vertexFilePath, const std::string &fragmentFilePath);
+    // defines are injected right after the #version line of both stages, one program per variant
+    Shader(const std::string &vertexFilePath, const std::string &fragmentFilePath, const std::vector<std::string> &defines = {});
+    // compute program, dispatched by the caller after Use
+    explicit Shader(const std::string &computeFilePath, const std::vector<std::string> &defines = {});
     ~Shader();
 
+    // owns its program, move only
+    Shader(const Shader &) = delete;
+    Shader &operator=(const Shader &) = delete;
+    Shader(Shader &&) noexcept = default;
+    Shader &operator=(Shader &&) noexcept = default;
+
+    // string based uploads, resolved through the reflected uniforms on every call (prefer handles on hot paths)
     void UploadUniformBool(const std::string &name, const glm::uint &value);
     void UploadUniformInt(const std::string &name, const glm::uint &value);
     void UploadUniformFloat1(const std::string &name, const float &vector);
@@ -36,6 +54,95 @@ public:
     void UploadUniformMatrixFloat4(const std::string &name, const glm::mat4 &vector);
 
     void Use() const;
+    GLuint GetId() const { return m_program.Get(); }
+
+    // points the uniform block to a binding point, false if the program doesn't declare it
+    bool BindUniformBlock(const std::string &name, GLuint binding);
+
+    // active uniform reflected at link time, nullptr if the program has none with that name
+    const UniformInfo *FindUniform(const std::string &name) const;
+
+    /**
+     * Resolves a uniform once so that it can be set without any lookup afterwards.
+     * Gives an invalid handle when the uniform isn't active or doesn't accept a TYPE.
+     */
+    template <typename TYPE>
+    UniformHandle<TYPE> GetUniform(const std::string &name) const
+    {
+        const UniformInfo *info = FindUniform(name);
+        if (info == nullptr)
+        {
+            return {};
+        }
+        if (!IsUniformTypeCompatible<TYPE>(info->type))
+        {
+            ERROR("Uniform " << name << " doesn't match the type it is resolved with");
+            return {};
+        }
+        return {info->location, info->type};
+    }
+
+    // resolves every element of the uniform array "name[i]", empty if it isn't active
+    template <typename TYPE>
+    UniformArray<TYPE> GetUniformArray(const std::string &name) const
+    {
+        UniformArray<TYPE> array;
+        const UniformInfo *info = FindUniform(name);
+        if (info == nullptr || !IsUniformTypeCompatible<TYPE>(info->type))
+        {
+            return array;
+        }
+
+        array.elements.reserve(info->size);
+        for (GLint i = 0; i < info->size; i++)
+        {
+            array.elements.push_back(GetUniform<TYPE>(name + "[" + std::to_string(i) + "]"));
+        }
+        return array;
+    }
+
+    template <typename TYPE>
+    inline void Set(UniformHandle<TYPE> handle, const std::type_identity_t<TYPE> &value)
+    {
+        if (!handle.IsValid())
+        {
+            return;
+        }
+
+        Use();
+        if constexpr (std::is_same_v<TYPE, glm::uint> || std::is_same_v<TYPE, int>)
+        {
+            // the GL only accepts the call matching the signedness of the uniform (bools and samplers take glUniform1i)
+            if (handle.type == GL_UNSIGNED_INT)
+            {
+                glUniform1ui(handle.location, static_cast<GLuint>(value));
+            }
+            else
+            {
+                glUniform1i(handle.location, static_cast<GLint>(value));
+            }
+        }
+        else if constexpr (std::is_same_v<TYPE, float>)
+        {
+            glUniform1f(handle.location, value);
+        }
+        else if constexpr (std::is_same_v<TYPE, glm::vec2>)
+        {
+            glUniform2f(handle.location, value[0], value[1]);
+        }
+        else if constexpr (std::is_same_v<TYPE, glm::vec3>)
+        {
+            glUniform3f(handle.location, value[0], value[1], value[2]);
+        }
+        else if constexpr (std::is_same_v<TYPE, glm::vec4>)
+        {
+            glUniform4f(handle.location, value[0], value[1], value[2], value[3]);
+        }
+        else if constexpr (std::is_same_v<TYPE, glm::mat4>)
+        {
+            glUniformMatrix4fv(handle.location, 1, GL_FALSE, glm::value_ptr(value));
+        }
+    }
 
     template <typename TYPE>
     inline void Upload(const std::string &name, const TYPE &value)
@@ -71,9 +178,14 @@ public:
     }
 
 private:
+    static std::string injectDefines(const std::string &iSource, const std::vector<std::string> &iDefines);
     GLuint compile(ShaderType iType, const std::string &shaderSource);
-    void createProgramShader(GLuint iVertexShader, GLuint iFragmentShader);
+    // iShaders are deleted once linked
+    void createProgramShader(std::initializer_list<GLuint> iShaders);
     bool checkError(ShaderType iType, GLuint iShader);
+    void reflectUniforms();
 
-    GLuint m_id;
+    GLProgram m_program;
+    // active uniforms by name, array elements are also stored one by one ("name[i]")
+    FlatHashMap<std::string, UniformInfo> m_uniforms;
 };
\ No newline at end of file
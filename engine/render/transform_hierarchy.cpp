@@ -0,0 +1,80 @@
+#include "transform_hierarchy.hpp"
+
+#include <algorithm>
+
+uint32_t TransformHierarchy::Add(const glm::mat4 &iLocal, int32_t iParent)
+{
+    uint32_t aNode = static_cast<uint32_t>(m_parents.size());
+    m_parents.push_back(iParent);
+    m_subtreeEnds.push_back(aNode + 1);
+    m_locals.push_back(iLocal);
+    m_worlds.push_back(iLocal);
+    m_dirty.push_back(1);
+    m_firstDirty = std::min<size_t>(m_firstDirty, aNode);
+
+    for (int32_t aAncestor = iParent; aAncestor != NO_PARENT; aAncestor = m_parents[aAncestor])
+    {
+        m_subtreeEnds[aAncestor] = aNode + 1;
+    }
+    return aNode;
+}
+
+void TransformHierarchy::Reserve(size_t iCount)
+{
+    m_parents.reserve(iCount);
+    m_subtreeEnds.reserve(iCount);
+    m_locals.reserve(iCount);
+    m_worlds.reserve(iCount);
+    m_dirty.reserve(iCount);
+}
+
+void TransformHierarchy::Clear()
+{
+    m_parents.clear();
+    m_subtreeEnds.clear();
+    m_locals.clear();
+    m_worlds.clear();
+    m_dirty.clear();
+    m_firstDirty = 0;
+}
+
+void TransformHierarchy::SetLocal(uint32_t iNode, const glm::mat4 &iLocal)
+{
+    m_locals[iNode] = iLocal;
+    m_dirty[iNode] = 1;
+    m_firstDirty = std::min<size_t>(m_firstDirty, iNode);
+}
+
+size_t TransformHierarchy::Update()
+{
+    const size_t aCount = m_parents.size();
+    if (m_firstDirty >= aCount)
+    {
+        return 0;
+    }
+
+    const int32_t *aParents = m_parents.data();
+    const glm::mat4 *aLocals = m_locals.data();
+    glm::mat4 *aWorlds = m_worlds.data();
+    uint8_t *aDirty = m_dirty.data();
+
+    // a parent comes first: its world matrix and flag are final when its children are reached
+    size_t aUpdated = 0;
+    for (size_t i = m_firstDirty; i < aCount; i++)
+    {
+        int32_t aParent = aParents[i];
+        if (aParent != NO_PARENT)
+        {
+            aDirty[i] |= aDirty[aParent];
+        }
+        if (aDirty[i])
+        {
+            aWorlds[i] = aParent == NO_PARENT ? aLocals[i] : aWorlds[aParent] * aLocals[i];
+            aUpdated++;
+        }
+    }
+
+    std::fill(m_dirty.begin() + m_firstDirty, m_dirty.end(), uint8_t(0));
+    m_firstDirty = aCount;
+    return aUpdated;
+}
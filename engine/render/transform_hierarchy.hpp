@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+/**
+ * Node transforms of a hierarchy flattened into arrays (parent index, local and world matrices, dirty flag)
+ * ordered so that a parent always comes before its children. World matrices are then recomputed in one linear
+ * pass where the parent's world matrix is always up to date, and only for the nodes whose local matrix changed
+ * and their descendants.
+ * Nodes added depth first (each node followed by its whole subtree) also give contiguous subtrees, see GetSubtreeEnd.
+ */
+class TransformHierarchy
+{
+public:
+    static constexpr int32_t NO_PARENT = -1;
+
+    // iParent must already be in the hierarchy, returns the index of the node
+    uint32_t Add(const glm::mat4 &iLocal, int32_t iParent = NO_PARENT);
+    void Reserve(size_t iCount);
+    void Clear();
+
+    size_t Size() const { return m_parents.size(); }
+    int32_t GetParent(uint32_t iNode) const { return m_parents[iNode]; }
+    // nodes [iNode, GetSubtreeEnd(iNode)) are iNode and its descendants
+    uint32_t GetSubtreeEnd(uint32_t iNode) const { return m_subtreeEnds[iNode]; }
+
+    const glm::mat4 &GetLocal(uint32_t iNode) const { return m_locals[iNode]; }
+    void SetLocal(uint32_t iNode, const glm::mat4 &iLocal);
+    // only valid after Update
+    const glm::mat4 &GetWorld(uint32_t iNode) const { return m_worlds[iNode]; }
+    const std::vector<glm::mat4> &GetWorlds() const { return m_worlds; }
+
+    bool IsDirty() const { return m_firstDirty < m_parents.size(); }
+    // recomputes the world matrices of the changed subtrees, returns the number of nodes updated
+    size_t Update();
+
+private:
+    std::vector<int32_t> m_parents;
+    std::vector<uint32_t> m_subtreeEnds;
+    std::vector<glm::mat4> m_locals;
+    std::vector<glm::mat4> m_worlds;
+    std::vector<uint8_t> m_dirty;
+    // nothing before it is dirty, the update starts there
+    size_t m_firstDirty = 0;
+};
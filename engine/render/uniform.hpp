@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstddef>
+#include <type_traits>
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+/**
+ * Location of a uniform resolved once through Shader::GetUniform, typed after the value it accepts.
+ * An invalid handle (uniform missing or optimized out by the driver) is ignored by Shader::Set.
+ * Handles belong to the program they were resolved from.
+ */
+template <typename T>
+struct UniformHandle
+{
+    GLint location = -1;
+    // reflected GL type, integers go through glUniform1ui when it's GL_UNSIGNED_INT
+    GLenum type = 0;
+
+    bool IsValid() const { return location >= 0; }
+};
+
+// one handle per element of a uniform array ("material.diffuse[0]", "material.diffuse[1]", ...)
+template <typename T>
+struct UniformArray
+{
+    std::vector<UniformHandle<T>> elements;
+
+    size_t Size() const { return elements.size(); }
+    // out of range elements give an invalid handle
+    UniformHandle<T> operator[](size_t iIndex) const
+    {
+        return iIndex < elements.size() ? elements[iIndex] : UniformHandle<T>{};
+    }
+};
+
+// reflected description of an active uniform
+struct UniformInfo
+{
+    GLint location = -1;
+    GLenum type = 0;
+    GLint size = 0;
+};
+
+// whether a value of type T can be uploaded to a uniform of GL type iType
+template <typename T>
+constexpr bool IsUniformTypeCompatible(GLenum iType)
+{
+    if constexpr (std::is_same_v<T, int> || std::is_same_v<T, glm::uint>)
+    {
+        // samplers are set through their texture unit
+        return iType == GL_INT || iType == GL_BOOL || iType == GL_UNSIGNED_INT ||
+               iType == GL_SAMPLER_2D || iType == GL_SAMPLER_2D_ARRAY || iType == GL_SAMPLER_CUBE;
+    }
+    else if constexpr (std::is_same_v<T, float>)
+    {
+        return iType == GL_FLOAT;
+    }
+    else if constexpr (std::is_same_v<T, glm::vec2>)
+    {
+        return iType == GL_FLOAT_VEC2;
+    }
+    else if constexpr (std::is_same_v<T, glm::vec3>)
+    {
+        return iType == GL_FLOAT_VEC3;
+    }
+    else if constexpr (std::is_same_v<T, glm::vec4>)
+    {
+        return iType == GL_FLOAT_VEC4;
+    }
+    else if constexpr (std::is_same_v<T, glm::mat4>)
+    {
+        return iType == GL_FLOAT_MAT4;
+    }
+    else
+    {
+        static_assert(!sizeof(T), "Unsupported type for shader upload");
+    }
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstddef>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+/**
+ * Uniform blocks shared by every shader, the GLSL declarations must be kept in sync (assets/shaders).
+ * Shader binds the blocks it declares to these binding points when it is linked.
+ */
+enum class UniformBinding : GLuint
+{
+    Frame = 0,
+    Light = 1,
+};
+
+// per frame camera and time, GLSL: uniform FrameBlock { ... } frame;
+struct FrameBlock
+{
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::mat4 viewProjection;
+    glm::vec3 viewPos;
+    float time;
+    float deltaTime;
+    float padding[3];
+};
+
+// per scene lighting, GLSL: uniform LightBlock { ... } light;
+struct LightBlock
+{
+    glm::vec3 position;
+    float padding0;
+    glm::vec3 ambient;
+    float padding1;
+    glm::vec3 diffuse;
+    float padding2;
+    glm::vec3 specular;
+    float padding3;
+};
+
+static_assert(offsetof(FrameBlock, viewPos) == 192 && offsetof(FrameBlock, time) == 204 && offsetof(FrameBlock, deltaTime) == 208);
+static_assert(sizeof(FrameBlock) == 224);
+static_assert(offsetof(LightBlock, ambient) == 16 && offsetof(LightBlock, specular) == 48 && sizeof(LightBlock) == 64);
+
+// shader storage blocks use their own binding points, set in GLSL with layout(binding = N)
+enum class StorageBinding : GLuint
+{
+    Draws = 0,
+    Materials = 1,
+    // GPU culling pass, see gpu_culler.hpp
+    CullObjects = 2,
+    CullCommands = 3,
+    CullCount = 4,
+};
+
+struct UniformBlockBinding
+{
+    const char *name;
+    UniformBinding binding;
+};
+
+inline constexpr UniformBlockBinding UNIFORM_BLOCKS[] = {
+    {"FrameBlock", UniformBinding::Frame},
+    {"LightBlock", UniformBinding::Light},
+};
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <type_traits>
+
+#include <glad/glad.h>
+
+#include "gl_object.hpp"
+
+/**
+ * std140 uniform block written from the CPU and bound to a fixed binding point, every program declaring
+ * the block reads the same buffer (see Shader::BindUniformBlock) so it is written once whatever the number
+ * of programs using it.
+ * Block must match the std140 layout of its GLSL declaration (vec3 padded to 16 bytes, size multiple of 16).
+ */
+template <typename Block>
+class UniformBuffer
+{
+public:
+    static_assert(std::is_trivially_copyable_v<Block>, "Uniform blocks are copied as is into the buffer");
+    static_assert(sizeof(Block) % 16 == 0, "std140 blocks are padded to a multiple of 16 bytes");
+
+    UniformBuffer() = default;
+
+    // creates the buffer and binds it, needs the GL context
+    void Create(GLuint binding)
+    {
+        m_binding = binding;
+        m_buffer = GLBuffer::Create();
+        glBindBuffer(GL_UNIFORM_BUFFER, m_buffer.Get());
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(Block), nullptr, GL_STREAM_DRAW);
+        glBindBufferBase(GL_UNIFORM_BUFFER, m_binding, m_buffer.Get());
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    }
+
+    bool IsValid() const { return static_cast<bool>(m_buffer); }
+    GLuint GetBinding() const { return m_binding; }
+
+    // meant to be called once per frame, the storage is orphaned so the GPU never stalls on the previous frame
+    void Update(const Block &block)
+    {
+        glBindBuffer(GL_UNIFORM_BUFFER, m_buffer.Get());
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(Block), nullptr, GL_STREAM_DRAW);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(Block), &block);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        // another buffer may have taken the binding point meanwhile (one per scene)
+        glBindBufferBase(GL_UNIFORM_BUFFER, m_binding, m_buffer.Get());
+    }
+
+private:
+    GLBuffer m_buffer;
+    GLuint m_binding = 0;
+};
@@ -0,0 +1,148 @@
+#include "vertex_format.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "mesh.hpp"
+
+namespace
+{
+    // byte offsets of the attributes in a packed vertex, the tangent follows the texture coordinates
+    constexpr size_t NORMAL_OFFSET = sizeof(glm::vec3);
+    constexpr size_t TCOORDS_OFFSET = NORMAL_OFFSET + sizeof(uint32_t);
+
+    size_t texCoordsSize(const VertexFormat &format)
+    {
+        return format.halfTexCoords ? sizeof(uint32_t) : sizeof(glm::vec2);
+    }
+
+    // x on 16 bits, y on the upper 15 bits of the second component and the bitangent sign in its lowest one
+    void packTangent(const Vertex &vertex, int16_t tangent[2])
+    {
+        glm::vec2 encoded = VertexFormat::EncodeOctahedral(vertex.tangent);
+        bool mirrored = glm::dot(glm::cross(vertex.normal, vertex.tangent), vertex.bitangent) < 0.0f;
+        tangent[0] = static_cast<int16_t>(std::lround(std::clamp(encoded.x, -1.0f, 1.0f) * 32767.0f));
+        tangent[1] = static_cast<int16_t>(std::lround(std::clamp(encoded.y, -1.0f, 1.0f) * 16383.0f) * 2 + (mirrored ? 1 : 0));
+    }
+}
+
+VertexFormat VertexFormat::Choose(const Mesh &mesh, const Settings &settings)
+{
+    float range = 0.0f;
+    for (const Vertex &vertex : mesh.vertices)
+    {
+        range = std::max({range, std::abs(vertex.tcoords.x), std::abs(vertex.tcoords.y)});
+    }
+
+    VertexFormat format;
+    format.halfTexCoords = range <= settings.halfTexCoordsRange;
+    format.tangents = mesh.HasTangents();
+    format.shortIndices = settings.shortIndices && mesh.vertices.size() <= MAX_SHORT_INDEX_VERTICES;
+    return format;
+}
+
+size_t VertexFormat::GetVertexSize() const
+{
+    return TCOORDS_OFFSET + texCoordsSize(*this) + (tangents ? sizeof(uint32_t) : 0);
+}
+
+std::vector<std::byte> VertexFormat::PackVertices(const std::vector<Vertex> &vertices) const
+{
+    size_t stride = GetVertexSize();
+    size_t tangentOffset = TCOORDS_OFFSET + texCoordsSize(*this);
+
+    std::vector<std::byte> packed(vertices.size() * stride);
+    for (size_t i = 0; i < vertices.size(); i++)
+    {
+        const Vertex &vertex = vertices[i];
+        std::byte *destination = packed.data() + i * stride;
+
+        std::memcpy(destination, &vertex.position, sizeof(glm::vec3));
+        uint32_t normal = glm::packSnorm2x16(EncodeOctahedral(vertex.normal));
+        std::memcpy(destination + NORMAL_OFFSET, &normal, sizeof(normal));
+        if (halfTexCoords)
+        {
+            uint32_t tcoords = glm::packHalf2x16(vertex.tcoords);
+            std::memcpy(destination + TCOORDS_OFFSET, &tcoords, sizeof(tcoords));
+        }
+        else
+        {
+            std::memcpy(destination + TCOORDS_OFFSET, &vertex.tcoords, sizeof(glm::vec2));
+        }
+        if (tangents)
+        {
+            int16_t tangent[2];
+            packTangent(vertex, tangent);
+            std::memcpy(destination + tangentOffset, tangent, sizeof(tangent));
+        }
+    }
+    return packed;
+}
+
+std::vector<std::byte> VertexFormat::PackIndices(const std::vector<unsigned int> &indices) const
+{
+    std::vector<std::byte> packed(indices.size() * GetIndexSize());
+    if (!shortIndices)
+    {
+        std::memcpy(packed.data(), indices.data(), packed.size());
+        return packed;
+    }
+    for (size_t i = 0; i < indices.size(); i++)
+    {
+        uint16_t index = static_cast<uint16_t>(indices[i]);
+        std::memcpy(packed.data() + i * sizeof(uint16_t), &index, sizeof(index));
+    }
+    return packed;
+}
+
+void VertexFormat::Bind(GLuint vertexBuffer, GLuint indexBuffer) const
+{
+    glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+
+    GLsizei stride = static_cast<GLsizei>(GetVertexSize());
+    // vertex positions
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void *)0);
+    // vertex normals, normalized to [-1, 1] and unfolded by the shader
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, stride, (void *)NORMAL_OFFSET);
+    // vertex texture coords
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 2, halfTexCoords ? GL_HALF_FLOAT : GL_FLOAT, GL_FALSE, stride, (void *)TCOORDS_OFFSET);
+    // vertex tangent, as integers so that the shader gets the sign bit, the bitangent is rebuilt from it
+    if (tangents)
+    {
+        glEnableVertexAttribArray(3);
+        glVertexAttribIPointer(3, 2, GL_SHORT, stride, (void *)(TCOORDS_OFFSET + texCoordsSize(*this)));
+    }
+}
+
+glm::vec2 VertexFormat::EncodeOctahedral(const glm::vec3 &direction)
+{
+    float sum = std::abs(direction.x) + std::abs(direction.y) + std::abs(direction.z);
+    if (sum == 0.0f)
+    {
+        return glm::vec2(0.0f);
+    }
+
+    glm::vec3 projected = direction / sum;
+    if (projected.z >= 0.0f)
+    {
+        return glm::vec2(projected.x, projected.y);
+    }
+    // the lower half folds over the diagonals
+    return glm::vec2((1.0f - std::abs(projected.y)) * (projected.x >= 0.0f ? 1.0f : -1.0f),
+                     (1.0f - std::abs(projected.x)) * (projected.y >= 0.0f ? 1.0f : -1.0f));
+}
+
+glm::vec3 VertexFormat::DecodeOctahedral(const glm::vec2 &encoded)
+{
+    // same as octahedralDecode in model.vert
+    glm::vec3 direction(encoded.x, encoded.y, 1.0f - std::abs(encoded.x) - std::abs(encoded.y));
+    float fold = std::max(-direction.z, 0.0f);
+    direction.x += direction.x >= 0.0f ? -fold : fold;
+    direction.y += direction.y >= 0.0f ? -fold : fold;
+    return glm::normalize(direction);
+}
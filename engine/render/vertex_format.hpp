@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+struct Vertex;
+class Mesh;
+
+/**
+ * How the vertices and indices of a mesh are stored on the GPU, chosen per mesh at import (see Choose).
+ * The CPU side keeps the full precision Vertex the simplifier, the optimizer and the mesh cache work on,
+ * the upload packs it in this layout:
+ *   position   3 x float                                                  12 bytes
+ *   normal     octahedral, 2 x 16 bits snorm                               4 bytes
+ *   tcoords    2 x half float, or 2 x float                                4 or 8 bytes
+ *   tangent    octahedral, 2 x 16 bits, the bitangent sign in the lowest    4 bytes, only with tangents
+ *              bit of the second one
+ * that is 20 to 28 bytes instead of the 56 of Vertex, and the indices take 16 bits when the vertices allow it.
+ * assets/shaders/model.vert decodes the attributes (GL converts the half floats and the normal).
+ */
+struct VertexFormat
+{
+    struct Settings
+    {
+        // largest texture coordinate (in absolute value) stored as a half float, steps of 2^-10 below 2
+        float halfTexCoordsRange = 2.0f;
+        // 16 bits indices for meshes of up to 65536 vertices
+        bool shortIndices = true;
+    };
+
+    static constexpr size_t MAX_SHORT_INDEX_VERTICES = 1 << 16;
+
+    bool halfTexCoords = false;
+    // tangent frame for the normal maps, meshes without tangents leave the attribute out
+    bool tangents = false;
+    bool shortIndices = false;
+
+    // the most compact layout that keeps the precision of mesh, on its final vertices and levels of detail
+    static VertexFormat Choose(const Mesh &mesh, const Settings &settings);
+    static VertexFormat Choose(const Mesh &mesh) { return Choose(mesh, Settings{}); }
+
+    size_t GetVertexSize() const;
+    size_t GetIndexSize() const { return shortIndices ? sizeof(uint16_t) : sizeof(uint32_t); }
+    GLenum GetIndexType() const { return shortIndices ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT; }
+
+    // GetVertexSize() bytes per vertex
+    std::vector<std::byte> PackVertices(const std::vector<Vertex> &vertices) const;
+    // GetIndexSize() bytes per index, the indices must fit (see MAX_SHORT_INDEX_VERTICES)
+    std::vector<std::byte> PackIndices(const std::vector<unsigned int> &indices) const;
+    // points the attributes 0 to 3 of the bound vertex array to buffers holding this layout
+    void Bind(GLuint vertexBuffer, GLuint indexBuffer) const;
+
+    // unit vector to the two snorm components of its octahedral projection, (0, 0) for a null vector
+    static glm::vec2 EncodeOctahedral(const glm::vec3 &direction);
+    static glm::vec3 DecodeOctahedral(const glm::vec2 &encoded);
+
+    bool operator==(const VertexFormat &other) const = default;
+};
@@ -0,0 +1,87 @@
+#include "async_loader.hpp"
+
+#include <optional>
+#include <unordered_map>
+
+#include "texture_cache.hpp"
+#include "loaders/loader.hpp"
+
+std::shared_ptr<std::vector<Mesh>> AsyncLoader<std::vector<Mesh>>::Load(UploadQueue &ioQueue, const std::string &iFilepath)
+{
+    auto aMeshes = std::make_shared<std::vector<Mesh>>(Loader::Parse(iFilepath));
+
+    // every texture file once, decoded in parallel unless another load already uploaded it
+    TextureCache &aCache = TextureCache::Get();
+    std::vector<TextureCache::Key> aKeys;
+    std::unordered_map<std::string, size_t> aIndices;
+    for (Mesh &aMesh : *aMeshes)
+    {
+        for (Material &aMaterial : aMesh.materials)
+        {
+            for (Texture *aTexture : aMaterial.GetTextures())
+            {
+                if (aTexture->id == 0 && !aTexture->path.empty() && aIndices.emplace(aTexture->path, aKeys.size()).second)
+                {
+                    aKeys.push_back(TextureCache::MakeKey(aTexture->path));
+                }
+            }
+        }
+    }
+
+    auto aImages = std::make_shared<std::vector<std::optional<Image>>>(aCache.Decode(aKeys));
+
+    // one job per texture and per mesh so the frame budget can cut between them
+    auto aIds = std::make_shared<std::vector<unsigned int>>(aKeys.size(), 0);
+    for (size_t i = 0; i < aKeys.size(); i++)
+    {
+        if ((*aImages)[i])
+        {
+            ioQueue.Push([&aCache, aImages, aIds, i, aKey = aKeys[i]]()
+                         {
+                             std::optional<Texture> aTexture = aCache.Upload(aKey, *(*aImages)[i]);
+                             (*aIds)[i] = aTexture ? aTexture->id : 0;
+                             (*aImages)[i].reset(); });
+        }
+    }
+
+    ioQueue.Push([&aCache, aMeshes, aIds, aKeys = std::move(aKeys), aIndices = std::move(aIndices)]()
+                 {
+                     for (Mesh &aMesh : *aMeshes)
+                     {
+                         for (Material &aMaterial : aMesh.materials)
+                         {
+                             for (Texture *aTexture : aMaterial.GetTextures())
+                             {
+                                 auto aIndex = aIndices.find(aTexture->path);
+                                 if (aTexture->id != 0 || aIndex == aIndices.end())
+                                 {
+                                     continue;
+                                 }
+
+                                 // textures that were already cached when this load started weren't decoded again
+                                 unsigned int &aId = (*aIds)[aIndex->second];
+                                 if (aId == 0)
+                                 {
+                                     std::optional<Texture> aCached = aCache.Find(aKeys[aIndex->second]);
+                                     aId = aCached ? aCached->id : 0;
+                                 }
+                                 aTexture->id = aId;
+                                 if (aTexture->id == 0)
+                                 {
+                                     // nothing to bind
+                                     aTexture->type = TextureType::UNKNOWN;
+                                 }
+                             }
+                         }
+                     } });
+
+    for (size_t i = 0; i < aMeshes->size(); i++)
+    {
+        ioQueue.Push([aMeshes, i]()
+                     {
+                         Mesh &aMesh = (*aMeshes)[i];
+                         aMesh.SetupMesh(aMesh.HasTangents()); });
+    }
+
+    return aMeshes;
+}
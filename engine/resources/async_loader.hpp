@@ -0,0 +1,23 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "upload_queue.hpp"
+#include "render/mesh.hpp"
+
+/**
+ * Splits the loading of a resource type between the worker pool and the GL thread for ResourceManager::LoadAsync.
+ * Load runs on a worker: it does the whole CPU side (parsing, decoding, ...) and pushes the GL side to the
+ * queue, the resource is only handed out once all of its jobs ran. Specialize it for every async loaded type.
+ */
+template <typename T>
+struct AsyncLoader;
+
+// meshes of a file, see Loader::Load
+template <>
+struct AsyncLoader<std::vector<Mesh>>
+{
+    static std::shared_ptr<std::vector<Mesh>> Load(UploadQueue &ioQueue, const std::string &iFilepath);
+};
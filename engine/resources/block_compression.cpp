@@ -0,0 +1,718 @@
+#include "block_compression.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cfloat>
+#include <cmath>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "core/thread_pool.hpp"
+
+namespace
+{
+    constexpr int TEXELS = BlockCompression::BLOCK_SIZE * BlockCompression::BLOCK_SIZE;
+
+    // rgba texels of a block in [0, 255], row after row
+    using Block = std::array<glm::vec4, TEXELS>;
+
+    // weights over 64 of the second endpoint for the 4 bits indices of BC7
+    constexpr int BC7_WEIGHTS[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+    // first byte of a mode 6 BC7 block, the mode is the position of the lowest set bit
+    constexpr uint8_t BC7_MODE_6 = 1 << 6;
+    // factor of the second endpoint for each index of a BC1 block in 4 colors mode
+    constexpr float BC1_FACTORS[4] = {0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f};
+
+    // least significant bit first, as every BCn block
+    struct BitWriter
+    {
+        uint8_t *data;
+        size_t position = 0;
+
+        void write(uint32_t iValue, int iCount)
+        {
+            for (int i = 0; i < iCount; i++, position++)
+            {
+                if ((iValue >> i) & 1)
+                {
+                    data[position >> 3] |= static_cast<uint8_t>(1 << (position & 7));
+                }
+            }
+        }
+    };
+
+    struct BitReader
+    {
+        const uint8_t *data;
+        size_t position = 0;
+
+        uint32_t read(int iCount)
+        {
+            uint32_t aValue = 0;
+            for (int i = 0; i < iCount; i++, position++)
+            {
+                aValue |= static_cast<uint32_t>((data[position >> 3] >> (position & 7)) & 1) << i;
+            }
+            return aValue;
+        }
+    };
+
+    // grey is replicated on rgb and goes with its alpha, texels out of the level repeat the last row/column
+    Block loadBlock(const unsigned char *iTexels, int iChannels, int iWidth, int iHeight, int iBlockX, int iBlockY)
+    {
+        Block aBlock;
+        for (int y = 0; y < BlockCompression::BLOCK_SIZE; y++)
+        {
+            for (int x = 0; x < BlockCompression::BLOCK_SIZE; x++)
+            {
+                int aX = std::min(iBlockX * BlockCompression::BLOCK_SIZE + x, iWidth - 1);
+                int aY = std::min(iBlockY * BlockCompression::BLOCK_SIZE + y, iHeight - 1);
+                const unsigned char *aTexel = iTexels + (static_cast<size_t>(aY) * iWidth + aX) * iChannels;
+                glm::vec4 &aColor = aBlock[y * BlockCompression::BLOCK_SIZE + x];
+                switch (iChannels)
+                {
+                case 1:
+                    aColor = glm::vec4(aTexel[0], aTexel[0], aTexel[0], 255.0f);
+                    break;
+                case 2:
+                    aColor = glm::vec4(aTexel[0], aTexel[0], aTexel[0], aTexel[1]);
+                    break;
+                case 3:
+                    aColor = glm::vec4(aTexel[0], aTexel[1], aTexel[2], 255.0f);
+                    break;
+                default:
+                    aColor = glm::vec4(aTexel[0], aTexel[1], aTexel[2], aTexel[3]);
+                    break;
+                }
+            }
+        }
+        return aBlock;
+    }
+
+    glm::vec4 mask(const glm::vec4 &iColor, int iDimensions)
+    {
+        return iDimensions == 3 ? glm::vec4(iColor.x, iColor.y, iColor.z, 0.0f) : iColor;
+    }
+
+    glm::vec4 blockMean(const Block &iBlock, int iDimensions)
+    {
+        glm::vec4 aSum(0.0f);
+        for (const glm::vec4 &aColor : iBlock)
+        {
+            aSum += mask(aColor, iDimensions);
+        }
+        return aSum / static_cast<float>(TEXELS);
+    }
+
+    // direction of largest variance of the texels (rgb or rgba), by power iteration on their covariance
+    glm::vec4 principalAxis(const Block &iBlock, const glm::vec4 &iMean, int iDimensions)
+    {
+        float aCovariance[4][4] = {};
+        glm::vec4 aMin(FLT_MAX);
+        glm::vec4 aMax(-FLT_MAX);
+        for (const glm::vec4 &aColor : iBlock)
+        {
+            glm::vec4 aDelta = mask(aColor, iDimensions) - iMean;
+            for (int i = 0; i < 4; i++)
+            {
+                for (int j = 0; j < 4; j++)
+                {
+                    aCovariance[i][j] += aDelta[i] * aDelta[j];
+                }
+            }
+            aMin = glm::min(aMin, aDelta);
+            aMax = glm::max(aMax, aDelta);
+        }
+
+        glm::vec4 aAxis = aMax - aMin;
+        for (int aIteration = 0; aIteration < 8; aIteration++)
+        {
+            float aLength = std::sqrt(glm::dot(aAxis, aAxis));
+            if (aLength < FLT_MIN)
+            {
+                return mask(glm::vec4(0.5f), iDimensions);
+            }
+            aAxis /= aLength;
+
+            glm::vec4 aNext(0.0f);
+            for (int i = 0; i < 4; i++)
+            {
+                for (int j = 0; j < 4; j++)
+                {
+                    aNext[i] += aCovariance[i][j] * aAxis[j];
+                }
+            }
+            aAxis = aNext;
+        }
+        float aLength = std::sqrt(glm::dot(aAxis, aAxis));
+        return aLength < FLT_MIN ? mask(glm::vec4(0.5f), iDimensions) : aAxis / aLength;
+    }
+
+    // extremes of the texels along the principal axis, the start of the segment being the lowest
+    void boundingEndpoints(const Block &iBlock, int iDimensions, glm::vec4 &oStart, glm::vec4 &oEnd)
+    {
+        glm::vec4 aMean = blockMean(iBlock, iDimensions);
+        glm::vec4 aAxis = principalAxis(iBlock, aMean, iDimensions);
+        float aMin = FLT_MAX;
+        float aMax = -FLT_MAX;
+        for (const glm::vec4 &aColor : iBlock)
+        {
+            float aProjection = glm::dot(mask(aColor, iDimensions) - aMean, aAxis);
+            aMin = std::min(aMin, aProjection);
+            aMax = std::max(aMax, aProjection);
+        }
+        oStart = aMean + aAxis * aMin;
+        oEnd = aMean + aAxis * aMax;
+    }
+
+    // endpoints minimizing the squared error of the texels interpolated at iFactors (0 = start, 1 = end)
+    bool fitEndpoints(const Block &iBlock, const float iFactors[TEXELS], glm::vec4 &oStart, glm::vec4 &oEnd)
+    {
+        float aStartStart = 0.0f, aStartEnd = 0.0f, aEndEnd = 0.0f;
+        glm::vec4 aStartSum(0.0f), aEndSum(0.0f);
+        for (int i = 0; i < TEXELS; i++)
+        {
+            float aEnd = iFactors[i];
+            float aStart = 1.0f - aEnd;
+            aStartStart += aStart * aStart;
+            aStartEnd += aStart * aEnd;
+            aEndEnd += aEnd * aEnd;
+            aStartSum += iBlock[i] * aStart;
+            aEndSum += iBlock[i] * aEnd;
+        }
+
+        float aDeterminant = aStartStart * aEndEnd - aStartEnd * aStartEnd;
+        if (std::abs(aDeterminant) < 1e-6f)
+        {
+            return false;
+        }
+        oStart = glm::clamp((aStartSum * aEndEnd - aEndSum * aStartEnd) / aDeterminant, glm::vec4(0.0f), glm::vec4(255.0f));
+        oEnd = glm::clamp((aEndSum * aStartStart - aStartSum * aStartEnd) / aDeterminant, glm::vec4(0.0f), glm::vec4(255.0f));
+        return true;
+    }
+
+    uint16_t packRgb565(const glm::vec4 &iColor)
+    {
+        auto aQuantize = [](float iValue, float iMax)
+        {
+            return static_cast<uint16_t>(std::clamp(std::lround(iValue * iMax / 255.0f), 0l, static_cast<long>(iMax)));
+        };
+        return static_cast<uint16_t>((aQuantize(iColor.x, 31.0f) << 11) | (aQuantize(iColor.y, 63.0f) << 5) | aQuantize(iColor.z, 31.0f));
+    }
+
+    // the bits are replicated in the low ones as the GPU does
+    glm::vec4 unpackRgb565(uint16_t iColor)
+    {
+        int aRed = (iColor >> 11) & 31;
+        int aGreen = (iColor >> 5) & 63;
+        int aBlue = iColor & 31;
+        return glm::vec4((aRed << 3) | (aRed >> 2), (aGreen << 2) | (aGreen >> 4), (aBlue << 3) | (aBlue >> 2), 255.0f);
+    }
+
+    float rgbError(const glm::vec4 &iA, const glm::vec4 &iB)
+    {
+        glm::vec3 aDelta = glm::vec3(iA.x - iB.x, iA.y - iB.y, iA.z - iB.z);
+        return glm::dot(aDelta, aDelta);
+    }
+
+    // nearest entry of the 4 colors mode palette for every texel, returns the squared error
+    float chooseColorIndices(const Block &iBlock, uint16_t iStart, uint16_t iEnd, uint8_t oIndices[TEXELS])
+    {
+        glm::vec4 aPalette[4];
+        for (int i = 0; i < 4; i++)
+        {
+            aPalette[i] = unpackRgb565(iStart) * (1.0f - BC1_FACTORS[i]) + unpackRgb565(iEnd) * BC1_FACTORS[i];
+        }
+
+        float aError = 0.0f;
+        for (int i = 0; i < TEXELS; i++)
+        {
+            float aBest = FLT_MAX;
+            for (uint8_t aIndex = 0; aIndex < 4; aIndex++)
+            {
+                float aDistance = rgbError(iBlock[i], aPalette[aIndex]);
+                if (aDistance < aBest)
+                {
+                    aBest = aDistance;
+                    oIndices[i] = aIndex;
+                }
+            }
+            aError += aBest;
+        }
+        return aError;
+    }
+
+    // BC1 color block (8 bytes), always in 4 colors mode so that BC3 decodes it the same
+    void encodeColorBlock(const Block &iBlock, uint8_t *oBlock)
+    {
+        glm::vec4 aStart, aEnd;
+        boundingEndpoints(iBlock, 3, aStart, aEnd);
+
+        uint16_t aBestStart = 0, aBestEnd = 0;
+        uint8_t aBestIndices[TEXELS] = {};
+        float aBestError = FLT_MAX;
+        for (int aIteration = 0; aIteration < 3; aIteration++)
+        {
+            uint16_t aPackedStart = packRgb565(aStart);
+            uint16_t aPackedEnd = packRgb565(aEnd);
+            uint8_t aIndices[TEXELS];
+            float aError = chooseColorIndices(iBlock, aPackedStart, aPackedEnd, aIndices);
+            if (aError < aBestError)
+            {
+                aBestError = aError;
+                aBestStart = aPackedStart;
+                aBestEnd = aPackedEnd;
+                std::copy(aIndices, aIndices + TEXELS, aBestIndices);
+            }
+
+            float aFactors[TEXELS];
+            for (int i = 0; i < TEXELS; i++)
+            {
+                aFactors[i] = BC1_FACTORS[aIndices[i]];
+            }
+            if (aError == 0.0f || !fitEndpoints(iBlock, aFactors, aStart, aEnd))
+            {
+                break;
+            }
+        }
+
+        // the first color must be the greatest for the 4 colors mode, swapping exchanges 0/1 and 2/3
+        if (aBestStart < aBestEnd)
+        {
+            std::swap(aBestStart, aBestEnd);
+            for (uint8_t &aIndex : aBestIndices)
+            {
+                aIndex ^= 1;
+            }
+        }
+        else if (aBestStart == aBestEnd)
+        {
+            std::fill(aBestIndices, aBestIndices + TEXELS, 0);
+        }
+
+        oBlock[0] = static_cast<uint8_t>(aBestStart & 0xFF);
+        oBlock[1] = static_cast<uint8_t>(aBestStart >> 8);
+        oBlock[2] = static_cast<uint8_t>(aBestEnd & 0xFF);
+        oBlock[3] = static_cast<uint8_t>(aBestEnd >> 8);
+        for (int y = 0; y < BlockCompression::BLOCK_SIZE; y++)
+        {
+            const uint8_t *aRow = aBestIndices + y * BlockCompression::BLOCK_SIZE;
+            oBlock[4 + y] = static_cast<uint8_t>(aRow[0] | (aRow[1] << 2) | (aRow[2] << 4) | (aRow[3] << 6));
+        }
+    }
+
+    // BC4 block (8 bytes) of one channel, 8 values mode between the extremes
+    void encodeValueBlock(const float iValues[TEXELS], uint8_t *oBlock)
+    {
+        float aMin = *std::min_element(iValues, iValues + TEXELS);
+        float aMax = *std::max_element(iValues, iValues + TEXELS);
+        uint8_t aStart = static_cast<uint8_t>(std::lround(aMax));
+        uint8_t aEnd = static_cast<uint8_t>(std::lround(aMin));
+
+        // with equal endpoints the block is in 6 values mode, where the index 0 is the first endpoint too
+        float aPalette[8] = {static_cast<float>(aStart), static_cast<float>(aEnd)};
+        for (int i = 2; i < 8; i++)
+        {
+            aPalette[i] = ((8 - i) * aPalette[0] + (i - 1) * aPalette[1]) / 7.0f;
+        }
+
+        BitWriter aWriter{oBlock};
+        aWriter.write(aStart, 8);
+        aWriter.write(aEnd, 8);
+        for (int i = 0; i < TEXELS; i++)
+        {
+            uint32_t aBest = 0;
+            for (uint32_t aIndex = 1; aStart != aEnd && aIndex < 8; aIndex++)
+            {
+                if (std::abs(iValues[i] - aPalette[aIndex]) < std::abs(iValues[i] - aPalette[aBest]))
+                {
+                    aBest = aIndex;
+                }
+            }
+            aWriter.write(aBest, 3);
+        }
+    }
+
+    void encodeChannelBlock(const Block &iBlock, int iChannel, uint8_t *oBlock)
+    {
+        float aValues[TEXELS];
+        for (int i = 0; i < TEXELS; i++)
+        {
+            aValues[i] = iBlock[i][iChannel];
+        }
+        encodeValueBlock(aValues, oBlock);
+    }
+
+    // 7 bits per channel plus a low bit shared by the channels
+    struct Bc7Endpoint
+    {
+        int channels[4];
+        int shared;
+
+        glm::vec4 Color() const
+        {
+            return glm::vec4(channels[0] * 2 + shared, channels[1] * 2 + shared, channels[2] * 2 + shared, channels[3] * 2 + shared);
+        }
+    };
+
+    Bc7Endpoint quantizeBc7Endpoint(const glm::vec4 &iColor)
+    {
+        Bc7Endpoint aBest = {};
+        float aBestError = FLT_MAX;
+        for (int aShared = 0; aShared < 2; aShared++)
+        {
+            Bc7Endpoint aEndpoint;
+            aEndpoint.shared = aShared;
+            for (int c = 0; c < 4; c++)
+            {
+                aEndpoint.channels[c] = std::clamp(static_cast<int>(std::lround((iColor[c] - aShared) / 2.0f)), 0, 127);
+            }
+            glm::vec4 aDelta = aEndpoint.Color() - iColor;
+            float aError = glm::dot(aDelta, aDelta);
+            if (aError < aBestError)
+            {
+                aBestError = aError;
+                aBest = aEndpoint;
+            }
+        }
+        return aBest;
+    }
+
+    float chooseBc7Indices(const Block &iBlock, const Bc7Endpoint &iStart, const Bc7Endpoint &iEnd, uint8_t oIndices[TEXELS])
+    {
+        // interpolated with the integer rounding of the decoder
+        glm::vec4 aPalette[16];
+        glm::vec4 aStart = iStart.Color();
+        glm::vec4 aEnd = iEnd.Color();
+        for (int i = 0; i < 16; i++)
+        {
+            for (int c = 0; c < 4; c++)
+            {
+                int aValue = ((64 - BC7_WEIGHTS[i]) * static_cast<int>(aStart[c]) + BC7_WEIGHTS[i] * static_cast<int>(aEnd[c]) + 32) >> 6;
+                aPalette[i][c] = static_cast<float>(aValue);
+            }
+        }
+
+        float aError = 0.0f;
+        for (int i = 0; i < TEXELS; i++)
+        {
+            float aBest = FLT_MAX;
+            for (uint8_t aIndex = 0; aIndex < 16; aIndex++)
+            {
+                glm::vec4 aDelta = iBlock[i] - aPalette[aIndex];
+                float aDistance = glm::dot(aDelta, aDelta);
+                if (aDistance < aBest)
+                {
+                    aBest = aDistance;
+                    oIndices[i] = aIndex;
+                }
+            }
+            aError += aBest;
+        }
+        return aError;
+    }
+
+    void writeBc7Block(const Bc7Endpoint &iStart, const Bc7Endpoint &iEnd, const uint8_t iIndices[TEXELS], uint8_t *oBlock)
+    {
+        std::fill(oBlock, oBlock + 16, 0);
+        BitWriter aWriter{oBlock};
+        aWriter.write(BC7_MODE_6, 7);
+        for (int c = 0; c < 4; c++)
+        {
+            aWriter.write(static_cast<uint32_t>(iStart.channels[c]), 7);
+            aWriter.write(static_cast<uint32_t>(iEnd.channels[c]), 7);
+        }
+        aWriter.write(static_cast<uint32_t>(iStart.shared), 1);
+        aWriter.write(static_cast<uint32_t>(iEnd.shared), 1);
+        // the highest bit of the first index is implicitly 0
+        aWriter.write(iIndices[0], 3);
+        for (int i = 1; i < TEXELS; i++)
+        {
+            aWriter.write(iIndices[i], 4);
+        }
+    }
+
+    void readBc7Block(const uint8_t *iBlock, Bc7Endpoint &oStart, Bc7Endpoint &oEnd, uint8_t oIndices[TEXELS])
+    {
+        BitReader aReader{iBlock};
+        aReader.read(7);
+        for (int c = 0; c < 4; c++)
+        {
+            oStart.channels[c] = static_cast<int>(aReader.read(7));
+            oEnd.channels[c] = static_cast<int>(aReader.read(7));
+        }
+        oStart.shared = static_cast<int>(aReader.read(1));
+        oEnd.shared = static_cast<int>(aReader.read(1));
+        oIndices[0] = static_cast<uint8_t>(aReader.read(3));
+        for (int i = 1; i < TEXELS; i++)
+        {
+            oIndices[i] = static_cast<uint8_t>(aReader.read(4));
+        }
+    }
+
+    // swaps the endpoints when the first index would need its highest bit
+    void writeBc7BlockAnchored(Bc7Endpoint iStart, Bc7Endpoint iEnd, uint8_t ioIndices[TEXELS], uint8_t *oBlock)
+    {
+        if (ioIndices[0] >= 8)
+        {
+            std::swap(iStart, iEnd);
+            for (int i = 0; i < TEXELS; i++)
+            {
+                ioIndices[i] = static_cast<uint8_t>(15 - ioIndices[i]);
+            }
+        }
+        writeBc7Block(iStart, iEnd, ioIndices, oBlock);
+    }
+
+    void encodeBc7Block(const Block &iBlock, uint8_t *oBlock)
+    {
+        glm::vec4 aStart, aEnd;
+        boundingEndpoints(iBlock, 4, aStart, aEnd);
+
+        Bc7Endpoint aBestStart = {}, aBestEnd = {};
+        uint8_t aBestIndices[TEXELS] = {};
+        float aBestError = FLT_MAX;
+        for (int aIteration = 0; aIteration < 3; aIteration++)
+        {
+            Bc7Endpoint aQuantizedStart = quantizeBc7Endpoint(aStart);
+            Bc7Endpoint aQuantizedEnd = quantizeBc7Endpoint(aEnd);
+            uint8_t aIndices[TEXELS];
+            float aError = chooseBc7Indices(iBlock, aQuantizedStart, aQuantizedEnd, aIndices);
+            if (aError < aBestError)
+            {
+                aBestError = aError;
+                aBestStart = aQuantizedStart;
+                aBestEnd = aQuantizedEnd;
+                std::copy(aIndices, aIndices + TEXELS, aBestIndices);
+            }
+
+            float aFactors[TEXELS];
+            for (int i = 0; i < TEXELS; i++)
+            {
+                aFactors[i] = BC7_WEIGHTS[aIndices[i]] / 64.0f;
+            }
+            if (aError == 0.0f || !fitEndpoints(iBlock, aFactors, aStart, aEnd))
+            {
+                break;
+            }
+        }
+        writeBc7BlockAnchored(aBestStart, aBestEnd, aBestIndices, oBlock);
+    }
+
+    void encodeBlock(const Block &iBlock, Image::Encoding iEncoding, int iChannels, uint8_t *oBlock)
+    {
+        switch (iEncoding)
+        {
+        case Image::Encoding::BC1:
+            encodeColorBlock(iBlock, oBlock);
+            break;
+        case Image::Encoding::BC3:
+            encodeChannelBlock(iBlock, 3, oBlock);
+            encodeColorBlock(iBlock, oBlock + 8);
+            break;
+        case Image::Encoding::BC5:
+            // red and green, or grey and alpha
+            encodeChannelBlock(iBlock, 0, oBlock);
+            encodeChannelBlock(iBlock, iChannels == 2 ? 3 : 1, oBlock + 8);
+            break;
+        case Image::Encoding::BC7:
+            encodeBc7Block(iBlock, oBlock);
+            break;
+        default:
+            break;
+        }
+    }
+
+    // the first iRows rows of texels of the blocks in reverse order
+    void flipColorRows(uint8_t *ioBlock, int iRows)
+    {
+        std::reverse(ioBlock + 4, ioBlock + 4 + iRows);
+    }
+
+    void flipValueRows(uint8_t *ioBlock, int iRows)
+    {
+        uint64_t aIndices = 0;
+        for (int i = 0; i < 6; i++)
+        {
+            aIndices |= static_cast<uint64_t>(ioBlock[2 + i]) << (i * 8);
+        }
+        // 12 bits per row
+        uint64_t aFlipped = aIndices;
+        for (int y = 0; y < iRows; y++)
+        {
+            uint64_t aRow = (aIndices >> (y * 12)) & 0xFFF;
+            int aTarget = iRows - 1 - y;
+            aFlipped = (aFlipped & ~(0xFFFull << (aTarget * 12))) | (aRow << (aTarget * 12));
+        }
+        for (int i = 0; i < 6; i++)
+        {
+            ioBlock[2 + i] = static_cast<uint8_t>(aFlipped >> (i * 8));
+        }
+    }
+
+    void flipBc7Rows(uint8_t *ioBlock, int iRows)
+    {
+        Bc7Endpoint aStart, aEnd;
+        uint8_t aIndices[TEXELS];
+        readBc7Block(ioBlock, aStart, aEnd, aIndices);
+        uint8_t aFlipped[TEXELS];
+        std::copy(aIndices, aIndices + TEXELS, aFlipped);
+        for (int y = 0; y < iRows; y++)
+        {
+            std::copy(aIndices + y * BlockCompression::BLOCK_SIZE, aIndices + (y + 1) * BlockCompression::BLOCK_SIZE,
+                      aFlipped + (iRows - 1 - y) * BlockCompression::BLOCK_SIZE);
+        }
+        writeBc7BlockAnchored(aStart, aEnd, aFlipped, ioBlock);
+    }
+
+    void flipBlockRows(uint8_t *ioBlock, Image::Encoding iEncoding, int iRows)
+    {
+        switch (iEncoding)
+        {
+        case Image::Encoding::BC1:
+            flipColorRows(ioBlock, iRows);
+            break;
+        case Image::Encoding::BC3:
+            flipValueRows(ioBlock, iRows);
+            flipColorRows(ioBlock + 8, iRows);
+            break;
+        case Image::Encoding::BC5:
+            flipValueRows(ioBlock, iRows);
+            flipValueRows(ioBlock + 8, iRows);
+            break;
+        case Image::Encoding::BC7:
+            flipBc7Rows(ioBlock, iRows);
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+size_t BlockCompression::GetBlockBytes(Image::Encoding iEncoding)
+{
+    switch (iEncoding)
+    {
+    case Image::Encoding::BC1:
+        return 8;
+    case Image::Encoding::BC3:
+    case Image::Encoding::BC5:
+    case Image::Encoding::BC7:
+        return 16;
+    default:
+        return 0;
+    }
+}
+
+int BlockCompression::GetChannels(Image::Encoding iEncoding)
+{
+    switch (iEncoding)
+    {
+    case Image::Encoding::BC1:
+        return 3;
+    case Image::Encoding::BC5:
+        return 2;
+    default:
+        return 4;
+    }
+}
+
+size_t BlockCompression::GetLevelSize(Image::Encoding iEncoding, int iChannels, int iWidth, int iHeight)
+{
+    if (iEncoding == Image::Encoding::RAW)
+    {
+        return static_cast<size_t>(iWidth) * iHeight * iChannels;
+    }
+    size_t aBlocksX = static_cast<size_t>(iWidth + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    size_t aBlocksY = static_cast<size_t>(iHeight + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    return aBlocksX * aBlocksY * GetBlockBytes(iEncoding);
+}
+
+std::optional<Image> BlockCompression::Encode(const Image &iImage, Image::Encoding iEncoding)
+{
+    if (iImage.encoding != Image::Encoding::RAW || iEncoding == Image::Encoding::RAW || iImage.channels < 1 || iImage.channels > 4 ||
+        iImage.width <= 0 || iImage.height <= 0 || iImage.levels.empty())
+    {
+        return {};
+    }
+
+    Image aResult;
+    aResult.width = iImage.width;
+    aResult.height = iImage.height;
+    aResult.channels = GetChannels(iEncoding);
+    aResult.encoding = iEncoding;
+    aResult.levels.resize(iImage.levels.size());
+
+    size_t aBlockBytes = GetBlockBytes(iEncoding);
+    for (size_t aLevel = 0; aLevel < iImage.levels.size(); aLevel++)
+    {
+        int aWidth = std::max(1, iImage.width >> aLevel);
+        int aHeight = std::max(1, iImage.height >> aLevel);
+        if (iImage.levels[aLevel].size() < GetLevelSize(Image::Encoding::RAW, iImage.channels, aWidth, aHeight))
+        {
+            return {};
+        }
+
+        int aBlocksX = (aWidth + BLOCK_SIZE - 1) / BLOCK_SIZE;
+        int aBlocksY = (aHeight + BLOCK_SIZE - 1) / BLOCK_SIZE;
+        std::vector<unsigned char> &aBlocks = aResult.levels[aLevel];
+        aBlocks.assign(GetLevelSize(iEncoding, aResult.channels, aWidth, aHeight), 0);
+        const unsigned char *aTexels = iImage.levels[aLevel].data();
+        ThreadPool::Get().ParallelFor(static_cast<size_t>(aBlocksY), [&](size_t y)
+                                      {
+                                          for (int x = 0; x < aBlocksX; x++)
+                                          {
+                                              Block aBlock = loadBlock(aTexels, iImage.channels, aWidth, aHeight, x, static_cast<int>(y));
+                                              encodeBlock(aBlock, iEncoding, iImage.channels, aBlocks.data() + (y * aBlocksX + x) * aBlockBytes);
+                                          } });
+    }
+    return aResult;
+}
+
+bool BlockCompression::FlipVertically(Image &ioImage)
+{
+    size_t aBlockBytes = GetBlockBytes(ioImage.encoding);
+    if (aBlockBytes == 0)
+    {
+        return false;
+    }
+
+    // everything is checked before the first block moves
+    for (size_t aLevel = 0; aLevel < ioImage.levels.size(); aLevel++)
+    {
+        int aWidth = std::max(1, ioImage.width >> aLevel);
+        int aHeight = std::max(1, ioImage.height >> aLevel);
+        const std::vector<unsigned char> &aBlocks = ioImage.levels[aLevel];
+        if ((aHeight > BLOCK_SIZE && aHeight % BLOCK_SIZE != 0) || aBlocks.size() < GetLevelSize(ioImage.encoding, ioImage.channels, aWidth, aHeight))
+        {
+            return false;
+        }
+        for (size_t aOffset = 0; ioImage.encoding == Image::Encoding::BC7 && aOffset < aBlocks.size(); aOffset += aBlockBytes)
+        {
+            if ((aBlocks[aOffset] & 0x7F) != BC7_MODE_6)
+            {
+                return false;
+            }
+        }
+    }
+
+    for (size_t aLevel = 0; aLevel < ioImage.levels.size(); aLevel++)
+    {
+        int aWidth = std::max(1, ioImage.width >> aLevel);
+        int aHeight = std::max(1, ioImage.height >> aLevel);
+        size_t aRowBytes = static_cast<size_t>(aWidth + BLOCK_SIZE - 1) / BLOCK_SIZE * aBlockBytes;
+        size_t aBlocksY = static_cast<size_t>(aHeight + BLOCK_SIZE - 1) / BLOCK_SIZE;
+        unsigned char *aBlocks = ioImage.levels[aLevel].data();
+        for (size_t y = 0; y < aBlocksY / 2; y++)
+        {
+            std::swap_ranges(aBlocks + y * aRowBytes, aBlocks + (y + 1) * aRowBytes, aBlocks + (aBlocksY - 1 - y) * aRowBytes);
+        }
+        int aRows = std::min(aHeight, BLOCK_SIZE);
+        for (size_t aOffset = 0; aOffset < aBlocksY * aRowBytes; aOffset += aBlockBytes)
+        {
+            flipBlockRows(aBlocks + aOffset, ioImage.encoding, aRows);
+        }
+    }
+    return true;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+#include "image.hpp"
+
+/**
+ * CPU encoder of the block compressed formats the GPU samples directly (BC1, BC3, BC5 and BC7), run offline
+ * by engine-cook. Every 4x4 block is fitted along the principal axis of its texels then refined by least
+ * squares on the chosen indices:
+ *   BC1  two rgb565 endpoints and 4 interpolated colors, 0.5 byte per texel
+ *   BC3  BC1 colors plus a block of 8 interpolated alphas, 1 byte per texel
+ *   BC5  two blocks of 8 interpolated values for red and green, 1 byte per texel
+ *   BC7  mode 6 only (one rgba subset, 7 bits + shared bit endpoints, 16 interpolated values), 1 byte per texel
+ * The blocks of a level are encoded in parallel on the ThreadPool.
+ */
+namespace BlockCompression
+{
+    inline constexpr int BLOCK_SIZE = 4;
+
+    // bytes per block, 0 for RAW
+    size_t GetBlockBytes(Image::Encoding iEncoding);
+    // channels of the decoded texels
+    int GetChannels(Image::Encoding iEncoding);
+    // bytes of one level of iWidth x iHeight texels (partial blocks on the edges are whole blocks)
+    size_t GetLevelSize(Image::Encoding iEncoding, int iChannels, int iWidth, int iHeight);
+
+    // encodes every level of a RAW image of 1 to 4 channels (grey is replicated on rgb), empty if it isn't one
+    std::optional<Image> Encode(const Image &iImage, Image::Encoding iEncoding);
+
+    /**
+     * Flips a block compressed image upside down by moving the rows of texels inside and across its blocks.
+     * Returns false, leaving the image untouched, for a level which height isn't a multiple of 4 (beyond the
+     * last ones of the chain) or a BC7 block in another mode than 6.
+     */
+    bool FlipVertically(Image &ioImage);
+};
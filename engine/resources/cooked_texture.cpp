@@ -0,0 +1,197 @@
+#include "cooked_texture.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+#include <stb_image.h>
+
+#include "ktx2.hpp"
+#include "block_compression.hpp"
+#include "helpers/log.hpp"
+
+namespace
+{
+    uint32_t levelSize(uint32_t iSize, uint32_t iLevel)
+    {
+        return std::max(1u, iSize >> iLevel);
+    }
+
+    // 2x2 box filter, the last row/column is repeated on odd sizes
+    std::vector<unsigned char> downsample(const std::vector<unsigned char> &iTexels, uint32_t iWidth, uint32_t iHeight, uint32_t iChannels)
+    {
+        uint32_t aWidth = std::max(1u, iWidth / 2);
+        uint32_t aHeight = std::max(1u, iHeight / 2);
+        std::vector<unsigned char> aTexels(static_cast<size_t>(aWidth) * aHeight * iChannels);
+
+        for (uint32_t y = 0; y < aHeight; y++)
+        {
+            uint32_t aY0 = std::min(y * 2, iHeight - 1);
+            uint32_t aY1 = std::min(y * 2 + 1, iHeight - 1);
+            for (uint32_t x = 0; x < aWidth; x++)
+            {
+                uint32_t aX0 = std::min(x * 2, iWidth - 1);
+                uint32_t aX1 = std::min(x * 2 + 1, iWidth - 1);
+                for (uint32_t c = 0; c < iChannels; c++)
+                {
+                    unsigned int aSum = iTexels[(static_cast<size_t>(aY0) * iWidth + aX0) * iChannels + c] +
+                                        iTexels[(static_cast<size_t>(aY0) * iWidth + aX1) * iChannels + c] +
+                                        iTexels[(static_cast<size_t>(aY1) * iWidth + aX0) * iChannels + c] +
+                                        iTexels[(static_cast<size_t>(aY1) * iWidth + aX1) * iChannels + c];
+                    aTexels[(static_cast<size_t>(y) * aWidth + x) * iChannels + c] = static_cast<unsigned char>((aSum + 2) / 4);
+                }
+            }
+        }
+        return aTexels;
+    }
+
+    // averaged normals are shorter than 1, the shaders expect unit ones
+    void renormalize(std::vector<unsigned char> &ioTexels, uint32_t iChannels)
+    {
+        for (size_t i = 0; i + 2 < ioTexels.size(); i += iChannels)
+        {
+            float aNormal[3];
+            for (int c = 0; c < 3; c++)
+            {
+                aNormal[c] = ioTexels[i + c] / 127.5f - 1.0f;
+            }
+            float aLength = std::sqrt(aNormal[0] * aNormal[0] + aNormal[1] * aNormal[1] + aNormal[2] * aNormal[2]);
+            if (aLength == 0.0f)
+            {
+                continue;
+            }
+            for (int c = 0; c < 3; c++)
+            {
+                ioTexels[i + c] = static_cast<unsigned char>(std::clamp(std::lround((aNormal[c] / aLength + 1.0f) * 127.5f), 0l, 255l));
+            }
+        }
+    }
+
+    uint32_t settingFlags(const CookedTexture::Settings &iSettings)
+    {
+        return (iSettings.normalMap ? CookedTexture::SETTING_NORMAL_MAP : 0u) | (iSettings.highQuality ? CookedTexture::SETTING_HIGH_QUALITY : 0u);
+    }
+}
+
+std::string CookedTexture::GetCookedPath(const std::string &iSourcePath)
+{
+    return iSourcePath + "." + EXTENSION;
+}
+
+bool CookedTexture::IsFresh(const std::string &iCookedPath, const std::string &iSourcePath, const std::optional<Settings> &iSettings)
+{
+    KTX2::Header aHeader;
+    std::string aKeyValueData;
+    {
+        std::ifstream aCooked(iCookedPath, std::ios::binary);
+        if (!aCooked.read(reinterpret_cast<char *>(&aHeader), sizeof(aHeader)) ||
+            std::memcmp(aHeader.identifier, KTX2::IDENTIFIER, sizeof(KTX2::IDENTIFIER)) != 0)
+        {
+            return false;
+        }
+        aKeyValueData.resize(aHeader.kvdByteLength);
+        if (!aCooked.seekg(aHeader.kvdByteOffset) || !aCooked.read(aKeyValueData.data(), static_cast<std::streamsize>(aKeyValueData.size())))
+        {
+            return false;
+        }
+    }
+
+    std::string_view aValue = KTX2::FindValue(aKeyValueData, STAMP_KEY);
+    Stamp aStamp;
+    if (aValue.size() != sizeof(aStamp))
+    {
+        return false;
+    }
+    std::memcpy(&aStamp, aValue.data(), sizeof(aStamp));
+    if (aStamp.version != VERSION || (iSettings && aStamp.settings != settingFlags(*iSettings)))
+    {
+        return false;
+    }
+
+    bool aRestamped = false;
+    if (!tools::IsStampFresh(aStamp.source, iSourcePath, aRestamped))
+    {
+        return false;
+    }
+    if (aRestamped)
+    {
+        std::fstream aCooked(iCookedPath, std::ios::binary | std::ios::in | std::ios::out);
+        aCooked.seekp(aHeader.kvdByteOffset + (aValue.data() - aKeyValueData.data()));
+        aCooked.write(reinterpret_cast<const char *>(&aStamp), sizeof(aStamp));
+    }
+    return true;
+}
+
+Image::Encoding CookedTexture::ChooseEncoding(const Image &iImage, const Settings &iSettings)
+{
+    if (iSettings.normalMap)
+    {
+        return Image::Encoding::BC5;
+    }
+
+    // images saved with an alpha channel are often opaque, they go to BC1 too
+    bool aAlpha = iImage.channels == 2;
+    if (iImage.channels == 4 && !iImage.levels.empty())
+    {
+        const std::vector<unsigned char> &aTexels = iImage.levels[0];
+        for (size_t i = 3; i < aTexels.size() && !aAlpha; i += 4)
+        {
+            aAlpha = aTexels[i] != 255;
+        }
+    }
+
+    if (iSettings.highQuality)
+    {
+        return Image::Encoding::BC7;
+    }
+    return aAlpha ? Image::Encoding::BC3 : Image::Encoding::BC1;
+}
+
+bool CookedTexture::Cook(const std::string &iSourcePath, const std::string &iDestination, const Settings &iSettings)
+{
+    Stamp aStamp = {};
+    aStamp.version = VERSION;
+    aStamp.settings = settingFlags(iSettings);
+    if (!tools::StampSource(aStamp.source, iSourcePath))
+    {
+        ERROR("Failed to read the source of the cooked texture: " << iSourcePath);
+        return false;
+    }
+
+    int aWidth, aHeight, aChannels;
+    unsigned char *aData = stbi_load(iSourcePath.c_str(), &aWidth, &aHeight, &aChannels, 0);
+    if (!aData)
+    {
+        ERROR("Failed to decode texture, param: " << iSourcePath);
+        return false;
+    }
+
+    Image aImage;
+    aImage.width = aWidth;
+    aImage.height = aHeight;
+    aImage.channels = aChannels;
+    aImage.levels.emplace_back(aData, aData + static_cast<size_t>(aWidth) * aHeight * aChannels);
+    stbi_image_free(aData);
+
+    uint32_t aChannelCount = static_cast<uint32_t>(aChannels);
+    for (uint32_t aLevel = 1; (std::max(aWidth, aHeight) >> aLevel) > 0; aLevel++)
+    {
+        aImage.levels.push_back(downsample(aImage.levels.back(), levelSize(aWidth, aLevel - 1), levelSize(aHeight, aLevel - 1), aChannelCount));
+        if (iSettings.normalMap && aChannelCount >= 3)
+        {
+            renormalize(aImage.levels.back(), aChannelCount);
+        }
+    }
+
+    std::optional<Image> aEncoded = BlockCompression::Encode(aImage, ChooseEncoding(aImage, iSettings));
+    if (!aEncoded)
+    {
+        ERROR("Failed to encode texture: " << iSourcePath);
+        return false;
+    }
+
+    std::string aStampBytes(reinterpret_cast<const char *>(&aStamp), sizeof(aStamp));
+    return KTX2::Write(iDestination, *aEncoded, {{STAMP_KEY, aStampBytes}});
+}
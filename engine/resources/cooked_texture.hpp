@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+
+#include "image.hpp"
+#include "source_stamp.hpp"
+
+/**
+ * Cooked textures: images (.jpg, .png, ...) encoded offline into block compressed formats with their whole
+ * mip chain, written next to the source as KTX 2.0 (see ktx2.hpp). Reading one is a single mapping through
+ * KTX2Loader, uploading it is one glCompressedTexImage2D per level without any decoding nor glGenerateMipmap,
+ * and it takes 4 to 8 times less memory on the GPU than the texels.
+ *
+ * The encoding follows the content (see ChooseEncoding): BC5 for the normal maps, BC1 for opaque colors and
+ * BC3 for colors with alpha, or BC7 for both in high quality. The stamp of the source and the settings the
+ * file was cooked with are in the key/value data of the file.
+ */
+namespace CookedTexture
+{
+    inline constexpr char EXTENSION[] = "ktx2";
+    // key of the Stamp in the key/value data of the cooked file
+    inline constexpr char STAMP_KEY[] = "EngineCookedTexture";
+    // bump whenever the encoding of the textures changes
+    inline constexpr uint32_t VERSION = 2;
+
+    // bits of Stamp::settings
+    inline constexpr uint32_t SETTING_NORMAL_MAP = 1u << 0;
+    inline constexpr uint32_t SETTING_HIGH_QUALITY = 1u << 1;
+
+    struct Stamp
+    {
+        uint32_t version;
+        // SETTING_* the file was cooked with, they decide its encoding
+        uint32_t settings;
+        SourceStamp source;
+    };
+
+    struct Settings
+    {
+        // x and y of a tangent space normal map in BC5, the shaders rebuild z
+        bool normalMap = false;
+        // BC7 for the colors: better gradients and alpha than BC1 / BC3, twice the size of BC1 and slower to encode
+        bool highQuality = false;
+    };
+
+    std::string GetCookedPath(const std::string &iSourcePath);
+
+    /**
+     * Checks the cooked file against its source, re-stamping it when only the modification time changed.
+     * When iSettings is given, a file cooked with other settings (so another encoding) is stale too.
+     */
+    bool IsFresh(const std::string &iCookedPath, const std::string &iSourcePath, const std::optional<Settings> &iSettings = std::nullopt);
+
+    Image::Encoding ChooseEncoding(const Image &iImage, const Settings &iSettings);
+
+    // decodes the source, builds its mip chain and writes it block compressed, doesn't need the GL context
+    bool Cook(const std::string &iSourcePath, const std::string &iDestination, const Settings &iSettings = {});
+};
@@ -1,23 +1,34 @@
 #include "fileloader.hpp"
 
+#include "cooked_texture.hpp"
+#include "texture_cache.hpp"
+#include "block_compression.hpp"
+#include "loaders/texture_loader.hpp"
 #include "render/mesh.hpp"
+#include "render/gl_state.hpp"
+
+#include <stb_image.h>
+
+// EXT_texture_compression_s3tc isn't core but every desktop driver exposes it, the loader may not define it
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
 
 #define REGISTER_VERTEX(temp_indices, temp_vertices, registered_vertices, vert, positions, normals, texcoords) \
     {                                                                                                          \
-        if ((registered_vertices).find((vert).token) == (registered_vertices).end())                           \
+        auto [index, inserted] = (registered_vertices).TryEmplace((vert), (temp_vertices).size());             \
+        if (inserted)                                                                                          \
         {                                                                                                      \
             (temp_vertices).push_back({                                                                        \
                 .position = (positions)[(vert).v],                                                             \
                 .normal = (normals)[(vert).vn],                                                                \
                 .tcoords = (texcoords)[(vert).vt],                                                             \
             });                                                                                                \
-            (registered_vertices)[(vert).token] = (temp_vertices).size() - 1;                                  \
-            (temp_indices).push_back((temp_vertices).size() - 1);                                              \
-        }                                                                                                      \
-        else                                                                                                   \
-        {                                                                                                      \
-            (temp_indices).push_back((registered_vertices)[(vert).token]);                                     \
         }                                                                                                      \
+        (temp_indices).push_back(*index);                                                                      \
     }
 
 struct FaceIndex
@@ -25,7 +36,23 @@ struct FaceIndex
     int v = -1;
     int vt = 0;
     int vn = 0;
-    std::string token = "";
+
+    bool operator==(const FaceIndex &other) const noexcept
+    {
+        return v == other.v && vt == other.vt && vn == other.vn;
+    }
+};
+
+struct FaceIndexHash
+{
+    std::size_t operator()(const FaceIndex &f) const noexcept
+    {
+        // mix bits (boost::hash_combine style)
+        std::size_t seed = std::hash<int>{}(f.v);
+        seed ^= std::hash<int>{}(f.vt) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+        seed ^= std::hash<int>{}(f.vn) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+        return seed;
+    }
 };
 
 struct Object
@@ -68,7 +95,8 @@ std::vector<Mesh> tools::LoadFileOBJ(const std::string &iFilepath)
     std::vector<glm::vec3> normals;
     std::vector<glm::vec2> texcoords;
 
-    std::unordered_map<std::string, int> registered_vertices = {};
+    // keyed by the parsed indices rather than the raw token text, so no string is built per face corner
+    FlatHashMap<FaceIndex, unsigned int, FaceIndexHash> registered_vertices = {};
 
     // DEBUG("Trying to load data from: " << iFilepath);
     std::string line;
@@ -151,19 +179,178 @@ std::vector<Mesh> tools::LoadFileOBJ(const std::string &iFilepath)
     }
 
     std::vector<Mesh> meshes;
-    for (const Object &object : objects)
+    for (Object &object : objects)
     {
         if (object.vertices.size() == 0 || object.indices.size() == 0)
         {
             ERROR("vertices/indices are empty in object: " << object.name);
             return {};
         }
-        meshes.push_back(Mesh(object.vertices, object.indices, {}));
+        meshes.push_back(Mesh(std::move(object.vertices), std::move(object.indices), {}));
     }
     // DEBUG(meshes.size() << " meshes loaded");
     return meshes;
 }
 
+std::optional<Texture> tools::LoadTexture(const std::string &path)
+{
+    return TextureCache::Get().Load(path);
+}
+
+std::optional<Image> tools::DecodeTexture(const std::string &path)
+{
+    // already in a GPU format (.ktx2, .dds)
+    if (std::optional<Image> image = Loader::ParseTexture(path))
+    {
+        return image;
+    }
+
+    // encoded offline by engine-cook, mips included
+    std::string cookedPath = CookedTexture::GetCookedPath(path);
+    if (CookedTexture::IsFresh(cookedPath, path))
+    {
+        std::optional<Image> image = Loader::ParseTexture(cookedPath);
+        if (image)
+        {
+            return image;
+        }
+    }
+
+    // stbi_set_flip_vertically_on_load(true); // not sure why I need to flip and sometimes no, we'll look into it later on
+
+    Image image;
+    unsigned char *data = stbi_load(path.c_str(), &image.width, &image.height, &image.channels, 0);
+    if (!data)
+    {
+        ERROR("Failed to load texture, param: " << path);
+        return {};
+    }
+    image.levels.emplace_back(data, data + static_cast<size_t>(image.width) * image.height * image.channels);
+    stbi_image_free(data);
+    return image;
+}
+
+GLenum tools::GetCompressedFormat(Image::Encoding encoding)
+{
+    switch (encoding)
+    {
+    case Image::Encoding::BC1:
+        return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+    case Image::Encoding::BC3:
+        return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+    case Image::Encoding::BC5:
+        return GL_COMPRESSED_RG_RGTC2;
+    case Image::Encoding::BC7:
+        return GL_COMPRESSED_RGBA_BPTC_UNORM;
+    default:
+        return 0;
+    }
+}
+
+GLTexture tools::UploadTexture(const Image &image, const std::string &path)
+{
+    GLenum format = 0;
+    if (image.encoding != Image::Encoding::RAW)
+        format = GetCompressedFormat(image.encoding);
+    else if (image.channels == 1)
+        format = GL_RED;
+    else if (image.channels == 3)
+        format = GL_RGB;
+    else if (image.channels == 4)
+        format = GL_RGBA;
+    if (format == 0)
+    {
+        ERROR("Unsupported texture format, param: " << path);
+        return {};
+    }
+
+    GLTexture texture = GLTexture::Create();
+    GLStateCache::Get().BindTexture(0, GL_TEXTURE_2D, texture.Get());
+
+    if (image.encoding != Image::Encoding::RAW)
+    {
+        // the blocks go as they are, the GPU samples them compressed
+        for (size_t level = 0; level < image.levels.size(); level++)
+        {
+            int width = std::max(1, image.width >> level);
+            int height = std::max(1, image.height >> level);
+            GLsizei size = static_cast<GLsizei>(BlockCompression::GetLevelSize(image.encoding, image.channels, width, height));
+            glCompressedTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(level), format, width, height, 0, size, image.levels[level].data());
+        }
+    }
+    else
+    {
+        // rows of RGB levels are not 4 bytes aligned
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        for (size_t level = 0; level < image.levels.size(); level++)
+        {
+            int width = std::max(1, image.width >> level);
+            int height = std::max(1, image.height >> level);
+            glTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(level), format, width, height, 0, format, GL_UNSIGNED_BYTE, image.levels[level].data());
+        }
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    }
+
+    // only the sources that weren't cooked come without their mip chain, compressed formats can't generate one
+    if (image.levels.size() == 1 && image.encoding == Image::Encoding::RAW)
+    {
+        glGenerateMipmap(GL_TEXTURE_2D);
+    }
+    else
+    {
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(image.levels.size() - 1));
+    }
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    GLStateCache::Get().BindTexture(0, GL_TEXTURE_2D, 0);
+
+    return texture;
+}
+
+void tools::UploadMeshes(std::vector<Mesh> &meshes)
+{
+    std::vector<Texture *> textures;
+    std::vector<std::string> paths;
+    for (Mesh &mesh : meshes)
+    {
+        for (Material &material : mesh.materials)
+        {
+            for (Texture *texture : material.GetTextures())
+            {
+                if (texture->id == 0 && !texture->path.empty())
+                {
+                    textures.push_back(texture);
+                    paths.push_back(texture->path);
+                }
+            }
+        }
+    }
+
+    // decoded in parallel, shared files only once
+    std::vector<std::optional<Texture>> loaded = TextureCache::Get().Load(paths);
+    for (size_t i = 0; i < textures.size(); i++)
+    {
+        if (loaded[i])
+        {
+            textures[i]->id = loaded[i]->id;
+        }
+        else
+        {
+            // nothing to bind
+            textures[i]->type = TextureType::UNKNOWN;
+        }
+    }
+
+    for (Mesh &mesh : meshes)
+    {
+        mesh.SetupMesh(mesh.HasTangents());
+    }
+}
+
 FaceIndex tools::parseFaceVertex(const std::string &token)
 {
     FaceIndex fi;
@@ -186,30 +373,25 @@ FaceIndex tools::parseFaceVertex(const std::string &token)
         fi.vn = std::stoi(index) - 1;
     }
 
-    fi.token = token;
-
     return fi;
 }
 
 glm::vec2 tools::ParseVec2(const std::string &line, size_t startPos)
 {
     glm::vec2 result(0.0f);
-    const char *ptr = line.c_str() + startPos;
-    char *endPtr = nullptr;
-
-    result.x = std::strtof(ptr, &endPtr);
-    if (ptr == endPtr)
-    {
-        throw std::runtime_error("Failed to parse X component from line: " + line);
-    }
-    ptr = endPtr;
+    std::string_view data = std::string_view(line).substr(std::min(startPos, line.size()));
 
-    result.y = std::strtof(ptr, &endPtr);
-    if (ptr == endPtr)
+    const char *components[] = {"X", "Y"};
+    for (int i = 0; i < 2; i++)
     {
-        throw std::runtime_error("Failed to parse Y component from line: " + line);
+        skipSpaces(data);
+        std::optional<float> number = ParseFloat(data);
+        if (!number)
+        {
+            throw std::runtime_error("Failed to parse " + std::string(components[i]) + " component from line: " + line);
+        }
+        result[i] = *number;
     }
-    ptr = endPtr;
 
     return result;
 }
@@ -217,30 +399,29 @@ glm::vec2 tools::ParseVec2(const std::string &line, size_t startPos)
 glm::vec3 tools::ParseVec3(const std::string &line, size_t startPos)
 {
     glm::vec3 result(0.0f);
-    const char *ptr = line.c_str() + startPos;
-    char *endPtr = nullptr;
+    std::string_view data = std::string_view(line).substr(std::min(startPos, line.size()));
 
-    result.x = std::strtof(ptr, &endPtr);
-    if (ptr == endPtr)
+    const char *components[] = {"X", "Y", "Z"};
+    for (int i = 0; i < 3; i++)
     {
-        throw std::runtime_error("Failed to parse X component from line: " + line);
+        skipSpaces(data);
+        std::optional<float> number = ParseFloat(data);
+        if (!number)
+        {
+            throw std::runtime_error("Failed to parse " + std::string(components[i]) + " component from line: " + line);
+        }
+        result[i] = *number;
     }
-    ptr = endPtr;
 
-    result.y = std::strtof(ptr, &endPtr);
-    if (ptr == endPtr)
-    {
-        throw std::runtime_error("Failed to parse Y component from line: " + line);
-    }
-    ptr = endPtr;
+    return result;
+}
 
-    result.z = std::strtof(ptr, &endPtr);
-    if (ptr == endPtr)
+void tools::skipSpaces(std::string_view &data)
+{
+    while (!data.empty() && std::isspace(static_cast<unsigned char>(data.front())))
     {
-        throw std::runtime_error("Failed to parse Z component from line: " + line);
+        data.remove_prefix(1);
     }
-
-    return result;
 }
 
 std::string tools::ltrim(const std::string &s)
@@ -6,23 +6,40 @@
 #include <sstream>
 #include <optional>
 #include <iostream>
+#include <algorithm>
 #include <filesystem>
+#include <string_view>
 #include <unordered_map>
 
 #include <glm/glm.hpp>
 
+#include "image.hpp"
+#include "render/gl_object.hpp"
+#include "number_parser.hpp"
+#include "helpers/flat_hash_map.hpp"
 #include "helpers/log.hpp"
 
 class Mesh;
+struct Texture;
 struct FaceIndex;
 
 namespace tools
 {
     std::string LoadFile(const std::string &iFilepath);
     std::vector<Mesh> LoadFileOBJ(const std::string &iFilepath);
+    std::optional<Texture> LoadTexture(const std::string &path);
+    // CPU side of LoadTexture (texture loader, cooked texture or image decoding), doesn't need the GL context
+    std::optional<Image> DecodeTexture(const std::string &path);
+    // GL internal format of a block compressed encoding, 0 for RAW
+    GLenum GetCompressedFormat(Image::Encoding encoding);
+    // empty on failure
+    GLTexture UploadTexture(const Image &image, const std::string &path);
+    // GL side of Loader::Load: uploads the textures referenced by the materials, then the meshes
+    void UploadMeshes(std::vector<Mesh> &meshes);
     FaceIndex parseFaceVertex(const std::string &token);
     glm::vec2 ParseVec2(const std::string &line, size_t startPos = 0);
     glm::vec3 ParseVec3(const std::string &line, size_t startPos = 0);
+    void skipSpaces(std::string_view &data);
 
     std::string ltrim(const std::string &s);
     std::string rtrim(const std::string &s);
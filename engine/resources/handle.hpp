@@ -0,0 +1,39 @@
+#pragma once
+
+#include <chrono>
+#include <future>
+#include <memory>
+
+/**
+ * Resource being loaded by ResourceManager::LoadAsync.
+ * It becomes ready on the GL thread once every upload of the resource is done, Get returns nullptr until then.
+ */
+template <typename T>
+class ResourceHandle
+{
+public:
+    ResourceHandle() = default;
+    explicit ResourceHandle(std::shared_future<std::shared_ptr<T>> iFuture) : m_future(std::move(iFuture)) {}
+
+    bool IsValid() const { return m_future.valid(); }
+
+    bool IsReady() const
+    {
+        return m_future.valid() && m_future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+    }
+
+    // rethrows the error of a failed load
+    std::shared_ptr<T> Get() const
+    {
+        return IsReady() ? m_future.get() : nullptr;
+    }
+
+    // blocks until the resource is ready, only from a thread that isn't the GL one (it does the uploads)
+    std::shared_ptr<T> Wait() const
+    {
+        return m_future.get();
+    }
+
+private:
+    std::shared_future<std::shared_ptr<T>> m_future;
+};
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * Decoded texels of a texture, produced on any thread and uploaded on the GL thread.
+ */
+struct Image
+{
+    // how the levels are stored, the block compressed ones hold 4x4 texel blocks row after row (see BlockCompression)
+    enum class Encoding : uint32_t
+    {
+        RAW,
+        // rgb, 8 bytes per block
+        BC1,
+        // rgba, 16 bytes per block
+        BC3,
+        // two channels (normal maps), 16 bytes per block
+        BC5,
+        // rgba, 16 bytes per block
+        BC7,
+    };
+
+    int width = 0;
+    int height = 0;
+    // of the texels once decoded: 3 for BC1, 2 for BC5, 4 for BC3 and BC7
+    int channels = 0;
+    Encoding encoding = Encoding::RAW;
+    // levels[0] is the full size image, cooked textures come with the rest of their mip chain
+    std::vector<std::vector<unsigned char>> levels;
+};
@@ -0,0 +1,355 @@
+#include "ktx2.hpp"
+
+#include <cstring>
+#include <fstream>
+#include <numeric>
+#include <algorithm>
+#include <filesystem>
+#include <system_error>
+
+#include "block_compression.hpp"
+#include "source_stamp.hpp"
+#include "helpers/log.hpp"
+
+namespace
+{
+    // values of the Khronos Data Format Specification used by the descriptors
+    constexpr uint32_t KHR_DF_MODEL_RGBSDA = 1;
+    constexpr uint32_t KHR_DF_MODEL_BC1A = 128;
+    constexpr uint32_t KHR_DF_MODEL_BC3 = 130;
+    constexpr uint32_t KHR_DF_MODEL_BC5 = 132;
+    constexpr uint32_t KHR_DF_MODEL_BC7 = 134;
+    constexpr uint32_t KHR_DF_PRIMARIES_BT709 = 1;
+    constexpr uint32_t KHR_DF_TRANSFER_LINEAR = 1;
+    constexpr uint32_t KHR_DF_VERSION = 2;
+    constexpr uint32_t KHR_DF_CHANNEL_ALPHA = 15;
+
+    struct Sample
+    {
+        uint32_t bitOffset;
+        uint32_t bitLength;
+        uint32_t channel;
+        uint32_t upper;
+    };
+
+    // bytes of a texel, or of a block for the compressed encodings
+    size_t texelBlockBytes(const Image &iImage)
+    {
+        size_t aBlockBytes = BlockCompression::GetBlockBytes(iImage.encoding);
+        return aBlockBytes != 0 ? aBlockBytes : static_cast<size_t>(iImage.channels);
+    }
+
+    // the whole data format descriptor: its total size then a single basic descriptor block
+    std::vector<uint32_t> dataFormatDescriptor(const Image &iImage)
+    {
+        uint32_t aModel = KHR_DF_MODEL_RGBSDA;
+        // texels per block minus one along x and y
+        uint32_t aBlockDimension = BlockCompression::BLOCK_SIZE - 1;
+        std::vector<Sample> aSamples;
+        switch (iImage.encoding)
+        {
+        case Image::Encoding::BC1:
+            aModel = KHR_DF_MODEL_BC1A;
+            aSamples = {{0, 64, 0, ~0u}};
+            break;
+        case Image::Encoding::BC3:
+            aModel = KHR_DF_MODEL_BC3;
+            aSamples = {{0, 64, KHR_DF_CHANNEL_ALPHA, ~0u}, {64, 64, 0, ~0u}};
+            break;
+        case Image::Encoding::BC5:
+            aModel = KHR_DF_MODEL_BC5;
+            aSamples = {{0, 64, 0, ~0u}, {64, 64, 1, ~0u}};
+            break;
+        case Image::Encoding::BC7:
+            aModel = KHR_DF_MODEL_BC7;
+            aSamples = {{0, 128, 0, ~0u}};
+            break;
+        default:
+            aBlockDimension = 0;
+            for (uint32_t c = 0; c < static_cast<uint32_t>(iImage.channels); c++)
+            {
+                aSamples.push_back({c * 8, 8, c == 3 ? KHR_DF_CHANNEL_ALPHA : c, 255});
+            }
+            break;
+        }
+
+        uint32_t aBlockSize = 24 + 16 * static_cast<uint32_t>(aSamples.size());
+        std::vector<uint32_t> aWords = {
+            4 + aBlockSize,
+            // vendor and descriptor type 0: Khronos basic descriptor
+            0,
+            KHR_DF_VERSION | (aBlockSize << 16),
+            // no flags: straight alpha
+            aModel | (KHR_DF_PRIMARIES_BT709 << 8) | (KHR_DF_TRANSFER_LINEAR << 16),
+            aBlockDimension | (aBlockDimension << 8),
+            static_cast<uint32_t>(texelBlockBytes(iImage)),
+            0,
+        };
+        for (const Sample &aSample : aSamples)
+        {
+            aWords.push_back(aSample.bitOffset | ((aSample.bitLength - 1) << 16) | (aSample.channel << 24));
+            aWords.push_back(0);
+            aWords.push_back(0);
+            aWords.push_back(aSample.upper);
+        }
+        return aWords;
+    }
+
+    // sorted by key, every entry padded on 4 bytes
+    std::string keyValueData(KTX2::KeyValues iKeyValues)
+    {
+        std::sort(iKeyValues.begin(), iKeyValues.end(), [](const auto &iA, const auto &iB)
+                  { return iA.first < iB.first; });
+
+        std::string aData;
+        for (const auto &[aKey, aValue] : iKeyValues)
+        {
+            uint32_t aLength = static_cast<uint32_t>(aKey.size() + 1 + aValue.size());
+            aData.append(reinterpret_cast<const char *>(&aLength), sizeof(aLength));
+            aData.append(aKey);
+            aData.push_back('\0');
+            aData.append(aValue);
+            aData.resize((aData.size() + 3) & ~size_t(3), '\0');
+        }
+        return aData;
+    }
+
+    size_t alignOffset(size_t iOffset, size_t iAlignment)
+    {
+        return (iOffset + iAlignment - 1) / iAlignment * iAlignment;
+    }
+}
+
+uint32_t KTX2::GetVkFormat(const Image &iImage)
+{
+    switch (iImage.encoding)
+    {
+    case Image::Encoding::BC1:
+        return VK_FORMAT_BC1_RGB_UNORM_BLOCK;
+    case Image::Encoding::BC3:
+        return VK_FORMAT_BC3_UNORM_BLOCK;
+    case Image::Encoding::BC5:
+        return VK_FORMAT_BC5_UNORM_BLOCK;
+    case Image::Encoding::BC7:
+        return VK_FORMAT_BC7_UNORM_BLOCK;
+    default:
+        break;
+    }
+
+    switch (iImage.channels)
+    {
+    case 1:
+        return VK_FORMAT_R8_UNORM;
+    case 2:
+        return VK_FORMAT_R8G8_UNORM;
+    case 3:
+        return VK_FORMAT_R8G8B8_UNORM;
+    case 4:
+        return VK_FORMAT_R8G8B8A8_UNORM;
+    default:
+        return 0;
+    }
+}
+
+bool KTX2::Write(const std::string &iPath, const Image &iImage, const KeyValues &iKeyValues)
+{
+    uint32_t aVkFormat = GetVkFormat(iImage);
+    if (aVkFormat == 0 || iImage.width <= 0 || iImage.height <= 0 || iImage.levels.empty())
+    {
+        ERROR("Texture can't be stored as KTX2: " << iPath);
+        return false;
+    }
+
+    uint32_t aLevelCount = static_cast<uint32_t>(iImage.levels.size());
+    std::vector<size_t> aLevelSizes(aLevelCount);
+    for (uint32_t aLevel = 0; aLevel < aLevelCount; aLevel++)
+    {
+        aLevelSizes[aLevel] = BlockCompression::GetLevelSize(iImage.encoding, iImage.channels, std::max(1, iImage.width >> aLevel),
+                                                             std::max(1, iImage.height >> aLevel));
+        if (iImage.levels[aLevel].size() < aLevelSizes[aLevel])
+        {
+            ERROR("Texture level is truncated, not written: " << iPath);
+            return false;
+        }
+    }
+
+    Header aHeader = {};
+    std::memcpy(aHeader.identifier, IDENTIFIER, sizeof(IDENTIFIER));
+    aHeader.vkFormat = aVkFormat;
+    aHeader.typeSize = 1;
+    aHeader.pixelWidth = static_cast<uint32_t>(iImage.width);
+    aHeader.pixelHeight = static_cast<uint32_t>(iImage.height);
+    aHeader.faceCount = 1;
+    aHeader.levelCount = aLevelCount;
+
+    std::vector<uint32_t> aDescriptor = dataFormatDescriptor(iImage);
+    std::string aKeyValueData = keyValueData(iKeyValues);
+    size_t aOffset = sizeof(Header) + aLevelCount * sizeof(LevelIndex);
+    aHeader.dfdByteOffset = static_cast<uint32_t>(aOffset);
+    aHeader.dfdByteLength = static_cast<uint32_t>(aDescriptor.size() * sizeof(uint32_t));
+    aOffset += aHeader.dfdByteLength;
+    if (!aKeyValueData.empty())
+    {
+        aHeader.kvdByteOffset = static_cast<uint32_t>(aOffset);
+        aHeader.kvdByteLength = static_cast<uint32_t>(aKeyValueData.size());
+        aOffset += aKeyValueData.size();
+    }
+
+    // the smallest level first, so that a streamed read gets a usable texture early
+    size_t aAlignment = std::lcm(texelBlockBytes(iImage), size_t(4));
+    std::vector<LevelIndex> aIndex(aLevelCount);
+    for (uint32_t aLevel = aLevelCount; aLevel-- > 0;)
+    {
+        aOffset = alignOffset(aOffset, aAlignment);
+        aIndex[aLevel] = {aOffset, aLevelSizes[aLevel], aLevelSizes[aLevel]};
+        aOffset += aLevelSizes[aLevel];
+    }
+
+    std::string aTemporary = tools::GetTemporaryPath(iPath);
+    std::error_code aError;
+    {
+        std::ofstream aStream(aTemporary, std::ios::binary | std::ios::trunc);
+        if (!aStream)
+        {
+            ERROR("Failed to create texture: " << aTemporary);
+            return false;
+        }
+
+        aStream.write(reinterpret_cast<const char *>(&aHeader), sizeof(aHeader));
+        aStream.write(reinterpret_cast<const char *>(aIndex.data()), static_cast<std::streamsize>(aIndex.size() * sizeof(LevelIndex)));
+        aStream.write(reinterpret_cast<const char *>(aDescriptor.data()), aHeader.dfdByteLength);
+        aStream.write(aKeyValueData.data(), static_cast<std::streamsize>(aKeyValueData.size()));
+        size_t aWritten = aHeader.dfdByteOffset + aHeader.dfdByteLength + aKeyValueData.size();
+        for (uint32_t aLevel = aLevelCount; aLevel-- > 0;)
+        {
+            static constexpr char aPadding[16] = {};
+            aStream.write(aPadding, static_cast<std::streamsize>(aIndex[aLevel].byteOffset - aWritten));
+            aStream.write(reinterpret_cast<const char *>(iImage.levels[aLevel].data()), static_cast<std::streamsize>(aLevelSizes[aLevel]));
+            aWritten = aIndex[aLevel].byteOffset + aLevelSizes[aLevel];
+        }
+
+        if (!aStream)
+        {
+            ERROR("Failed to write texture: " << aTemporary);
+            aStream.close();
+            std::filesystem::remove(aTemporary, aError);
+            return false;
+        }
+    }
+
+    std::filesystem::rename(aTemporary, iPath, aError);
+    if (aError)
+    {
+        ERROR("Failed to write texture: " << iPath);
+        std::filesystem::remove(aTemporary, aError);
+        return false;
+    }
+    return true;
+}
+
+std::optional<Image> KTX2::Parse(std::string_view iData, const std::string &iPath)
+{
+    Header aHeader;
+    if (iData.size() < sizeof(aHeader))
+    {
+        ERROR("Not a KTX2 texture: " << iPath);
+        return {};
+    }
+    std::memcpy(&aHeader, iData.data(), sizeof(aHeader));
+    if (std::memcmp(aHeader.identifier, IDENTIFIER, sizeof(IDENTIFIER)) != 0)
+    {
+        ERROR("Not a KTX2 texture: " << iPath);
+        return {};
+    }
+
+    Image aImage;
+    switch (aHeader.vkFormat)
+    {
+    case VK_FORMAT_R8_UNORM:
+    case VK_FORMAT_R8G8_UNORM:
+    case VK_FORMAT_R8G8B8_UNORM:
+    case VK_FORMAT_R8G8B8A8_UNORM:
+        aImage.channels = aHeader.vkFormat == VK_FORMAT_R8_UNORM      ? 1
+                          : aHeader.vkFormat == VK_FORMAT_R8G8_UNORM  ? 2
+                          : aHeader.vkFormat == VK_FORMAT_R8G8B8_UNORM ? 3
+                                                                      : 4;
+        break;
+    case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+        aImage.encoding = Image::Encoding::BC1;
+        break;
+    case VK_FORMAT_BC3_UNORM_BLOCK:
+        aImage.encoding = Image::Encoding::BC3;
+        break;
+    case VK_FORMAT_BC5_UNORM_BLOCK:
+        aImage.encoding = Image::Encoding::BC5;
+        break;
+    case VK_FORMAT_BC7_UNORM_BLOCK:
+        aImage.encoding = Image::Encoding::BC7;
+        break;
+    default:
+        ERROR("Unsupported KTX2 format " << aHeader.vkFormat << ": " << iPath);
+        return {};
+    }
+    if (aImage.encoding != Image::Encoding::RAW)
+    {
+        aImage.channels = BlockCompression::GetChannels(aImage.encoding);
+    }
+
+    if (aHeader.pixelWidth == 0 || aHeader.pixelHeight == 0 || aHeader.pixelDepth != 0 || aHeader.layerCount > 1 ||
+        aHeader.faceCount != 1 || aHeader.supercompressionScheme != 0 || aHeader.levelCount > 32)
+    {
+        ERROR("Unsupported KTX2 texture (only 2D without supercompression): " << iPath);
+        return {};
+    }
+    aImage.width = static_cast<int>(aHeader.pixelWidth);
+    aImage.height = static_cast<int>(aHeader.pixelHeight);
+
+    // a level count of 0 asks for the mip chain to be generated at load
+    uint32_t aLevelCount = std::max(1u, aHeader.levelCount);
+    if (iData.size() < sizeof(aHeader) + aLevelCount * sizeof(LevelIndex))
+    {
+        ERROR("KTX2 texture is truncated: " << iPath);
+        return {};
+    }
+
+    aImage.levels.resize(aLevelCount);
+    for (uint32_t aLevel = 0; aLevel < aLevelCount; aLevel++)
+    {
+        LevelIndex aIndex;
+        std::memcpy(&aIndex, iData.data() + sizeof(aHeader) + aLevel * sizeof(LevelIndex), sizeof(aIndex));
+        size_t aSize = BlockCompression::GetLevelSize(aImage.encoding, aImage.channels, std::max(1, aImage.width >> aLevel),
+                                                      std::max(1, aImage.height >> aLevel));
+        if (aIndex.byteOffset > iData.size() || aIndex.byteLength > iData.size() - aIndex.byteOffset || aIndex.byteLength < aSize)
+        {
+            ERROR("KTX2 texture is truncated: " << iPath);
+            return {};
+        }
+        const char *aLevelData = iData.data() + aIndex.byteOffset;
+        aImage.levels[aLevel].assign(aLevelData, aLevelData + aSize);
+    }
+    return aImage;
+}
+
+std::string_view KTX2::FindValue(std::string_view iKeyValueData, std::string_view iKey)
+{
+    size_t aOffset = 0;
+    while (iKeyValueData.size() - aOffset >= sizeof(uint32_t))
+    {
+        uint32_t aLength;
+        std::memcpy(&aLength, iKeyValueData.data() + aOffset, sizeof(aLength));
+        aOffset += sizeof(aLength);
+        if (aLength > iKeyValueData.size() - aOffset)
+        {
+            break;
+        }
+
+        std::string_view aEntry = iKeyValueData.substr(aOffset, aLength);
+        size_t aKeyEnd = aEntry.find('\0');
+        if (aKeyEnd != std::string_view::npos && aEntry.substr(0, aKeyEnd) == iKey)
+        {
+            return aEntry.substr(aKeyEnd + 1);
+        }
+        aOffset = std::min(iKeyValueData.size(), (aOffset + aLength + 3) & ~size_t(3));
+    }
+    return {};
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <utility>
+#include <optional>
+#include <string_view>
+
+#include "image.hpp"
+
+/**
+ * KTX 2.0 container (Khronos), written by the texture cooker and read by KTX2Loader. Only what the engine
+ * uploads is supported: 2D textures without supercompression holding 8 bits unorm texels or BC1, BC3, BC5
+ * and BC7 blocks, with any number of levels.
+ *
+ * Layout (little endian):
+ *   Header, LevelIndex[levels], data format descriptor, key/value data,
+ *   then the levels from the smallest to the full size one, each aligned on lcm(block size, 4)
+ * Rows go from the top of the image down, as stb_image decodes them.
+ */
+namespace KTX2
+{
+    inline constexpr char EXTENSION[] = "ktx2";
+    inline constexpr uint8_t IDENTIFIER[12] = {0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'};
+
+    // the VkFormat of the texels
+    inline constexpr uint32_t VK_FORMAT_R8_UNORM = 9;
+    inline constexpr uint32_t VK_FORMAT_R8G8_UNORM = 16;
+    inline constexpr uint32_t VK_FORMAT_R8G8B8_UNORM = 23;
+    inline constexpr uint32_t VK_FORMAT_R8G8B8A8_UNORM = 37;
+    inline constexpr uint32_t VK_FORMAT_BC1_RGB_UNORM_BLOCK = 131;
+    inline constexpr uint32_t VK_FORMAT_BC3_UNORM_BLOCK = 137;
+    inline constexpr uint32_t VK_FORMAT_BC5_UNORM_BLOCK = 141;
+    inline constexpr uint32_t VK_FORMAT_BC7_UNORM_BLOCK = 145;
+
+    struct Header
+    {
+        uint8_t identifier[12];
+        uint32_t vkFormat;
+        uint32_t typeSize;
+        uint32_t pixelWidth;
+        uint32_t pixelHeight;
+        uint32_t pixelDepth;
+        uint32_t layerCount;
+        uint32_t faceCount;
+        uint32_t levelCount;
+        uint32_t supercompressionScheme;
+        uint32_t dfdByteOffset;
+        uint32_t dfdByteLength;
+        uint32_t kvdByteOffset;
+        uint32_t kvdByteLength;
+        uint64_t sgdByteOffset;
+        uint64_t sgdByteLength;
+    };
+
+    static_assert(sizeof(Header) == 80);
+
+    struct LevelIndex
+    {
+        uint64_t byteOffset;
+        uint64_t byteLength;
+        uint64_t uncompressedByteLength;
+    };
+
+    // key (without its terminating null) and raw value
+    using KeyValues = std::vector<std::pair<std::string, std::string>>;
+
+    // 0 when the image can't be stored
+    uint32_t GetVkFormat(const Image &iImage);
+
+    // written aside then renamed so that a reader never sees a partial file
+    bool Write(const std::string &iPath, const Image &iImage, const KeyValues &iKeyValues = {});
+
+    // iData is the whole file, iPath only names it in the errors
+    std::optional<Image> Parse(std::string_view iData, const std::string &iPath);
+
+    // value of iKey in the key/value data of a file, empty view when it isn't there
+    std::string_view FindValue(std::string_view iKeyValueData, std::string_view iKey);
+};
@@ -1,4 +1,6 @@
 #pragma once
 
 #include "loader.hpp"
-#include "obj_loader.hpp"
\ No newline at end of file
+#include "obj_loader.hpp"
+#include "mesh_loader.hpp"
+#include "texture_loader.hpp"
\ No newline at end of file
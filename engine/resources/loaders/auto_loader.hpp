@@ -4,22 +4,46 @@
 
 #include "loader.hpp"
 #include "iloader.hpp"
+#include "icooker.hpp"
+#include "itexture_loader.hpp"
 
 #define DEFINE_LOADER(CLASS, EXT)                             \
     inline constexpr char CLASS##_##EXT##_EXTENSION[] = #EXT; \
-    class CLASS : public AutoRegisterLoader<CLASS, CLASS##_##EXT##_EXTENSION>
+    class CLASS : public ILoader
 
-template <typename T, const char *EXTENSION>
-class AutoRegisterLoader : public ILoader
+#define DEFINE_COOKER(CLASS, EXT)                             \
+    inline constexpr char CLASS##_##EXT##_EXTENSION[] = #EXT; \
+    class CLASS : public ICooker
+
+#define DEFINE_TEXTURE_LOADER(CLASS, EXT)                     \
+    inline constexpr char CLASS##_##EXT##_EXTENSION[] = #EXT; \
+    class CLASS : public ITextureLoader
+
+// the REGISTER_ macros go at namespace scope in the .cpp of the class, registering it when the program starts
+#define REGISTER_LOADER(CLASS, EXT)                              \
+    static const AutoRegistrar CLASS##_##EXT##_REGISTRAR([]()    \
+        { Loader::RegisterLoader(CLASS##_##EXT##_EXTENSION, []() \
+              { return std::make_unique<CLASS>(); }); })
+
+#define REGISTER_COOKER(CLASS, EXT)                              \
+    static const AutoRegistrar CLASS##_##EXT##_REGISTRAR([]()    \
+        { Loader::RegisterCooker(CLASS##_##EXT##_EXTENSION, []() \
+              { return std::make_unique<CLASS>(); }); })
+
+#define REGISTER_TEXTURE_LOADER(CLASS, EXT)                             \
+    static const AutoRegistrar CLASS##_##EXT##_REGISTRAR([]()           \
+        { Loader::RegisterTextureLoader(CLASS##_##EXT##_EXTENSION, []() \
+              { return std::make_unique<CLASS>(); }); })
+
+/**
+ * Runs a registration during the static initialization of the translation unit defining it. It has to be a
+ * plain object of a .cpp: a static member of a class template is only instantiated when something uses it,
+ * and the engine is linked as an object library so that no .cpp holding only a registrar is dropped.
+ */
+struct AutoRegistrar
 {
-protected:
-    struct Registrar
+    explicit AutoRegistrar(void (*iRegister)())
     {
-        Registrar()
-        {
-            Loader::RegisterLoader(EXTENSION, []()
-                                   { return std::make_unique<T>(); });
-        }
-    };
-    inline static Registrar registrar{};
-};
\ No newline at end of file
+        iRegister();
+    }
+};
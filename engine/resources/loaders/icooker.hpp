@@ -0,0 +1,18 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "render/mesh.hpp"
+
+/**
+ * Writes already loaded meshes into an engine specific format, so that the next load
+ * can skip the parsing of the source file entirely.
+ */
+class ICooker
+{
+public:
+    virtual ~ICooker() = default;
+
+    virtual bool Cook(const std::string &sourcePath, const std::vector<Mesh> &meshes, const std::string &destination) = 0;
+};
@@ -10,5 +10,9 @@ class ILoader
 public:
     virtual ~ILoader() = default;
 
-    virtual std::vector<Mesh> Load(const std::string &path) = 0;
+    /**
+     * Reads the meshes of a file without touching the GL context, so it can run on any thread.
+     * Materials only reference their textures by path, Loader::Load uploads everything afterwards.
+     */
+    virtual std::vector<Mesh> Parse(const std::string &path) = 0;
 };
\ No newline at end of file
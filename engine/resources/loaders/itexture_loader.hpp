@@ -0,0 +1,18 @@
+#pragma once
+
+#include <string>
+#include <optional>
+
+#include "resources/image.hpp"
+
+class ITextureLoader
+{
+public:
+    virtual ~ITextureLoader() = default;
+
+    /**
+     * Reads a texture already in a GPU format (texels or compressed blocks, with their mip chain) without
+     * touching the GL context, so it can run on any thread. tools::UploadTexture uploads it afterwards.
+     */
+    virtual std::optional<Image> Parse(const std::string &path) = 0;
+};
@@ -8,18 +8,70 @@
 #include <print>
 
 #include "iloader.hpp"
+#include "icooker.hpp"
+#include "itexture_loader.hpp"
+#include "resources/fileloader.hpp"
+#include "mesh_cache.hpp"
 
 class Loader
 {
 public:
     using LoaderFactory = std::function<std::unique_ptr<ILoader>()>;
     using Registry = std::unordered_map<std::string, LoaderFactory>;
+    using CookerFactory = std::function<std::unique_ptr<ICooker>()>;
+    using CookerRegistry = std::unordered_map<std::string, CookerFactory>;
+    using TextureLoaderFactory = std::function<std::unique_ptr<ITextureLoader>()>;
+    using TextureRegistry = std::unordered_map<std::string, TextureLoaderFactory>;
 
-    static std::vector<Mesh> Load(const std::string &filepath)
+    /**
+     * Loads the meshes of a file with the loader registered for its extension and uploads them.
+     * With useCache, a fresh cooked version of the file is loaded instead when there is one,
+     * otherwise the source is loaded and cooked for the next time.
+     */
+    static std::vector<Mesh> Load(const std::string &filepath, bool useCache = true)
+    {
+        std::vector<Mesh> meshes = Parse(filepath, useCache);
+        tools::UploadMeshes(meshes);
+        return meshes;
+    }
+
+    // CPU side of Load, doesn't need the GL context
+    static std::vector<Mesh> Parse(const std::string &filepath, bool useCache = true)
     {
         auto extension = GetExtension(filepath);
-        auto loader = CreateLoader(extension);
-        return loader->Load(filepath);
+        if (!useCache || extension == MeshCache::EXTENSION || !HasCooker(MeshCache::EXTENSION))
+        {
+            return CreateLoader(extension)->Parse(filepath);
+        }
+
+        std::string cookedPath = MeshCache::GetCookedPath(filepath);
+        if (MeshCache::IsFresh(cookedPath, filepath))
+        {
+            std::vector<Mesh> meshes = CreateLoader(MeshCache::EXTENSION)->Parse(cookedPath);
+            if (!meshes.empty())
+            {
+                return meshes;
+            }
+        }
+
+        std::vector<Mesh> meshes = CreateLoader(extension)->Parse(filepath);
+        if (!meshes.empty())
+        {
+            CreateCooker(MeshCache::EXTENSION)->Cook(filepath, meshes, cookedPath);
+        }
+        return meshes;
+    }
+
+    // reads a texture with the loader registered for its extension, empty when there is none or it fails
+    static std::optional<Image> ParseTexture(const std::string &filepath)
+    {
+        TextureRegistry &registry = GetTextureRegistry();
+        auto loader = registry.find(GetExtension(filepath));
+        if (loader == registry.end())
+        {
+            return {};
+        }
+        return loader->second()->Parse(filepath);
     }
 
     static void RegisterLoader(const std::string &extension, LoaderFactory factory, bool forceRegistering = false)
@@ -31,6 +83,53 @@ public:
         }
     }
 
+    static void RegisterCooker(const std::string &extension, CookerFactory factory, bool forceRegistering = false)
+    {
+        CookerRegistry &registry = GetCookerRegistry();
+        if (registry.find(extension) == registry.end() || forceRegistering)
+        {
+            registry[extension] = factory;
+        }
+    }
+
+    static void RegisterTextureLoader(const std::string &extension, TextureLoaderFactory factory, bool forceRegistering = false)
+    {
+        TextureRegistry &registry = GetTextureRegistry();
+        if (registry.find(extension) == registry.end() || forceRegistering)
+        {
+            registry[extension] = factory;
+        }
+    }
+
+    static bool HasLoader(const std::string &extension)
+    {
+        Registry &registry = GetRegistry();
+        return registry.find(extension) != registry.end();
+    }
+
+    static bool HasCooker(const std::string &extension)
+    {
+        CookerRegistry &registry = GetCookerRegistry();
+        return registry.find(extension) != registry.end();
+    }
+
+    static bool HasTextureLoader(const std::string &extension)
+    {
+        TextureRegistry &registry = GetTextureRegistry();
+        return registry.find(extension) != registry.end();
+    }
+
+    static std::unique_ptr<ICooker> CreateCooker(const std::string &extension)
+    {
+        CookerRegistry &registry = GetCookerRegistry();
+        auto cooker = registry.find(extension);
+        if (cooker == registry.end())
+        {
+            throw std::runtime_error("No cooker registered for extension: " + extension);
+        }
+        return cooker->second();
+    }
+
 private:
     static std::unique_ptr<ILoader> CreateLoader(const std::string &extension)
     {
@@ -58,4 +157,16 @@ private:
         static Registry registry;
         return registry;
     }
+
+    static CookerRegistry &GetCookerRegistry()
+    {
+        static CookerRegistry registry;
+        return registry;
+    }
+
+    static TextureRegistry &GetTextureRegistry()
+    {
+        static TextureRegistry registry;
+        return registry;
+    }
 };
\ No newline at end of file
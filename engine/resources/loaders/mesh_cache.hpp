@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "resources/source_stamp.hpp"
+
+/**
+ * Cooked mesh cache: meshes loaded from a source file (.obj, ...) are written next to it in a binary
+ * format holding the de-duplicated vertices, indices, material table and texture references.
+ * The cooked file records the stamp of its source (see SourceStamp) and of the files the loader read
+ * besides it (Mesh::dependencies, the .mtl of an .obj), Loader::Parse uses it instead of the source as
+ * long as they are all fresh.
+ *
+ * Layout (little endian, every array aligned on 16 bytes from the start of the file):
+ *   Header, SourceStamp[dependency count], dependency paths
+ *   per mesh: name, flags (MESH_FLAG_*), materials (name, colors, scalars, texture type + path per slot),
+ *             vertex count, index count, Vertex[vertex count], unsigned int[index count],
+ *             lod count, per lod: error, index count, unsigned int[index count]
+ */
+namespace MeshCache
+{
+    inline constexpr char EXTENSION[] = "mesh";
+    inline constexpr char MAGIC[4] = {'E', 'M', 'S', 'H'};
+    // bump whenever the layout, the Vertex struct or the processing of the imported meshes changes
+    inline constexpr uint32_t VERSION = 7;
+
+    inline constexpr uint32_t MESH_FLAG_TANGENTS = 1 << 0;
+    // the VertexFormat chosen at import
+    inline constexpr uint32_t MESH_FLAG_HALF_TEXCOORDS = 1 << 1;
+    inline constexpr uint32_t MESH_FLAG_SHORT_INDICES = 1 << 2;
+
+    // the levels of detail were generated (MeshSimplifier enabled), whether a mesh got any or not
+    inline constexpr uint32_t COOK_FLAG_LODS = 1 << 0;
+
+    struct Header
+    {
+        char magic[4];
+        uint32_t version;
+        uint32_t vertexSize;
+        uint32_t meshCount;
+        SourceStamp source;
+        uint32_t dependencyCount;
+        // COOK_FLAG_*
+        uint32_t flags;
+    };
+
+    std::string GetCookedPath(const std::string &sourcePath);
+
+    /**
+     * Checks the cooked file against its source and dependencies, re-stamping them when only the modification
+     * time changed. A file cooked without all of requiredFlags (COOK_FLAG_*) isn't fresh.
+     */
+    bool IsFresh(const std::string &cookedPath, const std::string &sourcePath, uint32_t requiredFlags = 0);
+};
@@ -0,0 +1,488 @@
+#include "mesh_loader.hpp"
+
+#include <cstring>
+#include <fstream>
+#include <algorithm>
+
+namespace
+{
+    constexpr size_t ALIGNMENT = 16;
+    // sanity bound on the length of a dependency path read back from a cooked file
+    constexpr uint32_t MAX_DEPENDENCY_PATH = 4096;
+    // smallest number of bytes a record takes in a cooked file, to bound the counts read back before allocating
+    constexpr size_t MIN_DEPENDENCY_SIZE = sizeof(SourceStamp) + sizeof(uint32_t);
+    // name, flags, material count, vertex count, index count and level count
+    constexpr size_t MIN_MESH_SIZE = 3 * sizeof(uint32_t) + 2 * sizeof(uint64_t) + sizeof(uint32_t);
+    // name, colors and one type and path length per texture
+    constexpr size_t MIN_MATERIAL_SIZE = sizeof(uint32_t) + 4 * sizeof(glm::vec3) + 3 * sizeof(float) + 6 * 2 * sizeof(uint32_t);
+    constexpr size_t MIN_LOD_SIZE = sizeof(float) + sizeof(uint64_t);
+
+    // bounds checked cursor over the mapped cooked file
+    struct Reader
+    {
+        std::string_view data;
+        size_t offset = 0;
+
+        bool read(void *destination, size_t size)
+        {
+            if (size > data.size() - offset)
+            {
+                return false;
+            }
+            std::memcpy(destination, data.data() + offset, size);
+            offset += size;
+            return true;
+        }
+
+        template <typename T>
+        bool read(T &value)
+        {
+            return read(&value, sizeof(T));
+        }
+
+        bool readString(std::string &value)
+        {
+            uint32_t length = 0;
+            if (!read(length) || length > data.size() - offset)
+            {
+                return false;
+            }
+            value.assign(data.data() + offset, length);
+            offset += length;
+            return true;
+        }
+
+        // whether count records of at least size bytes each can fit in what is left
+        bool fits(uint64_t count, size_t size) const
+        {
+            return count <= (data.size() - offset) / size;
+        }
+
+        bool align()
+        {
+            size_t aligned = (offset + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+            if (aligned > data.size())
+            {
+                return false;
+            }
+            offset = aligned;
+            return true;
+        }
+    };
+
+    struct Writer
+    {
+        std::ofstream &stream;
+        size_t offset = 0;
+
+        void write(const void *source, size_t size)
+        {
+            stream.write(static_cast<const char *>(source), static_cast<std::streamsize>(size));
+            offset += size;
+        }
+
+        template <typename T>
+        void write(const T &value)
+        {
+            write(&value, sizeof(T));
+        }
+
+        void writeString(const std::string &value)
+        {
+            write(static_cast<uint32_t>(value.size()));
+            write(value.data(), value.size());
+        }
+
+        void align()
+        {
+            static constexpr char padding[ALIGNMENT] = {};
+            size_t aligned = (offset + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+            write(padding, aligned - offset);
+        }
+    };
+
+    bool readMaterial(Reader &reader, Material &material)
+    {
+        bool ok = reader.readString(material.name) &&
+                  reader.read(material.ambient_color) &&
+                  reader.read(material.diffuse_color) &&
+                  reader.read(material.emissive_color) &&
+                  reader.read(material.specular_color) &&
+                  reader.read(material.specular_exponent) &&
+                  reader.read(material.optic_density) &&
+                  reader.read(material.alpha);
+        if (!ok)
+        {
+            return false;
+        }
+
+        for (Texture *texture : material.GetTextures())
+        {
+            uint32_t type = 0;
+            if (!reader.read(type) || !reader.readString(texture->path))
+            {
+                return false;
+            }
+            texture->type = texture->path.empty() ? TextureType::UNKNOWN : static_cast<TextureType>(type);
+        }
+        return true;
+    }
+
+    // indices past the vertices would make the GPU read out of the vertex buffer
+    bool indicesInRange(const std::vector<unsigned int> &indices, uint64_t vertexCount)
+    {
+        return std::all_of(indices.begin(), indices.end(), [vertexCount](unsigned int index)
+                           { return index < vertexCount; });
+    }
+
+    void writeMaterial(Writer &writer, const Material &material)
+    {
+        writer.writeString(material.name);
+        writer.write(material.ambient_color);
+        writer.write(material.diffuse_color);
+        writer.write(material.emissive_color);
+        writer.write(material.specular_color);
+        writer.write(material.specular_exponent);
+        writer.write(material.optic_density);
+        writer.write(material.alpha);
+
+        for (const Texture *texture : material.GetTextures())
+        {
+            writer.write(static_cast<uint32_t>(texture->type));
+            writer.writeString(texture->type != TextureType::UNKNOWN ? texture->path : std::string());
+        }
+    }
+}
+
+REGISTER_LOADER(MeshLoader, mesh);
+REGISTER_COOKER(MeshCooker, mesh);
+
+std::string MeshCache::GetCookedPath(const std::string &sourcePath)
+{
+    return sourcePath + "." + EXTENSION;
+}
+
+bool MeshCache::IsFresh(const std::string &cookedPath, const std::string &sourcePath, uint32_t requiredFlags)
+{
+    Header header;
+    {
+        std::ifstream cooked(cookedPath, std::ios::binary);
+        if (!cooked.read(reinterpret_cast<char *>(&header), sizeof(header)))
+        {
+            return false;
+        }
+    }
+
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION || header.vertexSize != sizeof(Vertex) ||
+        (header.flags & requiredFlags) != requiredFlags)
+    {
+        return false;
+    }
+
+    bool restamped = false;
+    if (!tools::IsStampFresh(header.source, sourcePath, restamped))
+    {
+        return false;
+    }
+    if (restamped)
+    {
+        std::fstream cooked(cookedPath, std::ios::binary | std::ios::in | std::ios::out);
+        cooked.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    }
+
+    std::error_code error;
+    uintmax_t fileSize = std::filesystem::file_size(cookedPath, error);
+    if (error || header.dependencyCount > (fileSize - sizeof(header)) / MIN_DEPENDENCY_SIZE)
+    {
+        return false;
+    }
+    std::vector<SourceStamp> stamps(header.dependencyCount);
+    std::vector<std::string> dependencies(header.dependencyCount);
+    {
+        std::ifstream cooked(cookedPath, std::ios::binary);
+        cooked.seekg(sizeof(header));
+        if (!cooked.read(reinterpret_cast<char *>(stamps.data()), static_cast<std::streamsize>(stamps.size() * sizeof(SourceStamp))))
+        {
+            return false;
+        }
+        for (std::string &dependency : dependencies)
+        {
+            uint32_t length = 0;
+            if (!cooked.read(reinterpret_cast<char *>(&length), sizeof(length)) || length > MAX_DEPENDENCY_PATH)
+            {
+                return false;
+            }
+            dependency.resize(length);
+            if (!cooked.read(dependency.data(), length))
+            {
+                return false;
+            }
+        }
+    }
+
+    for (uint32_t i = 0; i < header.dependencyCount; i++)
+    {
+        if (!tools::IsStampFresh(stamps[i], dependencies[i], restamped))
+        {
+            return false;
+        }
+        if (restamped)
+        {
+            std::fstream cooked(cookedPath, std::ios::binary | std::ios::in | std::ios::out);
+            cooked.seekp(sizeof(header) + i * sizeof(SourceStamp));
+            cooked.write(reinterpret_cast<const char *>(&stamps[i]), sizeof(SourceStamp));
+        }
+    }
+    return true;
+}
+
+std::vector<Mesh> MeshLoader::Parse(const std::string &path)
+{
+    MappedFile file(path);
+    if (!file.IsOpen())
+    {
+        ERROR("File not read successfully, param: " << path);
+        return {};
+    }
+
+    Reader reader{file.GetView()};
+    MeshCache::Header header;
+    if (!reader.read(header) || std::memcmp(header.magic, MeshCache::MAGIC, sizeof(MeshCache::MAGIC)) != 0)
+    {
+        ERROR("Not a cooked mesh file: " << path);
+        return {};
+    }
+    if (header.version != MeshCache::VERSION || header.vertexSize != sizeof(Vertex))
+    {
+        ERROR("Cooked mesh file is outdated: " << path);
+        return {};
+    }
+
+    // the dependencies only matter to IsFresh
+    for (uint32_t i = 0; i < header.dependencyCount; i++)
+    {
+        SourceStamp stamp;
+        if (!reader.read(stamp))
+        {
+            ERROR("Cooked mesh file is truncated: " << path);
+            return {};
+        }
+    }
+    for (uint32_t i = 0; i < header.dependencyCount; i++)
+    {
+        std::string dependency;
+        if (!reader.readString(dependency))
+        {
+            ERROR("Cooked mesh file is truncated: " << path);
+            return {};
+        }
+    }
+    if (!reader.align())
+    {
+        ERROR("Cooked mesh file is truncated: " << path);
+        return {};
+    }
+
+    if (!reader.fits(header.meshCount, MIN_MESH_SIZE))
+    {
+        ERROR("Cooked mesh file is truncated: " << path);
+        return {};
+    }
+    std::vector<Mesh> meshes(header.meshCount);
+    for (Mesh &mesh : meshes)
+    {
+        uint32_t flags = 0;
+        uint32_t materialCount = 0;
+        if (!reader.readString(mesh.name) || !reader.read(flags) || !reader.read(materialCount) ||
+            !reader.fits(materialCount, MIN_MATERIAL_SIZE))
+        {
+            ERROR("Cooked mesh file is truncated: " << path);
+            return {};
+        }
+
+        mesh.materials.resize(materialCount);
+        for (Material &material : mesh.materials)
+        {
+            if (!readMaterial(reader, material))
+            {
+                ERROR("Cooked mesh file is truncated: " << path);
+                return {};
+            }
+        }
+
+        uint64_t vertexCount = 0;
+        uint64_t indexCount = 0;
+        if (!reader.read(vertexCount) || !reader.read(indexCount) || !reader.align() || !reader.fits(vertexCount, sizeof(Vertex)))
+        {
+            ERROR("Cooked mesh file is truncated: " << path);
+            return {};
+        }
+        mesh.vertices.resize(vertexCount);
+        reader.read(mesh.vertices.data(), vertexCount * sizeof(Vertex));
+
+        if (!reader.align() || !reader.fits(indexCount, sizeof(unsigned int)))
+        {
+            ERROR("Cooked mesh file is truncated: " << path);
+            return {};
+        }
+        mesh.indices.resize(indexCount);
+        reader.read(mesh.indices.data(), indexCount * sizeof(unsigned int));
+        reader.align();
+        if (!indicesInRange(mesh.indices, vertexCount))
+        {
+            ERROR("Cooked mesh file is corrupt: " << path);
+            return {};
+        }
+
+        uint32_t lodCount = 0;
+        if (!reader.read(lodCount) || !reader.fits(lodCount, MIN_LOD_SIZE))
+        {
+            ERROR("Cooked mesh file is truncated: " << path);
+            return {};
+        }
+        mesh.lods.resize(lodCount);
+        for (MeshLod &lod : mesh.lods)
+        {
+            uint64_t lodIndexCount = 0;
+            if (!reader.read(lod.error) || !reader.read(lodIndexCount) || !reader.align() ||
+                !reader.fits(lodIndexCount, sizeof(unsigned int)))
+            {
+                ERROR("Cooked mesh file is truncated: " << path);
+                return {};
+            }
+            lod.indices.resize(lodIndexCount);
+            reader.read(lod.indices.data(), lodIndexCount * sizeof(unsigned int));
+            reader.align();
+            if (!indicesInRange(lod.indices, vertexCount))
+            {
+                ERROR("Cooked mesh file is corrupt: " << path);
+                return {};
+            }
+        }
+
+        mesh.SetHasTangents((flags & MeshCache::MESH_FLAG_TANGENTS) != 0);
+        VertexFormat format;
+        format.halfTexCoords = (flags & MeshCache::MESH_FLAG_HALF_TEXCOORDS) != 0;
+        format.tangents = mesh.HasTangents();
+        format.shortIndices = (flags & MeshCache::MESH_FLAG_SHORT_INDICES) != 0;
+        mesh.SetVertexFormat(format);
+        mesh.ComputeBounds();
+    }
+
+    INFO("Loaded cooked mesh file: " << path);
+    return meshes;
+}
+
+bool MeshCooker::Cook(const std::string &sourcePath, const std::vector<Mesh> &meshes, const std::string &destination)
+{
+    MeshCache::Header header = {};
+    std::memcpy(header.magic, MeshCache::MAGIC, sizeof(MeshCache::MAGIC));
+    header.version = MeshCache::VERSION;
+    header.vertexSize = sizeof(Vertex);
+    header.meshCount = static_cast<uint32_t>(meshes.size());
+    header.flags = MeshSimplifier::IsEnabled() ? MeshCache::COOK_FLAG_LODS : 0u;
+    if (!tools::StampSource(header.source, sourcePath))
+    {
+        ERROR("Failed to read the source of the cooked mesh file: " << sourcePath);
+        return false;
+    }
+
+    std::vector<std::string> dependencies;
+    for (const Mesh &mesh : meshes)
+    {
+        for (const std::string &dependency : mesh.dependencies)
+        {
+            if (std::find(dependencies.begin(), dependencies.end(), dependency) == dependencies.end())
+            {
+                dependencies.push_back(dependency);
+            }
+        }
+    }
+    std::vector<SourceStamp> stamps(dependencies.size());
+    for (size_t i = 0; i < dependencies.size(); i++)
+    {
+        if (!tools::StampSource(stamps[i], dependencies[i]))
+        {
+            ERROR("Failed to read a dependency of the cooked mesh file: " << dependencies[i]);
+            return false;
+        }
+    }
+    header.dependencyCount = static_cast<uint32_t>(dependencies.size());
+
+    // written aside then renamed so that a reader never sees a partial file
+    std::string temporary = tools::GetTemporaryPath(destination);
+    std::error_code error;
+    {
+        std::ofstream stream(temporary, std::ios::binary | std::ios::trunc);
+        if (!stream)
+        {
+            ERROR("Failed to create cooked mesh file: " << temporary);
+            return false;
+        }
+
+        Writer writer{stream};
+        writer.write(header);
+        writer.write(stamps.data(), stamps.size() * sizeof(SourceStamp));
+        for (const std::string &dependency : dependencies)
+        {
+            writer.writeString(dependency);
+        }
+        writer.align();
+        for (const Mesh &mesh : meshes)
+        {
+            writer.writeString(mesh.name);
+            uint32_t flags = mesh.HasTangents() ? MeshCache::MESH_FLAG_TANGENTS : 0u;
+            if (mesh.GetVertexFormat().halfTexCoords)
+            {
+                flags |= MeshCache::MESH_FLAG_HALF_TEXCOORDS;
+            }
+            if (mesh.GetVertexFormat().shortIndices)
+            {
+                flags |= MeshCache::MESH_FLAG_SHORT_INDICES;
+            }
+            writer.write(flags);
+            writer.write(static_cast<uint32_t>(mesh.materials.size()));
+            for (const Material &material : mesh.materials)
+            {
+                writeMaterial(writer, material);
+            }
+
+            writer.write(static_cast<uint64_t>(mesh.vertices.size()));
+            writer.write(static_cast<uint64_t>(mesh.indices.size()));
+            writer.align();
+            writer.write(mesh.vertices.data(), mesh.vertices.size() * sizeof(Vertex));
+            writer.align();
+            writer.write(mesh.indices.data(), mesh.indices.size() * sizeof(unsigned int));
+            writer.align();
+
+            writer.write(static_cast<uint32_t>(mesh.lods.size()));
+            for (const MeshLod &lod : mesh.lods)
+            {
+                writer.write(lod.error);
+                writer.write(static_cast<uint64_t>(lod.indices.size()));
+                writer.align();
+                writer.write(lod.indices.data(), lod.indices.size() * sizeof(unsigned int));
+                writer.align();
+            }
+        }
+
+        if (!stream)
+        {
+            ERROR("Failed to write cooked mesh file: " << temporary);
+            stream.close();
+            std::filesystem::remove(temporary, error);
+            return false;
+        }
+    }
+
+    std::filesystem::rename(temporary, destination, error);
+    if (error)
+    {
+        ERROR("Failed to write cooked mesh file: " << destination);
+        std::filesystem::remove(temporary, error);
+        return false;
+    }
+
+    INFO("Cooked mesh file written: " << destination);
+    return true;
+}
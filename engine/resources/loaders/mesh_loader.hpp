@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <optional>
+#include <filesystem>
+
+#include "auto_loader.hpp"
+#include "mesh_cache.hpp"
+#include "resources/mapped_file.hpp"
+#include "resources/fileloader.hpp"
+#include "render/mesh.hpp"
+#include "render/mesh_simplifier.hpp"
+#include "helpers/log.hpp"
+
+// reads cooked meshes written by MeshCooker, see mesh_cache.hpp for the layout
+DEFINE_LOADER(MeshLoader, mesh)
+{
+public:
+    std::vector<Mesh> Parse(const std::string &path) override;
+};
+
+DEFINE_COOKER(MeshCooker, mesh)
+{
+public:
+    bool Cook(const std::string &sourcePath, const std::vector<Mesh> &meshes, const std::string &destination) override;
+};
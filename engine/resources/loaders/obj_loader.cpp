@@ -1,27 +1,11 @@
 #include "obj_loader.hpp"
 
-#define REGISTER_VERTEX(indices, vertices, registered_vertices, vertex, positions, normals, texcoords) \
-    {                                                                                                  \
-        if (registered_vertices.find(vertex) == registered_vertices.end())                             \
-        {                                                                                              \
-            vertices.push_back({                                                                       \
-                .position = positions[vertex.v],                                                       \
-                .normal = vertex.vn > -1 ? normals[vertex.vn] : glm::vec3(0.0f),                       \
-                .tcoords = vertex.vt > -1 ? texcoords[vertex.vt] : glm::vec2(0.0f),                    \
-            });                                                                                        \
-            registered_vertices[vertex] = vertices.size() - 1;                                         \
-            indices.push_back(vertices.size() - 1);                                                    \
-        }                                                                                              \
-        else                                                                                           \
-        {                                                                                              \
-            indices.push_back(registered_vertices[vertex]);                                            \
-        }                                                                                              \
-    }
-
-std::vector<Mesh> OBJLoader::Load(const std::string &path)
+REGISTER_LOADER(OBJLoader, obj);
+
+std::vector<Mesh> OBJLoader::Parse(const std::string &path)
 {
-    std::ifstream stream(path);
-    if (!stream.is_open())
+    MappedFile file(path);
+    if (!file.IsOpen())
     {
         ERROR("File not read successfully, param: " << path);
         return {};
@@ -29,178 +13,134 @@ std::vector<Mesh> OBJLoader::Load(const std::string &path)
 
     std::string directory = path.substr(0, path.find_last_of('/'));
 
-    std::vector<glm::vec3> positions;
-    std::vector<glm::vec3> normals;
-    std::vector<glm::vec2> texcoords;
+    INFO("Starting OBJ loading file at: " << path);
+    ThreadPool &pool = ThreadPool::Get();
 
-    std::unordered_map<Triplet, int, TripletHash> registered_vertices = {};
-    std::unordered_map<std::string, Material> registered_materials = {};
+    // phase 1: split the file on line boundaries so that every record belongs to exactly one chunk
+    std::vector<Chunk> chunks = splitChunks(file.GetView(), pool.GetThreadCount());
 
-    std::vector<Mesh> meshes;
+    // phase 2: parse every chunk independently
+    pool.ParallelFor(chunks.size(), [&](size_t i)
+                     { parseChunk(chunks[i]); });
 
-    INFO("Starting OBJ loading file at: " << path);
-    int line = 1;
-    // TODO: optimize by copying first the whole file and then parse it using pointer instead of stream.get() each time
-    char c = stream.get();
-    while (!stream.fail())
+    bool failed = false;
+    int firstLine = 1;
+    for (const Chunk &chunk : chunks)
     {
-        // comment
-        if (c == '#')
+        for (const ChunkError &error : chunk.errors)
         {
-            skipLine(stream);
+            ERROR(error.message << " at line: " << firstLine + error.line - 1);
         }
-        // object name
-        else if (c == 'o')
+        failed |= chunk.failed;
+        firstLine += chunk.lines;
+    }
+    if (failed)
+    {
+        return {};
+    }
+
+    // phase 3: a prefix sum over the per chunk attribute counts gives every chunk its global offsets
+    std::vector<ChunkOffsets> offsets(chunks.size());
+    ChunkOffsets total;
+    for (size_t i = 0; i < chunks.size(); i++)
+    {
+        offsets[i] = total;
+        total.positions += chunks[i].positions.size();
+        total.texcoords += chunks[i].texcoords.size();
+        total.normals += chunks[i].normals.size();
+    }
+
+    std::vector<glm::vec3> positions(total.positions);
+    std::vector<glm::vec2> texcoords(total.texcoords);
+    std::vector<glm::vec3> normals(total.normals);
+
+    pool.ParallelFor(chunks.size(), [&](size_t i)
+                     {
+                         Chunk &chunk = chunks[i];
+                         const ChunkOffsets &offset = offsets[i];
+
+                         std::copy(chunk.positions.begin(), chunk.positions.end(), positions.begin() + offset.positions);
+                         std::copy(chunk.texcoords.begin(), chunk.texcoords.end(), texcoords.begin() + offset.texcoords);
+                         std::copy(chunk.normals.begin(), chunk.normals.end(), normals.begin() + offset.normals);
+                         std::vector<glm::vec3>().swap(chunk.positions);
+                         std::vector<glm::vec2>().swap(chunk.texcoords);
+                         std::vector<glm::vec3>().swap(chunk.normals);
+
+                         // relative (negative) indices were stored relative to the start of the chunk
+                         for (size_t j = 0; j < chunk.corners.size(); j++)
+                         {
+                             Triplet &corner = chunk.corners[j];
+                             uint8_t relative = chunk.relative[j];
+                             if (relative & RELATIVE_V)
+                                 corner.v += static_cast<int>(offset.positions);
+                             if (relative & RELATIVE_VT)
+                                 corner.vt += static_cast<int>(offset.texcoords);
+                             if (relative & RELATIVE_VN)
+                                 corner.vn += static_cast<int>(offset.normals);
+                         } });
+
+    // replay objects and materials in file order
+    std::unordered_map<std::string, Material> registered_materials = {};
+    std::vector<std::string> libraries;
+    std::vector<Mesh> meshes;
+    std::vector<std::vector<FaceRange>> meshFaces;
+
+    auto assignFaces = [&](size_t chunk, size_t begin, size_t end)
+    {
+        if (begin == end)
         {
-            ignoreSpaces(stream);
-            c = stream.peek();
-            if (c == '\n')
-            {
-                ERROR("Needs a group name for keyword " << BOLD("o") << " at line: " << line);
-                return {};
-            }
-            meshes.push_back({});
-            Mesh &active = meshes.back();
-            active.name = readLine(stream);
+            return;
         }
-        // vertices
-        else if (c == 'v')
+        // in case no object name defined, we could stop there
+        if (meshes.empty())
         {
-            c = stream.get();
-            // texture vertices
-            if (c == 't')
-            {
-                ignoreSpaces(stream);
-                std::optional<glm::vec2> vt = readVec2(stream);
-                if (vt)
-                {
-                    texcoords.push_back(*vt);
-                }
-                else
-                {
-                    ERROR("Parsing geometric vertex failed at line: " << line);
-                }
-            }
-            // normals vertices
-            else if (c == 'n')
-            {
-                ignoreSpaces(stream);
-                std::optional<glm::vec3> vn = readVec3(stream);
-                if (vn)
-                {
-                    normals.push_back(*vn);
-                }
-                else
-                {
-                    ERROR("Parsing geometric vertex failed at line: " << line);
-                }
-            }
-            // parameter space vertices
-            else if (c == 'p')
-            {
-            }
-            // geometric vertices
-            else if (c == ' ')
-            {
-                ignoreSpaces(stream);
-                std::optional<glm::vec3> v = readVec3(stream);
-                if (v)
-                {
-                    positions.push_back(*v);
-                }
-                else
-                {
-                    ERROR("Parsing geometric vertex failed at line: " << line);
-                }
-            }
-            else
-            {
-                ERROR("Unknown keyword at line: " << line);
-            }
-            skipLine(stream);
+            meshes.push_back({});
+            meshFaces.push_back({});
         }
-        // face
-        else if (c == 'f')
-        {
-            // in case no object name defined, we could stop there
-            if (meshes.empty())
-            {
-                meshes.push_back({});
-            }
-            Mesh &active = meshes.back();
+        meshFaces.back().push_back({chunk, begin, end});
+    };
 
-            std::vector<Triplet> triplets;
-            while (!stream.fail() && stream.peek() != '\n')
-            {
-                ignoreSpaces(stream);
-                std::optional<Triplet> triplet = readTriplet(stream);
-                if (triplet)
-                {
-                    triplets.push_back(*triplet);
-                }
-                else
-                {
-                    break;
-                }
-            }
-            skipLine(stream);
+    firstLine = 1;
+    for (size_t i = 0; i < chunks.size(); i++)
+    {
+        const Chunk &chunk = chunks[i];
+        size_t face = 0;
+        for (const Statement &statement : chunk.statements)
+        {
+            assignFaces(i, face, statement.face);
+            face = statement.face;
 
-            if (triplets.size() < 3)
+            if (statement.type == Statement::Type::Object)
             {
-                ERROR("Face needs at least three triplets at line: " << line);
-                return {};
+                meshes.push_back({});
+                meshFaces.push_back({});
+                meshes.back().name = statement.argument;
             }
-
-            // triangulate face
-            for (size_t i = 1; i < triplets.size() - 1; ++i)
+            else if (statement.type == Statement::Type::UseMaterial)
             {
-                REGISTER_VERTEX(active.indices, active.vertices, registered_vertices, triplets[0], positions, normals, texcoords);
-                REGISTER_VERTEX(active.indices, active.vertices, registered_vertices, triplets[i], positions, normals, texcoords);
-                REGISTER_VERTEX(active.indices, active.vertices, registered_vertices, triplets[i + 1], positions, normals, texcoords);
-            }
-        }
-        // smoothing group
-        else if (c == 's')
-        {
-            ignoreSpaces(stream);
-            // DEBUG("Smoothing group: " << BOLD(readLine(stream)) << " at line: " << line);
-            skipLine(stream);
-        }
-        else if (c == 'u')
-        {
-            stream.unget();
-            if (readWord(stream) == "usemtl")
-            {
-                ignoreSpaces(stream);
-                std::string name = readLine(stream);
-                auto it = registered_materials.find(name);
+                auto it = registered_materials.find(std::string(statement.argument));
                 if (it != registered_materials.end())
                 {
                     if (meshes.empty())
                     {
                         meshes.push_back({});
+                        meshFaces.push_back({});
                     }
                     Mesh &active = meshes.back();
                     active.AddMaterial(it->second);
                 }
             }
-            skipLine(stream);
-        }
-        else if (c == 'm')
-        {
-            stream.unget();
-            if (readWord(stream) == "mtllib")
+            else if (statement.type == Statement::Type::MaterialLibrary)
             {
-                ignoreSpaces(stream);
-
-                std::filesystem::path path = directory + "/" + readLine(stream);
+                std::filesystem::path path = directory + "/" + std::string(statement.argument);
                 if (!std::filesystem::exists(path))
                 {
                     ERROR("Material file doesn't exist: " << path.string());
                     continue;
                 }
 
-                DEBUG("Material library: " << BOLD(path.string()) << " at line: " << line);
+                DEBUG("Material library: " << BOLD(path.string()) << " at line: " << firstLine + statement.line - 1);
+                libraries.push_back(path.string());
                 for (Material &material : LoadMaterial(path.string()))
                 {
                     if (registered_materials.find(material.name) == registered_materials.end())
@@ -213,48 +153,61 @@ std::vector<Mesh> OBJLoader::Load(const std::string &path)
                     }
                 }
             }
-            skipLine(stream);
-        }
-        else if (c == '\n')
-        {
-            line++;
         }
-        else
-        {
-            // ignore line
-            skipLine(stream);
-        }
-
-        c = stream.get();
+        assignFaces(i, face, chunk.faces.size());
+        firstLine += chunk.lines;
+    }
+
+    // triangulate, de-duplicate the vertices, add the tangents, simplify (when enabled), reorder and pick the GPU layout of every object in parallel
+    std::atomic<bool> invalid = false;
+    pool.ParallelFor(meshes.size(), [&](size_t i)
+                     {
+                         if (!buildMesh(meshes[i], meshFaces[i], chunks, positions, texcoords, normals))
+                         {
+                             invalid = true;
+                             return;
+                         }
+                         meshes[i].SetHasTangents(MeshTangents::Generate(meshes[i]));
+                         if (MeshSimplifier::IsEnabled())
+                         {
+                             MeshSimplifier::GenerateLods(meshes[i]);
+                         }
+                         if (MeshOptimizer::IsEnabled())
+                         {
+                             MeshOptimizer::Optimize(meshes[i]);
+                         }
+                         meshes[i].SetVertexFormat(VertexFormat::Choose(meshes[i]));
+                         meshes[i].ComputeBounds();
+                         meshes[i].dependencies = libraries; });
+    if (invalid)
+    {
+        ERROR("Face references a vertex that doesn't exist in: " << path);
+        return {};
     }
 
     INFO("Finished loading mesh...");
 
-    for (Mesh &mesh : meshes)
-    {
-        mesh.SetupMesh();
-    }
-
     return meshes;
 }
 
 std::vector<Material> OBJLoader::LoadMaterial(const std::string &path)
 {
-    std::ifstream stream(path);
-    if (!stream.is_open())
+    MappedFile file(path);
+    if (!file.IsOpen())
     {
         ERROR("File not read successfully, param: " << path);
         return {};
     }
+    std::string_view data = file.GetView();
 
     std::string directory = path.substr(0, path.find_last_of('/'));
 
     std::vector<Material> materials;
 
     int line = 1;
-    char c = stream.get();
-    while (!stream.fail())
+    while (!data.empty())
     {
+        char c = data.front();
         if (c == 'K')
         {
             if (materials.empty())
@@ -262,12 +215,17 @@ std::vector<Material> OBJLoader::LoadMaterial(const std::string &path)
                 ERROR("Keyword newmtl mandatory");
                 return {};
             }
-            c = stream.get();
+            data.remove_prefix(1);
+            c = data.empty() ? '\n' : data.front();
+            if (c != '\n')
+            {
+                data.remove_prefix(1);
+            }
             // ambient color
             if (c == 'a')
             {
-                ignoreSpaces(stream);
-                std::optional<glm::vec3> color = readVec3(stream);
+                ignoreSpaces(data);
+                std::optional<glm::vec3> color = readVec3(data);
                 if (color)
                 {
                     Material &active = materials.back();
@@ -275,14 +233,15 @@ std::vector<Material> OBJLoader::LoadMaterial(const std::string &path)
                 }
                 else
                 {
+                    ERROR("Parsing ambient color failed at line: " << line);
                     return {};
                 }
             }
             // diffuse color
             else if (c == 'd')
             {
-                ignoreSpaces(stream);
-                std::optional<glm::vec3> color = readVec3(stream);
+                ignoreSpaces(data);
+                std::optional<glm::vec3> color = readVec3(data);
                 if (color)
                 {
                     Material &active = materials.back();
@@ -290,14 +249,15 @@ std::vector<Material> OBJLoader::LoadMaterial(const std::string &path)
                 }
                 else
                 {
+                    ERROR("Parsing diffuse color failed at line: " << line);
                     return {};
                 }
             }
             // emissive color
             else if (c == 'e')
             {
-                ignoreSpaces(stream);
-                std::optional<glm::vec3> color = readVec3(stream);
+                ignoreSpaces(data);
+                std::optional<glm::vec3> color = readVec3(data);
                 if (color)
                 {
                     Material &active = materials.back();
@@ -305,14 +265,15 @@ std::vector<Material> OBJLoader::LoadMaterial(const std::string &path)
                 }
                 else
                 {
+                    ERROR("Parsing emissive color failed at line: " << line);
                     return {};
                 }
             }
             // specular color
             else if (c == 's')
             {
-                ignoreSpaces(stream);
-                std::optional<glm::vec3> color = readVec3(stream);
+                ignoreSpaces(data);
+                std::optional<glm::vec3> color = readVec3(data);
                 if (color)
                 {
                     Material &active = materials.back();
@@ -320,26 +281,26 @@ std::vector<Material> OBJLoader::LoadMaterial(const std::string &path)
                 }
                 else
                 {
+                    ERROR("Parsing specular color failed at line: " << line);
                     return {};
                 }
             }
             else
             {
-                ERROR("Unknown keyword " << BOLD("K" + c) << " at line: " << line);
+                ERROR("Unknown keyword " << BOLD("K" << c) << " at line: " << line);
                 return {};
             }
-            skipLine(stream);
+            skipLine(data);
         }
         else if (c == 'n')
         {
-            stream.unget();
-            if (readWord(stream) == "newmtl")
+            if (readWord(data) == "newmtl")
             {
-                ignoreSpaces(stream);
-                Material material = {.name = readLine(stream)};
+                ignoreSpaces(data);
+                Material material = {.name = std::string(readLine(data))};
                 materials.push_back(material);
             }
-            skipLine(stream);
+            skipLine(data);
         }
         else if (c == 'N')
         {
@@ -348,12 +309,17 @@ std::vector<Material> OBJLoader::LoadMaterial(const std::string &path)
                 ERROR("Keyword newmtl mandatory");
                 return {};
             }
-            c = stream.get();
+            data.remove_prefix(1);
+            c = data.empty() ? '\n' : data.front();
+            if (c != '\n')
+            {
+                data.remove_prefix(1);
+            }
             // specular exponent
             if (c == 's')
             {
-                ignoreSpaces(stream);
-                std::optional<float> number = readNumber(stream);
+                ignoreSpaces(data);
+                std::optional<float> number = readNumber(data);
                 if (number)
                 {
                     Material &active = materials.back();
@@ -361,14 +327,15 @@ std::vector<Material> OBJLoader::LoadMaterial(const std::string &path)
                 }
                 else
                 {
+                    ERROR("Parsing specular exponent failed at line: " << line);
                     return {};
                 }
             }
             // optic density
             else if (c == 'i')
             {
-                ignoreSpaces(stream);
-                std::optional<float> number = readNumber(stream);
+                ignoreSpaces(data);
+                std::optional<float> number = readNumber(data);
                 if (number)
                 {
                     Material &active = materials.back();
@@ -376,14 +343,15 @@ std::vector<Material> OBJLoader::LoadMaterial(const std::string &path)
                 }
                 else
                 {
+                    ERROR("Parsing optic density failed at line: " << line);
                     return {};
                 }
             }
             else
             {
-                ERROR("Unknown keyword " << BOLD("N" + c) << " at line: " << line);
+                ERROR("Unknown keyword " << BOLD("N" << c) << " at line: " << line);
             }
-            skipLine(stream);
+            skipLine(data);
         }
         else if (c == 'd')
         {
@@ -392,8 +360,9 @@ std::vector<Material> OBJLoader::LoadMaterial(const std::string &path)
                 ERROR("Keyword newmtl mandatory");
                 return {};
             }
-            ignoreSpaces(stream);
-            std::optional<float> number = readNumber(stream);
+            data.remove_prefix(1);
+            ignoreSpaces(data);
+            std::optional<float> number = readNumber(data);
             if (number)
             {
                 Material &active = materials.back();
@@ -401,9 +370,10 @@ std::vector<Material> OBJLoader::LoadMaterial(const std::string &path)
             }
             else
             {
+                ERROR("Parsing alpha failed at line: " << line);
                 return {};
             }
-            skipLine(stream);
+            skipLine(data);
         }
         else if (c == 'm')
         {
@@ -412,61 +382,59 @@ std::vector<Material> OBJLoader::LoadMaterial(const std::string &path)
                 ERROR("Keyword newmtl mandatory");
                 return {};
             }
-            stream.unget();
-            std::string token = readWord(stream);
-            ignoreSpaces(stream);
+            std::string_view token = readWord(data);
+            ignoreSpaces(data);
             Material &active = materials.back();
             std::string texturePath;
             if (token == "map_Kd" || token == "map_Ks" || token == "map_Ka" || token == "map_Bump")
             {
-                std::filesystem::path texturePath = directory + "/" + readLine(stream);
+                std::filesystem::path texturePath = directory + "/" + std::string(readLine(data));
                 if (!std::filesystem::exists(texturePath))
                 {
                     ERROR("Texture file doesn't exist: " << texturePath.string());
-                    skipLine(stream);
+                    skipLine(data);
                     continue;
                 }
-                std::optional<Texture> texture = LoadTexture(texturePath.string());
-                if (texture)
+                // uploaded with the mesh
+                Texture texture;
+                texture.path = texturePath.string();
+                std::string_view type = token.substr(4);
+                if (type == "Kd")
                 {
-                    std::string type = token.substr(4);
-                    if (type == "Kd")
-                    {
-                        (*texture).type = TextureType::DIFFUSE;
-                        active.texture_diffuse = *texture;
-                    }
-                    else if (type == "Ks")
-                    {
-                        (*texture).type = TextureType::SPECULAR;
-                        active.texture_specular = *texture;
-                    }
-                    else if (type == "Ka")
-                    {
-                        (*texture).type = TextureType::AMBIENT;
-                        active.texture_ambiant = *texture;
-                    }
-                    else if (type == "Bump")
-                    {
-                        (*texture).type = TextureType::NORMAL;
-                        active.texture_normal = *texture;
-                    }
+                    texture.type = TextureType::DIFFUSE;
+                    active.texture_diffuse = texture;
+                }
+                else if (type == "Ks")
+                {
+                    texture.type = TextureType::SPECULAR;
+                    active.texture_specular = texture;
+                }
+                else if (type == "Ka")
+                {
+                    texture.type = TextureType::AMBIENT;
+                    active.texture_ambiant = texture;
+                }
+                else if (type == "Bump")
+                {
+                    texture.type = TextureType::NORMAL;
+                    active.texture_normal = texture;
                 }
             }
             else
             {
                 ERROR("Unknown keyword " << BOLD(token) << " at line: " << line);
             }
-            skipLine(stream);
+            skipLine(data);
         }
         else if (c == '\n')
         {
             line++;
+            data.remove_prefix(1);
         }
         else
         {
-            skipLine(stream);
+            skipLine(data);
         }
-        c = stream.get();
     }
 
     INFO("Loaded " << materials.size() << " materials");
@@ -476,328 +444,445 @@ std::vector<Material> OBJLoader::LoadMaterial(const std::string &path)
 
 std::optional<Texture> OBJLoader::LoadTexture(const std::string &path)
 {
-    unsigned int textureID;
-    glGenTextures(1, &textureID);
+    return tools::LoadTexture(path);
+}
 
-    // stbi_set_flip_vertically_on_load(true); // not sure why I need to flip and sometimes no, we'll look into it later on
+std::vector<OBJLoader::Chunk> OBJLoader::splitChunks(std::string_view data, size_t count)
+{
+    count = std::clamp<size_t>(data.size() / MIN_CHUNK_SIZE, 1, std::max<size_t>(count, 1));
+    size_t target = data.size() / count;
 
-    int width, height, nrComponents;
-    unsigned char *data = stbi_load(path.c_str(), &width, &height, &nrComponents, 0);
-    if (data)
+    std::vector<Chunk> chunks;
+    chunks.reserve(count);
+    while (!data.empty())
     {
-        GLenum format;
-        if (nrComponents == 1)
-            format = GL_RED;
-        else if (nrComponents == 3)
-            format = GL_RGB;
-        else if (nrComponents == 4)
-            format = GL_RGBA;
+        size_t end = data.size();
+        if (chunks.size() + 1 < count && target < data.size())
+        {
+            end = data.find('\n', target);
+            end = end == std::string_view::npos ? data.size() : end + 1;
+        }
+        chunks.push_back({});
+        chunks.back().data = data.substr(0, end);
+        data.remove_prefix(end);
+    }
+    return chunks;
+}
+
+void OBJLoader::parseChunk(Chunk &chunk)
+{
+    std::string_view data = chunk.data;
+
+    auto toIndex = [](int raw, size_t count, uint8_t flag, uint8_t &relative) -> int
+    {
+        // OBJ indices are 1-based, negative ones count backward from the last attribute read so far
+        if (raw > 0)
+        {
+            return raw - 1;
+        }
+        if (raw < 0)
+        {
+            relative |= flag;
+            return static_cast<int>(count) + raw;
+        }
+        return -1;
+    };
+
+    int line = 1;
+    while (!data.empty())
+    {
+        char c = data.front();
+        // comment
+        if (c == '#')
+        {
+            skipLine(data);
+        }
+        // object name
+        else if (c == 'o')
+        {
+            data.remove_prefix(1);
+            ignoreSpaces(data);
+            if (data.empty() || data.front() == '\n')
+            {
+                chunk.errors.push_back({line, "Needs a group name for keyword o"});
+                chunk.failed = true;
+                return;
+            }
+            chunk.statements.push_back({Statement::Type::Object, readLine(data), chunk.faces.size(), line});
+        }
+        // vertices
+        else if (c == 'v')
+        {
+            data.remove_prefix(1);
+            c = data.empty() ? '\n' : data.front();
+            // texture vertices
+            if (c == 't')
+            {
+                data.remove_prefix(1);
+                ignoreSpaces(data);
+                std::optional<glm::vec2> vt = readVec2(data);
+                if (vt)
+                {
+                    chunk.texcoords.push_back(*vt);
+                }
+                else
+                {
+                    chunk.errors.push_back({line, "Parsing texture vertex failed"});
+                }
+            }
+            // normals vertices
+            else if (c == 'n')
+            {
+                data.remove_prefix(1);
+                ignoreSpaces(data);
+                std::optional<glm::vec3> vn = readVec3(data);
+                if (vn)
+                {
+                    chunk.normals.push_back(*vn);
+                }
+                else
+                {
+                    chunk.errors.push_back({line, "Parsing vertex normal failed"});
+                }
+            }
+            // parameter space vertices
+            else if (c == 'p')
+            {
+            }
+            // geometric vertices
+            else if (c == ' ')
+            {
+                ignoreSpaces(data);
+                std::optional<glm::vec3> v = readVec3(data);
+                if (v)
+                {
+                    chunk.positions.push_back(*v);
+                }
+                else
+                {
+                    chunk.errors.push_back({line, "Parsing geometric vertex failed"});
+                }
+            }
+            else
+            {
+                chunk.errors.push_back({line, "Unknown keyword"});
+            }
+            skipLine(data);
+        }
+        // face
+        else if (c == 'f')
+        {
+            data.remove_prefix(1);
 
-        glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
+            Face face = {.first = chunk.corners.size(), .count = 0};
+            while (!data.empty() && data.front() != '\n')
+            {
+                ignoreSpaces(data);
+                std::optional<Triplet> triplet = readTriplet(data);
+                if (!triplet)
+                {
+                    break;
+                }
 
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+                uint8_t relative = 0;
+                Triplet corner;
+                corner.v = toIndex(triplet->v, chunk.positions.size(), RELATIVE_V, relative);
+                corner.vt = toIndex(triplet->vt, chunk.texcoords.size(), RELATIVE_VT, relative);
+                corner.vn = toIndex(triplet->vn, chunk.normals.size(), RELATIVE_VN, relative);
+                chunk.corners.push_back(corner);
+                chunk.relative.push_back(relative);
+                face.count++;
+            }
+            skipLine(data);
 
-        glBindTexture(GL_TEXTURE_2D, 0);
-        stbi_image_free(data);
+            if (face.count < 3)
+            {
+                chunk.errors.push_back({line, "Face needs at least three triplets"});
+                chunk.failed = true;
+                return;
+            }
+            chunk.faces.push_back(face);
+        }
+        // smoothing group
+        else if (c == 's')
+        {
+            data.remove_prefix(1);
+            ignoreSpaces(data);
+            skipLine(data);
+        }
+        else if (c == 'u')
+        {
+            if (readWord(data) == "usemtl")
+            {
+                ignoreSpaces(data);
+                chunk.statements.push_back({Statement::Type::UseMaterial, readLine(data), chunk.faces.size(), line});
+            }
+            skipLine(data);
+        }
+        else if (c == 'm')
+        {
+            if (readWord(data) == "mtllib")
+            {
+                ignoreSpaces(data);
+                chunk.statements.push_back({Statement::Type::MaterialLibrary, readLine(data), chunk.faces.size(), line});
+            }
+            skipLine(data);
+        }
+        else if (c == '\n')
+        {
+            line++;
+            data.remove_prefix(1);
+        }
+        else
+        {
+            // ignore line
+            skipLine(data);
+        }
+    }
 
-        Texture texture;
-        texture.id = textureID;
-        texture.path = path;
-        return texture;
+    chunk.lines = line - 1;
+}
+
+bool OBJLoader::buildMesh(Mesh &mesh, const std::vector<FaceRange> &faces, const std::vector<Chunk> &chunks,
+                          const std::vector<glm::vec3> &positions, const std::vector<glm::vec2> &texcoords, const std::vector<glm::vec3> &normals)
+{
+    size_t corners = 0;
+    for (const FaceRange &range : faces)
+    {
+        const Chunk &chunk = chunks[range.chunk];
+        for (size_t i = range.begin; i < range.end; i++)
+        {
+            corners += chunk.faces[i].count;
+        }
     }
-    else
+
+    // shared corners make unique vertices far fewer than corners, half of them is a generous estimate
+    FlatHashMap<Triplet, unsigned int, TripletHash> registered_vertices(corners / 2);
+    mesh.vertices.reserve(corners / 2);
+    mesh.indices.reserve(corners * 3 / 2);
+
+    auto registerVertex = [&](const Triplet &vertex) -> bool
     {
-        ERROR("Failed to load texture, param: " << path);
-        stbi_image_free(data);
-        return {};
+        if (const unsigned int *index = registered_vertices.Find(vertex))
+        {
+            mesh.indices.push_back(*index);
+            return true;
+        }
+
+        if (vertex.v < 0 || vertex.v >= static_cast<int>(positions.size()) ||
+            vertex.vt < -1 || vertex.vt >= static_cast<int>(texcoords.size()) ||
+            vertex.vn < -1 || vertex.vn >= static_cast<int>(normals.size()))
+        {
+            return false;
+        }
+
+        mesh.vertices.push_back({
+            .position = positions[vertex.v],
+            .normal = vertex.vn > -1 ? normals[vertex.vn] : glm::vec3(0.0f),
+            .tcoords = vertex.vt > -1 ? texcoords[vertex.vt] : glm::vec2(0.0f),
+        });
+        unsigned int index = static_cast<unsigned int>(mesh.vertices.size() - 1);
+        registered_vertices.TryEmplace(vertex, index);
+        mesh.indices.push_back(index);
+        return true;
+    };
+
+    for (const FaceRange &range : faces)
+    {
+        const Chunk &chunk = chunks[range.chunk];
+        for (size_t i = range.begin; i < range.end; i++)
+        {
+            const Face &face = chunk.faces[i];
+            const Triplet *triplets = chunk.corners.data() + face.first;
+
+            // triangulate face
+            for (size_t j = 1; j < face.count - 1; ++j)
+            {
+                if (!registerVertex(triplets[0]) || !registerVertex(triplets[j]) || !registerVertex(triplets[j + 1]))
+                {
+                    return false;
+                }
+            }
+        }
     }
+
+    return true;
 }
 
-std::optional<OBJLoader::Triplet> OBJLoader::readTriplet(std::ifstream &stream)
+std::optional<OBJLoader::Triplet> OBJLoader::readTriplet(std::string_view &data)
 {
-    OBJLoader::Triplet result;
+    // raw values as written in the file, 0 marks a missing component
+    OBJLoader::Triplet result = {.v = 0, .vt = 0, .vn = 0};
 
-    std::optional<int> number = readInteger(stream, false);
+    std::optional<int> number = readInteger(data, false);
     if (number)
     {
-        // v : 0-indexed
-        result.v = (*number) - 1;
+        result.v = *number;
     }
     else
     {
-        ERROR("Missing geometric vertex in face");
         return {};
     }
 
-    char c = stream.peek();
-    if (c == ' ' || c == '\n' || c == EOF)
+    if (data.empty() || data.front() == ' ' || data.front() == '\n')
     {
         return result;
     }
 
-    if (c != '/')
+    if (data.front() != '/')
     {
-        ERROR("Invalid triplet format");
         return {};
     }
-    stream.get();
+    data.remove_prefix(1);
 
-    number = readInteger(stream, false);
+    number = readInteger(data, false);
     if (number)
     {
-        // vt : 0-indexed
-        result.vt = (*number) - 1;
+        result.vt = *number;
     }
 
-    if (stream.peek() != '/')
+    if (data.empty() || data.front() != '/')
     {
-        ERROR("Invalid triplet format");
         return {};
     }
-    stream.get();
+    data.remove_prefix(1);
 
-    number = readInteger(stream, false);
+    number = readInteger(data, false);
     if (number)
     {
-        // vn : 0-indexed
-        result.vn = (*number) - 1;
+        result.vn = *number;
     }
 
     return result;
 }
 
-std::optional<glm::vec2> OBJLoader::readVec2(std::ifstream &stream)
+std::optional<glm::vec2> OBJLoader::readVec2(std::string_view &data)
 {
     glm::vec2 result;
 
-    std::optional<float> number = readNumber(stream);
+    std::optional<float> number = readNumber(data);
     if (number)
     {
         result.x = *number;
     }
     else
     {
-        ERROR("Expects x component");
         return {};
     }
-    if (stream.peek() != ' ')
+    if (data.empty() || data.front() != ' ')
     {
-        ERROR("Expects y component");
         return {};
     }
-    ignoreSpaces(stream);
-    number = readNumber(stream);
+    ignoreSpaces(data);
+    number = readNumber(data);
     if (number)
     {
         result.y = *number;
     }
     else
     {
-        ERROR("Expects y component");
         return {};
     }
 
     return result;
 }
 
-std::optional<glm::vec3> OBJLoader::readVec3(std::ifstream &stream)
+std::optional<glm::vec3> OBJLoader::readVec3(std::string_view &data)
 {
     glm::vec3 result;
 
-    std::optional<float> number = readNumber(stream);
+    std::optional<float> number = readNumber(data);
     if (number)
     {
         result.x = *number;
     }
     else
     {
-        ERROR("Expects x component");
         return {};
     }
 
-    if (stream.peek() != ' ')
+    if (data.empty() || data.front() != ' ')
     {
-        ERROR("Expects y component");
         return {};
     }
-    ignoreSpaces(stream);
-    number = readNumber(stream);
+    ignoreSpaces(data);
+    number = readNumber(data);
     if (number)
     {
         result.y = *number;
     }
     else
     {
-        ERROR("Expects y component");
         return {};
     }
 
-    if (stream.peek() != ' ')
+    if (data.empty() || data.front() != ' ')
     {
-        ERROR("Expects z component");
         return {};
     }
-    ignoreSpaces(stream);
-    number = readNumber(stream);
+    ignoreSpaces(data);
+    number = readNumber(data);
     if (number)
     {
         result.z = *number;
     }
     else
     {
-        ERROR("Expects z component");
         return {};
     }
 
     return result;
 }
 
-std::optional<float> OBJLoader::readNumber(std::ifstream &stream)
+std::optional<float> OBJLoader::readNumber(std::string_view &data)
 {
-    std::string data;
-    char c = stream.get();
-    bool hasDecimal = false;
-
-    if (c == '-' || c == '+')
-    {
-        data += c;
-        c = stream.get();
-    }
-
-    while (!stream.fail())
-    {
-        if (c >= '0' && c <= '9')
-        {
-            data += c;
-        }
-        else if (c == '.' || c == ',')
-        {
-            if (!hasDecimal)
-            {
-                data += c;
-                hasDecimal = true;
-            }
-            else
-            {
-                ERROR("Invalid number in stream");
-                return {};
-            }
-        }
-        else
-        {
-            stream.unget();
-            break;
-        }
-        c = stream.get();
-    }
-
-    if (data.empty())
-    {
-        ERROR("No number found");
-        return {};
-    }
-    return std::stof(data);
+    return tools::ParseFloat(data);
 }
 
-std::optional<int> OBJLoader::readInteger(std::ifstream &stream, bool strict)
+std::optional<int> OBJLoader::readInteger(std::string_view &data, bool strict)
 {
-    int value = 0;
-
-    bool hasDigits = false;
-    bool isNegative = false;
-
-    int c = stream.peek();
-    if (c == '-' || c == '+')
+    std::optional<int> number = tools::ParseInt(data);
+    if (!number && strict)
     {
-        isNegative = (c == '-');
-        stream.get(); // consume sign
+        ERROR("Invalid integer in stream");
     }
-
-    while (!stream.fail())
-    {
-        c = stream.peek();
-        if (c >= '0' && c <= '9')
-        {
-            hasDigits = true;
-            value = value * 10 + (c - '0');
-            stream.get(); // consume digit
-        }
-        else
-        {
-            break;
-        }
-    }
-    if (!hasDigits)
-    {
-        if (strict)
-        {
-            ERROR("Invalid integer in stream");
-        }
-        return std::nullopt;
-    }
-
-    return isNegative ? -value : value;
+    return number;
 }
 
-std::string OBJLoader::readLine(std::ifstream &stream)
+std::string_view OBJLoader::readLine(std::string_view &data)
 {
-    std::string data;
-    char c = stream.get();
-    while (!stream.fail() && c != '\n')
-    {
-        data += c;
-        c = stream.get();
-    }
-    if (!stream.fail())
+    size_t end = data.find('\n');
+    if (end == std::string_view::npos)
     {
-        stream.unget(); // put the eol into buffer
+        end = data.size();
     }
-    return data;
+    std::string_view line = data.substr(0, end);
+    data.remove_prefix(end); // leave the eol in the view
+    return line;
 }
 
-std::string OBJLoader::readWord(std::ifstream &stream)
+std::string_view OBJLoader::readWord(std::string_view &data)
 {
-    std::string name;
-    char c = stream.get();
-    while (!stream.fail() && !std::isspace(c))
-    {
-        name += c;
-        c = stream.get();
-    }
-    if (!stream.fail())
+    size_t end = 0;
+    while (end < data.size() && !std::isspace(static_cast<unsigned char>(data[end])))
     {
-        stream.unget(); // put the space token into buffer
+        end++;
     }
-    return name;
+    std::string_view word = data.substr(0, end);
+    data.remove_prefix(end); // leave the space token in the view
+    return word;
 }
 
-void OBJLoader::ignoreSpaces(std::ifstream &stream)
+void OBJLoader::ignoreSpaces(std::string_view &data)
 {
-    unsigned char c = stream.get();
-    while (!stream.fail() && c == ' ')
-    {
-        c = stream.get();
-    }
-    if (!stream.fail())
+    while (!data.empty() && data.front() == ' ')
     {
-        stream.unget(); // add back the non space character to buffer
+        data.remove_prefix(1);
     }
 }
 
-void OBJLoader::skipLine(std::ifstream &stream)
+void OBJLoader::skipLine(std::string_view &data)
 {
-    char c = stream.get();
-    while (!stream.fail() && c != '\n')
-    {
-        c = stream.get();
-    }
-    if (!stream.fail())
-    {
-        stream.unget();
-    }
+    size_t end = data.find('\n');
+    data.remove_prefix(end == std::string_view::npos ? data.size() : end);
 }
\ No newline at end of file
@@ -1,8 +1,11 @@
 #pragma once
 
 #include <print>
-#include <fstream>
+#include <atomic>
+#include <cctype>
+#include <cstdint>
 #include <string>
+#include <string_view>
 #include <optional>
 #include <filesystem>
 
@@ -11,7 +14,14 @@
 #include <stb_image.h>
 
 #include "auto_loader.hpp"
+#include "core/thread_pool.hpp"
+#include "resources/mapped_file.hpp"
+#include "resources/number_parser.hpp"
 #include "render/mesh.hpp"
+#include "render/mesh_optimizer.hpp"
+#include "render/mesh_simplifier.hpp"
+#include "render/mesh_tangents.hpp"
+#include "helpers/flat_hash_map.hpp"
 #include "helpers/log.hpp"
 
 DEFINE_LOADER(OBJLoader, obj)
@@ -65,18 +75,93 @@ public:
     // };
 
 public:
-    std::vector<Mesh> Load(const std::string &path) override;
+    std::vector<Mesh> Parse(const std::string &path) override;
     std::vector<Material> LoadMaterial(const std::string &path);
     std::optional<Texture> LoadTexture(const std::string &path);
 
 private:
-    std::optional<OBJLoader::Triplet> readTriplet(std::ifstream & stream);
-    std::optional<glm::vec2> readVec2(std::ifstream & stream);
-    std::optional<glm::vec3> readVec3(std::ifstream & stream);
-    std::optional<float> readNumber(std::ifstream & stream);
-    std::optional<int> readInteger(std::ifstream & stream, bool strict = true);
-    std::string readLine(std::ifstream & stream);
-    std::string readWord(std::ifstream & stream);
-    void ignoreSpaces(std::ifstream & stream);
-    void skipLine(std::ifstream & stream);
+    // files smaller than this are parsed as a single chunk
+    static constexpr size_t MIN_CHUNK_SIZE = 1 << 20;
+
+    // which components of a face corner were written as relative (negative) indices
+    static constexpr uint8_t RELATIVE_V = 1 << 0;
+    static constexpr uint8_t RELATIVE_VT = 1 << 1;
+    static constexpr uint8_t RELATIVE_VN = 1 << 2;
+
+    struct Face
+    {
+        size_t first = 0; // first corner in Chunk::corners
+        size_t count = 0;
+    };
+
+    // records that depend on what came before them in the file, replayed in order once all chunks are parsed
+    struct Statement
+    {
+        enum class Type
+        {
+            Object,
+            UseMaterial,
+            MaterialLibrary,
+        };
+
+        Type type;
+        std::string_view argument;
+        size_t face = 0; // number of faces of the chunk read before this statement
+        int line = 0;
+    };
+
+    struct ChunkError
+    {
+        int line = 0;
+        std::string message;
+    };
+
+    struct Chunk
+    {
+        std::string_view data;
+
+        std::vector<glm::vec3> positions;
+        std::vector<glm::vec2> texcoords;
+        std::vector<glm::vec3> normals;
+
+        // 0-based, relative ones are relative to the first attribute of the chunk until merged
+        std::vector<Triplet> corners;
+        std::vector<uint8_t> relative;
+        std::vector<Face> faces;
+        std::vector<Statement> statements;
+
+        std::vector<ChunkError> errors;
+        bool failed = false;
+        int lines = 0;
+    };
+
+    struct ChunkOffsets
+    {
+        size_t positions = 0;
+        size_t texcoords = 0;
+        size_t normals = 0;
+    };
+
+    struct FaceRange
+    {
+        size_t chunk = 0;
+        size_t begin = 0;
+        size_t end = 0;
+    };
+
+    std::vector<Chunk> splitChunks(std::string_view data, size_t count);
+    void parseChunk(Chunk & chunk);
+    bool buildMesh(Mesh & mesh, const std::vector<FaceRange> &faces, const std::vector<Chunk> &chunks,
+                   const std::vector<glm::vec3> &positions, const std::vector<glm::vec2> &texcoords, const std::vector<glm::vec3> &normals);
+
+    // all readers consume from the front of the given view, leaving it right after what was read
+    std::optional<OBJLoader::Triplet> readTriplet(std::string_view & data);
+    std::optional<glm::vec2> readVec2(std::string_view & data);
+    std::optional<glm::vec3> readVec3(std::string_view & data);
+    std::optional<float> readNumber(std::string_view & data);
+    std::optional<int> readInteger(std::string_view & data, bool strict = true);
+    std::string_view readLine(std::string_view & data);
+    std::string_view readWord(std::string_view & data);
+    void ignoreSpaces(std::string_view & data);
+    void skipLine(std::string_view & data);
 };
\ No newline at end of file
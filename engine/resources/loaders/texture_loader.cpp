@@ -0,0 +1,193 @@
+#include "texture_loader.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+
+#include "resources/block_compression.hpp"
+
+namespace
+{
+    constexpr uint32_t makeFourCC(const char (&code)[5])
+    {
+        return static_cast<uint32_t>(code[0]) | (static_cast<uint32_t>(code[1]) << 8) | (static_cast<uint32_t>(code[2]) << 16) |
+               (static_cast<uint32_t>(code[3]) << 24);
+    }
+
+    constexpr uint32_t DDS_MAGIC = makeFourCC("DDS ");
+    constexpr uint32_t DDPF_FOURCC = 0x4;
+    constexpr uint32_t DDSCAPS2_CUBEMAP = 0x200;
+    constexpr uint32_t DDSCAPS2_VOLUME = 0x200000;
+    constexpr uint32_t DDS_DIMENSION_TEXTURE2D = 3;
+
+    // DXGI_FORMAT values of the extended header, the sRGB ones are sampled as unorm like every texture of the engine
+    constexpr uint32_t DXGI_FORMAT_BC1_UNORM = 71;
+    constexpr uint32_t DXGI_FORMAT_BC1_UNORM_SRGB = 72;
+    constexpr uint32_t DXGI_FORMAT_BC3_UNORM = 77;
+    constexpr uint32_t DXGI_FORMAT_BC3_UNORM_SRGB = 78;
+    constexpr uint32_t DXGI_FORMAT_BC5_UNORM = 83;
+    constexpr uint32_t DXGI_FORMAT_BC7_UNORM = 98;
+    constexpr uint32_t DXGI_FORMAT_BC7_UNORM_SRGB = 99;
+
+    struct DDSPixelFormat
+    {
+        uint32_t size;
+        uint32_t flags;
+        uint32_t fourCC;
+        uint32_t rgbBitCount;
+        uint32_t masks[4];
+    };
+
+    struct DDSHeader
+    {
+        uint32_t size;
+        uint32_t flags;
+        uint32_t height;
+        uint32_t width;
+        uint32_t pitchOrLinearSize;
+        uint32_t depth;
+        uint32_t mipMapCount;
+        uint32_t reserved[11];
+        DDSPixelFormat pixelFormat;
+        uint32_t caps[4];
+        uint32_t reserved2;
+    };
+
+    // follows DDSHeader when the four character code is DX10
+    struct DDSHeaderDX10
+    {
+        uint32_t dxgiFormat;
+        uint32_t resourceDimension;
+        uint32_t miscFlag;
+        uint32_t arraySize;
+        uint32_t miscFlags2;
+    };
+
+    static_assert(sizeof(DDSHeader) == 124);
+
+    Image::Encoding fourCCEncoding(uint32_t fourCC)
+    {
+        if (fourCC == makeFourCC("DXT1"))
+            return Image::Encoding::BC1;
+        if (fourCC == makeFourCC("DXT5"))
+            return Image::Encoding::BC3;
+        if (fourCC == makeFourCC("ATI2") || fourCC == makeFourCC("BC5U"))
+            return Image::Encoding::BC5;
+        return Image::Encoding::RAW;
+    }
+
+    Image::Encoding dxgiEncoding(uint32_t format)
+    {
+        switch (format)
+        {
+        case DXGI_FORMAT_BC1_UNORM:
+        case DXGI_FORMAT_BC1_UNORM_SRGB:
+            return Image::Encoding::BC1;
+        case DXGI_FORMAT_BC3_UNORM:
+        case DXGI_FORMAT_BC3_UNORM_SRGB:
+            return Image::Encoding::BC3;
+        case DXGI_FORMAT_BC5_UNORM:
+            return Image::Encoding::BC5;
+        case DXGI_FORMAT_BC7_UNORM:
+        case DXGI_FORMAT_BC7_UNORM_SRGB:
+            return Image::Encoding::BC7;
+        default:
+            return Image::Encoding::RAW;
+        }
+    }
+}
+
+REGISTER_TEXTURE_LOADER(KTX2Loader, ktx2);
+REGISTER_TEXTURE_LOADER(DDSLoader, dds);
+
+std::optional<Image> KTX2Loader::Parse(const std::string &path)
+{
+    MappedFile file(path);
+    if (!file.IsOpen())
+    {
+        ERROR("File not read successfully, param: " << path);
+        return {};
+    }
+    return KTX2::Parse(file.GetView(), path);
+}
+
+std::optional<Image> DDSLoader::Parse(const std::string &path)
+{
+    MappedFile file(path);
+    if (!file.IsOpen())
+    {
+        ERROR("File not read successfully, param: " << path);
+        return {};
+    }
+
+    std::string_view data = file.GetView();
+    uint32_t magic = 0;
+    DDSHeader header;
+    if (data.size() < sizeof(magic) + sizeof(header))
+    {
+        ERROR("Not a DDS texture: " << path);
+        return {};
+    }
+    std::memcpy(&magic, data.data(), sizeof(magic));
+    std::memcpy(&header, data.data() + sizeof(magic), sizeof(header));
+    if (magic != DDS_MAGIC || header.size != sizeof(DDSHeader))
+    {
+        ERROR("Not a DDS texture: " << path);
+        return {};
+    }
+
+    size_t offset = sizeof(magic) + sizeof(header);
+    Image::Encoding encoding = Image::Encoding::RAW;
+    if ((header.pixelFormat.flags & DDPF_FOURCC) && header.pixelFormat.fourCC == makeFourCC("DX10"))
+    {
+        DDSHeaderDX10 extended;
+        if (data.size() < offset + sizeof(extended))
+        {
+            ERROR("DDS texture is truncated: " << path);
+            return {};
+        }
+        std::memcpy(&extended, data.data() + offset, sizeof(extended));
+        offset += sizeof(extended);
+        if (extended.resourceDimension != DDS_DIMENSION_TEXTURE2D || extended.arraySize > 1)
+        {
+            ERROR("Unsupported DDS texture (only 2D): " << path);
+            return {};
+        }
+        encoding = dxgiEncoding(extended.dxgiFormat);
+    }
+    else if (header.pixelFormat.flags & DDPF_FOURCC)
+    {
+        encoding = fourCCEncoding(header.pixelFormat.fourCC);
+    }
+
+    if (encoding == Image::Encoding::RAW)
+    {
+        ERROR("Unsupported DDS format (BC1, BC3, BC5 or BC7 only): " << path);
+        return {};
+    }
+    if (header.width == 0 || header.height == 0 || (header.caps[1] & (DDSCAPS2_CUBEMAP | DDSCAPS2_VOLUME)))
+    {
+        ERROR("Unsupported DDS texture (only 2D): " << path);
+        return {};
+    }
+
+    Image image;
+    image.width = static_cast<int>(header.width);
+    image.height = static_cast<int>(header.height);
+    image.encoding = encoding;
+    image.channels = BlockCompression::GetChannels(encoding);
+    // the levels follow each other from the full size one
+    image.levels.resize(std::clamp(header.mipMapCount, 1u, 32u));
+    for (size_t level = 0; level < image.levels.size(); level++)
+    {
+        size_t size = BlockCompression::GetLevelSize(encoding, image.channels, std::max(1, image.width >> level), std::max(1, image.height >> level));
+        if (size > data.size() - offset)
+        {
+            ERROR("DDS texture is truncated: " << path);
+            return {};
+        }
+        image.levels[level].assign(data.data() + offset, data.data() + offset + size);
+        offset += size;
+    }
+    return image;
+}
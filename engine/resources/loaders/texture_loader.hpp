@@ -0,0 +1,24 @@
+#pragma once
+
+#include <string>
+#include <optional>
+
+#include "auto_loader.hpp"
+#include "resources/image.hpp"
+#include "resources/ktx2.hpp"
+#include "resources/mapped_file.hpp"
+#include "helpers/log.hpp"
+
+// KTX 2.0 textures, the format of the cooked textures (see ktx2.hpp)
+DEFINE_TEXTURE_LOADER(KTX2Loader, ktx2)
+{
+public:
+    std::optional<Image> Parse(const std::string &path) override;
+};
+
+// DirectDraw Surface textures holding BC1 (DXT1), BC3 (DXT5), BC5 (ATI2) or BC7 blocks, as exported by most texture tools
+DEFINE_TEXTURE_LOADER(DDSLoader, dds)
+{
+public:
+    std::optional<Image> Parse(const std::string &path) override;
+};
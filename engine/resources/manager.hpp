@@ -2,11 +2,19 @@
 
 #include <unordered_map>
 #include <stdexcept>
+#include <exception>
+#include <future>
 #include <memory>
+#include <chrono>
 #include <typeindex>
 #include <typeinfo>
 
 #include "registry.hpp"
+#include "handle.hpp"
+#include "async_loader.hpp"
+#include "upload_queue.hpp"
+#include "core/thread_pool.hpp"
+#include "helpers/log.hpp"
 
 class ResourceManager
 {
@@ -28,6 +36,63 @@ public:
         }
     }
 
+    /**
+     * Loads a resource in the background with AsyncLoader<T>: the CPU side runs on the worker pool and the
+     * GL side is queued for ProcessUploads. The resource is registered under iId once fully uploaded,
+     * if iId got registered meanwhile the first one is kept.
+     */
+    template <typename T, typename... Args>
+    ResourceHandle<T> LoadAsync(const std::string &iId, Args... iArgs)
+    {
+        auto aPromise = std::make_shared<std::promise<std::shared_ptr<T>>>();
+        ResourceHandle<T> aHandle(aPromise->get_future().share());
+
+        auto aRegistryIterator = m_registries.find(typeid(T));
+        if (aRegistryIterator != m_registries.end())
+        {
+            ResourceRegistry<T> *aRegistry = static_cast<ResourceRegistry<T> *>(aRegistryIterator->second.get());
+            if (aRegistry->Contains(iId))
+            {
+                aPromise->set_value(aRegistry->Get(iId));
+                return aHandle;
+            }
+        }
+
+        // the queue is shared with the task, it may still be running when the manager goes away
+        std::shared_ptr<UploadQueue> aUploads = m_uploads;
+        ThreadPool::Get().Submit([this, aUploads, aPromise, iId, ... iArgs = std::move(iArgs)]()
+                                 {
+                                     try
+                                     {
+                                         std::shared_ptr<T> aResource = AsyncLoader<T>::Load(*aUploads, iArgs...);
+                                         // queued after every upload of the resource, only run by ProcessUploads so the manager is alive
+                                         aUploads->Push([this, aPromise, iId, aResource]()
+                                                        { aPromise->set_value(add<T>(iId, aResource)); });
+                                     }
+                                     catch (...)
+                                     {
+                                         aUploads->Push([aPromise, aError = std::current_exception(), iId]()
+                                                        {
+                                                            ERROR("Asynchronous loading failed, id: " << iId);
+                                                            aPromise->set_exception(aError); });
+                                     } });
+
+        return aHandle;
+    }
+
+    /**
+     * Runs the GL side of the asynchronous loads for at most iBudget (at least one job), once per frame on the GL thread.
+     */
+    void ProcessUploads(std::chrono::microseconds iBudget)
+    {
+        m_uploads->Drain(iBudget);
+    }
+
+    bool HasPendingUploads() const
+    {
+        return !m_uploads->Empty();
+    }
+
     template <typename T>
     void Unload(const std::string &iId)
     {
@@ -82,5 +147,17 @@ public:
     }
 
 private:
+    template <typename T>
+    std::shared_ptr<T> add(const std::string &iId, std::shared_ptr<T> iResource)
+    {
+        std::unique_ptr<IRegistry> &aRegistry = m_registries[typeid(T)];
+        if (!aRegistry)
+        {
+            aRegistry = std::make_unique<ResourceRegistry<T>>();
+        }
+        return static_cast<ResourceRegistry<T> *>(aRegistry.get())->Add(iId, std::move(iResource));
+    }
+
     std::unordered_map<std::type_index, std::unique_ptr<IRegistry>> m_registries;
+    std::shared_ptr<UploadQueue> m_uploads = std::make_shared<UploadQueue>();
 };
\ No newline at end of file
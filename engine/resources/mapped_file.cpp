@@ -0,0 +1,187 @@
+#include "mapped_file.hpp"
+
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#define NOGDI
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "helpers/log.hpp"
+
+MappedFile::MappedFile(const std::string &iFilepath)
+{
+    Open(iFilepath);
+}
+
+MappedFile::~MappedFile()
+{
+    Close();
+}
+
+MappedFile::MappedFile(MappedFile &&iOther) noexcept
+{
+    *this = std::move(iOther);
+}
+
+MappedFile &MappedFile::operator=(MappedFile &&iOther) noexcept
+{
+    if (this != &iOther)
+    {
+        Close();
+        m_data = std::exchange(iOther.m_data, nullptr);
+        m_size = std::exchange(iOther.m_size, 0);
+        m_bOpen = std::exchange(iOther.m_bOpen, false);
+#ifdef _WIN32
+        m_file = std::exchange(iOther.m_file, nullptr);
+        m_mapping = std::exchange(iOther.m_mapping, nullptr);
+#else
+        m_fd = std::exchange(iOther.m_fd, -1);
+#endif
+    }
+    return *this;
+}
+
+#ifdef _WIN32
+
+bool MappedFile::Open(const std::string &iFilepath)
+{
+    Close();
+
+    HANDLE aFile = CreateFileA(iFilepath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (aFile == INVALID_HANDLE_VALUE)
+    {
+        ERROR("File not mapped, could not open: " << iFilepath);
+        return false;
+    }
+
+    LARGE_INTEGER aSize;
+    if (!GetFileSizeEx(aFile, &aSize))
+    {
+        ERROR("File not mapped, could not read size: " << iFilepath);
+        CloseHandle(aFile);
+        return false;
+    }
+
+    m_file = aFile;
+    m_size = static_cast<size_t>(aSize.QuadPart);
+    m_bOpen = true;
+
+    // an empty file can't be mapped but is still a valid (empty) view
+    if (m_size == 0)
+    {
+        return true;
+    }
+
+    HANDLE aMapping = CreateFileMappingA(aFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (aMapping == nullptr)
+    {
+        ERROR("File not mapped, reason: CreateFileMapping failed for " << iFilepath);
+        Close();
+        return false;
+    }
+    m_mapping = aMapping;
+
+    m_data = static_cast<const char *>(MapViewOfFile(aMapping, FILE_MAP_READ, 0, 0, 0));
+    if (m_data == nullptr)
+    {
+        ERROR("File not mapped, reason: MapViewOfFile failed for " << iFilepath);
+        Close();
+        return false;
+    }
+
+    return true;
+}
+
+void MappedFile::Close()
+{
+    if (m_data != nullptr)
+    {
+        UnmapViewOfFile(m_data);
+    }
+    if (m_mapping != nullptr)
+    {
+        CloseHandle(m_mapping);
+    }
+    if (m_file != nullptr)
+    {
+        CloseHandle(m_file);
+    }
+
+    m_data = nullptr;
+    m_mapping = nullptr;
+    m_file = nullptr;
+    m_size = 0;
+    m_bOpen = false;
+}
+
+#else
+
+bool MappedFile::Open(const std::string &iFilepath)
+{
+    Close();
+
+    int aFd = ::open(iFilepath.c_str(), O_RDONLY);
+    if (aFd == -1)
+    {
+        ERROR("File not mapped, could not open: " << iFilepath);
+        return false;
+    }
+
+    struct stat aStat;
+    if (::fstat(aFd, &aStat) == -1)
+    {
+        ERROR("File not mapped, could not read size: " << iFilepath);
+        ::close(aFd);
+        return false;
+    }
+
+    m_fd = aFd;
+    m_size = static_cast<size_t>(aStat.st_size);
+    m_bOpen = true;
+
+    // an empty file can't be mapped but is still a valid (empty) view
+    if (m_size == 0)
+    {
+        return true;
+    }
+
+    void *aData = ::mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, aFd, 0);
+    if (aData == MAP_FAILED)
+    {
+        ERROR("File not mapped, reason: mmap failed for " << iFilepath);
+        Close();
+        return false;
+    }
+    // the parsers walk the file front to back
+    ::madvise(aData, m_size, MADV_SEQUENTIAL);
+
+    m_data = static_cast<const char *>(aData);
+    return true;
+}
+
+void MappedFile::Close()
+{
+    if (m_data != nullptr)
+    {
+        ::munmap(const_cast<char *>(m_data), m_size);
+    }
+    if (m_fd != -1)
+    {
+        ::close(m_fd);
+    }
+
+    m_data = nullptr;
+    m_fd = -1;
+    m_size = 0;
+    m_bOpen = false;
+}
+
+#endif
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+/**
+ * Read-only memory mapping of a whole file.
+ * The content is exposed as a std::string_view that stays valid as long as the MappedFile is alive,
+ * so parsers can walk the file with pointer cursors instead of going through a stream.
+ */
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    explicit MappedFile(const std::string &iFilepath);
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+    MappedFile(MappedFile &&iOther) noexcept;
+    MappedFile &operator=(MappedFile &&iOther) noexcept;
+
+    bool Open(const std::string &iFilepath);
+    void Close();
+
+    bool IsOpen() const { return m_bOpen; }
+    size_t GetSize() const { return m_size; }
+    std::string_view GetView() const { return {m_data, m_size}; }
+
+private:
+    const char *m_data = nullptr;
+    size_t m_size = 0;
+    bool m_bOpen = false;
+
+#ifdef _WIN32
+    void *m_file = nullptr;
+    void *m_mapping = nullptr;
+#else
+    int m_fd = -1;
+#endif
+};
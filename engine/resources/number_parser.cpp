@@ -0,0 +1,118 @@
+#include "number_parser.hpp"
+
+#include <bit>
+#include <charconv>
+#include <cmath>
+#include <limits>
+#include <system_error>
+
+#ifdef ENGINE_SIMD_SSE2
+#include <emmintrin.h>
+#endif
+
+std::optional<float> tools::ParseFloat(std::string_view &ioData)
+{
+    const char *aBegin = ioData.data();
+    const char *aEnd = aBegin + ioData.size();
+
+    // from_chars doesn't accept an explicit '+', OBJ exporters sometimes write one
+    const char *aCursor = aBegin;
+    if (aCursor != aEnd && *aCursor == '+')
+    {
+        ++aCursor;
+        if (aCursor != aEnd && *aCursor == '-')
+        {
+            return std::nullopt;
+        }
+    }
+
+    float aValue = 0.0f;
+    std::from_chars_result aResult = std::from_chars(aCursor, aEnd, aValue, std::chars_format::general);
+    if (aResult.ec == std::errc::invalid_argument)
+    {
+        return std::nullopt;
+    }
+    // out of range still consumes the token and gives what strtof would instead of failing the whole file:
+    // +-inf when it overflows, +-0 when it underflows
+    if (aResult.ec == std::errc::result_out_of_range)
+    {
+        bool aNegative = *aCursor == '-';
+        bool aOverflow;
+        double aWide = 0.0;
+        if (std::from_chars(aCursor, aResult.ptr, aWide, std::chars_format::general).ec == std::errc())
+        {
+            aOverflow = std::fabs(aWide) > std::numeric_limits<float>::max();
+        }
+        else
+        {
+            // beyond a double too, the sign of the exponent tells which way
+            std::string_view aToken(aCursor, static_cast<size_t>(aResult.ptr - aCursor));
+            size_t aExponent = aToken.find_first_of("eE");
+            aOverflow = aExponent == std::string_view::npos || aExponent + 1 >= aToken.size() || aToken[aExponent + 1] != '-';
+        }
+        aValue = aOverflow ? std::numeric_limits<float>::infinity() : 0.0f;
+        aValue = aNegative ? -aValue : aValue;
+    }
+
+    ioData.remove_prefix(static_cast<size_t>(aResult.ptr - aBegin));
+    return aValue;
+}
+
+std::optional<int> tools::ParseInt(std::string_view &ioData)
+{
+    std::string_view aData = ioData;
+
+    bool aIsNegative = false;
+    if (!aData.empty() && (aData.front() == '-' || aData.front() == '+'))
+    {
+        aIsNegative = (aData.front() == '-');
+        aData.remove_prefix(1);
+    }
+
+    size_t aDigits = ScanDigits(aData);
+    if (aDigits == 0)
+    {
+        return std::nullopt;
+    }
+
+    // the negative side goes one further than the positive one
+    unsigned int aMagnitude = 0;
+    unsigned int aLimit = static_cast<unsigned int>(std::numeric_limits<int>::max()) + (aIsNegative ? 1u : 0u);
+    std::from_chars_result aResult = std::from_chars(aData.data(), aData.data() + aDigits, aMagnitude);
+    if (aResult.ec != std::errc() || aMagnitude > aLimit)
+    {
+        return std::nullopt;
+    }
+
+    ioData.remove_prefix(ioData.size() - aData.size() + aDigits);
+    // negated as unsigned, -static_cast<int>(2147483648u) would overflow
+    return aIsNegative ? static_cast<int>(0u - aMagnitude) : static_cast<int>(aMagnitude);
+}
+
+size_t tools::ScanDigits(std::string_view iData)
+{
+    size_t aLength = 0;
+
+#ifdef ENGINE_SIMD_SSE2
+    // compare 16 characters at once against ['0', '9'], bytes >= 0x80 are negative once signed so they fall below '0'
+    const __m128i aLow = _mm_set1_epi8('0');
+    const __m128i aHigh = _mm_set1_epi8('9');
+    while (aLength + 16 <= iData.size())
+    {
+        __m128i aChunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(iData.data() + aLength));
+        __m128i aOutside = _mm_or_si128(_mm_cmplt_epi8(aChunk, aLow), _mm_cmpgt_epi8(aChunk, aHigh));
+        unsigned int aMask = static_cast<unsigned int>(_mm_movemask_epi8(aOutside));
+        if (aMask != 0)
+        {
+            return aLength + static_cast<size_t>(std::countr_zero(aMask));
+        }
+        aLength += 16;
+    }
+#endif
+
+    while (aLength < iData.size() && iData[aLength] >= '0' && iData[aLength] <= '9')
+    {
+        ++aLength;
+    }
+    return aLength;
+}
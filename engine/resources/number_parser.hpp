@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+#include <optional>
+#include <string_view>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define ENGINE_SIMD_SSE2
+#endif
+
+/**
+ * Allocation-free numeric token parsing shared by the text asset loaders (OBJ, MTL, ...).
+ * Every function reads from the front of the given view and, on success, removes the token from it.
+ * On failure the view is left untouched.
+ *
+ * Parsing is locale independent: '.' is the only decimal separator, a leading '+' or '-' is accepted
+ * and exponents ("1e-5", "2.5E+3") are supported.
+ */
+namespace tools
+{
+    std::optional<float> ParseFloat(std::string_view &ioData);
+    std::optional<int> ParseInt(std::string_view &ioData);
+
+    // length of the run of '0'-'9' characters at the front of the view (SSE2 accelerated when available)
+    size_t ScanDigits(std::string_view iData);
+};
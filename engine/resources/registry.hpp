@@ -41,6 +41,18 @@ public:
         return aResource;
     }
 
+    // registers an already built resource, if iId is taken the registered one is kept and returned
+    std::shared_ptr<T> Add(const std::string &iId, std::shared_ptr<T> iResource)
+    {
+        auto [aResourceIterator, aInserted] = m_resources.try_emplace(iId, ResourceEntry{std::move(iResource)});
+        return aResourceIterator->second.Ref;
+    }
+
+    bool Contains(const std::string &iId) const
+    {
+        return m_resources.find(iId) != m_resources.end();
+    }
+
     /**
      * Unregister a resource from the registry by its ID.
      * If the resource is held somewhere else, it will not delete the resource in memory until no one else holds a reference to it.
@@ -0,0 +1,74 @@
+#include "source_stamp.hpp"
+
+#include <atomic>
+#include <filesystem>
+#include <random>
+#include <system_error>
+
+#include "mapped_file.hpp"
+#include "helpers/hash.hpp"
+
+bool tools::StampSource(SourceStamp &oStamp, const std::string &iSourcePath)
+{
+    std::error_code aError;
+    uintmax_t aSize = std::filesystem::file_size(iSourcePath, aError);
+    if (aError)
+    {
+        return false;
+    }
+    std::filesystem::file_time_type aTime = std::filesystem::last_write_time(iSourcePath, aError);
+    if (aError)
+    {
+        return false;
+    }
+
+    MappedFile aFile(iSourcePath);
+    if (!aFile.IsOpen())
+    {
+        return false;
+    }
+
+    oStamp.size = static_cast<uint64_t>(aSize);
+    oStamp.time = static_cast<int64_t>(aTime.time_since_epoch().count());
+    oStamp.hash = HashBytes(aFile.GetView());
+    return true;
+}
+
+bool tools::IsStampFresh(SourceStamp &ioStamp, const std::string &iSourcePath, bool &oRestamped)
+{
+    oRestamped = false;
+
+    std::error_code aError;
+    uintmax_t aSize = std::filesystem::file_size(iSourcePath, aError);
+    if (aError || aSize != ioStamp.size)
+    {
+        return false;
+    }
+    std::filesystem::file_time_type aTime = std::filesystem::last_write_time(iSourcePath, aError);
+    if (aError)
+    {
+        return false;
+    }
+    if (static_cast<int64_t>(aTime.time_since_epoch().count()) == ioStamp.time)
+    {
+        return true;
+    }
+
+    SourceStamp aCurrent;
+    if (!StampSource(aCurrent, iSourcePath) || aCurrent.hash != ioStamp.hash)
+    {
+        return false;
+    }
+
+    ioStamp = aCurrent;
+    oRestamped = true;
+    return true;
+}
+
+std::string tools::GetTemporaryPath(const std::string &iPath)
+{
+    // random per process for the other processes cooking the same file, counted for the other threads
+    static const uint64_t PROCESS = (static_cast<uint64_t>(std::random_device()()) << 32) | std::random_device()();
+    static std::atomic<uint64_t> sCount = 0;
+    return iPath + "." + std::to_string(PROCESS) + "-" + std::to_string(sCount++) + ".tmp";
+}
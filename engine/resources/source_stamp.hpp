@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+/**
+ * Identity of the source file a cooked asset was produced from, stored in the header of every cooked file.
+ * Size and modification time are compared first, the content hash only decides when the time changed
+ * without the size changing (checkout, copy, touch, ...).
+ */
+struct SourceStamp
+{
+    uint64_t size = 0;
+    int64_t time = 0;
+    uint64_t hash = 0;
+};
+
+namespace tools
+{
+    // fills oStamp from the current state of the source file
+    bool StampSource(SourceStamp &oStamp, const std::string &iSourcePath);
+
+    /**
+     * Whether the source still matches ioStamp. When only the modification time differs and the content
+     * is unchanged, ioStamp is updated and oRestamped is set so the caller can write it back.
+     */
+    bool IsStampFresh(SourceStamp &ioStamp, const std::string &iSourcePath, bool &oRestamped);
+
+    /**
+     * Path to write a cooked file aside before renaming it over iPath, so that a reader never sees a partial
+     * file. Unique per call, two cooks of the same file (pool threads, engine-cook) never share it.
+     */
+    std::string GetTemporaryPath(const std::string &iPath);
+};
@@ -0,0 +1,146 @@
+#include "texture_cache.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <system_error>
+
+#include "fileloader.hpp"
+#include "block_compression.hpp"
+#include "core/thread_pool.hpp"
+#include "helpers/log.hpp"
+
+namespace
+{
+    // done on the texels rather than with stbi_set_flip_vertically_on_load, a global that isn't safe to change while decoding in parallel
+    bool flipVertically(Image &ioImage)
+    {
+        if (ioImage.encoding != Image::Encoding::RAW)
+        {
+            return BlockCompression::FlipVertically(ioImage);
+        }
+        for (size_t aLevel = 0; aLevel < ioImage.levels.size(); aLevel++)
+        {
+            size_t aWidth = static_cast<size_t>(std::max(1, ioImage.width >> aLevel));
+            size_t aHeight = static_cast<size_t>(std::max(1, ioImage.height >> aLevel));
+            size_t aRow = aWidth * ioImage.channels;
+            unsigned char *aTexels = ioImage.levels[aLevel].data();
+            for (size_t y = 0; y < aHeight / 2; y++)
+            {
+                std::swap_ranges(aTexels + y * aRow, aTexels + (y + 1) * aRow, aTexels + (aHeight - 1 - y) * aRow);
+            }
+        }
+        return true;
+    }
+}
+
+TextureCache &TextureCache::Get()
+{
+    static TextureCache aCache;
+    return aCache;
+}
+
+TextureCache::Key TextureCache::MakeKey(const std::string &iPath, uint32_t iFlags)
+{
+    std::error_code aError;
+    std::filesystem::path aCanonical = std::filesystem::weakly_canonical(iPath, aError);
+    return {aError ? iPath : aCanonical.generic_string(), iFlags};
+}
+
+std::optional<Texture> TextureCache::Find(const Key &iKey) const
+{
+    std::lock_guard<std::mutex> aLock(m_mutex);
+    const GLTexture *aTexture = m_textures.Find(iKey);
+    if (!aTexture)
+    {
+        return {};
+    }
+
+    Texture aResult;
+    aResult.id = aTexture->Get();
+    aResult.path = iKey.path;
+    return aResult;
+}
+
+std::vector<std::optional<Image>> TextureCache::Decode(const std::vector<Key> &iKeys) const
+{
+    std::vector<std::optional<Image>> aImages(iKeys.size());
+    ThreadPool::Get().ParallelFor(iKeys.size(), [&](size_t i)
+                                  {
+                                      const Key &aKey = iKeys[i];
+                                      if (Find(aKey))
+                                      {
+                                          return;
+                                      }
+                                      aImages[i] = tools::DecodeTexture(aKey.path);
+                                      if (aImages[i] && (aKey.flags & FLIP_VERTICALLY) && !flipVertically(*aImages[i]))
+                                      {
+                                          WARNING("Texture can't be flipped, uploaded as it is: " << aKey.path);
+                                      } });
+    return aImages;
+}
+
+std::optional<Texture> TextureCache::Upload(const Key &iKey, const Image &iImage)
+{
+    if (std::optional<Texture> aCached = Find(iKey))
+    {
+        return aCached;
+    }
+
+    GLTexture aTexture = tools::UploadTexture(iImage, iKey.path);
+    if (!aTexture)
+    {
+        return {};
+    }
+
+    Texture aResult;
+    aResult.path = iKey.path;
+    {
+        std::lock_guard<std::mutex> aLock(m_mutex);
+        aResult.id = m_textures.TryEmplace(iKey, std::move(aTexture)).first->Get();
+    }
+    return aResult;
+}
+
+std::vector<std::optional<Texture>> TextureCache::Load(const std::vector<std::string> &iPaths, uint32_t iFlags)
+{
+    // decode every distinct file once
+    std::vector<Key> aKeys;
+    std::vector<size_t> aSlots(iPaths.size());
+    FlatHashMap<Key, size_t, KeyHash> aUnique(iPaths.size());
+    for (size_t i = 0; i < iPaths.size(); i++)
+    {
+        Key aKey = MakeKey(iPaths[i], iFlags);
+        auto [aSlot, aInserted] = aUnique.TryEmplace(aKey, aKeys.size());
+        if (aInserted)
+        {
+            aKeys.push_back(std::move(aKey));
+        }
+        aSlots[i] = *aSlot;
+    }
+
+    std::vector<std::optional<Image>> aImages = Decode(aKeys);
+
+    std::vector<std::optional<Texture>> aUploaded(aKeys.size());
+    for (size_t i = 0; i < aKeys.size(); i++)
+    {
+        aUploaded[i] = aImages[i] ? Upload(aKeys[i], *aImages[i]) : Find(aKeys[i]);
+    }
+
+    std::vector<std::optional<Texture>> aTextures(iPaths.size());
+    for (size_t i = 0; i < iPaths.size(); i++)
+    {
+        aTextures[i] = aUploaded[aSlots[i]];
+    }
+    return aTextures;
+}
+
+std::optional<Texture> TextureCache::Load(const std::string &iPath, uint32_t iFlags)
+{
+    return Load(std::vector<std::string>{iPath}, iFlags)[0];
+}
+
+void TextureCache::Clear()
+{
+    std::lock_guard<std::mutex> aLock(m_mutex);
+    m_textures.Clear();
+}
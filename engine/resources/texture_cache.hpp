@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <optional>
+
+#include "image.hpp"
+#include "render/mesh.hpp"
+#include "render/gl_object.hpp"
+#include "helpers/flat_hash_map.hpp"
+
+/**
+ * GL textures shared by every loader, keyed by canonical path and import flags, so a file referenced by
+ * many materials is decoded and uploaded exactly once. The cache owns the textures, the Texture it hands out
+ * stay valid until Clear.
+ * Decoding is thread safe and runs in parallel on the thread pool, uploading (and anything returning a
+ * Texture) must happen on the GL thread.
+ */
+class TextureCache
+{
+public:
+    enum Flags : uint32_t
+    {
+        NONE = 0,
+        FLIP_VERTICALLY = 1 << 0,
+    };
+
+    struct Key
+    {
+        std::string path;
+        uint32_t flags = NONE;
+
+        bool operator==(const Key &iOther) const noexcept
+        {
+            return flags == iOther.flags && path == iOther.path;
+        }
+    };
+
+    struct KeyHash
+    {
+        size_t operator()(const Key &iKey) const noexcept
+        {
+            return std::hash<std::string>{}(iKey.path) ^ (static_cast<size_t>(iKey.flags) * 0x9e3779b97f4a7c15ull);
+        }
+    };
+
+    // engine wide cache, textures belong to the single GL context
+    static TextureCache &Get();
+
+    static Key MakeKey(const std::string &iPath, uint32_t iFlags = NONE);
+
+    // thread safe
+    std::optional<Texture> Find(const Key &iKey) const;
+
+    /**
+     * CPU side, thread safe: decodes the keys that aren't cached yet in parallel.
+     * Entries of cached keys or of files that failed to decode are empty.
+     */
+    std::vector<std::optional<Image>> Decode(const std::vector<Key> &iKeys) const;
+
+    // GL thread: uploads and caches a decoded image, keeps the cached texture if another load won the race
+    std::optional<Texture> Upload(const Key &iKey, const Image &iImage);
+
+    // GL thread: decodes the missing textures in parallel then uploads them one after the other
+    std::vector<std::optional<Texture>> Load(const std::vector<std::string> &iPaths, uint32_t iFlags = NONE);
+    std::optional<Texture> Load(const std::string &iPath, uint32_t iFlags = NONE);
+
+    // GL thread: deletes every cached texture
+    void Clear();
+
+private:
+    mutable std::mutex m_mutex;
+    FlatHashMap<Key, GLTexture, KeyHash> m_textures;
+};
@@ -0,0 +1,37 @@
+#include "upload_queue.hpp"
+
+void UploadQueue::Push(Job iJob)
+{
+    std::lock_guard<std::mutex> aLock(m_mutex);
+    m_jobs.push_back(std::move(iJob));
+}
+
+size_t UploadQueue::Drain(std::chrono::microseconds iBudget)
+{
+    auto aStart = std::chrono::steady_clock::now();
+    size_t aCount = 0;
+    do
+    {
+        Job aJob;
+        {
+            std::lock_guard<std::mutex> aLock(m_mutex);
+            if (m_jobs.empty())
+            {
+                break;
+            }
+            aJob = std::move(m_jobs.front());
+            m_jobs.pop_front();
+        }
+        // run outside of the lock, workers keep pushing meanwhile
+        aJob();
+        aCount++;
+    } while (std::chrono::steady_clock::now() - aStart < iBudget);
+
+    return aCount;
+}
+
+bool UploadQueue::Empty() const
+{
+    std::lock_guard<std::mutex> aLock(m_mutex);
+    return m_jobs.empty();
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <mutex>
+
+/**
+ * Jobs that need the GL context, pushed by workers once their CPU side is done and run by the GL thread
+ * in push order. The GL thread drains the queue once per frame under a time budget so that large loads
+ * are spread over several frames instead of freezing the window.
+ */
+class UploadQueue
+{
+public:
+    using Job = std::function<void()>;
+
+    // thread safe
+    void Push(Job iJob);
+
+    /**
+     * Runs queued jobs until iBudget is spent, always at least one so loading keeps progressing.
+     * Must be called from the GL thread, returns the number of jobs run.
+     */
+    size_t Drain(std::chrono::microseconds iBudget);
+
+    bool Empty() const;
+
+private:
+    mutable std::mutex m_mutex;
+    std::deque<Job> m_jobs;
+};